@@ -23,6 +23,12 @@ inline bool IsValid(const OpcUa_EventNotificationList& notification) {
 }
 
 inline bool IsValid(const OpcUa_ExtensionObject& extension_object) {
+  // Body encoded ahead, as by SharedExtensionObject.
+  if (extension_object.Encoding == OpcUa_ExtensionObjectEncoding_Binary) {
+    assert(extension_object.Body.Binary.Length > 0);
+    return extension_object.Body.Binary.Length > 0;
+  }
+
   assert(extension_object.Encoding ==
          OpcUa_ExtensionObjectEncoding_EncodeableObject);
   if (extension_object.Encoding !=
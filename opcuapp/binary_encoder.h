@@ -4,9 +4,20 @@
 #include <opcua_binaryencoder.h>
 #include <opcuapp/status_code.h>
 #include <cassert>
+#include <vector>
 
 namespace opcua {
 
+#define BINARY_ENCODER_WRITE(EncodeType)                                 \
+  template <>                                                            \
+  inline void BinaryEncoder::Write(const OpcUa_##EncodeType& value,      \
+                                   OpcUa_StringA field_name) const {     \
+    assert(encode_context_);                                             \
+    Check(encoder_->Write##EncodeType(                                   \
+        reinterpret_cast<OpcUa_Encoder*>(encode_context_), field_name,   \
+        &const_cast<OpcUa_##EncodeType&>(value), OpcUa_Null));           \
+  }
+
 class BinaryEncoder {
  public:
   BinaryEncoder() { Check(::OpcUa_BinaryEncoder_Create(&encoder_)); }
@@ -39,6 +50,16 @@ class BinaryEncoder {
       *size = static_cast<size_t>(int_size);
   }
 
+  template <typename T>
+  void Write(const T& value, OpcUa_StringA field_name = nullptr) const;
+
+  template <typename T>
+  void WriteArray(const std::vector<T>& array) const {
+    Write<Int32>(static_cast<Int32>(array.size()));
+    for (auto& v : array)
+      Write<T>(v);
+  }
+
   void WriteEncodable(const OpcUa_EncodeableType& type,
                       const OpcUa_Void* object,
                       const char* field_name = nullptr,
@@ -60,4 +81,17 @@ class BinaryEncoder {
   OpcUa_Handle encode_context_ = OpcUa_Null;
 };
 
+BINARY_ENCODER_WRITE(Boolean);
+BINARY_ENCODER_WRITE(SByte);
+BINARY_ENCODER_WRITE(Int32);
+BINARY_ENCODER_WRITE(UInt32);
+BINARY_ENCODER_WRITE(Double);
+BINARY_ENCODER_WRITE(String);
+BINARY_ENCODER_WRITE(NodeId);
+BINARY_ENCODER_WRITE(ExpandedNodeId);
+BINARY_ENCODER_WRITE(QualifiedName);
+BINARY_ENCODER_WRITE(LocalizedText);
+BINARY_ENCODER_WRITE(ExtensionObject);
+BINARY_ENCODER_WRITE(DiagnosticInfo);
+
 }  // namespace opcua
@@ -0,0 +1,581 @@
+#pragma once
+
+// Before binary_decoder.h, which can't be included first.
+#include <opcuapp/data_value.h>
+
+#include <opcuapp/binary_decoder.h>
+#include <opcuapp/span.h>
+#include <opcuapp/stream.h>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__BYTE_ORDER__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "BinaryReader copies values in host byte order");
+#endif
+
+namespace opcua {
+
+// Binary decoder reading straight from a buffer, with the interface of
+// BinaryDecoder. Primitives are read inline instead of through the stack
+// decoder and its stream, and arrays of plain data are bounds-checked and
+// copied at once. ExtensionObjects are still decoded by the stack, as their
+// bodies need the known types of |context|.
+//
+// Array lengths are limited by |context|.MaxArrayLength, if set, and
+// nesting of Variants, DataValues and DiagnosticInfos by |kMaxDepth|.
+// Assumes a little-endian host.
+class BinaryReader {
+ public:
+  static const UInt32 kMaxDepth = 100;
+
+  BinaryReader(Span<const char> data, OpcUa_MessageContext& context)
+      : data_{data}, context_{context} {}
+
+  BinaryReader(const BinaryReader&) = delete;
+  BinaryReader& operator=(const BinaryReader&) = delete;
+
+  using NamespaceMapping = BinaryDecoder::NamespaceMapping;
+
+  void set_namespace_mapping(NamespaceMapping mapping) {
+    namespace_mapping_ = std::move(mapping);
+  }
+
+  bool at_end() const { return pos_ == data_.size(); }
+
+  template <typename T>
+  T Read() {
+    static_assert(std::is_arithmetic<T>::value, "Unsupported type");
+    T value;
+    std::memcpy(&value, Take(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  template <typename T>
+  T ReadEnum() {
+    return static_cast<T>(Read<Int32>());
+  }
+
+  template <typename T>
+  std::vector<T> ReadArray() {
+    auto len = Read<Int32>();
+    if (len <= 0)
+      return {};
+    CheckArrayLength(len);
+    return ReadElements<T>(len, std::is_arithmetic<T>{});
+  }
+
+  // Views into the data, valid as long as it is. Null reads as a view with
+  // no data.
+  Span<const char> ReadStringView();
+  Span<const char> ReadByteStringView() { return ReadStringView(); }
+
+ private:
+  template <typename T>
+  std::vector<T> ReadElements(Int32 len, std::true_type) {
+    std::vector<T> array(static_cast<size_t>(len));
+    std::memcpy(array.data(), Take(sizeof(T) * array.size()),
+                sizeof(T) * array.size());
+    return array;
+  }
+
+  template <typename T>
+  std::vector<T> ReadElements(Int32 len, std::false_type) {
+    // Each element takes at least a byte.
+    Take(0, static_cast<size_t>(len));
+    std::vector<T> array;
+    array.reserve(static_cast<size_t>(len));
+    for (Int32 i = 0; i < len; ++i)
+      array.emplace_back(Read<T>());
+    return array;
+  }
+
+  // Values whose encoding is their little-endian memory layout.
+  template <typename T>
+  using IsPlain = std::integral_constant<
+      bool,
+      std::is_arithmetic<T>::value || std::is_same<T, OpcUa_Guid>::value ||
+          std::is_same<T, OpcUa_DateTime>::value>;
+
+  // Counts the nesting of values that can contain themselves.
+  class Nesting {
+   public:
+    explicit Nesting(UInt32& depth) : depth_{depth} {
+      if (++depth_ > kMaxDepth) {
+        --depth_;
+        Check(OpcUa_BadEncodingLimitsExceeded);
+      }
+    }
+    ~Nesting() { --depth_; }
+
+    Nesting(const Nesting&) = delete;
+    Nesting& operator=(const Nesting&) = delete;
+
+   private:
+    UInt32& depth_;
+  };
+
+  void CheckArrayLength(std::uint64_t length) const {
+    const std::uint64_t max_length =
+        context_.MaxArrayLength != 0
+            ? context_.MaxArrayLength
+            : std::numeric_limits<Int32>::max();
+    if (length > max_length)
+      Check(OpcUa_BadEncodingLimitsExceeded);
+  }
+
+  // Checks that |size| bytes, and |reserve| more after them, are left.
+  const char* Take(size_t size, size_t reserve = 0) {
+    if (size + reserve > data_.size() - pos_)
+      Check(OpcUa_BadDecodingError);
+    auto* data = data_.data() + pos_;
+    pos_ += size;
+    return data;
+  }
+
+  template <typename T>
+  void ReadRaw(T& value) {
+    std::memcpy(&value, Take(sizeof(value)), sizeof(value));
+  }
+
+  // |value| is initialized, and stays clearable if a read throws.
+  void ReadValue(OpcUa_String& value);
+  void ReadValue(OpcUa_ByteString& value);
+  void ReadValue(OpcUa_Guid& value) { ReadRaw(value); }
+  void ReadValue(OpcUa_DateTime& value) { ReadRaw(value); }
+  void ReadValue(OpcUa_NodeId& value) { ReadNodeId(value); }
+  void ReadValue(OpcUa_ExpandedNodeId& value);
+  void ReadValue(OpcUa_QualifiedName& value);
+  void ReadValue(OpcUa_LocalizedText& value);
+  void ReadValue(OpcUa_ExtensionObject& value);
+  void ReadValue(OpcUa_DataValue& value);
+  void ReadValue(OpcUa_Variant& value);
+  void ReadValue(OpcUa_DiagnosticInfo& value);
+
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value>::type ReadValue(
+      T& value) {
+    ReadRaw(value);
+  }
+
+  // Returns the encoding flags above the identifier type.
+  Byte ReadNodeId(OpcUa_NodeId& value);
+
+  template <typename T>
+  void ReadPointee(T*& value) {
+    value = detail::AllocateValues<T>(1);
+    ReadValue(*value);
+  }
+
+  template <typename T>
+  void ReadVariantArray(Int32 length, T*& values) {
+    if (length <= 0)
+      return;
+    CheckArrayLength(static_cast<std::uint64_t>(length));
+    ReadVariantArray(length, values, IsPlain<T>{});
+  }
+
+  template <typename T>
+  void ReadVariantArray(Int32 length, T*& values, std::true_type) {
+    const auto size = sizeof(T) * static_cast<size_t>(length);
+    const auto* data = Take(size);
+    values = detail::AllocateValues<T>(length);
+    std::memcpy(values, data, size);
+  }
+
+  template <typename T>
+  void ReadVariantArray(Int32 length, T*& values, std::false_type) {
+    // Each element takes at least a byte.
+    Take(0, static_cast<size_t>(length));
+    values = detail::AllocateValues<T>(length);
+    for (Int32 i = 0; i < length; ++i)
+      ReadValue(values[i]);
+  }
+
+  void ReadVariantArray(Byte datatype,
+                        Int32 length,
+                        OpcUa_VariantArrayUnion& values);
+  void ReadVariantScalar(Byte datatype, OpcUa_VariantUnion& value);
+
+  NamespaceIndex MapNamespaceIndex(NamespaceIndex namespace_index) const {
+    auto i = namespace_mapping_.find(namespace_index);
+    return i == namespace_mapping_.end() ? namespace_index : i->second;
+  }
+
+  const Span<const char> data_;
+  size_t pos_ = 0;
+  OpcUa_MessageContext& context_;
+  NamespaceMapping namespace_mapping_;
+  UInt32 depth_ = 0;
+};
+
+#define BINARY_READER_READ(DecodeType)                 \
+  template <>                                          \
+  inline DecodeType BinaryReader::Read<DecodeType>() { \
+    DecodeType value;                                  \
+    ReadValue(value.get());                            \
+    return value;                                      \
+  }
+
+BINARY_READER_READ(String);
+BINARY_READER_READ(QualifiedName);
+BINARY_READER_READ(LocalizedText);
+BINARY_READER_READ(ExtensionObject);
+BINARY_READER_READ(DataValue);
+BINARY_READER_READ(Variant);
+
+#undef BINARY_READER_READ
+
+template <>
+inline StatusCode BinaryReader::Read<StatusCode>() {
+  return Read<OpcUa_StatusCode>();
+}
+
+// Namespaces of top-level node ids are mapped, as in BinaryDecoder.
+template <>
+inline NodeId BinaryReader::Read<NodeId>() {
+  NodeId value;
+  ReadValue(value.get());
+  value.get().NamespaceIndex = MapNamespaceIndex(value.get().NamespaceIndex);
+  return value;
+}
+
+template <>
+inline ExpandedNodeId BinaryReader::Read<ExpandedNodeId>() {
+  ExpandedNodeId value;
+  auto& node_id = value.get().NodeId;
+  ReadValue(value.get());
+  node_id.NamespaceIndex = MapNamespaceIndex(node_id.NamespaceIndex);
+  return value;
+}
+
+template <>
+inline ByteString BinaryReader::Read<ByteString>() {
+  OpcUa_ByteString value;
+  ::OpcUa_ByteString_Initialize(&value);
+  ReadValue(value);
+  return ByteString{std::move(value)};
+}
+
+inline Span<const char> BinaryReader::ReadStringView() {
+  const auto length = Read<Int32>();
+  if (length < 0)
+    return {nullptr, 0};
+  return {Take(static_cast<size_t>(length)), static_cast<size_t>(length)};
+}
+
+inline void BinaryReader::ReadValue(OpcUa_String& value) {
+  const auto view = ReadStringView();
+  if (view.data()) {
+    Check(::OpcUa_String_AttachToString(
+        const_cast<OpcUa_StringA>(view.data()),
+        static_cast<UInt32>(view.size()), 0, OpcUa_True, OpcUa_True, &value));
+  } else {
+    ::OpcUa_String_Initialize(&value);
+  }
+}
+
+inline void BinaryReader::ReadValue(OpcUa_ByteString& value) {
+  const auto length = Read<Int32>();
+  value.Length = length < 0 ? -1 : length;
+  if (length <= 0)
+    return;
+  const auto* data = Take(static_cast<size_t>(length));
+  value.Data = detail::AllocateValues<Byte>(length);
+  std::memcpy(value.Data, data, static_cast<size_t>(length));
+}
+
+inline Byte BinaryReader::ReadNodeId(OpcUa_NodeId& value) {
+  const auto encoding = Read<Byte>();
+  switch (encoding & 0x3F) {
+    case 0x00:
+      value.Identifier.Numeric = Read<Byte>();
+      break;
+    case 0x01: {
+      const auto* data = Take(3);
+      value.NamespaceIndex = static_cast<Byte>(data[0]);
+      UInt16 id;
+      std::memcpy(&id, data + 1, sizeof(id));
+      value.Identifier.Numeric = id;
+      break;
+    }
+    case 0x02: {
+      const auto* data = Take(6);
+      std::memcpy(&value.NamespaceIndex, data, 2);
+      std::memcpy(&value.Identifier.Numeric, data + 2, 4);
+      break;
+    }
+    case 0x03:
+      value.NamespaceIndex = Read<UInt16>();
+      value.IdentifierType = OpcUa_IdentifierType_String;
+      ReadValue(value.Identifier.String);
+      break;
+    case 0x04:
+      value.NamespaceIndex = Read<UInt16>();
+      value.IdentifierType = OpcUa_IdentifierType_Guid;
+      ReadPointee(value.Identifier.Guid);
+      break;
+    case 0x05:
+      value.NamespaceIndex = Read<UInt16>();
+      value.IdentifierType = OpcUa_IdentifierType_Opaque;
+      ReadValue(value.Identifier.ByteString);
+      break;
+    default:
+      Check(OpcUa_BadDecodingError);
+  }
+  return static_cast<Byte>(encoding & 0xC0);
+}
+
+inline void BinaryReader::ReadValue(OpcUa_ExpandedNodeId& value) {
+  const auto flags = ReadNodeId(value.NodeId);
+  if (flags & 0x80)
+    ReadValue(value.NamespaceUri);
+  if (flags & 0x40)
+    value.ServerIndex = Read<UInt32>();
+}
+
+inline void BinaryReader::ReadValue(OpcUa_QualifiedName& value) {
+  value.NamespaceIndex = Read<UInt16>();
+  ReadValue(value.Name);
+}
+
+inline void BinaryReader::ReadValue(OpcUa_LocalizedText& value) {
+  const auto mask = Read<Byte>();
+  if (mask & 0x01)
+    ReadValue(value.Locale);
+  if (mask & 0x02)
+    ReadValue(value.Text);
+}
+
+inline void BinaryReader::ReadValue(OpcUa_ExtensionObject& value) {
+  // Finds the end of the object, and lets the stack decode the body.
+  const auto start = pos_;
+  {
+    NodeId type_id;
+    ReadNodeId(type_id.get());
+  }
+  const auto encoding = Read<Byte>();
+  if (encoding != 0x00)
+    ReadStringView();
+
+  MemoryInputStream stream{data_.data() + start, pos_ - start};
+  BinaryDecoder decoder;
+  decoder.Open(stream.get(), context_);
+  decoder.Read<ExtensionObject>().release(value);
+}
+
+inline void BinaryReader::ReadValue(OpcUa_DataValue& value) {
+  const Nesting nesting{depth_};
+  const auto mask = Read<Byte>();
+  if (mask & 0x01)
+    ReadValue(value.Value);
+  if (mask & 0x02)
+    value.StatusCode = Read<OpcUa_StatusCode>();
+  if (mask & 0x04)
+    ReadRaw(value.SourceTimestamp);
+  if (mask & 0x10)
+    value.SourcePicoseconds = Read<UInt16>();
+  if (mask & 0x08)
+    ReadRaw(value.ServerTimestamp);
+  if (mask & 0x20)
+    value.ServerPicoseconds = Read<UInt16>();
+}
+
+inline void BinaryReader::ReadValue(OpcUa_Variant& value) {
+  const Nesting nesting{depth_};
+  const auto encoding = Read<Byte>();
+  const auto datatype = static_cast<Byte>(encoding & 0x3F);
+  if (datatype > OpcUaType_DiagnosticInfo)
+    Check(OpcUa_BadDecodingError);
+  value.Datatype = datatype;
+
+  if (!(encoding & 0x80)) {
+    ReadVariantScalar(datatype, value.Value);
+    return;
+  }
+
+  const auto length = Read<Int32>();
+  if (!(encoding & 0x40)) {
+    value.ArrayType = OpcUa_VariantArrayType_Array;
+    value.Value.Array.Length = length < 0 ? -1 : length;
+    ReadVariantArray(datatype, length, value.Value.Array.Value);
+    return;
+  }
+
+  // The dimensions follow the elements.
+  auto& matrix = value.Value.Matrix;
+  OpcUa_VariantArrayUnion elements = {};
+  try {
+    ReadVariantArray(datatype, length, elements);
+    const auto dimension_count = Read<Int32>();
+    const auto* data =
+        dimension_count > 0 ? Take(sizeof(Int32) * dimension_count) : nullptr;
+    // Checked at each step, so the product can't overflow.
+    std::uint64_t element_count = dimension_count > 0 ? 1 : 0;
+    for (Int32 i = 0; i < dimension_count; ++i) {
+      Int32 dimension;
+      std::memcpy(&dimension, data + sizeof(Int32) * i, sizeof(dimension));
+      if (dimension < 0)
+        Check(OpcUa_BadDecodingError);
+      element_count *= static_cast<std::uint64_t>(dimension);
+      CheckArrayLength(element_count);
+    }
+    if (element_count != static_cast<std::uint64_t>(length < 0 ? 0 : length))
+      Check(OpcUa_BadDecodingError);
+    if (dimension_count > 0) {
+      auto* dimensions = detail::AllocateValues<Int32>(dimension_count);
+      std::memcpy(dimensions, data, sizeof(Int32) * dimension_count);
+      matrix.Dimensions = dimensions;
+      matrix.NoOfDimensions = dimension_count;
+    }
+  } catch (...) {
+    // The elements can't be cleared without matching dimensions.
+    OpcUa_Variant array;
+    ::OpcUa_Variant_Initialize(&array);
+    array.Datatype = datatype;
+    array.ArrayType = OpcUa_VariantArrayType_Array;
+    array.Value.Array.Length = length;
+    array.Value.Array.Value = elements;
+    ::OpcUa_Variant_Clear(&array);
+    throw;
+  }
+  value.ArrayType = OpcUa_VariantArrayType_Matrix;
+  matrix.Value = elements;
+}
+
+inline void BinaryReader::ReadVariantScalar(Byte datatype,
+                                            OpcUa_VariantUnion& value) {
+  switch (datatype) {
+    case OpcUaType_Null:
+      return;
+    case OpcUaType_Boolean:
+      return ReadRaw(value.Boolean);
+    case OpcUaType_SByte:
+      return ReadRaw(value.SByte);
+    case OpcUaType_Byte:
+      return ReadRaw(value.Byte);
+    case OpcUaType_Int16:
+      return ReadRaw(value.Int16);
+    case OpcUaType_UInt16:
+      return ReadRaw(value.UInt16);
+    case OpcUaType_Int32:
+      return ReadRaw(value.Int32);
+    case OpcUaType_UInt32:
+      return ReadRaw(value.UInt32);
+    case OpcUaType_Int64:
+      return ReadRaw(value.Int64);
+    case OpcUaType_UInt64:
+      return ReadRaw(value.UInt64);
+    case OpcUaType_Float:
+      return ReadRaw(value.Float);
+    case OpcUaType_Double:
+      return ReadRaw(value.Double);
+    case OpcUaType_String:
+      return ReadValue(value.String);
+    case OpcUaType_DateTime:
+      return ReadRaw(value.DateTime);
+    case OpcUaType_Guid:
+      return ReadPointee(value.Guid);
+    case OpcUaType_ByteString:
+      return ReadValue(value.ByteString);
+    case OpcUaType_XmlElement:
+      return ReadValue(value.XmlElement);
+    case OpcUaType_NodeId:
+      return ReadPointee(value.NodeId);
+    case OpcUaType_ExpandedNodeId:
+      return ReadPointee(value.ExpandedNodeId);
+    case OpcUaType_StatusCode:
+      return ReadRaw(value.StatusCode);
+    case OpcUaType_QualifiedName:
+      return ReadPointee(value.QualifiedName);
+    case OpcUaType_LocalizedText:
+      return ReadPointee(value.LocalizedText);
+    case OpcUaType_ExtensionObject:
+      return ReadPointee(value.ExtensionObject);
+    case OpcUaType_DataValue:
+      return ReadPointee(value.DataValue);
+    default:
+      Check(OpcUa_BadDecodingError);
+  }
+}
+
+inline void BinaryReader::ReadVariantArray(Byte datatype,
+                                           Int32 length,
+                                           OpcUa_VariantArrayUnion& values) {
+  switch (datatype) {
+    case OpcUaType_Boolean:
+      return ReadVariantArray(length, values.BooleanArray);
+    case OpcUaType_SByte:
+      return ReadVariantArray(length, values.SByteArray);
+    case OpcUaType_Byte:
+      return ReadVariantArray(length, values.ByteArray);
+    case OpcUaType_Int16:
+      return ReadVariantArray(length, values.Int16Array);
+    case OpcUaType_UInt16:
+      return ReadVariantArray(length, values.UInt16Array);
+    case OpcUaType_Int32:
+      return ReadVariantArray(length, values.Int32Array);
+    case OpcUaType_UInt32:
+      return ReadVariantArray(length, values.UInt32Array);
+    case OpcUaType_Int64:
+      return ReadVariantArray(length, values.Int64Array);
+    case OpcUaType_UInt64:
+      return ReadVariantArray(length, values.UInt64Array);
+    case OpcUaType_Float:
+      return ReadVariantArray(length, values.FloatArray);
+    case OpcUaType_Double:
+      return ReadVariantArray(length, values.DoubleArray);
+    case OpcUaType_String:
+      return ReadVariantArray(length, values.StringArray);
+    case OpcUaType_DateTime:
+      return ReadVariantArray(length, values.DateTimeArray);
+    case OpcUaType_Guid:
+      return ReadVariantArray(length, values.GuidArray);
+    case OpcUaType_ByteString:
+      return ReadVariantArray(length, values.ByteStringArray);
+    case OpcUaType_XmlElement:
+      return ReadVariantArray(length, values.XmlElementArray);
+    case OpcUaType_NodeId:
+      return ReadVariantArray(length, values.NodeIdArray);
+    case OpcUaType_ExpandedNodeId:
+      return ReadVariantArray(length, values.ExpandedNodeIdArray);
+    case OpcUaType_StatusCode:
+      return ReadVariantArray(length, values.StatusCodeArray);
+    case OpcUaType_QualifiedName:
+      return ReadVariantArray(length, values.QualifiedNameArray);
+    case OpcUaType_LocalizedText:
+      return ReadVariantArray(length, values.LocalizedTextArray);
+    case OpcUaType_ExtensionObject:
+      return ReadVariantArray(length, values.ExtensionObjectArray);
+    case OpcUaType_DataValue:
+      return ReadVariantArray(length, values.DataValueArray);
+    case OpcUaType_Variant:
+      return ReadVariantArray(length, values.VariantArray);
+    default:
+      Check(OpcUa_BadDecodingError);
+  }
+}
+
+inline void BinaryReader::ReadValue(OpcUa_DiagnosticInfo& value) {
+  const Nesting nesting{depth_};
+  const auto mask = Read<Byte>();
+  if (mask & 0x01)
+    value.SymbolicId = Read<Int32>();
+  if (mask & 0x02)
+    value.NamespaceUri = Read<Int32>();
+  if (mask & 0x08)
+    value.Locale = Read<Int32>();
+  if (mask & 0x04)
+    value.LocalizedText = Read<Int32>();
+  if (mask & 0x10)
+    ReadValue(value.AdditionalInfo);
+  if (mask & 0x20)
+    value.InnerStatusCode = Read<OpcUa_StatusCode>();
+  if (mask & 0x40)
+    ReadPointee(value.InnerDiagnosticInfo);
+}
+
+}  // namespace opcua
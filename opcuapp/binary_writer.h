@@ -0,0 +1,534 @@
+#pragma once
+
+#include <opcuapp/binary_encoder.h>
+#include <opcuapp/status_code.h>
+#include <opcuapp/stream.h>
+#include <opcuapp/variant_matrix.h>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+#include <vector>
+
+#if defined(__BYTE_ORDER__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "BinaryWriter copies values in host byte order");
+#endif
+
+namespace opcua {
+
+// Binary encoding of the value and notification types sent on every
+// Publish, written straight into |data| instead of through the stack
+// encoder one field at a time. The output is the same as BinaryEncoder's.
+// Types that are rare on this path, like non-empty DiagnosticInfos and
+// unknown ExtensionObject bodies, are still encoded by the stack.
+//
+// Without an output buffer, the writer only counts the encoded size.
+//
+// Assumes a little-endian host.
+class BinaryWriter {
+ public:
+  BinaryWriter(std::vector<char>& data, OpcUa_MessageContext& context)
+      : data_{&data}, context_{context} {}
+
+  explicit BinaryWriter(OpcUa_MessageContext& context)
+      : data_{nullptr}, context_{context} {}
+
+  BinaryWriter(const BinaryWriter&) = delete;
+  BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+  // Bytes written so far.
+  size_t size() const { return size_; }
+
+  template <class T>
+  typename std::enable_if<std::is_arithmetic<T>::value>::type Write(
+      T value) {
+    WriteRaw(&value, sizeof(value));
+  }
+
+  void Write(const OpcUa_DateTime& value) { WriteRaw(&value, sizeof(value)); }
+  void Write(const OpcUa_Guid& value) { WriteRaw(&value, sizeof(value)); }
+
+  void Write(const OpcUa_String& value);
+  void Write(const OpcUa_ByteString& value);
+  void Write(const OpcUa_NodeId& value) { WriteNodeId(value, 0); }
+  void Write(const OpcUa_ExpandedNodeId& value);
+  void Write(const OpcUa_QualifiedName& value);
+  void Write(const OpcUa_LocalizedText& value);
+  void Write(const OpcUa_ExtensionObject& value);
+  void Write(const OpcUa_DataValue& value);
+  void Write(const OpcUa_Variant& value);
+  void Write(const OpcUa_DiagnosticInfo& value);
+
+  void Write(const OpcUa_ResponseHeader& value);
+  void Write(const OpcUa_MonitoredItemNotification& value);
+  void Write(const OpcUa_DataChangeNotification& value);
+  void Write(const OpcUa_EventFieldList& value);
+  void Write(const OpcUa_EventNotificationList& value);
+  void Write(const OpcUa_NotificationMessage& value);
+  void Write(const OpcUa_PublishResponse& value);
+
+  // A null array is written with length -1.
+  template <class T>
+  void WriteArray(const T* values, Int32 count);
+
+ private:
+  // Plain data is written with a single copy.
+  template <class T>
+  struct IsPlain
+      : std::integral_constant<bool,
+                               std::is_arithmetic<T>::value ||
+                                   std::is_same<T, OpcUa_DateTime>::value ||
+                                   std::is_same<T, OpcUa_Guid>::value> {};
+
+  template <class T>
+  void WriteElements(const T* values, Int32 count, std::true_type) {
+    WriteRaw(values, sizeof(T) * static_cast<size_t>(count));
+  }
+
+  template <class T>
+  void WriteElements(const T* values, Int32 count, std::false_type) {
+    for (Int32 i = 0; i < count; ++i)
+      Write(values[i]);
+  }
+
+  void WriteRaw(const void* data, size_t size) {
+    size_ += size;
+    if (!data_)
+      return;
+    // Grows geometrically and copies once, without zeroing the bytes first.
+    const auto required = data_->size() + size;
+    if (required > data_->capacity()) {
+      data_->reserve(std::max({required, 2 * data_->capacity(),
+                               kMinCapacity}));
+    }
+    const auto* bytes = static_cast<const char*>(data);
+    data_->insert(data_->end(), bytes, bytes + size);
+  }
+
+  static const size_t kMinCapacity = 256;
+
+  void WriteNodeId(const OpcUa_NodeId& value, Byte flags);
+  void WriteVariantArray(Byte datatype,
+                         const OpcUa_VariantArrayUnion& values,
+                         Int32 length);
+  void WriteVariantScalar(Byte datatype, const OpcUa_VariantUnion& value);
+
+  template <class T>
+  void WritePointee(const T* value) {
+    if (!value)
+      Check(OpcUa_BadEncodingError);
+    Write(*value);
+  }
+
+  // Returns false if |type| has no native encoding.
+  bool WriteEncodeableBody(const OpcUa_EncodeableType& type,
+                           const void* object);
+
+  template <class Encode>
+  void WriteWithStack(Encode&& encode) {
+    std::vector<char> data;
+    {
+      BinaryEncoder encoder;
+      VectorOutputStream stream{data};
+      encoder.Open(stream.get(), context_);
+      encode(encoder);
+    }
+    WriteRaw(data.data(), data.size());
+  }
+
+  std::vector<char>* const data_;
+  size_t size_ = 0;
+  OpcUa_MessageContext& context_;
+};
+
+template <class T>
+inline void BinaryWriter::WriteArray(const T* values, Int32 count) {
+  if (!values || count < 0) {
+    Write(Int32{-1});
+    return;
+  }
+  Write(count);
+  WriteElements(values, count, IsPlain<T>{});
+}
+
+inline void BinaryWriter::Write(const OpcUa_String& value) {
+  if (::OpcUa_String_IsNull(&value)) {
+    Write(Int32{-1});
+    return;
+  }
+  const auto length = ::OpcUa_String_StrLen(&value);
+  Write(static_cast<Int32>(length));
+  WriteRaw(::OpcUa_String_GetRawString(&value), length);
+}
+
+inline void BinaryWriter::Write(const OpcUa_ByteString& value) {
+  WriteArray(value.Data, value.Length);
+}
+
+inline void BinaryWriter::WriteNodeId(const OpcUa_NodeId& value, Byte flags) {
+  const auto namespace_index = value.NamespaceIndex;
+  switch (value.IdentifierType) {
+    case OpcUa_IdentifierType_Numeric: {
+      const auto id = value.Identifier.Numeric;
+      if (namespace_index == 0 && id <= 0xFF) {
+        Write(static_cast<Byte>(0x00 | flags));
+        Write(static_cast<Byte>(id));
+      } else if (namespace_index <= 0xFF && id <= 0xFFFF) {
+        Write(static_cast<Byte>(0x01 | flags));
+        Write(static_cast<Byte>(namespace_index));
+        Write(static_cast<UInt16>(id));
+      } else {
+        Write(static_cast<Byte>(0x02 | flags));
+        Write(namespace_index);
+        Write(id);
+      }
+      return;
+    }
+    case OpcUa_IdentifierType_String:
+      Write(static_cast<Byte>(0x03 | flags));
+      Write(namespace_index);
+      Write(value.Identifier.String);
+      return;
+    case OpcUa_IdentifierType_Guid:
+      Write(static_cast<Byte>(0x04 | flags));
+      Write(namespace_index);
+      WritePointee(value.Identifier.Guid);
+      return;
+    case OpcUa_IdentifierType_Opaque:
+      Write(static_cast<Byte>(0x05 | flags));
+      Write(namespace_index);
+      Write(value.Identifier.ByteString);
+      return;
+    default:
+      Check(OpcUa_BadEncodingError);
+  }
+}
+
+inline void BinaryWriter::Write(const OpcUa_ExpandedNodeId& value) {
+  const bool has_namespace_uri = !::OpcUa_String_IsNull(&value.NamespaceUri);
+  const bool has_server_index = value.ServerIndex != 0;
+  WriteNodeId(value.NodeId, static_cast<Byte>((has_namespace_uri ? 0x80 : 0) |
+                                              (has_server_index ? 0x40 : 0)));
+  if (has_namespace_uri)
+    Write(value.NamespaceUri);
+  if (has_server_index)
+    Write(value.ServerIndex);
+}
+
+inline void BinaryWriter::Write(const OpcUa_QualifiedName& value) {
+  Write(value.NamespaceIndex);
+  Write(value.Name);
+}
+
+inline void BinaryWriter::Write(const OpcUa_LocalizedText& value) {
+  const bool has_locale = !::OpcUa_String_IsNull(&value.Locale);
+  const bool has_text = !::OpcUa_String_IsNull(&value.Text);
+  Write(static_cast<Byte>((has_locale ? 0x01 : 0) | (has_text ? 0x02 : 0)));
+  if (has_locale)
+    Write(value.Locale);
+  if (has_text)
+    Write(value.Text);
+}
+
+inline void BinaryWriter::Write(const OpcUa_ExtensionObject& value) {
+  switch (value.Encoding) {
+    case OpcUa_ExtensionObjectEncoding_None:
+      Write(value.TypeId.NodeId);
+      Write(Byte{0x00});
+      return;
+
+    case OpcUa_ExtensionObjectEncoding_Binary:
+      Write(value.TypeId.NodeId);
+      Write(Byte{0x01});
+      Write(value.Body.Binary);
+      return;
+
+    case OpcUa_ExtensionObjectEncoding_Xml:
+      Write(value.TypeId.NodeId);
+      Write(Byte{0x02});
+      Write(value.Body.Xml);
+      return;
+
+    case OpcUa_ExtensionObjectEncoding_EncodeableObject: {
+      const auto* type = value.Body.EncodeableObject.Type;
+      const auto* object = value.Body.EncodeableObject.Object;
+      // Types of other namespaces need the namespace table.
+      if (!type || !object || type->NamespaceUri)
+        break;
+
+      OpcUa_NodeId type_id;
+      ::OpcUa_NodeId_Initialize(&type_id);
+      type_id.Identifier.Numeric = type->BinaryEncodingTypeId;
+      Write(type_id);
+      Write(Byte{0x01});
+
+      // The body length is known once the body is written.
+      const auto length_pos = data_ ? data_->size() : 0;
+      Write(Int32{0});
+      const auto body_start = size_;
+      if (!WriteEncodeableBody(*type, object)) {
+        WriteWithStack([&](BinaryEncoder& encoder) {
+          encoder.WriteEncodable(*type, object);
+        });
+      }
+      const auto length = static_cast<Int32>(size_ - body_start);
+      if (data_)
+        std::memcpy(data_->data() + length_pos, &length, sizeof(length));
+      return;
+    }
+
+    default:
+      break;
+  }
+
+  WriteWithStack([&](BinaryEncoder& encoder) { encoder.Write(value); });
+}
+
+inline bool BinaryWriter::WriteEncodeableBody(const OpcUa_EncodeableType& type,
+                                              const void* object) {
+  if (&type == &OpcUa_DataChangeNotification_EncodeableType) {
+    Write(*static_cast<const OpcUa_DataChangeNotification*>(object));
+    return true;
+  }
+  if (&type == &OpcUa_EventNotificationList_EncodeableType) {
+    Write(*static_cast<const OpcUa_EventNotificationList*>(object));
+    return true;
+  }
+  return false;
+}
+
+inline void BinaryWriter::Write(const OpcUa_DataValue& value) {
+  const auto is_set = [](const OpcUa_DateTime& date_time) {
+    return date_time.dwLowDateTime != 0 || date_time.dwHighDateTime != 0;
+  };
+
+  const bool has_value = value.Value.Datatype != OpcUaType_Null;
+  const bool has_status_code = value.StatusCode != OpcUa_Good;
+  const bool has_source_timestamp = is_set(value.SourceTimestamp);
+  const bool has_server_timestamp = is_set(value.ServerTimestamp);
+  const bool has_source_picoseconds = value.SourcePicoseconds != 0;
+  const bool has_server_picoseconds = value.ServerPicoseconds != 0;
+
+  Write(static_cast<Byte>(
+      (has_value ? 0x01 : 0) | (has_status_code ? 0x02 : 0) |
+      (has_source_timestamp ? 0x04 : 0) | (has_server_timestamp ? 0x08 : 0) |
+      (has_source_picoseconds ? 0x10 : 0) |
+      (has_server_picoseconds ? 0x20 : 0)));
+
+  if (has_value)
+    Write(value.Value);
+  if (has_status_code)
+    Write(value.StatusCode);
+  if (has_source_timestamp)
+    Write(value.SourceTimestamp);
+  if (has_source_picoseconds)
+    Write(value.SourcePicoseconds);
+  if (has_server_timestamp)
+    Write(value.ServerTimestamp);
+  if (has_server_picoseconds)
+    Write(value.ServerPicoseconds);
+}
+
+inline void BinaryWriter::Write(const OpcUa_Variant& value) {
+  const auto datatype = static_cast<Byte>(value.Datatype & 0x3F);
+  switch (value.ArrayType) {
+    case OpcUa_VariantArrayType_Scalar:
+      Write(datatype);
+      WriteVariantScalar(datatype, value.Value);
+      return;
+
+    case OpcUa_VariantArrayType_Array:
+      Write(static_cast<Byte>(datatype | 0x80));
+      WriteVariantArray(datatype, value.Value.Array.Value,
+                        value.Value.Array.Length);
+      return;
+
+    case OpcUa_VariantArrayType_Matrix: {
+      auto& matrix = value.Value.Matrix;
+      const auto length = detail::GetMatrixLength(matrix);
+      Write(static_cast<Byte>(datatype | 0xC0));
+      WriteVariantArray(datatype, matrix.Value, length);
+      WriteArray(matrix.Dimensions, matrix.NoOfDimensions);
+      return;
+    }
+
+    default:
+      Check(OpcUa_BadEncodingError);
+  }
+}
+
+inline void BinaryWriter::WriteVariantScalar(Byte datatype,
+                                             const OpcUa_VariantUnion& value) {
+  switch (datatype) {
+    case OpcUaType_Null:
+      return;
+    case OpcUaType_Boolean:
+      return Write(value.Boolean);
+    case OpcUaType_SByte:
+      return Write(value.SByte);
+    case OpcUaType_Byte:
+      return Write(value.Byte);
+    case OpcUaType_Int16:
+      return Write(value.Int16);
+    case OpcUaType_UInt16:
+      return Write(value.UInt16);
+    case OpcUaType_Int32:
+      return Write(value.Int32);
+    case OpcUaType_UInt32:
+      return Write(value.UInt32);
+    case OpcUaType_Int64:
+      return Write(value.Int64);
+    case OpcUaType_UInt64:
+      return Write(value.UInt64);
+    case OpcUaType_Float:
+      return Write(value.Float);
+    case OpcUaType_Double:
+      return Write(value.Double);
+    case OpcUaType_String:
+      return Write(value.String);
+    case OpcUaType_DateTime:
+      return Write(value.DateTime);
+    case OpcUaType_Guid:
+      return WritePointee(value.Guid);
+    case OpcUaType_ByteString:
+      return Write(value.ByteString);
+    case OpcUaType_XmlElement:
+      return Write(value.XmlElement);
+    case OpcUaType_NodeId:
+      return WritePointee(value.NodeId);
+    case OpcUaType_ExpandedNodeId:
+      return WritePointee(value.ExpandedNodeId);
+    case OpcUaType_StatusCode:
+      return Write(value.StatusCode);
+    case OpcUaType_QualifiedName:
+      return WritePointee(value.QualifiedName);
+    case OpcUaType_LocalizedText:
+      return WritePointee(value.LocalizedText);
+    case OpcUaType_ExtensionObject:
+      return WritePointee(value.ExtensionObject);
+    case OpcUaType_DataValue:
+      return WritePointee(value.DataValue);
+    default:
+      Check(OpcUa_BadEncodingError);
+  }
+}
+
+inline void BinaryWriter::WriteVariantArray(
+    Byte datatype,
+    const OpcUa_VariantArrayUnion& values,
+    Int32 length) {
+  switch (datatype) {
+    case OpcUaType_Boolean:
+      return WriteArray(values.BooleanArray, length);
+    case OpcUaType_SByte:
+      return WriteArray(values.SByteArray, length);
+    case OpcUaType_Byte:
+      return WriteArray(values.ByteArray, length);
+    case OpcUaType_Int16:
+      return WriteArray(values.Int16Array, length);
+    case OpcUaType_UInt16:
+      return WriteArray(values.UInt16Array, length);
+    case OpcUaType_Int32:
+      return WriteArray(values.Int32Array, length);
+    case OpcUaType_UInt32:
+      return WriteArray(values.UInt32Array, length);
+    case OpcUaType_Int64:
+      return WriteArray(values.Int64Array, length);
+    case OpcUaType_UInt64:
+      return WriteArray(values.UInt64Array, length);
+    case OpcUaType_Float:
+      return WriteArray(values.FloatArray, length);
+    case OpcUaType_Double:
+      return WriteArray(values.DoubleArray, length);
+    case OpcUaType_String:
+      return WriteArray(values.StringArray, length);
+    case OpcUaType_DateTime:
+      return WriteArray(values.DateTimeArray, length);
+    case OpcUaType_Guid:
+      return WriteArray(values.GuidArray, length);
+    case OpcUaType_ByteString:
+      return WriteArray(values.ByteStringArray, length);
+    case OpcUaType_XmlElement:
+      return WriteArray(values.XmlElementArray, length);
+    case OpcUaType_NodeId:
+      return WriteArray(values.NodeIdArray, length);
+    case OpcUaType_ExpandedNodeId:
+      return WriteArray(values.ExpandedNodeIdArray, length);
+    case OpcUaType_StatusCode:
+      return WriteArray(values.StatusCodeArray, length);
+    case OpcUaType_QualifiedName:
+      return WriteArray(values.QualifiedNameArray, length);
+    case OpcUaType_LocalizedText:
+      return WriteArray(values.LocalizedTextArray, length);
+    case OpcUaType_ExtensionObject:
+      return WriteArray(values.ExtensionObjectArray, length);
+    case OpcUaType_DataValue:
+      return WriteArray(values.DataValueArray, length);
+    case OpcUaType_Variant:
+      return WriteArray(values.VariantArray, length);
+    default:
+      Check(OpcUa_BadEncodingError);
+  }
+}
+
+inline void BinaryWriter::Write(const OpcUa_DiagnosticInfo& value) {
+  // Responses mostly carry initialized DiagnosticInfos, which are written
+  // as an empty encoding mask.
+  const bool empty = value.SymbolicId == -1 && value.NamespaceUri == -1 &&
+                     value.Locale == -1 && value.LocalizedText == -1 &&
+                     ::OpcUa_String_IsNull(&value.AdditionalInfo) &&
+                     value.InnerStatusCode == OpcUa_Good &&
+                     !value.InnerDiagnosticInfo;
+  if (empty) {
+    Write(Byte{0x00});
+    return;
+  }
+  WriteWithStack([&](BinaryEncoder& encoder) { encoder.Write(value); });
+}
+
+inline void BinaryWriter::Write(const OpcUa_ResponseHeader& value) {
+  Write(value.Timestamp);
+  Write(value.RequestHandle);
+  Write(value.ServiceResult);
+  Write(value.ServiceDiagnostics);
+  WriteArray(value.StringTable, value.NoOfStringTable);
+  Write(value.AdditionalHeader);
+}
+
+inline void BinaryWriter::Write(const OpcUa_MonitoredItemNotification& value) {
+  Write(value.ClientHandle);
+  Write(value.Value);
+}
+
+inline void BinaryWriter::Write(const OpcUa_DataChangeNotification& value) {
+  WriteArray(value.MonitoredItems, value.NoOfMonitoredItems);
+  WriteArray(value.DiagnosticInfos, value.NoOfDiagnosticInfos);
+}
+
+inline void BinaryWriter::Write(const OpcUa_EventFieldList& value) {
+  Write(value.ClientHandle);
+  WriteArray(value.EventFields, value.NoOfEventFields);
+}
+
+inline void BinaryWriter::Write(const OpcUa_EventNotificationList& value) {
+  WriteArray(value.Events, value.NoOfEvents);
+}
+
+inline void BinaryWriter::Write(const OpcUa_NotificationMessage& value) {
+  Write(value.SequenceNumber);
+  Write(value.PublishTime);
+  WriteArray(value.NotificationData, value.NoOfNotificationData);
+}
+
+inline void BinaryWriter::Write(const OpcUa_PublishResponse& value) {
+  Write(value.ResponseHeader);
+  Write(value.SubscriptionId);
+  WriteArray(value.AvailableSequenceNumbers,
+             value.NoOfAvailableSequenceNumbers);
+  Write(value.MoreNotifications);
+  Write(value.NotificationMessage);
+  WriteArray(value.Results, value.NoOfResults);
+  WriteArray(value.DiagnosticInfos, value.NoOfDiagnosticInfos);
+}
+
+}  // namespace opcua
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <opcuapp/status_code.h>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace opcua {
+
+// Fixed-size buffers reused across encodings, so that large outputs are
+// built from recycled memory of a known size. Thread-safe.
+class BufferPool {
+ public:
+  // Returns its buffer to the pool.
+  class Releaser {
+   public:
+    explicit Releaser(BufferPool* pool = nullptr) : pool_{pool} {}
+    void operator()(char* data) const { pool_->Release(data); }
+
+   private:
+    BufferPool* pool_;
+  };
+
+  using Buffer = std::unique_ptr<char[], Releaser>;
+
+  // Keeps up to |max_free_count| released buffers for reuse.
+  explicit BufferPool(size_t buffer_size = 64 * 1024,
+                      size_t max_free_count = 64)
+      : buffer_size_{buffer_size}, max_free_count_{max_free_count} {}
+
+  ~BufferPool() {
+    for (auto* data : free_)
+      delete[] data;
+  }
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  static BufferPool& Get() {
+    // Leaked: each Buffer keeps a raw pointer to its pool, so a buffer held
+    // by a static or thread_local stream would be released into a
+    // destroyed pool.
+    static auto& pool = *new BufferPool;
+    return pool;
+  }
+
+  size_t buffer_size() const { return buffer_size_; }
+
+  // Buffers must be released before the pool is destroyed.
+  Buffer Acquire();
+
+  size_t free_count() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return free_.size();
+  }
+
+ private:
+  void Release(char* data);
+
+  const size_t buffer_size_;
+  const size_t max_free_count_;
+
+  mutable std::mutex mutex_;
+  std::vector<char*> free_;
+};
+
+inline BufferPool::Buffer BufferPool::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (!free_.empty()) {
+      auto* data = free_.back();
+      free_.pop_back();
+      return Buffer{data, Releaser{this}};
+    }
+  }
+  return Buffer{new char[buffer_size_], Releaser{this}};
+}
+
+inline void BufferPool::Release(char* data) {
+  if (!data)
+    return;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (free_.size() < max_free_count_) {
+      free_.emplace_back(data);
+      return;
+    }
+  }
+  delete[] data;
+}
+
+}  // namespace opcua
@@ -32,6 +32,15 @@ class DataValue {
 
   DataValue& operator=(const DataValue& source) = delete;
 
+  DataValue& operator=(DataValue&& source) {
+    if (&source != this) {
+      Clear();
+      value_ = source.value_;
+      Initialize(source.value_);
+    }
+    return *this;
+  }
+
   DataValue(StatusCode status_code) {
     Initialize(value_);
     value_.StatusCode = status_code.code();
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <opcua.h>
+#include <opcuapp/basic_types.h>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace opcua {
+
+// FieldLayout::count_offset of a field that isn't an array.
+const size_t kScalarField = static_cast<size_t>(-1);
+
+// Field of a structure that owns memory. Other fields are plain data and are
+// copied with the bytes of the structure.
+struct FieldLayout {
+  // OpcUaType_Null for a nested structure.
+  BuiltInType type;
+  const OpcUa_EncodeableType* structure;
+  size_t offset;
+  // Offset of the Int32 element count, or kScalarField.
+  size_t count_offset;
+};
+
+#define OPCUA_LAYOUT_FIELD(Type, Field, FieldType)                 \
+  ::opcua::FieldLayout {                                           \
+    OpcUaType_##FieldType, nullptr, offsetof(OpcUa_##Type, Field), \
+        ::opcua::kScalarField                                      \
+  }
+
+#define OPCUA_LAYOUT_ARRAY(Type, Field, FieldType)                 \
+  ::opcua::FieldLayout {                                           \
+    OpcUaType_##FieldType, nullptr, offsetof(OpcUa_##Type, Field), \
+        offsetof(OpcUa_##Type, NoOf##Field)                        \
+  }
+
+#define OPCUA_LAYOUT_STRUCT(Type, Field, FieldType)                \
+  ::opcua::FieldLayout {                                           \
+    OpcUaType_Null, &OpcUa_##FieldType##_EncodeableType,           \
+        offsetof(OpcUa_##Type, Field), ::opcua::kScalarField       \
+  }
+
+#define OPCUA_LAYOUT_STRUCT_ARRAY(Type, Field, FieldType)          \
+  ::opcua::FieldLayout {                                           \
+    OpcUaType_Null, &OpcUa_##FieldType##_EncodeableType,           \
+        offsetof(OpcUa_##Type, Field),                             \
+        offsetof(OpcUa_##Type, NoOf##Field)                        \
+  }
+
+// Owned fields of each registered encodeable type, so that CopyEncodeable
+// copies members directly instead of encoding and decoding the structure.
+// A layout must list every owned field of its type; unregistered types are
+// copied through their binary encoding.
+class EncodableLayouts {
+ public:
+  static EncodableLayouts& Get() {
+    static EncodableLayouts layouts;
+    return layouts;
+  }
+
+  // Not thread-safe. Custom types are registered at startup.
+  void Register(const OpcUa_EncodeableType& type,
+                std::vector<FieldLayout> fields) {
+    layouts_[&type] = std::move(fields);
+  }
+
+  const std::vector<FieldLayout>* Find(
+      const OpcUa_EncodeableType& type) const {
+    auto i = layouts_.find(&type);
+    return i != layouts_.end() ? &i->second : nullptr;
+  }
+
+ private:
+  EncodableLayouts();
+
+  std::unordered_map<const OpcUa_EncodeableType*, std::vector<FieldLayout>>
+      layouts_;
+};
+
+#define OPCUA_REGISTER_LAYOUT(Type, ...) \
+  Register(OpcUa_##Type##_EncodeableType, {__VA_ARGS__})
+
+inline EncodableLayouts::EncodableLayouts() {
+  // Headers.
+  OPCUA_REGISTER_LAYOUT(
+      RequestHeader,
+      OPCUA_LAYOUT_FIELD(RequestHeader, AuthenticationToken, NodeId),
+      OPCUA_LAYOUT_FIELD(RequestHeader, AuditEntryId, String),
+      OPCUA_LAYOUT_FIELD(RequestHeader, AdditionalHeader, ExtensionObject));
+  OPCUA_REGISTER_LAYOUT(
+      ResponseHeader,
+      OPCUA_LAYOUT_FIELD(ResponseHeader, ServiceDiagnostics, DiagnosticInfo),
+      OPCUA_LAYOUT_ARRAY(ResponseHeader, StringTable, String),
+      OPCUA_LAYOUT_FIELD(ResponseHeader, AdditionalHeader, ExtensionObject));
+
+  // Attributes.
+  OPCUA_REGISTER_LAYOUT(
+      ReadValueId, OPCUA_LAYOUT_FIELD(ReadValueId, NodeId, NodeId),
+      OPCUA_LAYOUT_FIELD(ReadValueId, IndexRange, String),
+      OPCUA_LAYOUT_FIELD(ReadValueId, DataEncoding, QualifiedName));
+  OPCUA_REGISTER_LAYOUT(WriteValue,
+                        OPCUA_LAYOUT_FIELD(WriteValue, NodeId, NodeId),
+                        OPCUA_LAYOUT_FIELD(WriteValue, IndexRange, String),
+                        OPCUA_LAYOUT_FIELD(WriteValue, Value, DataValue));
+  OPCUA_REGISTER_LAYOUT(
+      ReadRequest,
+      OPCUA_LAYOUT_STRUCT(ReadRequest, RequestHeader, RequestHeader),
+      OPCUA_LAYOUT_STRUCT_ARRAY(ReadRequest, NodesToRead, ReadValueId));
+  OPCUA_REGISTER_LAYOUT(
+      ReadResponse,
+      OPCUA_LAYOUT_STRUCT(ReadResponse, ResponseHeader, ResponseHeader),
+      OPCUA_LAYOUT_ARRAY(ReadResponse, Results, DataValue),
+      OPCUA_LAYOUT_ARRAY(ReadResponse, DiagnosticInfos, DiagnosticInfo));
+  OPCUA_REGISTER_LAYOUT(
+      WriteRequest,
+      OPCUA_LAYOUT_STRUCT(WriteRequest, RequestHeader, RequestHeader),
+      OPCUA_LAYOUT_STRUCT_ARRAY(WriteRequest, NodesToWrite, WriteValue));
+  OPCUA_REGISTER_LAYOUT(
+      WriteResponse,
+      OPCUA_LAYOUT_STRUCT(WriteResponse, ResponseHeader, ResponseHeader),
+      OPCUA_LAYOUT_ARRAY(WriteResponse, Results, StatusCode),
+      OPCUA_LAYOUT_ARRAY(WriteResponse, DiagnosticInfos, DiagnosticInfo));
+
+  // View.
+  OPCUA_REGISTER_LAYOUT(
+      BrowseDescription, OPCUA_LAYOUT_FIELD(BrowseDescription, NodeId, NodeId),
+      OPCUA_LAYOUT_FIELD(BrowseDescription, ReferenceTypeId, NodeId));
+  OPCUA_REGISTER_LAYOUT(
+      ReferenceDescription,
+      OPCUA_LAYOUT_FIELD(ReferenceDescription, ReferenceTypeId, NodeId),
+      OPCUA_LAYOUT_FIELD(ReferenceDescription, NodeId, ExpandedNodeId),
+      OPCUA_LAYOUT_FIELD(ReferenceDescription, BrowseName, QualifiedName),
+      OPCUA_LAYOUT_FIELD(ReferenceDescription, DisplayName, LocalizedText),
+      OPCUA_LAYOUT_FIELD(ReferenceDescription, TypeDefinition,
+                         ExpandedNodeId));
+  OPCUA_REGISTER_LAYOUT(
+      BrowseResult,
+      OPCUA_LAYOUT_FIELD(BrowseResult, ContinuationPoint, ByteString),
+      OPCUA_LAYOUT_STRUCT_ARRAY(BrowseResult, References,
+                                ReferenceDescription));
+  OPCUA_REGISTER_LAYOUT(
+      RelativePathElement,
+      OPCUA_LAYOUT_FIELD(RelativePathElement, ReferenceTypeId, NodeId),
+      OPCUA_LAYOUT_FIELD(RelativePathElement, TargetName, QualifiedName));
+  OPCUA_REGISTER_LAYOUT(
+      RelativePath,
+      OPCUA_LAYOUT_STRUCT_ARRAY(RelativePath, Elements, RelativePathElement));
+  OPCUA_REGISTER_LAYOUT(
+      BrowsePath, OPCUA_LAYOUT_FIELD(BrowsePath, StartingNode, NodeId),
+      OPCUA_LAYOUT_STRUCT(BrowsePath, RelativePath, RelativePath));
+  OPCUA_REGISTER_LAYOUT(
+      BrowsePathTarget,
+      OPCUA_LAYOUT_FIELD(BrowsePathTarget, TargetId, ExpandedNodeId));
+  OPCUA_REGISTER_LAYOUT(
+      BrowsePathResult,
+      OPCUA_LAYOUT_STRUCT_ARRAY(BrowsePathResult, Targets, BrowsePathTarget));
+
+  // Monitored items.
+  OPCUA_REGISTER_LAYOUT(
+      MonitoringParameters,
+      OPCUA_LAYOUT_FIELD(MonitoringParameters, Filter, ExtensionObject));
+  OPCUA_REGISTER_LAYOUT(
+      MonitoredItemCreateRequest,
+      OPCUA_LAYOUT_STRUCT(MonitoredItemCreateRequest, ItemToMonitor,
+                          ReadValueId),
+      OPCUA_LAYOUT_STRUCT(MonitoredItemCreateRequest, RequestedParameters,
+                          MonitoringParameters));
+  OPCUA_REGISTER_LAYOUT(
+      MonitoredItemCreateResult,
+      OPCUA_LAYOUT_FIELD(MonitoredItemCreateResult, FilterResult,
+                         ExtensionObject));
+  Register(OpcUa_DataChangeFilter_EncodeableType, {});
+  OPCUA_REGISTER_LAYOUT(
+      SimpleAttributeOperand,
+      OPCUA_LAYOUT_FIELD(SimpleAttributeOperand, TypeDefinitionId, NodeId),
+      OPCUA_LAYOUT_ARRAY(SimpleAttributeOperand, BrowsePath, QualifiedName),
+      OPCUA_LAYOUT_FIELD(SimpleAttributeOperand, IndexRange, String));
+  OPCUA_REGISTER_LAYOUT(
+      ContentFilterElement,
+      OPCUA_LAYOUT_ARRAY(ContentFilterElement, FilterOperands,
+                         ExtensionObject));
+  OPCUA_REGISTER_LAYOUT(
+      ContentFilter,
+      OPCUA_LAYOUT_STRUCT_ARRAY(ContentFilter, Elements, ContentFilterElement));
+  OPCUA_REGISTER_LAYOUT(
+      EventFilter,
+      OPCUA_LAYOUT_STRUCT_ARRAY(EventFilter, SelectClauses,
+                                SimpleAttributeOperand),
+      OPCUA_LAYOUT_STRUCT(EventFilter, WhereClause, ContentFilter));
+
+  // Notifications, copied on every Publish.
+  OPCUA_REGISTER_LAYOUT(
+      MonitoredItemNotification,
+      OPCUA_LAYOUT_FIELD(MonitoredItemNotification, Value, DataValue));
+  OPCUA_REGISTER_LAYOUT(
+      DataChangeNotification,
+      OPCUA_LAYOUT_STRUCT_ARRAY(DataChangeNotification, MonitoredItems,
+                                MonitoredItemNotification),
+      OPCUA_LAYOUT_ARRAY(DataChangeNotification, DiagnosticInfos,
+                         DiagnosticInfo));
+  OPCUA_REGISTER_LAYOUT(
+      EventFieldList, OPCUA_LAYOUT_ARRAY(EventFieldList, EventFields, Variant));
+  OPCUA_REGISTER_LAYOUT(
+      EventNotificationList,
+      OPCUA_LAYOUT_STRUCT_ARRAY(EventNotificationList, Events, EventFieldList));
+  OPCUA_REGISTER_LAYOUT(
+      NotificationMessage,
+      OPCUA_LAYOUT_ARRAY(NotificationMessage, NotificationData,
+                         ExtensionObject));
+  OPCUA_REGISTER_LAYOUT(
+      PublishResponse,
+      OPCUA_LAYOUT_STRUCT(PublishResponse, ResponseHeader, ResponseHeader),
+      OPCUA_LAYOUT_ARRAY(PublishResponse, AvailableSequenceNumbers, UInt32),
+      OPCUA_LAYOUT_STRUCT(PublishResponse, NotificationMessage,
+                          NotificationMessage),
+      OPCUA_LAYOUT_ARRAY(PublishResponse, Results, StatusCode),
+      OPCUA_LAYOUT_ARRAY(PublishResponse, DiagnosticInfos, DiagnosticInfo));
+  OPCUA_REGISTER_LAYOUT(
+      ModelChangeStructureDataType,
+      OPCUA_LAYOUT_FIELD(ModelChangeStructureDataType, Affected, NodeId),
+      OPCUA_LAYOUT_FIELD(ModelChangeStructureDataType, AffectedType, NodeId));
+}
+
+#undef OPCUA_REGISTER_LAYOUT
+
+}  // namespace opcua
@@ -3,24 +3,265 @@
 #include <opcuapp/basic_structs.h>
 #include <opcuapp/binary_decoder.h>
 #include <opcuapp/binary_encoder.h>
+#include <opcuapp/binary_writer.h>
+#include <opcuapp/byte_string.h>
+#include <opcuapp/data_value.h>
+#include <opcuapp/encodable_layout.h>
 #include <opcuapp/stream.h>
+#include <cstring>
 
 namespace opcua {
 
+namespace detail {
+
+inline MessageContext MakeMessageContext() {
+  MessageContext context;
+  context.KnownTypes = &OpcUa_ProxyStub_g_EncodeableTypes;
+  context.NamespaceUris = &OpcUa_ProxyStub_g_NamespaceUris;
+  context.AlwaysCheckLengths = OpcUa_False;
+  return context;
+}
+
+inline std::vector<char> EncodeVariant(const OpcUa_Variant& value) {
+  std::vector<char> data;
+  auto context = MakeMessageContext();
+  BinaryWriter{data, context}.Write(value);
+  return data;
+}
+
+inline void CopyDiagnosticInfo(const OpcUa_DiagnosticInfo& source,
+                               OpcUa_DiagnosticInfo& target) {
+  target.SymbolicId = source.SymbolicId;
+  target.NamespaceUri = source.NamespaceUri;
+  target.Locale = source.Locale;
+  target.LocalizedText = source.LocalizedText;
+  Copy(source.AdditionalInfo, target.AdditionalInfo);
+  target.InnerStatusCode = source.InnerStatusCode;
+  if (source.InnerDiagnosticInfo) {
+    auto* inner = static_cast<OpcUa_DiagnosticInfo*>(
+        ::OpcUa_Alloc(sizeof(OpcUa_DiagnosticInfo)));
+    if (!inner)
+      Check(OpcUa_BadOutOfMemory);
+    ::OpcUa_DiagnosticInfo_Initialize(inner);
+    target.InnerDiagnosticInfo = inner;
+    CopyDiagnosticInfo(*source.InnerDiagnosticInfo, *inner);
+  }
+}
+
+inline size_t GetFieldSize(const FieldLayout& field) {
+  if (field.structure)
+    return field.structure->AllocationSize;
+
+  switch (field.type) {
+    case OpcUaType_Boolean:
+      return sizeof(OpcUa_Boolean);
+    case OpcUaType_SByte:
+      return sizeof(OpcUa_SByte);
+    case OpcUaType_Byte:
+      return sizeof(OpcUa_Byte);
+    case OpcUaType_Int16:
+      return sizeof(OpcUa_Int16);
+    case OpcUaType_UInt16:
+      return sizeof(OpcUa_UInt16);
+    case OpcUaType_Int32:
+      return sizeof(OpcUa_Int32);
+    case OpcUaType_UInt32:
+      return sizeof(OpcUa_UInt32);
+    case OpcUaType_Int64:
+      return sizeof(OpcUa_Int64);
+    case OpcUaType_UInt64:
+      return sizeof(OpcUa_UInt64);
+    case OpcUaType_Float:
+      return sizeof(OpcUa_Float);
+    case OpcUaType_Double:
+      return sizeof(OpcUa_Double);
+    case OpcUaType_String:
+      return sizeof(OpcUa_String);
+    case OpcUaType_DateTime:
+      return sizeof(OpcUa_DateTime);
+    case OpcUaType_Guid:
+      return sizeof(OpcUa_Guid);
+    case OpcUaType_ByteString:
+      return sizeof(OpcUa_ByteString);
+    case OpcUaType_XmlElement:
+      return sizeof(OpcUa_XmlElement);
+    case OpcUaType_NodeId:
+      return sizeof(OpcUa_NodeId);
+    case OpcUaType_ExpandedNodeId:
+      return sizeof(OpcUa_ExpandedNodeId);
+    case OpcUaType_StatusCode:
+      return sizeof(OpcUa_StatusCode);
+    case OpcUaType_QualifiedName:
+      return sizeof(OpcUa_QualifiedName);
+    case OpcUaType_LocalizedText:
+      return sizeof(OpcUa_LocalizedText);
+    case OpcUaType_ExtensionObject:
+      return sizeof(OpcUa_ExtensionObject);
+    case OpcUaType_DataValue:
+      return sizeof(OpcUa_DataValue);
+    case OpcUaType_Variant:
+      return sizeof(OpcUa_Variant);
+    case OpcUaType_DiagnosticInfo:
+      return sizeof(OpcUa_DiagnosticInfo);
+    default:
+      assert(false);
+      return 0;
+  }
+}
+
+// Sets an owned field to its initial state, so the target can be cleared if
+// a copy throws.
+inline void InitializeField(const FieldLayout& field, void* value) {
+  if (field.structure)
+    field.structure->Initialize(value);
+  else
+    std::memset(value, 0, GetFieldSize(field));
+}
+
+// |target| is initialized.
+inline void CopyField(const FieldLayout& field,
+                      const void* source,
+                      void* target) {
+  if (field.structure) {
+    CopyEncodeable(*field.structure, source, target);
+    return;
+  }
+
+  switch (field.type) {
+    case OpcUaType_String:
+      Copy(*static_cast<const OpcUa_String*>(source),
+           *static_cast<OpcUa_String*>(target));
+      return;
+    case OpcUaType_ByteString:
+    case OpcUaType_XmlElement:
+      Copy(*static_cast<const OpcUa_ByteString*>(source),
+           *static_cast<OpcUa_ByteString*>(target));
+      return;
+    case OpcUaType_NodeId:
+      Copy(*static_cast<const OpcUa_NodeId*>(source),
+           *static_cast<OpcUa_NodeId*>(target));
+      return;
+    case OpcUaType_ExpandedNodeId:
+      Copy(*static_cast<const OpcUa_ExpandedNodeId*>(source),
+           *static_cast<OpcUa_ExpandedNodeId*>(target));
+      return;
+    case OpcUaType_QualifiedName:
+      Copy(*static_cast<const OpcUa_QualifiedName*>(source),
+           *static_cast<OpcUa_QualifiedName*>(target));
+      return;
+    case OpcUaType_LocalizedText:
+      Copy(*static_cast<const OpcUa_LocalizedText*>(source),
+           *static_cast<OpcUa_LocalizedText*>(target));
+      return;
+    case OpcUaType_ExtensionObject:
+      Copy(*static_cast<const OpcUa_ExtensionObject*>(source),
+           *static_cast<OpcUa_ExtensionObject*>(target));
+      return;
+    case OpcUaType_DataValue:
+      Copy(*static_cast<const OpcUa_DataValue*>(source),
+           *static_cast<OpcUa_DataValue*>(target));
+      return;
+    case OpcUaType_Variant:
+      Copy(*static_cast<const OpcUa_Variant*>(source),
+           *static_cast<OpcUa_Variant*>(target));
+      return;
+    case OpcUaType_DiagnosticInfo:
+      CopyDiagnosticInfo(*static_cast<const OpcUa_DiagnosticInfo*>(source),
+                         *static_cast<OpcUa_DiagnosticInfo*>(target));
+      return;
+    default:
+      // Plain data.
+      std::memcpy(target, source, GetFieldSize(field));
+      return;
+  }
+}
+
+// Returns false if |type| has no layout.
+inline bool CopyByLayout(const OpcUa_EncodeableType& type,
+                         const void* source,
+                         void* target) {
+  const auto* fields = EncodableLayouts::Get().Find(type);
+  if (!fields)
+    return false;
+
+  const auto* source_bytes = static_cast<const char*>(source);
+  auto* target_bytes = static_cast<char*>(target);
+
+  std::memcpy(target, source, type.AllocationSize);
+
+  // Owned fields must not share memory with |source|.
+  for (auto& field : *fields) {
+    auto* value = target_bytes + field.offset;
+    if (field.count_offset == kScalarField) {
+      InitializeField(field, value);
+    } else {
+      *reinterpret_cast<void**>(value) = nullptr;
+      *reinterpret_cast<Int32*>(target_bytes + field.count_offset) = 0;
+    }
+  }
+
+  for (auto& field : *fields) {
+    const auto* source_value = source_bytes + field.offset;
+    auto* target_value = target_bytes + field.offset;
+
+    if (field.count_offset == kScalarField) {
+      CopyField(field, source_value, target_value);
+      continue;
+    }
+
+    const auto count = *reinterpret_cast<const Int32*>(source_bytes +
+                                                       field.count_offset);
+    const auto* source_array =
+        *reinterpret_cast<const char* const*>(source_value);
+    auto& target_count =
+        *reinterpret_cast<Int32*>(target_bytes + field.count_offset);
+    if (count <= 0 || !source_array) {
+      // Keeps -1 for null arrays.
+      target_count = count;
+      continue;
+    }
+
+    const auto size = GetFieldSize(field);
+    auto* target_array =
+        static_cast<char*>(::OpcUa_Alloc(static_cast<UInt32>(size * count)));
+    if (!target_array)
+      Check(OpcUa_BadOutOfMemory);
+    for (Int32 i = 0; i < count; ++i)
+      InitializeField(field, target_array + i * size);
+    *reinterpret_cast<char**>(target_value) = target_array;
+    target_count = count;
+
+    for (Int32 i = 0; i < count; ++i)
+      CopyField(field, source_array + i * size, target_array + i * size);
+  }
+
+  return true;
+}
+
+}  // namespace detail
+
+// Size of the binary encoding of |value|, counted without an output buffer.
+template <class T>
+inline size_t EncodedSize(const T& value) {
+  auto context = detail::MakeMessageContext();
+  BinaryWriter writer{context};
+  writer.Write(value);
+  return writer.size();
+}
+
 inline void CopyEncodeable(const OpcUa_EncodeableType& type,
                            const OpcUa_Void* source,
                            OpcUa_Void* target) {
   assert(source);
   assert(target);
 
-  // TODO: Optimize.
+  if (detail::CopyByLayout(type, source, target))
+    return;
+
   std::vector<char> data;
   data.reserve(64);
 
-  MessageContext context;
-  context.KnownTypes = &OpcUa_ProxyStub_g_EncodeableTypes;
-  context.NamespaceUris = &OpcUa_ProxyStub_g_NamespaceUris;
-  context.AlwaysCheckLengths = OpcUa_False;
+  auto context = detail::MakeMessageContext();
 
   // Serialize.
   {
@@ -28,9 +28,15 @@ class ExpandedNodeId {
     namespace_uri.release(value_.NamespaceUri);
   }
 
-  ExpandedNodeId(const ExpandedNodeId& source) { Copy(source.value_, value_); }
+  ExpandedNodeId(const ExpandedNodeId& source) {
+    Initialize(value_);
+    Copy(source.value_, value_);
+  }
 
-  ExpandedNodeId(const OpcUa_ExpandedNodeId& source) { Copy(source, value_); }
+  ExpandedNodeId(const OpcUa_ExpandedNodeId& source) {
+    Initialize(value_);
+    Copy(source, value_);
+  }
 
   ExpandedNodeId(OpcUa_ExpandedNodeId&& source) : value_{source} {
     Initialize(source);
@@ -56,16 +62,18 @@ class ExpandedNodeId {
 
   ExpandedNodeId& operator=(ExpandedNodeId&& source) {
     if (this != &source) {
+      Clear(value_);
       value_ = source.value_;
-      Initialize(value_);
+      Initialize(source.value_);
     }
     return *this;
   }
 
   ExpandedNodeId& operator=(OpcUa_ExpandedNodeId&& source) {
     if (&value_ != &source) {
+      Clear(value_);
       value_ = source;
-      Initialize(value_);
+      Initialize(source);
     }
     return *this;
   }
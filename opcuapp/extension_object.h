@@ -142,9 +142,7 @@ inline void Copy(const OpcUa_ExtensionObject& source,
       break;
 
     case OpcUa_ExtensionObjectEncoding_Xml:
-      assert(false);
-      Initialize(target);
-      // target.Body.Xml = XmlElement{source.Body.Xml}.release();
+      Copy(source.Body.Xml, target.Body.Xml);
       break;
 
     case OpcUa_ExtensionObjectEncoding_EncodeableObject: {
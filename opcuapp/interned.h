@@ -0,0 +1,169 @@
+#pragma once
+
+#include <opcuapp/localized_text.h>
+#include <opcuapp/qualified_name.h>
+#include <opcuapp/string.h>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+
+namespace opcua {
+
+namespace detail {
+
+// FNV-1a. Pass the previous hash to continue it over the next chunk.
+inline size_t HashBytes(const char* data,
+                        size_t size,
+                        size_t hash = 14695981039346656037ull) {
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+inline size_t HashString(const OpcUa_String& value) {
+  const auto length = ::OpcUa_String_StrLen(&value);
+  if (length == 0)
+    return 0;
+  return HashBytes(::OpcUa_String_GetRawString(&value), length);
+}
+
+// Null and empty strings are equal.
+inline bool IsSameString(const OpcUa_String& a, const OpcUa_String& b) {
+  const auto length = ::OpcUa_String_StrLen(&a);
+  return length == ::OpcUa_String_StrLen(&b) &&
+         (length == 0 || std::memcmp(::OpcUa_String_GetRawString(&a),
+                                     ::OpcUa_String_GetRawString(&b),
+                                     length) == 0);
+}
+
+inline size_t CombineHash(size_t a, size_t b) {
+  return a ^ (b + 0x9e3779b9 + (a << 6) + (a >> 2));
+}
+
+}  // namespace detail
+
+template <class T>
+struct InternTraits;
+
+template <>
+struct InternTraits<String> {
+  static size_t Hash(const String& value) {
+    return detail::HashString(value.get());
+  }
+  static bool Equal(const String& a, const String& b) {
+    return detail::IsSameString(a.get(), b.get());
+  }
+};
+
+template <>
+struct InternTraits<QualifiedName> {
+  static size_t Hash(const QualifiedName& value) {
+    return detail::CombineHash(value.namespace_index(),
+                               detail::HashString(value.name()));
+  }
+  static bool Equal(const QualifiedName& a, const QualifiedName& b) {
+    return a.namespace_index() == b.namespace_index() &&
+           detail::IsSameString(a.name(), b.name());
+  }
+};
+
+template <>
+struct InternTraits<LocalizedText> {
+  static size_t Hash(const LocalizedText& value) {
+    return detail::CombineHash(detail::HashString(value.locale()),
+                               detail::HashString(value.text()));
+  }
+  static bool Equal(const LocalizedText& a, const LocalizedText& b) {
+    return detail::IsSameString(a.locale(), b.locale()) &&
+           detail::IsSameString(a.text(), b.text());
+  }
+};
+
+// Process-wide set of immutable values. Values are kept until exit, so
+// pointers to them stay valid.
+template <class T>
+class InternPool {
+ public:
+  static InternPool& Get() {
+    // Never destroyed: the values are stack memory, and the stack is shut
+    // down before static destruction.
+    static auto& pool = *new InternPool;
+    return pool;
+  }
+
+  const T* Intern(T&& value);
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return values_.size();
+  }
+
+ private:
+  struct Hash {
+    size_t operator()(const T* value) const {
+      return InternTraits<T>::Hash(*value);
+    }
+  };
+
+  struct Equal {
+    bool operator()(const T* a, const T* b) const {
+      return InternTraits<T>::Equal(*a, *b);
+    }
+  };
+
+  InternPool() = default;
+
+  mutable std::mutex mutex_;
+  std::deque<T> values_;
+  std::unordered_set<const T*, Hash, Equal> index_;
+};
+
+template <class T>
+inline const T* InternPool<T>::Intern(T&& value) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto i = index_.find(&value);
+  if (i != index_.end())
+    return *i;
+  values_.emplace_back(std::move(value));
+  const auto* interned = &values_.back();
+  index_.insert(interned);
+  return interned;
+}
+
+// Handle of an interned value. Equal values share one copy, so handles are
+// compared by pointer.
+template <class T>
+class Interned {
+ public:
+  Interned() : value_{Default()} {}
+  Interned(T&& value) : value_{InternPool<T>::Get().Intern(std::move(value))} {}
+
+  Interned& operator=(T&& value) {
+    value_ = InternPool<T>::Get().Intern(std::move(value));
+    return *this;
+  }
+
+  const T& operator*() const { return *value_; }
+  const T* operator->() const { return value_; }
+
+  friend bool operator==(const Interned& a, const Interned& b) {
+    return a.value_ == b.value_;
+  }
+  friend bool operator!=(const Interned& a, const Interned& b) {
+    return a.value_ != b.value_;
+  }
+
+ private:
+  static const T* Default() {
+    static const T* value = InternPool<T>::Get().Intern(T{});
+    return value;
+  }
+
+  const T* value_;
+};
+
+}  // namespace opcua
@@ -6,6 +6,12 @@ namespace opcua {
 
 OPCUA_DEFINE_METHODS(LocalizedText);
 
+inline void Copy(const OpcUa_LocalizedText& source,
+                 OpcUa_LocalizedText& target) {
+  Copy(source.Locale, target.Locale);
+  Copy(source.Text, target.Text);
+}
+
 class LocalizedText {
  public:
   LocalizedText() { Initialize(value_); }
@@ -16,6 +22,11 @@ class LocalizedText {
     ::OpcUa_String_AttachCopy(&value_.Text, text);
   }
 
+  explicit LocalizedText(const OpcUa_String& text) {
+    Initialize(value_);
+    Copy(text, value_.Text);
+  }
+
   LocalizedText(OpcUa_LocalizedText&& source) : value_{source} {
     Initialize(source);
   }
@@ -24,7 +35,11 @@ class LocalizedText {
     Initialize(source.value_);
   }
 
-  LocalizedText(const LocalizedText&) = delete;
+  LocalizedText(const LocalizedText& source) {
+    Initialize(value_);
+    Copy(source.value_.Locale, value_.Locale);
+    Copy(source.value_.Text, value_.Text);
+  }
 
   ~LocalizedText() { Clear(value_); }
 
@@ -34,7 +49,14 @@ class LocalizedText {
     return *this;
   }
 
-  LocalizedText& operator=(const LocalizedText&) = delete;
+  LocalizedText& operator=(const LocalizedText& source) {
+    if (&source != this) {
+      Clear(value_);
+      Copy(source.value_.Locale, value_.Locale);
+      Copy(source.value_.Text, value_.Text);
+    }
+    return *this;
+  }
 
   LocalizedText& operator=(LocalizedText&& source) {
     if (&source != this) {
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <opcuapp/span.h>
+#include <opcuapp/stream.h>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+// Keeps min/max usable and the rest of the Win32 API out of includers.
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace opcua {
+
+// Read-only mapping of a whole file, hinted for sequential access.
+class MappedFile {
+ public:
+  MappedFile() = default;
+
+  explicit MappedFile(const std::string& path) {
+    if (!Open(path))
+      throw std::runtime_error{"Can't open file " + path};
+  }
+
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Returns false if the file can't be opened or mapped.
+  bool Open(const std::string& path);
+  void Close();
+
+  // Empty for an empty file.
+  Span<const char> data() const { return {data_, size_}; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+inline bool MappedFile::Open(const std::string& path) {
+  Close();
+
+#if defined(_WIN32)
+  auto file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file, &size)) {
+    ::CloseHandle(file);
+    return false;
+  }
+  if (size.QuadPart == 0) {
+    ::CloseHandle(file);
+    return true;
+  }
+
+  auto mapping =
+      ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  ::CloseHandle(file);
+  if (!mapping)
+    return false;
+
+  // The view keeps the mapping open.
+  auto* data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  ::CloseHandle(mapping);
+  if (!data)
+    return false;
+
+  data_ = static_cast<const char*>(data);
+  size_ = static_cast<size_t>(size.QuadPart);
+
+#else
+  const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file == -1)
+    return false;
+
+  struct stat status;
+  if (::fstat(file, &status) != 0) {
+    ::close(file);
+    return false;
+  }
+  const auto size = static_cast<size_t>(status.st_size);
+  if (size == 0) {
+    ::close(file);
+    return true;
+  }
+
+  // The mapping stays valid after the file is closed.
+  auto* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if (data == MAP_FAILED)
+    return false;
+  ::posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+  data_ = static_cast<const char*>(data);
+  size_ = size;
+#endif
+
+  return true;
+}
+
+inline void MappedFile::Close() {
+  if (!data_)
+    return;
+
+#if defined(_WIN32)
+  ::UnmapViewOfFile(data_);
+#else
+  ::munmap(const_cast<char*>(data_), size_);
+#endif
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+// Input stream over a mapped file. Reads are copies out of the mapping,
+// without the buffering and locale work of std::istream.
+class MappedFileInputStream {
+ public:
+  explicit MappedFileInputStream(const std::string& path)
+      : file_{path}, stream_{file_.data().data(), file_.data().size()} {}
+
+  OpcUa_InputStream& get() { return stream_.get(); }
+  const OpcUa_InputStream& get() const { return stream_.get(); }
+
+  Span<const char> data() const { return file_.data(); }
+
+ private:
+  MappedFile file_;
+  MemoryInputStream stream_;
+};
+
+}  // namespace opcua
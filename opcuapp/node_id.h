@@ -4,7 +4,9 @@
 #include <opcuapp/byte_string.h>
 #include <opcuapp/guid.h>
 #include <opcuapp/string.h>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 inline bool operator<(const OpcUa_NodeId& a, const OpcUa_NodeId& b) {
   if (a.NamespaceIndex != b.NamespaceIndex)
@@ -28,6 +30,40 @@ inline bool operator<(const OpcUa_NodeId& a, const OpcUa_NodeId& b) {
   }
 }
 
+inline bool operator==(const OpcUa_NodeId& a, const OpcUa_NodeId& b) {
+  if (a.NamespaceIndex != b.NamespaceIndex ||
+      a.IdentifierType != b.IdentifierType)
+    return false;
+
+  switch (a.IdentifierType) {
+    case OpcUa_IdentifierType_Numeric:
+      return a.Identifier.Numeric == b.Identifier.Numeric;
+    case OpcUa_IdentifierType_String: {
+      // Null strings have no raw string and equal empty ones.
+      const char* sa = OpcUa_String_GetRawString(&a.Identifier.String);
+      const char* sb = OpcUa_String_GetRawString(&b.Identifier.String);
+      return std::strcmp(sa ? sa : "", sb ? sb : "") == 0;
+    }
+    case OpcUa_IdentifierType_Opaque:
+      return a.Identifier.ByteString.Length ==
+                 b.Identifier.ByteString.Length &&
+             std::equal(a.Identifier.ByteString.Data,
+                        a.Identifier.ByteString.Data +
+                            std::max(a.Identifier.ByteString.Length, 0),
+                        b.Identifier.ByteString.Data);
+    case OpcUa_IdentifierType_Guid:
+      return std::memcmp(a.Identifier.Guid, b.Identifier.Guid,
+                         sizeof(OpcUa_Guid)) == 0;
+    default:
+      assert(false);
+      return false;
+  }
+}
+
+inline bool operator!=(const OpcUa_NodeId& a, const OpcUa_NodeId& b) {
+  return !(a == b);
+}
+
 inline bool operator==(const OpcUa_NodeId& a, opcua::NumericNodeId b) {
   return a.IdentifierType == OpcUa_IdentifierType_Numeric &&
          a.NamespaceIndex == 0 && a.Identifier.Numeric == b;
@@ -62,8 +98,15 @@ class NodeId {
   NodeId(OpcUa_NodeId&& source) : value_{source} { Initialize(source); }
   NodeId(NodeId&& source) : value_{source.value_} { Initialize(source.value_); }
 
-  NodeId(const NodeId& source) { Copy(source.value_, value_); }
-  NodeId(const OpcUa_NodeId& source) { Copy(source, value_); }
+  NodeId(const NodeId& source) {
+    Initialize(value_);
+    Copy(source.value_, value_);
+  }
+
+  NodeId(const OpcUa_NodeId& source) {
+    Initialize(value_);
+    Copy(source, value_);
+  }
 
   ~NodeId() { Clear(); }
 
@@ -73,7 +116,6 @@ class NodeId {
     if (&source != this) {
       Clear();
       Copy(source.value_, value_);
-      Initialize(value_);
     }
     return *this;
   }
@@ -137,6 +179,14 @@ inline bool operator<(const NodeId& a, const NodeId& b) {
   return a.get() < b.get();
 }
 
+inline bool operator==(const NodeId& a, const NodeId& b) {
+  return a.get() == b.get();
+}
+
+inline bool operator!=(const NodeId& a, const NodeId& b) {
+  return !(a == b);
+}
+
 }  // namespace opcua
 
 inline bool operator==(const opcua::NodeId& a, OpcUa_UInt32 b) {
@@ -1,34 +1,61 @@
 #pragma once
 
+#include <opcuapp/pool_allocator.h>
 #include <opcuapp/status_code.h>
 
 namespace opcua {
 
+enum class MemoryAllocator { System, Pool };
+
 class Platform {
  public:
-  Platform();
-  explicit Platform(StatusCode& status_code);
+  explicit Platform(MemoryAllocator allocator = MemoryAllocator::System);
+  explicit Platform(StatusCode& status_code,
+                    MemoryAllocator allocator = MemoryAllocator::System);
   ~Platform();
 
   OpcUa_Handle handle() const { return handle_; }
 
  private:
+  void Install(MemoryAllocator allocator);
+
   StatusCode status_code_ = OpcUa_Bad;
   OpcUa_Handle handle_ = OpcUa_Null;
+  bool pool_allocator_ = false;
 };
 
-inline Platform::Platform() {
+inline Platform::Platform(MemoryAllocator allocator) {
   status_code_ = ::OpcUa_P_Initialize(&handle_);
   Check(status_code_);
+  Install(allocator);
 }
 
-inline Platform::Platform(StatusCode& status_code) {
+inline Platform::Platform(StatusCode& status_code, MemoryAllocator allocator) {
   status_code = status_code_ = ::OpcUa_P_Initialize(&handle_);
+  if (status_code_)
+    Install(allocator);
 }
 
 inline Platform::~Platform() {
-  if (status_code_)
-    ::OpcUa_P_Clean(&handle_);
+  if (!status_code_)
+    return;
+
+  // Blocks still held, like interned values, are freed to the pool later.
+  if (pool_allocator_) {
+    PoolAllocator::Get().Uninstall(
+        *static_cast<OpcUa_Port_CallTable*>(handle_));
+  }
+  ::OpcUa_P_Clean(&handle_);
+}
+
+// The proxy stub takes the call table when it initializes, so the
+// allocator must be in place before any stack memory is allocated.
+inline void Platform::Install(MemoryAllocator allocator) {
+  if (allocator != MemoryAllocator::Pool || !handle_)
+    return;
+
+  PoolAllocator::Get().Install(*static_cast<OpcUa_Port_CallTable*>(handle_));
+  pool_allocator_ = true;
 }
 
 }  // namespace opcua
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <opcuapp/basic_types.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace opcua {
+
+// Allocator for the small blocks that dominate stack traffic. Blocks up to
+// |kMaxSize| bytes come from per-size-class slabs and are recycled through
+// per-thread caches; larger ones go to the system allocator. Slabs are
+// never returned to the system. Thread-safe.
+//
+// Blocks may outlive the installation: once uninstalled, the call table
+// allocates from the system again, but still frees pool blocks to the pool.
+// After the first uninstall, frees look up whether the pool owns a block, so
+// system blocks from that time may be freed after installing again.
+class PoolAllocator {
+ public:
+  static constexpr size_t kGranularity = 16;
+  static constexpr size_t kMaxSize = 256;
+  static constexpr size_t kClassCount = kMaxSize / kGranularity;
+
+  struct Stats {
+    // Zero for the entry counting blocks larger than |kMaxSize|.
+    size_t size;
+    uint64_t allocations;
+    uint64_t frees;
+    size_t slabs;
+  };
+
+  static PoolAllocator& Get() {
+    // Leaked: the call table routes frees here for the life of the
+    // process, including those from thread cache destructors and stack
+    // cleanup that run after static destruction.
+    static auto& allocator = *new PoolAllocator;
+    return allocator;
+  }
+
+  // Returns nullptr when out of memory.
+  void* Allocate(size_t size);
+  void* Reallocate(void* data, size_t size);
+  void Free(void* data);
+
+  // Whether |data| is a block of the pool.
+  bool Owns(const void* data) const;
+
+  // One entry per size class, then one for larger blocks.
+  std::vector<Stats> stats() const;
+
+  // Routes the memory functions of the platform call table to the pool.
+  void Install(OpcUa_Port_CallTable& calls);
+  // Restores the system allocation. Frees and reallocations of blocks still
+  // owned by the pool keep going to the pool.
+  void Uninstall(OpcUa_Port_CallTable& calls);
+
+ private:
+  static OpcUa_Void* OPCUA_DLLCALL MemAlloc(OpcUa_UInt32 size) {
+    return Get().Allocate(size);
+  }
+  static OpcUa_Void* OPCUA_DLLCALL MemReAlloc(OpcUa_Void* data,
+                                              OpcUa_UInt32 size) {
+    auto& allocator = Get();
+    if (allocator.IsSystemBlock(data))
+      return allocator.system_realloc_(data, size);
+    return allocator.Reallocate(data, size);
+  }
+  static OpcUa_Void OPCUA_DLLCALL MemFree(OpcUa_Void* data) {
+    auto& allocator = Get();
+    if (allocator.IsSystemBlock(data))
+      allocator.system_free_(data);
+    else
+      allocator.Free(data);
+  }
+
+  static OpcUa_Void* OPCUA_DLLCALL UninstalledMemReAlloc(OpcUa_Void* data,
+                                                         OpcUa_UInt32 size);
+  static OpcUa_Void OPCUA_DLLCALL UninstalledMemFree(OpcUa_Void* data);
+
+  static constexpr size_t kSlabSize = 64 * 1024;
+  // Blocks moved at once between a thread cache and the shared lists.
+  static constexpr size_t kBatchSize = 32;
+  static constexpr size_t kLargeClass = kClassCount;
+
+  // Precedes each block and keeps its payload aligned.
+  struct alignas(std::max_align_t) Header {
+    union {
+      size_t size_class;
+      Header* next;
+    };
+    // Only set for blocks larger than |kMaxSize|.
+    size_t size;
+  };
+
+  struct FreeList {
+    Header* head = nullptr;
+    size_t count = 0;
+
+    void Push(Header* block) {
+      block->next = head;
+      head = block;
+      ++count;
+    }
+
+    Header* Pop() {
+      auto* block = head;
+      head = block->next;
+      --count;
+      return block;
+    }
+
+    // Moves up to |max_count| blocks to |target|.
+    void MoveTo(FreeList& target, size_t max_count) {
+      for (; head && max_count != 0; --max_count)
+        target.Push(Pop());
+    }
+  };
+
+  struct SizeClass {
+    std::mutex mutex;
+    FreeList free;
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<size_t> slabs{0};
+  };
+
+  struct ThreadCache {
+    ~ThreadCache();
+
+    std::array<FreeList, kClassCount> free;
+  };
+
+  PoolAllocator() = default;
+
+  static size_t GetClass(size_t size) {
+    return size <= kMaxSize ? (std::max<size_t>(size, 1) - 1) / kGranularity
+                            : kLargeClass;
+  }
+
+  static size_t GetBlockSize(size_t size_class) {
+    return sizeof(Header) + (size_class + 1) * kGranularity;
+  }
+
+  static ThreadCache* GetThreadCache();
+
+  // Whether |data| came from the system while the pool was uninstalled.
+  bool IsSystemBlock(const void* data) const {
+    return data && uninstalled_.load(std::memory_order_acquire) &&
+           !Owns(data);
+  }
+
+  // Trivially destructible, so it stays readable after the cache is gone.
+  static bool& thread_cache_destroyed() {
+    static thread_local bool destroyed = false;
+    return destroyed;
+  }
+
+  // Takes a batch from the shared list, carving a new slab if it is empty.
+  bool Refill(size_t size_class, FreeList& cache);
+  void Drain(size_t size_class, FreeList& cache, size_t count);
+
+  static size_t GetSize(const Header& block) {
+    return block.size_class == kLargeClass
+               ? block.size
+               : GetBlockSize(block.size_class) - sizeof(Header);
+  }
+
+  std::array<SizeClass, kClassCount + 1> classes_;
+
+  // Only looked up once uninstalled. Slabs are sorted by address.
+  mutable std::mutex owned_mutex_;
+  std::vector<const char*> slabs_;
+  std::unordered_set<const Header*> large_blocks_;
+
+  // Set by the first Uninstall; until then every block is the pool's.
+  std::atomic<bool> uninstalled_{false};
+
+  // Saved by the first Install.
+  decltype(OpcUa_Port_CallTable::MemAlloc) system_alloc_ = nullptr;
+  decltype(OpcUa_Port_CallTable::MemReAlloc) system_realloc_ = nullptr;
+  decltype(OpcUa_Port_CallTable::MemFree) system_free_ = nullptr;
+};
+
+inline PoolAllocator::ThreadCache::~ThreadCache() {
+  thread_cache_destroyed() = true;
+  auto& allocator = PoolAllocator::Get();
+  for (size_t i = 0; i < kClassCount; ++i)
+    allocator.Drain(i, free[i], free[i].count);
+}
+
+inline PoolAllocator::ThreadCache* PoolAllocator::GetThreadCache() {
+  if (thread_cache_destroyed())
+    return nullptr;
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+inline void* PoolAllocator::Allocate(size_t size) {
+  const auto size_class = GetClass(size);
+  auto& stats = classes_[size_class];
+
+  Header* block = nullptr;
+  if (size_class == kLargeClass) {
+    block = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+    if (block) {
+      block->size = size;
+      std::lock_guard<std::mutex> lock{owned_mutex_};
+      large_blocks_.insert(block);
+    }
+  } else if (auto* cache = GetThreadCache()) {
+    auto& free = cache->free[size_class];
+    if (free.head || Refill(size_class, free))
+      block = free.Pop();
+  } else {
+    FreeList free;
+    if (Refill(size_class, free)) {
+      block = free.Pop();
+      Drain(size_class, free, free.count);
+    }
+  }
+  if (!block)
+    return nullptr;
+
+  stats.allocations.fetch_add(1, std::memory_order_relaxed);
+  block->size_class = size_class;
+  return block + 1;
+}
+
+inline void* PoolAllocator::Reallocate(void* data, size_t size) {
+  if (!data)
+    return Allocate(size);
+
+  auto* block = static_cast<Header*>(data) - 1;
+  const auto size_class = block->size_class;
+  if (size_class == kLargeClass && GetClass(size) == kLargeClass) {
+    std::lock_guard<std::mutex> lock{owned_mutex_};
+    auto* new_block =
+        static_cast<Header*>(std::realloc(block, sizeof(Header) + size));
+    if (!new_block)
+      return nullptr;
+    large_blocks_.erase(block);
+    large_blocks_.insert(new_block);
+    new_block->size = size;
+    return new_block + 1;
+  }
+  if (size_class == GetClass(size))
+    return data;
+
+  auto* new_data = Allocate(size);
+  if (!new_data)
+    return nullptr;
+  std::memcpy(new_data, data, std::min(size, GetSize(*block)));
+  Free(data);
+  return new_data;
+}
+
+inline void PoolAllocator::Free(void* data) {
+  if (!data)
+    return;
+
+  auto* block = static_cast<Header*>(data) - 1;
+  const auto size_class = block->size_class;
+  classes_[size_class].frees.fetch_add(1, std::memory_order_relaxed);
+
+  if (size_class == kLargeClass) {
+    {
+      std::lock_guard<std::mutex> lock{owned_mutex_};
+      large_blocks_.erase(block);
+    }
+    std::free(block);
+  } else if (auto* cache = GetThreadCache()) {
+    auto& free = cache->free[size_class];
+    free.Push(block);
+    if (free.count > 2 * kBatchSize)
+      Drain(size_class, free, kBatchSize);
+  } else {
+    FreeList free;
+    free.Push(block);
+    Drain(size_class, free, 1);
+  }
+}
+
+inline bool PoolAllocator::Refill(size_t size_class, FreeList& cache) {
+  auto& shared = classes_[size_class];
+  std::lock_guard<std::mutex> lock{shared.mutex};
+
+  if (!shared.free.head) {
+    auto* slab = static_cast<char*>(std::malloc(kSlabSize));
+    if (!slab)
+      return false;
+    shared.slabs.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock{owned_mutex_};
+      slabs_.insert(std::upper_bound(slabs_.begin(), slabs_.end(), slab),
+                    slab);
+    }
+    const auto block_size = GetBlockSize(size_class);
+    for (size_t offset = 0; offset + block_size <= kSlabSize;
+         offset += block_size)
+      shared.free.Push(reinterpret_cast<Header*>(slab + offset));
+  }
+
+  shared.free.MoveTo(cache, kBatchSize);
+  return true;
+}
+
+inline void PoolAllocator::Drain(size_t size_class,
+                                 FreeList& cache,
+                                 size_t count) {
+  auto& shared = classes_[size_class];
+  std::lock_guard<std::mutex> lock{shared.mutex};
+  cache.MoveTo(shared.free, count);
+}
+
+inline std::vector<PoolAllocator::Stats> PoolAllocator::stats() const {
+  std::vector<Stats> stats(classes_.size());
+  for (size_t i = 0; i < classes_.size(); ++i) {
+    auto& size_class = classes_[i];
+    stats[i].size = i == kLargeClass ? 0 : (i + 1) * kGranularity;
+    stats[i].allocations =
+        size_class.allocations.load(std::memory_order_relaxed);
+    stats[i].frees = size_class.frees.load(std::memory_order_relaxed);
+    stats[i].slabs = size_class.slabs.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+inline bool PoolAllocator::Owns(const void* data) const {
+  if (!data)
+    return false;
+
+  const auto* block = static_cast<const Header*>(data) - 1;
+  const auto* address = reinterpret_cast<const char*>(block);
+  std::lock_guard<std::mutex> lock{owned_mutex_};
+  auto i = std::upper_bound(slabs_.begin(), slabs_.end(), address);
+  if (i != slabs_.begin() && address < *std::prev(i) + kSlabSize)
+    return true;
+  return large_blocks_.count(block) != 0;
+}
+
+inline void PoolAllocator::Install(OpcUa_Port_CallTable& calls) {
+  // A table uninstalled before frees through the pool already.
+  if (calls.MemFree != &UninstalledMemFree) {
+    system_alloc_ = calls.MemAlloc;
+    system_realloc_ = calls.MemReAlloc;
+    system_free_ = calls.MemFree;
+  }
+  calls.MemAlloc = &MemAlloc;
+  calls.MemReAlloc = &MemReAlloc;
+  calls.MemFree = &MemFree;
+}
+
+inline void PoolAllocator::Uninstall(OpcUa_Port_CallTable& calls) {
+  assert(calls.MemFree == &MemFree);
+  uninstalled_.store(true, std::memory_order_release);
+  calls.MemAlloc = system_alloc_;
+  calls.MemReAlloc = &UninstalledMemReAlloc;
+  calls.MemFree = &UninstalledMemFree;
+}
+
+inline OpcUa_Void* OPCUA_DLLCALL
+PoolAllocator::UninstalledMemReAlloc(OpcUa_Void* data, OpcUa_UInt32 size) {
+  auto& allocator = Get();
+  if (!allocator.Owns(data))
+    return allocator.system_realloc_(data, size);
+
+  // Moves the block to the system allocator.
+  auto* new_data = allocator.system_alloc_(size);
+  if (!new_data)
+    return nullptr;
+  const auto& block = *(static_cast<const Header*>(data) - 1);
+  std::memcpy(new_data, data, std::min<size_t>(size, GetSize(block)));
+  allocator.Free(data);
+  return new_data;
+}
+
+inline OpcUa_Void OPCUA_DLLCALL
+PoolAllocator::UninstalledMemFree(OpcUa_Void* data) {
+  auto& allocator = Get();
+  if (allocator.Owns(data))
+    allocator.Free(data);
+  else
+    allocator.system_free_(data);
+}
+
+}  // namespace opcua
@@ -8,6 +8,8 @@ OPCUA_DEFINE_ENCODEABLE(ActivateSessionRequest);
 OPCUA_DEFINE_ENCODEABLE(ActivateSessionResponse);
 OPCUA_DEFINE_ENCODEABLE(BrowseRequest);
 OPCUA_DEFINE_ENCODEABLE(BrowseResponse);
+OPCUA_DEFINE_ENCODEABLE(BrowseNextRequest);
+OPCUA_DEFINE_ENCODEABLE(BrowseNextResponse);
 OPCUA_DEFINE_ENCODEABLE(CloseSessionRequest);
 OPCUA_DEFINE_ENCODEABLE(CloseSessionResponse);
 OPCUA_DEFINE_ENCODEABLE(CreateSessionRequest);
@@ -27,6 +29,13 @@ OPCUA_DEFINE_ENCODEABLE(PublishRequest);
 OPCUA_DEFINE_ENCODEABLE(PublishResponse);
 OPCUA_DEFINE_ENCODEABLE(ReadRequest);
 OPCUA_DEFINE_ENCODEABLE(ReadResponse);
+OPCUA_DEFINE_ENCODEABLE(RegisterNodesRequest);
+OPCUA_DEFINE_ENCODEABLE(RegisterNodesResponse);
+OPCUA_DEFINE_ENCODEABLE(TranslateBrowsePathsToNodeIdsRequest);
 OPCUA_DEFINE_ENCODEABLE(TranslateBrowsePathsToNodeIdsResponse);
+OPCUA_DEFINE_ENCODEABLE(UnregisterNodesRequest);
+OPCUA_DEFINE_ENCODEABLE(UnregisterNodesResponse);
+OPCUA_DEFINE_ENCODEABLE(WriteRequest);
+OPCUA_DEFINE_ENCODEABLE(WriteResponse);
 
 }  // namespace opcua
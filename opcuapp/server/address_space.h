@@ -0,0 +1,501 @@
+#pragma once
+
+#include <opcuapp/server/node_attributes.h>
+#include <opcuapp/server/node_state.h>
+#include <opcuapp/server/reference_index.h>
+#include <opcuapp/status_code.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+namespace detail {
+
+template <class T>
+inline T* AllocateVariantValue(OpcUa_Variant& variant, BuiltInType type) {
+  auto* value = static_cast<T*>(::OpcUa_Alloc(sizeof(T)));
+  if (!value)
+    Check(OpcUa_BadOutOfMemory);
+  Initialize(*value);
+  variant.Datatype = static_cast<Byte>(type);
+  *reinterpret_cast<T**>(&variant.Value) = value;
+  return value;
+}
+
+inline Variant MakeBooleanVariant(Boolean value) {
+  OpcUa_Variant variant;
+  Initialize(variant);
+  variant.Datatype = OpcUaType_Boolean;
+  variant.Value.Boolean = value;
+  return variant;
+}
+
+inline Variant MakeVariant(const NodeId& value) {
+  OpcUa_Variant variant;
+  Initialize(variant);
+  Variant result{std::move(variant)};
+  value.CopyTo(*AllocateVariantValue<OpcUa_NodeId>(result.get(),
+                                                   OpcUaType_NodeId));
+  return result;
+}
+
+inline Variant MakeVariant(const QualifiedName& value) {
+  OpcUa_Variant variant;
+  Initialize(variant);
+  Variant result{std::move(variant)};
+  Copy(value.get(), *AllocateVariantValue<OpcUa_QualifiedName>(
+                        result.get(), OpcUaType_QualifiedName));
+  return result;
+}
+
+inline Variant MakeVariant(const LocalizedText& value) {
+  OpcUa_Variant variant;
+  Initialize(variant);
+  Variant result{std::move(variant)};
+  auto& text = *AllocateVariantValue<OpcUa_LocalizedText>(
+      result.get(), OpcUaType_LocalizedText);
+  Copy(value.locale(), text.Locale);
+  Copy(value.text(), text.Text);
+  return result;
+}
+
+inline Variant MakeVariant(const std::vector<UInt32>& values) {
+  OpcUa_Variant variant;
+  Initialize(variant);
+  variant.Datatype = OpcUaType_UInt32;
+  variant.ArrayType = OpcUa_VariantArrayType_Array;
+  if (!values.empty()) {
+    auto* data = static_cast<UInt32*>(
+        ::OpcUa_Alloc(static_cast<UInt32>(sizeof(UInt32) * values.size())));
+    if (!data)
+      Check(OpcUa_BadOutOfMemory);
+    std::copy(values.begin(), values.end(), data);
+    variant.Value.Array.Value.UInt32Array = data;
+    variant.Value.Array.Length = static_cast<Int32>(values.size());
+  }
+  return variant;
+}
+
+// Number of nodes in the subtree of |node|, including itself.
+inline NodeIndex CountNodes(const NodeState& node) {
+  NodeIndex count = 1;
+  for (auto& child : node.children)
+    count += CountNodes(child);
+  return count;
+}
+
+}  // namespace detail
+
+// A change of the address space, as reported by a GeneralModelChangeEvent.
+struct ModelChange {
+  NodeId affected;
+  // TypeDefinition of an affected Object or Variable.
+  NodeId affected_type;
+  // OpcUa_ModelChangeStructureVerbMask bits.
+  Byte verb;
+};
+
+// Owns loaded nodes and indexes them by NodeId and by pre-order NodeIndex.
+// Rarely set attributes are kept in sparse columns of NodeAttributes.
+//
+// Nodes are immutable once added, and the indexes and attribute columns
+// are chunked, so a copy shares everything with the original. Adding nodes
+// to a copy clones only the chunks that change, which makes publishing a
+// version with a few new nodes cheap. NodeIndexes are kept by later versions.
+// Deleted nodes leave a tombstone at their NodeIndex, which isn't reused.
+class AddressSpace {
+ public:
+  // |attributes| must be keyed by pre-order index within |nodes|, as produced
+  // by the node loaders. Returns one NodeAdded change per top-level node and
+  // one ReferenceAdded change per existing node that gained references.
+  // Throws OpcUa_BadNodeIdExists, without adding anything, if
+  // CheckNewNodeIds() fails.
+  std::vector<ModelChange> AddNodes(std::vector<NodeState>&& nodes,
+                                    NodeAttributes&& attributes);
+  std::vector<ModelChange> AddNodes(std::vector<NodeState>&& nodes);
+
+  // Deletes the nodes with their children and all references from and to
+  // them. Returns one NodeDeleted change per node and one ReferenceDeleted
+  // change per remaining node that lost references. Throws
+  // OpcUa_BadNodeIdUnknown, without deleting anything, if a NodeId is
+  // unknown.
+  std::vector<ModelChange> DeleteNodes(const std::vector<NodeId>& node_ids);
+
+  // OpcUa_BadNodeIdExists if a NodeId of |nodes| or of their children is
+  // already used, or is used twice within |nodes|.
+  StatusCode CheckNewNodeIds(const std::vector<NodeState>& nodes) const;
+
+  NodeIndex GetNodeIndex(const OpcUa_NodeId& node_id) const;
+  NodeIndex GetNodeIndex(const NodeId& node_id) const {
+    return GetNodeIndex(node_id.get());
+  }
+  const NodeState* GetNode(const NodeId& node_id) const;
+
+  const NodeState& node(NodeIndex index) const { return *node_index_[index]; }
+  // Including the deleted nodes.
+  NodeIndex node_count() const {
+    return static_cast<NodeIndex>(node_index_.size());
+  }
+
+  // Deleted nodes are kept by node() but can't be found by NodeId.
+  bool is_deleted(NodeIndex index) const { return deleted_.Has(index); }
+
+  const NodeAttributes& attributes() const { return attributes_; }
+  const ReferenceIndex& references() const { return references_; }
+
+  // Changes whenever nodes are added or deleted, so derived indexes and
+  // caches can tell they are stale.
+  UInt32 model_version() const { return model_version_; }
+
+  // The model version at which the node or its references last changed.
+  UInt32 node_version(NodeIndex index) const;
+
+  // Returns OpcUa_BadAttributeIdInvalid if the node class has no such
+  // attribute. Attributes not set at load time read as their defaults.
+  StatusCode Read(NodeIndex index,
+                  AttributeId attribute_id,
+                  Variant& value) const;
+
+ private:
+  void IndexNode(const NodeState& node);
+
+  // TypeDefinition reported with the changes of |node|.
+  static NodeId GetAffectedType(const NodeState& node);
+
+  // One batch per AddNodes call.
+  ChunkedVector<std::shared_ptr<const std::vector<NodeState>>> batches_;
+  ChunkedVector<const NodeState*> node_index_;
+  // Keyed by the hash of the NodeId.
+  ChunkedHashIndex<NodeIndex> node_ids_;
+  NodeAttributes attributes_;
+  ReferenceIndex references_;
+  UInt32 model_version_ = 0;
+  ChunkedVector<UInt32> node_versions_;
+  // The model version at which each deleted node was deleted.
+  AttributeColumn<UInt32> deleted_;
+};
+
+inline std::vector<ModelChange> AddressSpace::AddNodes(
+    std::vector<NodeState>&& nodes,
+    NodeAttributes&& attributes) {
+  Check(CheckNewNodeIds(nodes));
+
+  const auto offset = node_count();
+  auto batch = std::make_shared<const std::vector<NodeState>>(std::move(nodes));
+  for (auto& node : *batch)
+    IndexNode(node);
+  nodes.clear();
+  attributes_.Append(std::move(attributes), offset);
+
+  references_.AddNodes(
+      offset, node_count(),
+      [this](NodeIndex index) -> const NodeState& { return node(index); },
+      [this](const OpcUa_NodeId& node_id) { return GetNodeIndex(node_id); });
+  ++model_version_;
+  node_versions_.resize(node_count(), model_version_);
+
+  // Children are covered by the change of their top-level node.
+  std::vector<ModelChange> changes;
+  for (auto& node : *batch) {
+    changes.push_back({node.node_id, GetAffectedType(node),
+                       OpcUa_ModelChangeStructureVerbMask_NodeAdded});
+  }
+
+  // Existing nodes gain the inverse of each reference to them.
+  for (auto index = offset; index < node_count(); ++index) {
+    for (auto& reference : references_.GetReferences(index)) {
+      const auto target = reference.target;
+      if (target >= offset || node_version(target) == model_version_)
+        continue;
+      node_versions_.Mutable(target) = model_version_;
+      const auto& node = *node_index_[target];
+      changes.push_back({node.node_id, GetAffectedType(node),
+                         OpcUa_ModelChangeStructureVerbMask_ReferenceAdded});
+    }
+  }
+
+  batches_.push_back(std::move(batch));
+  return changes;
+}
+
+inline std::vector<ModelChange> AddressSpace::AddNodes(
+    std::vector<NodeState>&& nodes) {
+  return AddNodes(std::move(nodes), NodeAttributes{});
+}
+
+inline std::vector<ModelChange> AddressSpace::DeleteNodes(
+    const std::vector<NodeId>& node_ids) {
+  std::vector<NodeIndex> roots;
+  for (auto& node_id : node_ids) {
+    const auto index = GetNodeIndex(node_id);
+    if (index == kInvalidNodeIndex)
+      Check(OpcUa_BadNodeIdUnknown);
+    roots.push_back(index);
+  }
+  std::sort(roots.begin(), roots.end());
+
+  // Children follow their parent in pre-order, so a subtree is a range of
+  // indexes. Nodes within it may be deleted already.
+  std::vector<NodeIndex> nodes;
+  NodeIndex end = 0;
+  auto root = roots.begin();
+  for (auto i = roots.begin(); i != roots.end(); ++i) {
+    // Covered by the change of its parent.
+    if (*i < end)
+      continue;
+    *root++ = *i;
+    end = *i + detail::CountNodes(*node_index_[*i]);
+    for (auto index = *i; index < end; ++index) {
+      if (!is_deleted(index))
+        nodes.push_back(index);
+    }
+  }
+  roots.erase(root, roots.end());
+
+  const auto changed = references_.DeleteNodes(
+      {nodes.data(), nodes.size()},
+      [this](NodeIndex index) -> const NodeState& { return node(index); });
+  ++model_version_;
+
+  std::vector<ModelChange> changes;
+  for (auto root : roots) {
+    const auto& node = *node_index_[root];
+    changes.push_back({node.node_id, GetAffectedType(node),
+                       OpcUa_ModelChangeStructureVerbMask_NodeDeleted});
+  }
+  for (auto index : changed) {
+    node_versions_.Mutable(index) = model_version_;
+    const auto& node = *node_index_[index];
+    changes.push_back({node.node_id, GetAffectedType(node),
+                       OpcUa_ModelChangeStructureVerbMask_ReferenceDeleted});
+  }
+
+  for (auto index : nodes) {
+    const auto& node_id = node_index_[index]->node_id.get();
+    node_ids_.Erase(detail::HashNodeId(node_id),
+                    [index](NodeIndex i) { return i == index; });
+    node_versions_.Mutable(index) = model_version_;
+    deleted_.Set(index, model_version_);
+  }
+  return changes;
+}
+
+inline StatusCode AddressSpace::CheckNewNodeIds(
+    const std::vector<NodeState>& nodes) const {
+  std::vector<const OpcUa_NodeId*> node_ids;
+  std::vector<const NodeState*> pending;
+  for (auto& node : nodes)
+    pending.push_back(&node);
+  while (!pending.empty()) {
+    const auto& node = *pending.back();
+    pending.pop_back();
+    if (GetNodeIndex(node.node_id) != kInvalidNodeIndex)
+      return OpcUa_BadNodeIdExists;
+    node_ids.push_back(&node.node_id.get());
+    for (auto& child : node.children)
+      pending.push_back(&child);
+  }
+
+  std::sort(node_ids.begin(), node_ids.end(),
+            [](const OpcUa_NodeId* a, const OpcUa_NodeId* b) {
+              return *a < *b;
+            });
+  const auto duplicate = std::adjacent_find(
+      node_ids.begin(), node_ids.end(),
+      [](const OpcUa_NodeId* a, const OpcUa_NodeId* b) { return *a == *b; });
+  return duplicate == node_ids.end() ? OpcUa_Good : OpcUa_BadNodeIdExists;
+}
+
+// static
+inline NodeId AddressSpace::GetAffectedType(const NodeState& node) {
+  return node.node_class == OpcUa_NodeClass_Object ||
+                 node.node_class == OpcUa_NodeClass_Variable
+             ? node.type_definition_id
+             : NodeId{};
+}
+
+inline UInt32 AddressSpace::node_version(NodeIndex index) const {
+  assert(index < node_count());
+  return node_versions_[index];
+}
+
+inline void AddressSpace::IndexNode(const NodeState& node) {
+  const auto index = node_count();
+  node_index_.push_back(&node);
+  node_ids_.Insert(detail::HashNodeId(node.node_id.get()), index);
+  for (auto& child : node.children)
+    IndexNode(child);
+}
+
+inline NodeIndex AddressSpace::GetNodeIndex(
+    const OpcUa_NodeId& node_id) const {
+  auto* index = node_ids_.Find(
+      detail::HashNodeId(node_id), [this, &node_id](NodeIndex index) {
+        return node_index_[index]->node_id.get() == node_id;
+      });
+  return index ? *index : kInvalidNodeIndex;
+}
+
+inline const NodeState* AddressSpace::GetNode(const NodeId& node_id) const {
+  auto index = GetNodeIndex(node_id);
+  return index != kInvalidNodeIndex ? node_index_[index] : nullptr;
+}
+
+inline StatusCode AddressSpace::Read(NodeIndex index,
+                                     AttributeId attribute_id,
+                                     Variant& value) const {
+  assert(index < node_count());
+  const auto& node = *node_index_[index];
+  const auto node_class = node.node_class;
+
+  const bool is_type = node_class == OpcUa_NodeClass_ObjectType ||
+                       node_class == OpcUa_NodeClass_VariableType ||
+                       node_class == OpcUa_NodeClass_DataType ||
+                       node_class == OpcUa_NodeClass_ReferenceType;
+  const bool is_variable = node_class == OpcUa_NodeClass_Variable;
+  const bool has_value =
+      is_variable || node_class == OpcUa_NodeClass_VariableType;
+
+  switch (attribute_id) {
+    case OpcUa_Attributes_NodeId:
+      value = detail::MakeVariant(node.node_id);
+      return OpcUa_Good;
+    case OpcUa_Attributes_NodeClass:
+      value = Variant{static_cast<Int32>(node_class)};
+      return OpcUa_Good;
+    case OpcUa_Attributes_BrowseName:
+      value = detail::MakeVariant(*node.browse_name);
+      return OpcUa_Good;
+    case OpcUa_Attributes_DisplayName:
+      value = detail::MakeVariant(*node.display_name);
+      return OpcUa_Good;
+    case OpcUa_Attributes_Description: {
+      auto* description = attributes_.description.Find(index);
+      value = description ? detail::MakeVariant(*description)
+                          : detail::MakeVariant(LocalizedText{});
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_WriteMask: {
+      auto* write_mask = attributes_.write_mask.Find(index);
+      value = Variant{write_mask ? *write_mask : UInt32{0}};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_UserWriteMask: {
+      auto* user_write_mask = attributes_.user_write_mask.Find(index);
+      value = Variant{user_write_mask ? *user_write_mask : UInt32{0}};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_IsAbstract: {
+      if (!is_type)
+        break;
+      auto* is_abstract = attributes_.is_abstract.Find(index);
+      value = detail::MakeBooleanVariant(is_abstract ? *is_abstract : False);
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_Symmetric: {
+      if (node_class != OpcUa_NodeClass_ReferenceType)
+        break;
+      auto* symmetric = attributes_.symmetric.Find(index);
+      value = detail::MakeBooleanVariant(symmetric ? *symmetric : False);
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_InverseName: {
+      if (node_class != OpcUa_NodeClass_ReferenceType)
+        break;
+      auto* inverse_name = attributes_.inverse_name.Find(index);
+      value = inverse_name ? detail::MakeVariant(*inverse_name) : Variant{};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_ContainsNoLoops: {
+      if (node_class != OpcUa_NodeClass_View)
+        break;
+      auto* contains_no_loops = attributes_.contains_no_loops.Find(index);
+      value = detail::MakeBooleanVariant(
+          contains_no_loops ? *contains_no_loops : False);
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_EventNotifier: {
+      if (node_class != OpcUa_NodeClass_Object &&
+          node_class != OpcUa_NodeClass_View)
+        break;
+      auto* event_notifier = attributes_.event_notifier.Find(index);
+      value = Variant{event_notifier ? *event_notifier : Byte{0}};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_Value:
+      if (!has_value)
+        break;
+      value = node.value.Copy();
+      return OpcUa_Good;
+    case OpcUa_Attributes_DataType:
+      if (!has_value)
+        break;
+      value = detail::MakeVariant(node.data_type_id);
+      return OpcUa_Good;
+    case OpcUa_Attributes_ValueRank: {
+      if (!has_value)
+        break;
+      auto* value_rank = attributes_.value_rank.Find(index);
+      value = Variant{value_rank ? *value_rank : Int32{-1}};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_ArrayDimensions: {
+      if (!has_value)
+        break;
+      auto* array_dimensions = attributes_.array_dimensions.Find(index);
+      value = array_dimensions ? detail::MakeVariant(*array_dimensions)
+                               : Variant{};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_AccessLevel: {
+      if (!is_variable)
+        break;
+      auto* access_level = attributes_.access_level.Find(index);
+      value = Variant{access_level ? *access_level : Byte{0}};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_UserAccessLevel: {
+      if (!is_variable)
+        break;
+      auto* user_access_level = attributes_.user_access_level.Find(index);
+      value = Variant{user_access_level ? *user_access_level : Byte{0}};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_MinimumSamplingInterval: {
+      if (!is_variable)
+        break;
+      auto* interval = attributes_.minimum_sampling_interval.Find(index);
+      value = Variant{interval ? *interval : Double{-1}};
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_Historizing: {
+      if (!is_variable)
+        break;
+      auto* historizing = attributes_.historizing.Find(index);
+      value = detail::MakeBooleanVariant(historizing ? *historizing : False);
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_Executable: {
+      if (node_class != OpcUa_NodeClass_Method)
+        break;
+      auto* executable = attributes_.executable.Find(index);
+      value = detail::MakeBooleanVariant(executable ? *executable : False);
+      return OpcUa_Good;
+    }
+    case OpcUa_Attributes_UserExecutable: {
+      if (node_class != OpcUa_NodeClass_Method)
+        break;
+      auto* user_executable = attributes_.user_executable.Find(index);
+      value = detail::MakeBooleanVariant(user_executable ? *user_executable
+                                                         : False);
+      return OpcUa_Good;
+    }
+  }
+
+  return OpcUa_BadAttributeIdInvalid;
+}
+
+}  // namespace server
+}  // namespace opcua
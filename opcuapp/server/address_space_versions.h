@@ -0,0 +1,225 @@
+#pragma once
+
+#include <opcuapp/server/address_space.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+// Publishes immutable versions of an AddressSpace. Readers pin the current
+// version without taking a lock. A writer copies the current version, which
+// shares its chunked storage, changes the copy and swaps it in atomically.
+// The copy clones only the chunks it changes.
+// Replaced versions are freed by epoch-based reclamation once no reader
+// that could have seen them is still pinned or held.
+class AddressSpaceVersions {
+ public:
+  class Snapshot {
+   public:
+    Snapshot(Snapshot&& source)
+        : versions_{source.versions_},
+          slot_{source.slot_},
+          address_space_{source.address_space_} {
+      source.slot_ = nullptr;
+      source.address_space_ = nullptr;
+    }
+
+    ~Snapshot() {
+      if (slot_)
+        slot_->store(kFreeSlot, std::memory_order_release);
+    }
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    const AddressSpace& operator*() const { return *address_space_; }
+    const AddressSpace* operator->() const { return address_space_; }
+
+    // Keeps the version alive beyond the snapshot, until the returned
+    // pointer and its copies are gone, e.g. for a continuation point. Takes
+    // no slot. The AddressSpaceVersions must outlive it.
+    std::shared_ptr<const AddressSpace> Hold() const;
+
+   private:
+    Snapshot(const AddressSpaceVersions& versions,
+             std::atomic<std::uint64_t>& slot,
+             const AddressSpace& address_space)
+        : versions_{&versions}, slot_{&slot}, address_space_{&address_space} {}
+
+    const AddressSpaceVersions* versions_;
+    std::atomic<std::uint64_t>* slot_;
+    const AddressSpace* address_space_;
+
+    friend class AddressSpaceVersions;
+  };
+
+  explicit AddressSpaceVersions(AddressSpace&& initial = AddressSpace{});
+  ~AddressSpaceVersions();
+
+  AddressSpaceVersions(const AddressSpaceVersions&) = delete;
+  AddressSpaceVersions& operator=(const AddressSpaceVersions&) = delete;
+
+  // The version stays alive while the snapshot is held. Snapshots should be
+  // short-lived, e.g. one service call.
+  Snapshot Pin() const;
+
+  // Applies |update| to a copy of the current version and publishes it.
+  // Writers are serialized; readers are never blocked.
+  void Update(const std::function<void(AddressSpace& address_space)>& update);
+
+  std::vector<ModelChange> AddNodes(std::vector<NodeState>&& nodes,
+                                    NodeAttributes&& attributes);
+  std::vector<ModelChange> DeleteNodes(const std::vector<NodeId>& node_ids);
+
+  // Frees replaced versions that are no longer pinned. Writers call it after
+  // each update.
+  void Reclaim();
+
+  // Number of replaced versions still waiting for readers.
+  size_t retired_count() const;
+
+ private:
+  static const size_t kSlotCount = 64;
+  // Slot value of a reader that is not pinned. Epochs start at 1.
+  static const std::uint64_t kFreeSlot = 0;
+
+  void ReclaimLocked();
+
+  std::atomic<const AddressSpace*> current_;
+  std::atomic<std::uint64_t> epoch_{1};
+  // Epoch of each pinned reader.
+  mutable std::array<std::atomic<std::uint64_t>, kSlotCount> slots_{};
+
+  mutable std::mutex mutex_;
+  std::vector<std::pair<std::uint64_t, std::unique_ptr<const AddressSpace>>>
+      retired_;
+
+  // Epochs of the held versions. Not guarded by |mutex_|, so a hold doesn't
+  // wait for a writer.
+  mutable std::mutex held_mutex_;
+  mutable std::multiset<std::uint64_t> held_;
+};
+
+inline AddressSpaceVersions::AddressSpaceVersions(AddressSpace&& initial)
+    : current_{new AddressSpace{std::move(initial)}} {}
+
+inline AddressSpaceVersions::~AddressSpaceVersions() {
+  assert(std::all_of(slots_.begin(), slots_.end(), [](auto& slot) {
+    return slot.load() == kFreeSlot;
+  }));
+  assert(held_.empty());
+  delete current_.load();
+}
+
+inline AddressSpaceVersions::Snapshot AddressSpaceVersions::Pin() const {
+  const auto start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  for (;;) {
+    for (size_t i = 0; i < kSlotCount; ++i) {
+      auto& slot = slots_[(start + i) % kSlotCount];
+      // The epoch is read before the version, so a version replaced at or
+      // after this epoch is kept until the slot is released.
+      auto epoch = epoch_.load();
+      auto expected = kFreeSlot;
+      if (slot.compare_exchange_strong(expected, epoch))
+        return Snapshot{*this, slot, *current_.load()};
+    }
+    std::this_thread::yield();
+  }
+}
+
+inline std::shared_ptr<const AddressSpace>
+AddressSpaceVersions::Snapshot::Hold() const {
+  auto& versions = *versions_;
+  // The slot keeps the version until the hold is visible to reclamation.
+  const auto epoch = slot_->load();
+  {
+    std::lock_guard<std::mutex> lock{versions.held_mutex_};
+    versions.held_.insert(epoch);
+  }
+  return std::shared_ptr<const AddressSpace>{
+      address_space_, [&versions, epoch](const AddressSpace*) {
+        std::lock_guard<std::mutex> lock{versions.held_mutex_};
+        versions.held_.erase(versions.held_.find(epoch));
+      }};
+}
+
+inline void AddressSpaceVersions::Update(
+    const std::function<void(AddressSpace& address_space)>& update) {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  auto next = std::make_unique<AddressSpace>(*current_.load());
+  update(*next);
+
+  std::unique_ptr<const AddressSpace> previous{
+      current_.exchange(next.release())};
+  const auto epoch = epoch_.fetch_add(1);
+  retired_.emplace_back(epoch, std::move(previous));
+
+  ReclaimLocked();
+}
+
+inline std::vector<ModelChange> AddressSpaceVersions::AddNodes(
+    std::vector<NodeState>&& nodes,
+    NodeAttributes&& attributes) {
+  std::vector<ModelChange> changes;
+  Update([&](AddressSpace& address_space) {
+    changes = address_space.AddNodes(std::move(nodes), std::move(attributes));
+  });
+  return changes;
+}
+
+inline std::vector<ModelChange> AddressSpaceVersions::DeleteNodes(
+    const std::vector<NodeId>& node_ids) {
+  std::vector<ModelChange> changes;
+  Update([&](AddressSpace& address_space) {
+    changes = address_space.DeleteNodes(node_ids);
+  });
+  return changes;
+}
+
+inline void AddressSpaceVersions::Reclaim() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  ReclaimLocked();
+}
+
+inline void AddressSpaceVersions::ReclaimLocked() {
+  auto min_epoch = epoch_.load();
+  for (auto& slot : slots_) {
+    const auto epoch = slot.load();
+    if (epoch != kFreeSlot && epoch < min_epoch)
+      min_epoch = epoch;
+  }
+  // Read after the slots: a hold is added before its slot is released.
+  {
+    std::lock_guard<std::mutex> lock{held_mutex_};
+    if (!held_.empty() && *held_.begin() < min_epoch)
+      min_epoch = *held_.begin();
+  }
+
+  // A version retired at |epoch| may be seen by readers pinned at |epoch| or
+  // earlier.
+  retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                [min_epoch](const auto& retired) {
+                                  return retired.first < min_epoch;
+                                }),
+                 retired_.end());
+}
+
+inline size_t AddressSpaceVersions::retired_count() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return retired_.size();
+}
+
+}  // namespace server
+}  // namespace opcua
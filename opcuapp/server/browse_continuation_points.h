@@ -0,0 +1,127 @@
+#pragma once
+
+#include <opcuapp/byte_string.h>
+#include <opcuapp/server/reference_index.h>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace opcua {
+namespace server {
+
+class AddressSpace;
+
+// Position of an unfinished Browse within the reference list of a node,
+// together with the filters of the original BrowseDescription.
+struct BrowseCursor {
+  // Version the cursor was made for, if held. Otherwise the cursor is only
+  // valid in versions of the same AddressSpace::model_version().
+  std::shared_ptr<const AddressSpace> address_space;
+  UInt32 model_version = 0;
+  NodeIndex node = kInvalidNodeIndex;
+  UInt32 position = 0;
+  UInt32 max_references = 0;
+  // kInvalidReferenceTypeIndex matches all reference types.
+  ReferenceTypeIndex reference_type = kInvalidReferenceTypeIndex;
+  bool include_subtypes = false;
+  OpcUa_BrowseDirection direction = OpcUa_BrowseDirection_Forward;
+  UInt32 node_class_mask = 0;
+  UInt32 result_mask = 0;
+};
+
+// Per-session storage of Browse cursors keyed by continuation point.
+class BrowseContinuationPoints {
+ public:
+  static const size_t kDefaultMaxCount = 16;
+
+  explicit BrowseContinuationPoints(size_t max_count = kDefaultMaxCount)
+      : max_count_{max_count} {}
+
+  // Returns false if all continuation points are in use.
+  bool Add(const BrowseCursor& cursor, ByteString& continuation_point);
+
+  // Removes the cursor. Returns false if |continuation_point| is unknown.
+  bool Take(const OpcUa_ByteString& continuation_point, BrowseCursor& cursor);
+
+  bool Release(const OpcUa_ByteString& continuation_point);
+
+  void Clear();
+
+  size_t size() const;
+
+ private:
+  static bool Parse(const OpcUa_ByteString& continuation_point,
+                    std::uint64_t& id);
+
+  const size_t max_count_;
+
+  mutable std::mutex mutex_;
+  std::map<std::uint64_t, BrowseCursor> cursors_;
+  std::uint64_t next_id_ = 1;
+};
+
+inline bool BrowseContinuationPoints::Add(const BrowseCursor& cursor,
+                                          ByteString& continuation_point) {
+  std::uint64_t id = 0;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (cursors_.size() >= max_count_)
+      return false;
+    id = next_id_++;
+    cursors_.emplace(id, cursor);
+  }
+
+  continuation_point = ByteString{&id, sizeof(id)};
+  return true;
+}
+
+inline bool BrowseContinuationPoints::Take(
+    const OpcUa_ByteString& continuation_point,
+    BrowseCursor& cursor) {
+  std::uint64_t id = 0;
+  if (!Parse(continuation_point, id))
+    return false;
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto i = cursors_.find(id);
+  if (i == cursors_.end())
+    return false;
+  cursor = i->second;
+  cursors_.erase(i);
+  return true;
+}
+
+inline bool BrowseContinuationPoints::Release(
+    const OpcUa_ByteString& continuation_point) {
+  std::uint64_t id = 0;
+  if (!Parse(continuation_point, id))
+    return false;
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  return cursors_.erase(id) != 0;
+}
+
+inline void BrowseContinuationPoints::Clear() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  cursors_.clear();
+}
+
+inline size_t BrowseContinuationPoints::size() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return cursors_.size();
+}
+
+// static
+inline bool BrowseContinuationPoints::Parse(
+    const OpcUa_ByteString& continuation_point,
+    std::uint64_t& id) {
+  if (continuation_point.Length != sizeof(id) || !continuation_point.Data)
+    return false;
+  std::memcpy(&id, continuation_point.Data, sizeof(id));
+  return true;
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <opcuapp/requests.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/vector.h>
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+namespace detail {
+
+inline bool IsSameBrowseName(const OpcUa_QualifiedName& a,
+                             const OpcUa_QualifiedName& b) {
+  if (a.NamespaceIndex != b.NamespaceIndex)
+    return false;
+  const char* sa = OpcUa_String_GetRawString(&a.Name);
+  const char* sb = OpcUa_String_GetRawString(&b.Name);
+  return std::strcmp(sa ? sa : "", sb ? sb : "") == 0;
+}
+
+}  // namespace detail
+
+// TranslateBrowsePathsToNodeIds over an AddressSpace.
+//
+// Each step of a RelativePath is a hash lookup of (source node, target
+// BrowseName) in ReferenceIndex, followed by its reference type bit test.
+// Resolved paths are kept in a bounded LRU cache of one model version. It is
+// replaced when a newer version is served, and a request for an older
+// version resolves without caching. Paths are resolved without holding a
+// lock.
+class BrowsePathTranslator {
+ public:
+  static const size_t kDefaultCacheSize = 1024;
+
+  explicit BrowsePathTranslator(size_t cache_size = kDefaultCacheSize)
+      : cache_size_{cache_size} {}
+
+  // Serves the version of the address space it is given.
+  TranslateBrowsePathsToNodeIdsResponse Translate(
+      const AddressSpace& address_space,
+      const OpcUa_TranslateBrowsePathsToNodeIdsRequest& request);
+
+ private:
+  struct Target {
+    NodeIndex node;
+    // Set only for targets outside of the address space.
+    const ExpandedNodeId* external_id;
+    UInt32 remaining_path_index;
+  };
+
+  struct Result {
+    StatusCode status_code;
+    std::vector<Target> targets;
+  };
+
+  using CacheList =
+      std::list<std::pair<std::string, std::shared_ptr<const Result>>>;
+
+  // Cache of one model version.
+  struct State {
+    UInt32 model_version = 0;
+
+    std::mutex cache_mutex;
+    // Most recently used first.
+    CacheList cache;
+    std::unordered_map<std::string, CacheList::iterator> cache_index;
+  };
+
+  // The state of the version of |address_space|, and whether results may be
+  // cached in it.
+  std::shared_ptr<State> GetState(const AddressSpace& address_space,
+                                  bool& cacheable);
+
+  // Returns false if the path can't match anything, e.g. because of an
+  // unknown reference type.
+  bool MakeCacheKey(const AddressSpace& address_space,
+                    NodeIndex start,
+                    Span<const OpcUa_RelativePathElement> elements,
+                    std::string& key) const;
+
+  Result Resolve(const AddressSpace& address_space,
+                 NodeIndex start,
+                 Span<const OpcUa_RelativePathElement> elements) const;
+
+  bool Matches(const AddressSpace& address_space,
+               const OpcUa_RelativePathElement& element,
+               ReferenceTypeIndex reference_type,
+               const NodeReference& reference) const;
+
+  void Translate(const AddressSpace& address_space,
+                 State& state,
+                 bool cacheable,
+                 const OpcUa_BrowsePath& path,
+                 OpcUa_BrowsePathResult& result);
+
+  void Fill(const AddressSpace& address_space,
+            const Result& source,
+            OpcUa_BrowsePathResult& result) const;
+
+  const size_t cache_size_;
+
+  // Guards |state_| only.
+  std::mutex mutex_;
+  // State of the newest version served so far.
+  std::shared_ptr<State> state_;
+};
+
+inline TranslateBrowsePathsToNodeIdsResponse BrowsePathTranslator::Translate(
+    const AddressSpace& address_space,
+    const OpcUa_TranslateBrowsePathsToNodeIdsRequest& request) {
+  TranslateBrowsePathsToNodeIdsResponse response;
+
+  Span<const OpcUa_BrowsePath> paths{
+      request.BrowsePaths, static_cast<size_t>(request.NoOfBrowsePaths)};
+  if (paths.empty()) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadNothingToDo;
+    return response;
+  }
+
+  bool cacheable = false;
+  const auto state = GetState(address_space, cacheable);
+
+  Vector<OpcUa_BrowsePathResult> results(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i)
+    Translate(address_space, *state, cacheable, paths[i], results[i]);
+
+  response.ResponseHeader.ServiceResult = OpcUa_Good;
+  response.NoOfResults = results.size();
+  response.Results = results.release();
+  return response;
+}
+
+inline std::shared_ptr<BrowsePathTranslator::State>
+BrowsePathTranslator::GetState(const AddressSpace& address_space,
+                               bool& cacheable) {
+  const auto model_version = address_space.model_version();
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (state_ && state_->model_version == model_version) {
+    cacheable = true;
+    return state_;
+  }
+
+  // Only a newer version replaces the shared cache.
+  auto state = std::make_shared<State>();
+  state->model_version = model_version;
+  cacheable = !state_ || state_->model_version < model_version;
+  if (cacheable)
+    state_ = state;
+  return state;
+}
+
+inline void BrowsePathTranslator::Translate(const AddressSpace& address_space,
+                                            State& state,
+                                            bool cacheable,
+                                            const OpcUa_BrowsePath& path,
+                                            OpcUa_BrowsePathResult& result) {
+  Span<const OpcUa_RelativePathElement> elements{
+      path.RelativePath.Elements,
+      static_cast<size_t>(path.RelativePath.NoOfElements)};
+  if (elements.empty()) {
+    result.StatusCode = OpcUa_BadNothingToDo;
+    return;
+  }
+
+  const auto start = address_space.GetNodeIndex(path.StartingNode);
+  if (start == kInvalidNodeIndex) {
+    result.StatusCode = OpcUa_BadNodeIdUnknown;
+    return;
+  }
+
+  // Only the last element may omit the target name.
+  for (size_t i = 0; i + 1 < elements.size(); ++i) {
+    if (OpcUa_String_IsEmpty(&elements[i].TargetName.Name) != OpcUa_False) {
+      result.StatusCode = OpcUa_BadBrowseNameInvalid;
+      return;
+    }
+  }
+
+  std::string key;
+  if (!MakeCacheKey(address_space, start, elements, key)) {
+    result.StatusCode = OpcUa_BadNoMatch;
+    return;
+  }
+
+  cacheable = cacheable && cache_size_ != 0;
+  if (cacheable) {
+    std::shared_ptr<const Result> cached;
+    {
+      std::lock_guard<std::mutex> lock{state.cache_mutex};
+      auto i = state.cache_index.find(key);
+      if (i != state.cache_index.end()) {
+        state.cache.splice(state.cache.begin(), state.cache, i->second);
+        cached = i->second->second;
+      }
+    }
+    if (cached) {
+      Fill(address_space, *cached, result);
+      return;
+    }
+  }
+
+  auto resolved = std::make_shared<const Result>(
+      Resolve(address_space, start, elements));
+  Fill(address_space, *resolved, result);
+  if (!cacheable)
+    return;
+
+  std::lock_guard<std::mutex> lock{state.cache_mutex};
+  // Another request may have resolved the same path meanwhile.
+  if (state.cache_index.count(key) != 0)
+    return;
+  if (state.cache.size() >= cache_size_) {
+    state.cache_index.erase(state.cache.back().first);
+    state.cache.pop_back();
+  }
+  state.cache.emplace_front(key, std::move(resolved));
+  state.cache_index.emplace(std::move(key), state.cache.begin());
+}
+
+inline bool BrowsePathTranslator::MakeCacheKey(
+    const AddressSpace& address_space,
+    NodeIndex start,
+    Span<const OpcUa_RelativePathElement> elements,
+    std::string& key) const {
+  const auto append = [&key](const void* data, size_t size) {
+    key.append(static_cast<const char*>(data), size);
+  };
+
+  append(&start, sizeof(start));
+  for (auto& element : elements) {
+    auto reference_type = kInvalidReferenceTypeIndex;
+    if (!::OpcUa_NodeId_IsNull(
+            const_cast<OpcUa_NodeId*>(&element.ReferenceTypeId))) {
+      reference_type = address_space.references().FindReferenceType(
+          element.ReferenceTypeId);
+      if (reference_type == kInvalidReferenceTypeIndex)
+        return false;
+    }
+
+    const char flags = (element.IsInverse != OpcUa_False ? 1 : 0) |
+                       (element.IncludeSubtypes != OpcUa_False ? 2 : 0);
+    const char* name = OpcUa_String_GetRawString(&element.TargetName.Name);
+    const auto name_size = static_cast<UInt32>(name ? std::strlen(name) : 0);
+
+    append(&reference_type, sizeof(reference_type));
+    append(&flags, sizeof(flags));
+    append(&element.TargetName.NamespaceIndex,
+           sizeof(element.TargetName.NamespaceIndex));
+    append(&name_size, sizeof(name_size));
+    append(name, name_size);
+  }
+  return true;
+}
+
+inline BrowsePathTranslator::Result BrowsePathTranslator::Resolve(
+    const AddressSpace& address_space,
+    NodeIndex start,
+    Span<const OpcUa_RelativePathElement> elements) const {
+  Result result{OpcUa_Good, {}};
+  const auto& references = address_space.references();
+
+  std::vector<NodeIndex> nodes{start};
+  std::vector<NodeIndex> next_nodes;
+  for (size_t i = 0; i < elements.size() && !nodes.empty(); ++i) {
+    const auto& element = elements[i];
+    const auto& target_name = element.TargetName;
+    const bool last = i + 1 == elements.size();
+    const auto reference_type =
+        ::OpcUa_NodeId_IsNull(
+            const_cast<OpcUa_NodeId*>(&element.ReferenceTypeId))
+            ? kInvalidReferenceTypeIndex
+            : address_space.references().FindReferenceType(
+                  element.ReferenceTypeId);
+
+    next_nodes.clear();
+    for (auto node : nodes) {
+      // An empty name on the last element selects all targets.
+      if (last && OpcUa_String_IsEmpty(&target_name.Name) != OpcUa_False) {
+        for (auto& reference : references.GetReferences(node)) {
+          if (reference.target != kInvalidNodeIndex &&
+              Matches(address_space, element, reference_type, reference))
+            next_nodes.push_back(reference.target);
+        }
+      } else {
+        references.ForEachChild(
+            node, detail::HashBrowseName(target_name),
+            [&](const NodeReference& reference) {
+              if (Matches(address_space, element, reference_type,
+                          reference) &&
+                  detail::IsSameBrowseName(
+                      address_space.node(reference.target).browse_name->get(),
+                      target_name))
+                next_nodes.push_back(reference.target);
+            });
+      }
+
+      // The rest of the path has to be resolved by the server owning the
+      // external target.
+      references.ForEachExternal(node, [&](const NodeReference& reference) {
+        if (Matches(address_space, element, reference_type, reference)) {
+          result.targets.push_back(
+              {kInvalidNodeIndex, reference.target_id,
+               static_cast<UInt32>(i)});
+        }
+      });
+    }
+
+    std::sort(next_nodes.begin(), next_nodes.end());
+    next_nodes.erase(std::unique(next_nodes.begin(), next_nodes.end()),
+                     next_nodes.end());
+    nodes.swap(next_nodes);
+  }
+
+  for (auto node : nodes)
+    result.targets.push_back({node, nullptr, ~UInt32{0}});
+
+  if (result.targets.empty())
+    result.status_code = OpcUa_BadNoMatch;
+  return result;
+}
+
+inline bool BrowsePathTranslator::Matches(
+    const AddressSpace& address_space,
+    const OpcUa_RelativePathElement& element,
+    ReferenceTypeIndex reference_type,
+    const NodeReference& reference) const {
+  if ((element.IsInverse != OpcUa_False) != (reference.inverse != OpcUa_False))
+    return false;
+  if (reference_type == kInvalidReferenceTypeIndex)
+    return true;
+  return element.IncludeSubtypes != OpcUa_False
+             ? address_space.references().IsSubtype(reference.reference_type,
+                                                    reference_type)
+             : reference.reference_type == reference_type;
+}
+
+inline void BrowsePathTranslator::Fill(const AddressSpace& address_space,
+                                       const Result& source,
+                                       OpcUa_BrowsePathResult& result) const {
+  result.StatusCode = source.status_code.code();
+  if (source.targets.empty())
+    return;
+
+  Vector<OpcUa_BrowsePathTarget> targets(source.targets.size());
+  for (size_t i = 0; i < targets.size(); ++i) {
+    const auto& target = source.targets[i];
+    if (target.node != kInvalidNodeIndex) {
+      address_space.node(target.node).node_id.CopyTo(
+          targets[i].TargetId.NodeId);
+    } else {
+      Copy(target.external_id->get(), targets[i].TargetId);
+    }
+    targets[i].RemainingPathIndex = target.remaining_path_index;
+  }
+
+  result.NoOfTargets = static_cast<Int32>(targets.size());
+  result.Targets = targets.release();
+}
+
+}  // namespace server
+}  // namespace opcua
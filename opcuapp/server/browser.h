@@ -0,0 +1,300 @@
+#pragma once
+
+#include <opcuapp/requests.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/address_space_versions.h>
+#include <opcuapp/server/browse_continuation_points.h>
+#include <opcuapp/vector.h>
+#include <limits>
+
+namespace opcua {
+namespace server {
+
+// Browse and BrowseNext over an AddressSpace. References come from the
+// prebuilt ReferenceIndex, so a continuation point only has to remember the
+// position within the reference list of the node.
+//
+// Each call serves the version of the address space it is given, e.g. one
+// pinned from AddressSpaceVersions. Continuation points made from a snapshot
+// hold its version, so BrowseNext continues in it while newer versions are
+// published. Others are only valid in the model version that made them.
+class Browser {
+ public:
+  BrowseResponse Browse(const AddressSpace& address_space,
+                        const OpcUa_BrowseRequest& request,
+                        BrowseContinuationPoints& continuation_points) const {
+    return Browse(address_space, nullptr, request, continuation_points);
+  }
+  BrowseResponse Browse(const AddressSpaceVersions::Snapshot& snapshot,
+                        const OpcUa_BrowseRequest& request,
+                        BrowseContinuationPoints& continuation_points) const {
+    return Browse(*snapshot, &snapshot, request, continuation_points);
+  }
+
+  BrowseNextResponse BrowseNext(
+      const AddressSpace& address_space,
+      const OpcUa_BrowseNextRequest& request,
+      BrowseContinuationPoints& continuation_points) const;
+
+ private:
+  BrowseResponse Browse(const AddressSpace& address_space,
+                        const AddressSpaceVersions::Snapshot* snapshot,
+                        const OpcUa_BrowseRequest& request,
+                        BrowseContinuationPoints& continuation_points) const;
+
+  StatusCode MakeCursor(const AddressSpace& address_space,
+                        const OpcUa_BrowseDescription& description,
+                        UInt32 max_references,
+                        BrowseCursor& cursor) const;
+
+  // |snapshot| is held by a new continuation point, if set.
+  void Browse(const AddressSpace& address_space,
+              const AddressSpaceVersions::Snapshot* snapshot,
+              BrowseCursor& cursor,
+              BrowseContinuationPoints& continuation_points,
+              OpcUa_BrowseResult& result) const;
+
+  bool Matches(const AddressSpace& address_space,
+               const BrowseCursor& cursor,
+               const NodeReference& reference) const;
+
+  void Describe(const AddressSpace& address_space,
+                const NodeReference& reference,
+                UInt32 result_mask,
+                OpcUa_ReferenceDescription& description) const;
+};
+
+inline BrowseResponse Browser::Browse(
+    const AddressSpace& address_space,
+    const AddressSpaceVersions::Snapshot* snapshot,
+    const OpcUa_BrowseRequest& request,
+    BrowseContinuationPoints& continuation_points) const {
+  BrowseResponse response;
+
+  Span<const OpcUa_BrowseDescription> descriptions{
+      request.NodesToBrowse, static_cast<size_t>(request.NoOfNodesToBrowse)};
+  if (descriptions.empty()) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadNothingToDo;
+    return response;
+  }
+
+  // Views are not supported.
+  if (!::OpcUa_NodeId_IsNull(
+          const_cast<OpcUa_NodeId*>(&request.View.ViewId))) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadViewIdUnknown;
+    return response;
+  }
+
+  Vector<OpcUa_BrowseResult> results(descriptions.size());
+  for (size_t i = 0; i < descriptions.size(); ++i) {
+    BrowseCursor cursor;
+    auto status_code =
+        MakeCursor(address_space, descriptions[i],
+                   request.RequestedMaxReferencesPerNode, cursor);
+    if (!status_code) {
+      results[i].StatusCode = status_code.code();
+      continue;
+    }
+    Browse(address_space, snapshot, cursor, continuation_points, results[i]);
+  }
+
+  response.ResponseHeader.ServiceResult = OpcUa_Good;
+  response.NoOfResults = results.size();
+  response.Results = results.release();
+  return response;
+}
+
+inline BrowseNextResponse Browser::BrowseNext(
+    const AddressSpace& address_space,
+    const OpcUa_BrowseNextRequest& request,
+    BrowseContinuationPoints& continuation_points) const {
+  BrowseNextResponse response;
+
+  Span<const OpcUa_ByteString> points{
+      request.ContinuationPoints,
+      static_cast<size_t>(request.NoOfContinuationPoints)};
+  if (points.empty()) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadNothingToDo;
+    return response;
+  }
+
+  Vector<OpcUa_BrowseResult> results(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (request.ReleaseContinuationPoints != OpcUa_False) {
+      results[i].StatusCode = continuation_points.Release(points[i])
+                                  ? OpcUa_Good
+                                  : OpcUa_BadContinuationPointInvalid;
+      continue;
+    }
+
+    BrowseCursor cursor;
+    if (!continuation_points.Take(points[i], cursor)) {
+      results[i].StatusCode = OpcUa_BadContinuationPointInvalid;
+      continue;
+    }
+    if (cursor.address_space) {
+      // Keeps the held version in the next continuation point.
+      const auto held = cursor.address_space;
+      Browse(*held, nullptr, cursor, continuation_points, results[i]);
+      continue;
+    }
+    // Positions are not valid in another version of the address space.
+    if (cursor.model_version != address_space.model_version()) {
+      results[i].StatusCode = OpcUa_BadContinuationPointInvalid;
+      continue;
+    }
+    Browse(address_space, nullptr, cursor, continuation_points, results[i]);
+  }
+
+  response.ResponseHeader.ServiceResult = OpcUa_Good;
+  response.NoOfResults = results.size();
+  response.Results = results.release();
+  return response;
+}
+
+inline StatusCode Browser::MakeCursor(
+    const AddressSpace& address_space,
+    const OpcUa_BrowseDescription& description,
+    UInt32 max_references,
+    BrowseCursor& cursor) const {
+  cursor.node = address_space.GetNodeIndex(description.NodeId);
+  if (cursor.node == kInvalidNodeIndex)
+    return OpcUa_BadNodeIdUnknown;
+
+  if (description.BrowseDirection != OpcUa_BrowseDirection_Forward &&
+      description.BrowseDirection != OpcUa_BrowseDirection_Inverse &&
+      description.BrowseDirection != OpcUa_BrowseDirection_Both)
+    return OpcUa_BadBrowseDirectionInvalid;
+
+  cursor.reference_type = kInvalidReferenceTypeIndex;
+  if (!::OpcUa_NodeId_IsNull(
+          const_cast<OpcUa_NodeId*>(&description.ReferenceTypeId))) {
+    cursor.reference_type = address_space.references().FindReferenceType(
+        description.ReferenceTypeId);
+    if (cursor.reference_type == kInvalidReferenceTypeIndex)
+      return OpcUa_BadReferenceTypeIdInvalid;
+  }
+
+  cursor.model_version = address_space.model_version();
+  cursor.position = 0;
+  cursor.max_references = max_references;
+  cursor.include_subtypes = description.IncludeSubtypes != OpcUa_False;
+  cursor.direction = description.BrowseDirection;
+  cursor.node_class_mask = description.NodeClassMask;
+  cursor.result_mask = description.ResultMask;
+  return OpcUa_Good;
+}
+
+inline void Browser::Browse(const AddressSpace& address_space,
+                            const AddressSpaceVersions::Snapshot* snapshot,
+                            BrowseCursor& cursor,
+                            BrowseContinuationPoints& continuation_points,
+                            OpcUa_BrowseResult& result) const {
+  const auto references =
+      address_space.references().GetReferences(cursor.node);
+
+  // The first pass only tests filters, so the result array is allocated once
+  // with its final size.
+  const auto max_references = cursor.max_references != 0
+                                  ? cursor.max_references
+                                  : std::numeric_limits<UInt32>::max();
+  size_t count = 0;
+  auto end = static_cast<size_t>(cursor.position);
+  for (; end < references.size(); ++end) {
+    if (!Matches(address_space, cursor, references[end]))
+      continue;
+    if (count == max_references)
+      break;
+    ++count;
+  }
+
+  Vector<OpcUa_ReferenceDescription> descriptions(count);
+  size_t index = 0;
+  for (auto i = static_cast<size_t>(cursor.position); i < end; ++i) {
+    if (Matches(address_space, cursor, references[i]))
+      Describe(address_space, references[i], cursor.result_mask,
+                 descriptions[index++]);
+  }
+  assert(index == count);
+
+  result.StatusCode = OpcUa_Good;
+  result.NoOfReferences = static_cast<Int32>(descriptions.size());
+  result.References = descriptions.release();
+
+  if (end < references.size()) {
+    cursor.position = static_cast<UInt32>(end);
+    if (snapshot && !cursor.address_space)
+      cursor.address_space = snapshot->Hold();
+    ByteString continuation_point;
+    if (continuation_points.Add(cursor, continuation_point))
+      continuation_point.swap(result.ContinuationPoint);
+    else
+      result.StatusCode = OpcUa_BadNoContinuationPoints;
+  }
+}
+
+inline bool Browser::Matches(const AddressSpace& address_space,
+                             const BrowseCursor& cursor,
+                             const NodeReference& reference) const {
+  if (cursor.direction == OpcUa_BrowseDirection_Forward && reference.inverse)
+    return false;
+  if (cursor.direction == OpcUa_BrowseDirection_Inverse && !reference.inverse)
+    return false;
+
+  if (cursor.reference_type != kInvalidReferenceTypeIndex) {
+    if (cursor.include_subtypes
+            ? !address_space.references().IsSubtype(reference.reference_type,
+                                                    cursor.reference_type)
+            : reference.reference_type != cursor.reference_type)
+      return false;
+  }
+
+  if (cursor.node_class_mask != 0) {
+    // Node class of targets outside of the address space is unknown.
+    if (reference.target == kInvalidNodeIndex)
+      return false;
+    const auto node_class = address_space.node(reference.target).node_class;
+    if ((cursor.node_class_mask & node_class) == 0)
+      return false;
+  }
+
+  return true;
+}
+
+inline void Browser::Describe(const AddressSpace& address_space,
+                              const NodeReference& reference,
+                              UInt32 result_mask,
+                              OpcUa_ReferenceDescription& description) const {
+  if (result_mask & OpcUa_BrowseResultMask_ReferenceTypeId) {
+    address_space.references()
+        .reference_type_id(reference.reference_type)
+        .CopyTo(description.ReferenceTypeId);
+  }
+  if (result_mask & OpcUa_BrowseResultMask_IsForward)
+    description.IsForward = reference.inverse ? OpcUa_False : OpcUa_True;
+
+  if (reference.target == kInvalidNodeIndex) {
+    Copy(reference.target_id->get(), description.NodeId);
+    return;
+  }
+
+  const auto& target = address_space.node(reference.target);
+  target.node_id.CopyTo(description.NodeId.NodeId);
+
+  if (result_mask & OpcUa_BrowseResultMask_NodeClass)
+    description.NodeClass = target.node_class;
+  if (result_mask & OpcUa_BrowseResultMask_BrowseName)
+    Copy(target.browse_name->get(), description.BrowseName);
+  if (result_mask & OpcUa_BrowseResultMask_DisplayName) {
+    Copy(target.display_name->locale(), description.DisplayName.Locale);
+    Copy(target.display_name->text(), description.DisplayName.Text);
+  }
+  if ((result_mask & OpcUa_BrowseResultMask_TypeDefinition) &&
+      (target.node_class == OpcUa_NodeClass_Object ||
+       target.node_class == OpcUa_NodeClass_Variable)) {
+    target.type_definition_id.CopyTo(description.TypeDefinition.NodeId);
+  }
+}
+
+}  // namespace server
+}  // namespace opcua
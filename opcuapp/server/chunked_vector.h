@@ -0,0 +1,204 @@
+#pragma once
+
+#include <opcuapp/basic_types.h>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+namespace detail {
+
+template <class T>
+inline std::shared_ptr<std::vector<T>> CloneChunk(const std::vector<T>& chunk,
+                                                  size_t capacity,
+                                                  std::true_type) {
+  auto clone = std::make_shared<std::vector<T>>();
+  clone->reserve(capacity);
+  clone->assign(chunk.begin(), chunk.end());
+  return clone;
+}
+
+// Chunks of move-only values are never shared, unless the vector itself was
+// copied, which is a bug.
+template <class T>
+inline std::shared_ptr<std::vector<T>> CloneChunk(const std::vector<T>&,
+                                                  size_t,
+                                                  std::false_type) {
+  assert(false);
+  std::terminate();
+}
+
+}  // namespace detail
+
+// Vector split into chunks that copies share, so copying costs one pointer
+// per chunk. Changing an element first clones its chunk if another copy
+// still uses it. Copies may be read concurrently while one of them changes.
+template <class T, size_t kChunkSize = 256>
+class ChunkedVector {
+ public:
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const T& operator[](size_t index) const {
+    assert(index < size_);
+    return (*chunks_[index / kChunkSize])[index % kChunkSize];
+  }
+
+  const T& back() const { return (*this)[size_ - 1]; }
+
+  T& Mutable(size_t index) {
+    assert(index < size_);
+    return MutableChunk(index / kChunkSize)[index % kChunkSize];
+  }
+
+  void push_back(T value) {
+    if (size_ % kChunkSize == 0) {
+      chunks_.emplace_back(std::make_shared<std::vector<T>>());
+      chunks_.back()->reserve(kChunkSize);
+    }
+    MutableChunk(size_ / kChunkSize).push_back(std::move(value));
+    ++size_;
+  }
+
+  // Only grows.
+  void resize(size_t size, const T& value = T{}) {
+    assert(size >= size_);
+    while (size_ < size)
+      push_back(value);
+  }
+
+  // Shifts the elements after |index|, so it costs O(size() - index).
+  void insert(size_t index, T value) {
+    assert(index <= size_);
+    push_back(std::move(value));
+    for (auto i = size_ - 1; i > index; --i)
+      std::swap(Mutable(i - 1), Mutable(i));
+  }
+
+  void clear() {
+    chunks_.clear();
+    size_ = 0;
+  }
+
+ private:
+  std::vector<T>& MutableChunk(size_t chunk_index) {
+    auto& chunk = chunks_[chunk_index];
+    if (chunk.use_count() != 1) {
+      chunk = detail::CloneChunk(*chunk, kChunkSize,
+                                 std::is_copy_constructible<T>{});
+    }
+    return *chunk;
+  }
+
+  std::vector<std::shared_ptr<std::vector<T>>> chunks_;
+  size_t size_ = 0;
+};
+
+// Hash multimap over ChunkedVectors, so copies share their storage and an
+// insert clones a couple of chunks. Values are found by hash and then by
+// the |matches| predicate of the caller, which compares the keys.
+template <class T>
+class ChunkedHashIndex {
+ public:
+  template <class Matches>
+  const T* Find(size_t hash, const Matches& matches) const {
+    if (heads_.empty())
+      return nullptr;
+    for (auto i = heads_[hash & (heads_.size() - 1)]; i != kEnd;
+         i = entries_[i].next) {
+      auto& entry = entries_[i];
+      if (entry.hash == hash && matches(entry.value))
+        return &entry.value;
+    }
+    return nullptr;
+  }
+
+  // Calls |visit| for every value of |hash|.
+  template <class Visit>
+  void ForEach(size_t hash, const Visit& visit) const {
+    if (heads_.empty())
+      return;
+    for (auto i = heads_[hash & (heads_.size() - 1)]; i != kEnd;
+         i = entries_[i].next) {
+      auto& entry = entries_[i];
+      if (entry.hash == hash)
+        visit(entry.value);
+    }
+  }
+
+  void Insert(size_t hash, T value) {
+    // Erased entries are only dropped by a rehash.
+    if (entries_.size() >= heads_.size())
+      Rehash();
+    auto& head = heads_.Mutable(hash & (heads_.size() - 1));
+    entries_.push_back({hash, head, std::move(value)});
+    head = static_cast<UInt32>(entries_.size() - 1);
+    ++size_;
+  }
+
+  // Erases every value of |hash| for which |matches| returns true. |matches|
+  // is called once per candidate and may act on the value.
+  template <class Matches>
+  void Erase(size_t hash, const Matches& matches) {
+    if (heads_.empty())
+      return;
+    const auto bucket = hash & (heads_.size() - 1);
+    auto previous = kEnd;
+    for (auto i = heads_[bucket]; i != kEnd;) {
+      const auto& entry = entries_[i];
+      const auto next = entry.next;
+      if (entry.hash == hash && matches(entry.value)) {
+        if (previous == kEnd)
+          heads_.Mutable(bucket) = next;
+        else
+          entries_.Mutable(previous).next = next;
+        --size_;
+      } else {
+        previous = i;
+      }
+      i = next;
+    }
+  }
+
+  size_t size() const { return size_; }
+
+ private:
+  static const UInt32 kEnd = static_cast<UInt32>(-1);
+
+  struct Entry {
+    size_t hash;
+    UInt32 next;
+    T value;
+  };
+
+  void Rehash() {
+    size_t bucket_count = 16;
+    while (bucket_count < (size_ + 1) * 2)
+      bucket_count *= 2;
+
+    ChunkedHashIndex index;
+    index.heads_.resize(bucket_count, kEnd);
+    for (size_t bucket = 0; bucket < heads_.size(); ++bucket) {
+      for (auto i = heads_[bucket]; i != kEnd; i = entries_[i].next)
+        index.Insert(entries_[i].hash, entries_[i].value);
+    }
+    *this = std::move(index);
+  }
+
+  ChunkedVector<UInt32> heads_;
+  ChunkedVector<Entry> entries_;
+  // Number of values not erased.
+  size_t size_ = 0;
+};
+
+template <class T>
+const UInt32 ChunkedHashIndex<T>::kEnd;
+
+}  // namespace server
+}  // namespace opcua
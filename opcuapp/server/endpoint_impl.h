@@ -66,7 +66,8 @@ class EndpointImpl : public std::enable_shared_from_this<EndpointImpl> {
   NodeId MakeAuthenticationToken();
   NodeId MakeSessionId();
 
-  std::shared_ptr<Session> CreateSession(String session_name);
+  std::shared_ptr<Session> CreateSession(String session_name,
+                                         UInt32 max_response_message_size);
   std::shared_ptr<Session> GetSession(const NodeId& authentication_token);
 
   std::vector<const OpcUa_ServiceType*> MakeSupportedServices() const;
@@ -267,15 +268,42 @@ EndpointImpl::MakeSupportedServices() const {
           static_cast<OpcUa_PfnBeginInvokeService*>(
               &BeginInvokeSession<OpcUa_ReadRequest, ReadResponse>),
       },
+      {
+          OpcUaId_WriteRequest,
+          &OpcUa_WriteResponse_EncodeableType,
+          static_cast<OpcUa_PfnBeginInvokeService*>(
+              &BeginInvokeSession<OpcUa_WriteRequest, WriteResponse>),
+      },
+      {
+          OpcUaId_RegisterNodesRequest,
+          &OpcUa_RegisterNodesResponse_EncodeableType,
+          static_cast<OpcUa_PfnBeginInvokeService*>(
+              &BeginInvokeSession<OpcUa_RegisterNodesRequest,
+                                  RegisterNodesResponse>),
+      },
+      {
+          OpcUaId_UnregisterNodesRequest,
+          &OpcUa_UnregisterNodesResponse_EncodeableType,
+          static_cast<OpcUa_PfnBeginInvokeService*>(
+              &BeginInvokeSession<OpcUa_UnregisterNodesRequest,
+                                  UnregisterNodesResponse>),
+      },
       {
           OpcUaId_BrowseRequest,
           &OpcUa_BrowseResponse_EncodeableType,
           static_cast<OpcUa_PfnBeginInvokeService*>(
               &BeginInvokeSession<OpcUa_BrowseRequest, BrowseResponse>),
       },
+      {
+          OpcUaId_BrowseNextRequest,
+          &OpcUa_BrowseNextResponse_EncodeableType,
+          static_cast<OpcUa_PfnBeginInvokeService*>(
+              &BeginInvokeSession<OpcUa_BrowseNextRequest,
+                                  BrowseNextResponse>),
+      },
       {
           OpcUaId_TranslateBrowsePathsToNodeIdsRequest,
-          &OpcUa_BrowseResponse_EncodeableType,
+          &OpcUa_TranslateBrowsePathsToNodeIdsResponse_EncodeableType,
           static_cast<OpcUa_PfnBeginInvokeService*>(
               &BeginInvokeSession<OpcUa_TranslateBrowsePathsToNodeIdsRequest,
                                   TranslateBrowsePathsToNodeIdsResponse>),
@@ -545,7 +573,8 @@ inline NodeId EndpointImpl::MakeSessionId() {
 inline void EndpointImpl::BeginInvoke(
     OpcUa_CreateSessionRequest& request,
     const std::function<void(CreateSessionResponse& response)>& callback) {
-  auto session = CreateSession(std::move(request.SessionName));
+  auto session = CreateSession(std::move(request.SessionName),
+                               request.MaxResponseMessageSize);
 
   CreateSessionResponse response;
   response.RevisedSessionTimeout = request.RequestedSessionTimeout;
@@ -646,7 +675,8 @@ inline EndpointDescription EndpointImpl::GetEndpointDescription() const {
 }
 
 inline std::shared_ptr<Session> EndpointImpl::CreateSession(
-    String session_name) {
+    String session_name,
+    UInt32 max_response_message_size) {
   std::lock_guard<std::mutex> lock{mutex_};
 
   auto session_id = MakeSessionId();
@@ -659,6 +689,7 @@ inline std::shared_ptr<Session> EndpointImpl::CreateSession(
       std::move(session_id),
       std::move(session_name),
       authentication_token,
+      max_response_message_size,
       session_handlers_,
   });
 
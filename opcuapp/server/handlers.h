@@ -2,6 +2,8 @@
 
 #include <opcuapp/data_value.h>
 #include <opcuapp/requests.h>
+#include <opcuapp/server/browse_continuation_points.h>
+#include <opcuapp/server/registered_nodes.h>
 #include <opcuapp/structs.h>
 #include <opcuapp/variant.h>
 #include <opcuapp/vector.h>
@@ -12,12 +14,31 @@ namespace opcua {
 namespace server {
 
 using ReadCallback = std::function<void(ReadResponse&& response)>;
+// Registered node aliases are replaced with their NodeIds before the call.
 using ReadHandler = std::function<void(OpcUa_ReadRequest& request,
                                        const ReadCallback& callback)>;
+// Gets the aliases as they are, with the |registered_nodes| of the calling
+// session to resolve them.
+using RegisteredReadHandler =
+    std::function<void(OpcUa_ReadRequest& request,
+                       const RegisteredNodes& registered_nodes,
+                       const ReadCallback& callback)>;
 
 using BrowseCallback = std::function<void(BrowseResponse&& response)>;
 using BrowseHandler = std::function<void(OpcUa_BrowseRequest& request,
                                          const BrowseCallback& callback)>;
+// Gets the |continuation_points| of the calling session, to keep the
+// references that don't fit the response for BrowseNext.
+using ContinuationBrowseHandler =
+    std::function<void(OpcUa_BrowseRequest& request,
+                       BrowseContinuationPoints& continuation_points,
+                       const BrowseCallback& callback)>;
+
+using BrowseNextCallback = std::function<void(BrowseNextResponse&& response)>;
+using BrowseNextHandler =
+    std::function<void(OpcUa_BrowseNextRequest& request,
+                       BrowseContinuationPoints& continuation_points,
+                       const BrowseNextCallback& callback)>;
 
 using TranslateBrowsePathsToNodeIdsCallback =
     std::function<void(TranslateBrowsePathsToNodeIdsResponse&& response)>;
@@ -25,6 +46,21 @@ using TranslateBrowsePathsToNodeIdsHandler =
     std::function<void(OpcUa_TranslateBrowsePathsToNodeIdsRequest& request,
                        const TranslateBrowsePathsToNodeIdsCallback& callback)>;
 
+using WriteCallback = std::function<void(WriteResponse&& response)>;
+using WriteHandler = std::function<void(OpcUa_WriteRequest& request,
+                                        const WriteCallback& callback)>;
+using RegisteredWriteHandler =
+    std::function<void(OpcUa_WriteRequest& request,
+                       const RegisteredNodes& registered_nodes,
+                       const WriteCallback& callback)>;
+
+using RegisterNodesCallback =
+    std::function<void(RegisterNodesResponse&& response)>;
+using RegisterNodesHandler =
+    std::function<void(OpcUa_RegisterNodesRequest& request,
+                       RegisteredNodes& registered_nodes,
+                       const RegisterNodesCallback& callback)>;
+
 using DataChangeHandler = std::function<void(DataValue&& data_value)>;
 using EventHandler = std::function<void(Vector<OpcUa_Variant>&& event_fields)>;
 
@@ -48,7 +84,15 @@ using CreateMonitoredItemHandler =
 
 struct SessionHandlers {
   ReadHandler read_handler_;
+  WriteHandler write_handler_;
+  // Used instead of |read_handler_| and |write_handler_| if set.
+  RegisteredReadHandler registered_read_handler_;
+  RegisteredWriteHandler registered_write_handler_;
+  RegisterNodesHandler register_nodes_handler_;
   BrowseHandler browse_handler_;
+  // Used instead of |browse_handler_| if set.
+  ContinuationBrowseHandler continuation_browse_handler_;
+  BrowseNextHandler browse_next_handler_;
   TranslateBrowsePathsToNodeIdsHandler
       translate_browse_paths_to_node_ids_handler_;
   CreateMonitoredItemHandler create_monitored_item_handler_;
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <opcuapp/byte_string.h>
+#include <opcuapp/date_time.h>
+#include <opcuapp/extension_object.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/handlers.h>
+#include <opcuapp/string.h>
+#include <opcuapp/structs.h>
+#include <opcuapp/timer.h>
+#include <opcuapp/vector.h>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+// Reports changes of the address space as GeneralModelChangeEvents of the
+// Server object. Changes reported within one coalescing interval go out as
+// a single event with one entry per affected node, so a client can
+// invalidate the affected subtrees instead of browsing everything again.
+template <class Timer>
+class BasicModelChangeEvents {
+ public:
+  explicit BasicModelChangeEvents(UInt32 coalescing_interval_ms);
+  ~BasicModelChangeEvents();
+
+  BasicModelChangeEvents(const BasicModelChangeEvents&) = delete;
+  BasicModelChangeEvents& operator=(const BasicModelChangeEvents&) = delete;
+
+  // Thread-safe. The verbs of a node reported more than once within the
+  // interval are merged. NodeDeleted drops the verbs reported before it, as
+  // they describe a node that no longer exists, so a node added and deleted
+  // within the interval is reported as deleted only.
+  void Report(const std::vector<ModelChange>& changes);
+
+  // Emits the pending changes as one event. Called on each timer tick.
+  void Flush();
+
+  // Creates an item for the EventNotifier of the Server object. |filter|
+  // must hold an EventFilter; its where clause isn't evaluated. The item
+  // must not outlive the BasicModelChangeEvents.
+  CreateMonitoredItemResult CreateMonitoredItem(
+      const OpcUa_ExtensionObject& filter);
+
+  size_t pending_count() const;
+
+ private:
+  enum class Field {
+    Null,
+    EventId,
+    EventType,
+    SourceNode,
+    SourceName,
+    Time,
+    ReceiveTime,
+    Message,
+    Severity,
+    Changes,
+  };
+
+  struct Event {
+    Byte event_id[16];
+    DateTime time;
+    std::vector<ModelChange> changes;
+  };
+
+  class Item;
+
+  static Field GetField(const OpcUa_SimpleAttributeOperand& operand);
+  static void MakeField(Field field, const Event& event, OpcUa_Variant& value);
+
+  void Subscribe(const std::shared_ptr<Item>& item);
+
+  Timer timer_;
+  const DateTime start_time_ = DateTime::UtcNow();
+
+  mutable std::mutex mutex_;
+  std::vector<ModelChange> pending_;
+  // Position of each affected node in |pending_|.
+  std::map<NodeId, size_t> pending_index_;
+  std::uint64_t event_count_ = 0;
+  std::vector<std::weak_ptr<Item>> items_;
+};
+
+using ModelChangeEvents = BasicModelChangeEvents<Timer>;
+
+template <class Timer>
+class BasicModelChangeEvents<Timer>::Item
+    : public MonitoredItem,
+      public std::enable_shared_from_this<Item> {
+ public:
+  Item(BasicModelChangeEvents& owner, std::vector<Field>&& fields)
+      : owner_{owner}, fields_{std::move(fields)} {}
+
+  virtual void SubscribeDataChange(
+      const DataChangeHandler& data_change_handler) override {}
+
+  virtual void SubscribeEvents(const EventHandler& event_handler) override {
+    event_handler_ = event_handler;
+    owner_.Subscribe(this->shared_from_this());
+  }
+
+  void OnEvent(const Event& event) const {
+    Vector<OpcUa_Variant> event_fields{fields_.size()};
+    for (size_t i = 0; i < fields_.size(); ++i)
+      MakeField(fields_[i], event, event_fields[i]);
+    event_handler_(std::move(event_fields));
+  }
+
+ private:
+  BasicModelChangeEvents& owner_;
+  const std::vector<Field> fields_;
+  EventHandler event_handler_;
+};
+
+template <class Timer>
+inline BasicModelChangeEvents<Timer>::BasicModelChangeEvents(
+    UInt32 coalescing_interval_ms) {
+  timer_.set_interval(coalescing_interval_ms);
+  timer_.Start([this] { Flush(); });
+}
+
+template <class Timer>
+inline BasicModelChangeEvents<Timer>::~BasicModelChangeEvents() {
+  timer_.Stop();
+}
+
+template <class Timer>
+inline void BasicModelChangeEvents<Timer>::Report(
+    const std::vector<ModelChange>& changes) {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  for (auto& change : changes) {
+    auto i = pending_index_.emplace(change.affected, pending_.size());
+    if (i.second) {
+      pending_.push_back(change);
+      continue;
+    }
+    auto& pending = pending_[i.first->second];
+    if (change.verb & OpcUa_ModelChangeStructureVerbMask_NodeDeleted)
+      pending = change;
+    else
+      pending.verb |= change.verb;
+  }
+}
+
+template <class Timer>
+inline void BasicModelChangeEvents<Timer>::Flush() {
+  Event event;
+  std::vector<std::shared_ptr<Item>> items;
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    if (pending_.empty())
+      return;
+
+    event.changes = std::move(pending_);
+    pending_.clear();
+    pending_index_.clear();
+
+    // Unique within the server: the start time and a sequence number.
+    const auto start_time = start_time_.get();
+    std::memcpy(event.event_id, &start_time, 8);
+    const auto event_number = ++event_count_;
+    std::memcpy(event.event_id + 8, &event_number, 8);
+    event.time = DateTime::UtcNow();
+
+    items.reserve(items_.size());
+    auto end = items_.begin();
+    for (auto& weak_item : items_) {
+      if (auto item = weak_item.lock()) {
+        items.emplace_back(std::move(item));
+        // A self-move may empty a weak_ptr.
+        if (&*end != &weak_item)
+          *end = std::move(weak_item);
+        ++end;
+      }
+    }
+    items_.erase(end, items_.end());
+  }
+
+  for (auto& item : items)
+    item->OnEvent(event);
+}
+
+template <class Timer>
+inline CreateMonitoredItemResult
+BasicModelChangeEvents<Timer>::CreateMonitoredItem(
+    const OpcUa_ExtensionObject& filter) {
+  if (filter.Encoding != OpcUa_ExtensionObjectEncoding_EncodeableObject ||
+      filter.Body.EncodeableObject.Type != &OpcUa_EventFilter_EncodeableType) {
+    return {OpcUa_BadMonitoredItemFilterUnsupported};
+  }
+
+  auto& event_filter = *static_cast<const OpcUa_EventFilter*>(
+      filter.Body.EncodeableObject.Object);
+  std::vector<Field> fields;
+  fields.reserve(event_filter.NoOfSelectClauses);
+  for (Int32 i = 0; i < event_filter.NoOfSelectClauses; ++i)
+    fields.push_back(GetField(event_filter.SelectClauses[i]));
+
+  return {OpcUa_Good, std::make_shared<Item>(*this, std::move(fields))};
+}
+
+template <class Timer>
+inline size_t BasicModelChangeEvents<Timer>::pending_count() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return pending_.size();
+}
+
+template <class Timer>
+inline void BasicModelChangeEvents<Timer>::Subscribe(
+    const std::shared_ptr<Item>& item) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  items_.emplace_back(item);
+}
+
+// static
+template <class Timer>
+inline typename BasicModelChangeEvents<Timer>::Field
+BasicModelChangeEvents<Timer>::GetField(
+    const OpcUa_SimpleAttributeOperand& operand) {
+  static const std::pair<const char*, Field> kFields[] = {
+      {"EventId", Field::EventId},
+      {"EventType", Field::EventType},
+      {"SourceNode", Field::SourceNode},
+      {"SourceName", Field::SourceName},
+      {"Time", Field::Time},
+      {"ReceiveTime", Field::ReceiveTime},
+      {"Message", Field::Message},
+      {"Severity", Field::Severity},
+      {"Changes", Field::Changes},
+  };
+
+  if (operand.AttributeId != OpcUa_Attributes_Value ||
+      operand.NoOfBrowsePath != 1 ||
+      operand.BrowsePath[0].NamespaceIndex != 0) {
+    return Field::Null;
+  }
+
+  const auto* name = ::OpcUa_String_GetRawString(&operand.BrowsePath[0].Name);
+  if (!name)
+    return Field::Null;
+
+  for (auto& field : kFields) {
+    if (std::strcmp(field.first, name) == 0)
+      return field.second;
+  }
+  return Field::Null;
+}
+
+// static
+template <class Timer>
+inline void BasicModelChangeEvents<Timer>::MakeField(Field field,
+                                                     const Event& event,
+                                                     OpcUa_Variant& value) {
+  switch (field) {
+    case Field::Null:
+      break;
+
+    case Field::EventId:
+      value.Datatype = OpcUaType_ByteString;
+      value.Value.ByteString =
+          ByteString{event.event_id, sizeof(event.event_id)}.release();
+      break;
+
+    case Field::EventType:
+      detail::MakeVariant(NodeId{OpcUaId_GeneralModelChangeEventType})
+          .release(value);
+      break;
+
+    case Field::SourceNode:
+      detail::MakeVariant(NodeId{OpcUaId_Server}).release(value);
+      break;
+
+    case Field::SourceName:
+      value.Datatype = OpcUaType_String;
+      String{"Server"}.release(value.Value.String);
+      break;
+
+    case Field::Time:
+    case Field::ReceiveTime:
+      Variant{event.time}.release(value);
+      break;
+
+    case Field::Message:
+      detail::MakeVariant(LocalizedText{"The address space has changed."})
+          .release(value);
+      break;
+
+    case Field::Severity:
+      value.Datatype = OpcUaType_UInt16;
+      value.Value.UInt16 = 100;
+      break;
+
+    case Field::Changes: {
+      Vector<OpcUa_ExtensionObject> changes{event.changes.size()};
+      for (size_t i = 0; i < changes.size(); ++i) {
+        auto& change = event.changes[i];
+        ModelChangeStructureDataType structure;
+        change.affected.CopyTo(structure.Affected);
+        change.affected_type.CopyTo(structure.AffectedType);
+        structure.Verb = change.verb;
+        ExtensionObject::Encode(std::move(structure)).release(changes[i]);
+      }
+      value.Datatype = OpcUaType_ExtensionObject;
+      value.ArrayType = OpcUa_VariantArrayType_Array;
+      value.Value.Array.Length = static_cast<Int32>(changes.size());
+      value.Value.Array.Value.ExtensionObjectArray = changes.release();
+      break;
+    }
+  }
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <opcuapp/basic_types.h>
+#include <opcuapp/localized_text.h>
+#include <opcuapp/server/chunked_vector.h>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+// Pre-order position of a node in the address space.
+using NodeIndex = UInt32;
+
+const NodeIndex kInvalidNodeIndex = static_cast<NodeIndex>(-1);
+
+namespace detail {
+
+inline unsigned CountBits(std::uint64_t bits) {
+  bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+  bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+  bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<unsigned>((bits * 0x0101010101010101ULL) >> 56);
+}
+
+}  // namespace detail
+
+// Sparse attribute storage. A bitmap marks the nodes that have a value, and
+// the values are kept densely in node index order. Nodes are expected to be
+// added in increasing index order, which makes Set an append. Copies share
+// the storage of unchanged nodes.
+template <class T>
+class AttributeColumn {
+ public:
+  bool Has(NodeIndex index) const {
+    const auto word = index / kWordBits;
+    return word < bits_.size() && (bits_[word] & Bit(index)) != 0;
+  }
+
+  const T* Find(NodeIndex index) const {
+    return Has(index) ? &values_[Rank(index)] : nullptr;
+  }
+
+  void Set(NodeIndex index, T value) {
+    const auto word = index / kWordBits;
+    if (word >= bits_.size()) {
+      ranks_.resize(word + 1, static_cast<UInt32>(values_.size()));
+      bits_.resize(word + 1, 0);
+    }
+
+    const auto rank = Rank(index);
+    if (bits_[word] & Bit(index)) {
+      values_.Mutable(rank) = std::move(value);
+      return;
+    }
+
+    bits_.Mutable(word) |= Bit(index);
+    values_.insert(rank, std::move(value));
+    for (auto i = word + 1; i < ranks_.size(); ++i)
+      ++ranks_.Mutable(i);
+  }
+
+  // Moves the values of |source| in, shifting its indexes by |offset|.
+  // |offset| must not be less than any index already set.
+  void Append(AttributeColumn&& source, NodeIndex offset) {
+    for (size_t word = 0; word < source.bits_.size(); ++word) {
+      for (auto bits = source.bits_[word]; bits != 0; bits &= bits - 1) {
+        const auto bit = detail::CountBits((bits & (~bits + 1)) - 1);
+        const auto source_index =
+            static_cast<NodeIndex>(word * kWordBits + bit);
+        Set(offset + source_index,
+            std::move(source.values_.Mutable(source.Rank(source_index))));
+      }
+    }
+    source = AttributeColumn{};
+  }
+
+  size_t size() const { return values_.size(); }
+
+ private:
+  static const size_t kWordBits = 64;
+
+  static std::uint64_t Bit(NodeIndex index) {
+    return std::uint64_t{1} << (index % kWordBits);
+  }
+
+  size_t Rank(NodeIndex index) const {
+    const auto word = index / kWordBits;
+    assert(word < bits_.size());
+    return ranks_[word] + detail::CountBits(bits_[word] & (Bit(index) - 1));
+  }
+
+  ChunkedVector<std::uint64_t> bits_;
+  // Number of values before each bitmap word.
+  ChunkedVector<UInt32> ranks_;
+  ChunkedVector<T> values_;
+};
+
+// Attributes that are absent or default for most nodes.
+struct NodeAttributes {
+  AttributeColumn<LocalizedText> description;
+  AttributeColumn<UInt32> write_mask;
+  AttributeColumn<UInt32> user_write_mask;
+  AttributeColumn<Boolean> is_abstract;
+  AttributeColumn<Boolean> symmetric;
+  AttributeColumn<LocalizedText> inverse_name;
+  AttributeColumn<Boolean> contains_no_loops;
+  AttributeColumn<Byte> event_notifier;
+  AttributeColumn<Int32> value_rank;
+  AttributeColumn<std::vector<UInt32>> array_dimensions;
+  AttributeColumn<Byte> access_level;
+  AttributeColumn<Byte> user_access_level;
+  AttributeColumn<Double> minimum_sampling_interval;
+  AttributeColumn<Boolean> historizing;
+  AttributeColumn<Boolean> executable;
+  AttributeColumn<Boolean> user_executable;
+
+  void Append(NodeAttributes&& source, NodeIndex offset) {
+    description.Append(std::move(source.description), offset);
+    write_mask.Append(std::move(source.write_mask), offset);
+    user_write_mask.Append(std::move(source.user_write_mask), offset);
+    is_abstract.Append(std::move(source.is_abstract), offset);
+    symmetric.Append(std::move(source.symmetric), offset);
+    inverse_name.Append(std::move(source.inverse_name), offset);
+    contains_no_loops.Append(std::move(source.contains_no_loops), offset);
+    event_notifier.Append(std::move(source.event_notifier), offset);
+    value_rank.Append(std::move(source.value_rank), offset);
+    array_dimensions.Append(std::move(source.array_dimensions), offset);
+    access_level.Append(std::move(source.access_level), offset);
+    user_access_level.Append(std::move(source.user_access_level), offset);
+    minimum_sampling_interval.Append(
+        std::move(source.minimum_sampling_interval), offset);
+    historizing.Append(std::move(source.historizing), offset);
+    executable.Append(std::move(source.executable), offset);
+    user_executable.Append(std::move(source.user_executable), offset);
+  }
+};
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <opcuapp/mapped_file.h>
+#include <opcuapp/server/address_space_versions.h>
+#include <opcuapp/server/node_loader.h>
+#include <opcuapp/server/node_writer.h>
+#include <opcuapp/stream.h>
+#include <opcuapp/string_table.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace opcua {
+namespace server {
+
+namespace detail {
+
+// Flushes the system buffers of the file at |path| to the disk.
+inline bool SyncFile(const std::string& path) {
+#if defined(_WIN32)
+  const int fd = ::_open(path.c_str(), _O_WRONLY | _O_BINARY);
+  if (fd == -1)
+    return false;
+  const bool synced = ::_commit(fd) == 0;
+  ::_close(fd);
+#else
+  const int fd = ::open(path.c_str(), O_WRONLY);
+  if (fd == -1)
+    return false;
+  const bool synced = ::fsync(fd) == 0;
+  ::close(fd);
+#endif
+  return synced;
+}
+
+}  // namespace detail
+
+// Persists nodes added at runtime. The model is kept in a .uanodes snapshot
+// at |path| and a journal at |path|.journal, to which each batch is appended
+// as a length-prefixed .uanodes image of its own. A batch is synced to the
+// disk before it is added, so added nodes survive a crash of the process or
+// of the system. Compact() writes the current version to a fresh snapshot
+// in the background and starts a new journal, so a restart is a load of the
+// snapshot and a short replay. Deletions are not journaled.
+class NodeJournal {
+ public:
+  // |namespace_uris| must outlive the journal.
+  NodeJournal(const StringTable& namespace_uris, std::string path);
+  ~NodeJournal();
+
+  NodeJournal(const NodeJournal&) = delete;
+  NodeJournal& operator=(const NodeJournal&) = delete;
+
+  // Loads the snapshot and replays the journal, one AddNodes per batch. A
+  // batch torn by a crash is dropped. Batches whose nodes are all loaded
+  // already are skipped, as they were compacted before the crash; a batch
+  // with only some of them throws.
+  void Load(AddressSpaceVersions& versions);
+
+  // Appends the batch to the journal, then adds it to |versions|. Batches
+  // must be added through the journal for Compact() to see them in order.
+  // Throws OpcUa_BadNodeIdExists before writing anything if a NodeId is
+  // used already. Returns the changes to report to clients.
+  std::vector<ModelChange> AddNodes(AddressSpaceVersions& versions,
+                                    std::vector<NodeState>&& nodes,
+                                    NodeAttributes&& attributes);
+
+  // Starts writing the current version of |versions| to a fresh snapshot.
+  // Returns false if a compaction is still running.
+  bool Compact(const AddressSpaceVersions& versions);
+
+  // Waits for the running compaction and rethrows its error.
+  void WaitForCompaction();
+
+  // Batches appended since the last compaction.
+  size_t batch_count() const;
+
+ private:
+  static bool ReadFile(const std::string& path, std::vector<char>& data);
+
+  // Counts |nodes| and their children, and those of them that
+  // |address_space| has.
+  static void CountNodes(const AddressSpace& address_space,
+                         const std::vector<NodeState>& nodes,
+                         size_t& count,
+                         size_t& loaded_count);
+
+  void Replay(const std::string& path, AddressSpaceVersions& versions);
+  void WriteSnapshot(const AddressSpace& address_space) const;
+
+  const StringTable& namespace_uris_;
+  const std::string snapshot_path_;
+  const std::string journal_path_;
+  // Journal of a running or interrupted compaction.
+  const std::string compacting_path_;
+
+  mutable std::mutex mutex_;
+  std::ofstream journal_;
+  size_t batch_count_ = 0;
+  std::future<void> compaction_;
+};
+
+inline NodeJournal::NodeJournal(const StringTable& namespace_uris,
+                                std::string path)
+    : namespace_uris_{namespace_uris},
+      snapshot_path_{std::move(path)},
+      journal_path_{snapshot_path_ + ".journal"},
+      compacting_path_{snapshot_path_ + ".journal.old"} {}
+
+inline NodeJournal::~NodeJournal() {
+  if (compaction_.valid())
+    compaction_.wait();
+}
+
+// static
+inline bool NodeJournal::ReadFile(const std::string& path,
+                                  std::vector<char>& data) {
+  std::ifstream stream{path, std::ios::in | std::ios::binary};
+  if (!stream)
+    return false;
+  data.assign(std::istreambuf_iterator<char>{stream},
+              std::istreambuf_iterator<char>{});
+  return true;
+}
+
+// static
+inline void NodeJournal::CountNodes(const AddressSpace& address_space,
+                                    const std::vector<NodeState>& nodes,
+                                    size_t& count,
+                                    size_t& loaded_count) {
+  for (auto& node : nodes) {
+    ++count;
+    if (address_space.GetNodeIndex(node.node_id) != kInvalidNodeIndex)
+      ++loaded_count;
+    CountNodes(address_space, node.children, count, loaded_count);
+  }
+}
+
+inline void NodeJournal::Load(AddressSpaceVersions& versions) {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  {
+    MappedFile snapshot;
+    if (snapshot.Open(snapshot_path_)) {
+      NodeAttributes attributes;
+      auto nodes =
+          LoadPredefinedNodes(namespace_uris_, snapshot.data(), attributes);
+      versions.AddNodes(std::move(nodes), std::move(attributes));
+    }
+  }
+
+  Replay(compacting_path_, versions);
+  Replay(journal_path_, versions);
+
+  journal_.open(journal_path_,
+                std::ios::out | std::ios::binary | std::ios::app);
+  if (!journal_)
+    throw std::runtime_error("Can't open node journal");
+}
+
+inline void NodeJournal::Replay(const std::string& path,
+                                AddressSpaceVersions& versions) {
+  std::vector<char> data;
+  if (!ReadFile(path, data))
+    return;
+
+  size_t pos = 0;
+  while (data.size() - pos >= 4) {
+    UInt32 size = 0;
+    for (size_t i = 0; i < 4; ++i)
+      size |= UInt32{static_cast<Byte>(data[pos + i])} << (8 * i);
+    if (data.size() - pos - 4 < size)
+      break;
+
+    NodeAttributes attributes;
+    auto nodes = LoadPredefinedNodes(
+        namespace_uris_, Span<const char>{data.data() + pos + 4, size},
+        attributes);
+    size_t count = 0;
+    size_t loaded_count = 0;
+    CountNodes(*versions.Pin(), nodes, count, loaded_count);
+    if (loaded_count != 0 && loaded_count != count)
+      throw std::runtime_error("Node journal doesn't match the snapshot");
+    if (loaded_count == 0 && count != 0) {
+      versions.AddNodes(std::move(nodes), std::move(attributes));
+      ++batch_count_;
+    }
+
+    pos += 4 + size;
+  }
+
+  // Drops a torn batch, so that later batches aren't appended after it.
+  if (pos != data.size()) {
+    std::ofstream stream{path,
+                         std::ios::out | std::ios::binary | std::ios::trunc};
+    stream.write(data.data(), pos);
+  }
+}
+
+inline std::vector<ModelChange> NodeJournal::AddNodes(
+    AddressSpaceVersions& versions,
+    std::vector<NodeState>&& nodes,
+    NodeAttributes&& attributes) {
+  ChunkedOutputStream data;
+  SavePredefinedNodes(namespace_uris_, nodes, attributes, data.get());
+
+  char header[4];
+  const auto size = static_cast<UInt32>(data.size());
+  for (size_t i = 0; i < 4; ++i)
+    header[i] = static_cast<char>((size >> (8 * i)) & 0xFF);
+
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  // Versions change only through the journal, so the check holds until the
+  // batch is added.
+  Check(versions.Pin()->CheckNewNodeIds(nodes));
+
+  journal_.write(header, sizeof(header));
+  data.WriteTo(journal_);
+  journal_.flush();
+  if (!journal_ || !detail::SyncFile(journal_path_))
+    throw std::runtime_error("Can't write node journal");
+  ++batch_count_;
+
+  return versions.AddNodes(std::move(nodes), std::move(attributes));
+}
+
+inline bool NodeJournal::Compact(const AddressSpaceVersions& versions) {
+  std::lock_guard<std::mutex> lock{mutex_};
+
+  if (compaction_.valid()) {
+    if (compaction_.wait_for(std::chrono::seconds{0}) !=
+        std::future_status::ready) {
+      return false;
+    }
+    compaction_.get();
+  }
+
+  journal_.close();
+
+  if (std::ifstream{compacting_path_}) {
+    // Keeps the batches of an interrupted compaction with the new ones.
+    std::ofstream stream{compacting_path_,
+                         std::ios::out | std::ios::binary | std::ios::app};
+    std::vector<char> journal;
+    ReadFile(journal_path_, journal);
+    stream.write(journal.data(), journal.size());
+    if (!stream)
+      throw std::runtime_error("Can't write node journal");
+    std::remove(journal_path_.c_str());
+  } else {
+    std::rename(journal_path_.c_str(), compacting_path_.c_str());
+  }
+
+  journal_.open(journal_path_,
+                std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!journal_)
+    throw std::runtime_error("Can't open node journal");
+  batch_count_ = 0;
+
+  // The copy shares the node storage, so the version isn't pinned while
+  // the snapshot is written.
+  AddressSpace address_space = *versions.Pin();
+  compaction_ = std::async(
+      std::launch::async,
+      [this, address_space = std::move(address_space)] {
+        WriteSnapshot(address_space);
+        std::remove(compacting_path_.c_str());
+      });
+  return true;
+}
+
+inline void NodeJournal::WriteSnapshot(
+    const AddressSpace& address_space) const {
+  const auto temp_path = snapshot_path_ + ".tmp";
+  {
+    std::ofstream stream{temp_path,
+                         std::ios::out | std::ios::binary | std::ios::trunc};
+    SavePredefinedNodes(namespace_uris_, address_space, stream);
+    stream.flush();
+    if (!stream)
+      throw std::runtime_error("Can't write node snapshot");
+  }
+  // The journal is dropped once the snapshot replaces it, so the snapshot
+  // must be on the disk first.
+  if (!detail::SyncFile(temp_path))
+    throw std::runtime_error("Can't write node snapshot");
+
+  // Replaces the snapshot atomically where rename allows it.
+  if (std::rename(temp_path.c_str(), snapshot_path_.c_str()) != 0) {
+    std::remove(snapshot_path_.c_str());
+    if (std::rename(temp_path.c_str(), snapshot_path_.c_str()) != 0)
+      throw std::runtime_error("Can't replace node snapshot");
+  }
+}
+
+inline void NodeJournal::WaitForCompaction() {
+  std::future<void> compaction;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    compaction = std::move(compaction_);
+  }
+  if (compaction.valid())
+    compaction.get();
+}
+
+inline size_t NodeJournal::batch_count() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return batch_count_;
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -1,18 +1,21 @@
 #pragma once
 
-#include <opcuapp/binary_decoder.h>
+#include <opcuapp/binary_reader.h>
 #include <opcuapp/encodable_type_table.h>
+#include <opcuapp/mapped_file.h>
+#include <opcuapp/server/node_attributes.h>
 #include <opcuapp/server/node_state.h>
-#include <opcuapp/stream.h>
 #include <opcuapp/string_table.h>
 #include <opcuapp/structs.h>
 #include <istream>
+#include <iterator>
+#include <string>
 #include <vector>
 
 namespace opcua {
 namespace server {
 
-opcua::BinaryDecoder::NamespaceMapping MakeNamespaceMapping(
+inline opcua::BinaryDecoder::NamespaceMapping MakeNamespaceMapping(
     const StringTable& local,
     const StringTable& global) {
   opcua::BinaryDecoder::NamespaceMapping mapping;
@@ -27,10 +30,46 @@ opcua::BinaryDecoder::NamespaceMapping MakeNamespaceMapping(
   return mapping;
 }
 
+// Attribute mask bits of the .uanodes format.
+enum class AttributesToSave {
+  None = 0x00000000,
+  AccessLevel = 0x00000001,
+  ArrayDimensions = 0x00000002,
+  BrowseName = 0x00000004,
+  ContainsNoLoops = 0x00000008,
+  DataType = 0x00000010,
+  Description = 0x00000020,
+  DisplayName = 0x00000040,
+  EventNotifier = 0x00000080,
+  Executable = 0x00000100,
+  Historizing = 0x00000200,
+  InverseName = 0x00000400,
+  IsAbstract = 0x00000800,
+  MinimumSamplingInterval = 0x00001000,
+  NodeClass = 0x00002000,
+  NodeId = 0x00004000,
+  Symmetric = 0x00008000,
+  UserAccessLevel = 0x00010000,
+  UserExecutable = 0x00020000,
+  UserWriteMask = 0x00040000,
+  ValueRank = 0x00080000,
+  WriteMask = 0x00100000,
+  Value = 0x00200000,
+  SymbolicName = 0x00400000,
+  TypeDefinitionId = 0x00800000,
+  ModellingRuleId = 0x01000000,
+  NumericId = 0x02000000,
+  ReferenceTypeId = 0x08000000,
+  SuperTypeId = 0x10000000,
+  StatusCode = 0x20000000,
+};
+
 struct NodeLoaderContext {
-  BinaryDecoder& decoder_;
+  BinaryReader& decoder_;
   std::vector<NodeState>& nodes_;
   const StringTable& namespace_uris_;
+  // Keyed by pre-order index of the loaded nodes.
+  NodeAttributes& attributes_;
 };
 
 class NodeLoader : private NodeLoaderContext {
@@ -40,39 +79,6 @@ class NodeLoader : private NodeLoaderContext {
   void LoadNodes();
 
  private:
-  enum class AttributesToSave {
-    None = 0x00000000,
-    AccessLevel = 0x00000001,
-    ArrayDimensions = 0x00000002,
-    BrowseName = 0x00000004,
-    ContainsNoLoops = 0x00000008,
-    DataType = 0x00000010,
-    Description = 0x00000020,
-    DisplayName = 0x00000040,
-    EventNotifier = 0x00000080,
-    Executable = 0x00000100,
-    Historizing = 0x00000200,
-    InverseName = 0x00000400,
-    IsAbstract = 0x00000800,
-    MinimumSamplingInterval = 0x00001000,
-    NodeClass = 0x00002000,
-    NodeId = 0x00004000,
-    Symmetric = 0x00008000,
-    UserAccessLevel = 0x00010000,
-    UserExecutable = 0x00020000,
-    UserWriteMask = 0x00040000,
-    ValueRank = 0x00080000,
-    WriteMask = 0x00100000,
-    Value = 0x00200000,
-    SymbolicName = 0x00400000,
-    TypeDefinitionId = 0x00800000,
-    ModellingRuleId = 0x01000000,
-    NumericId = 0x02000000,
-    ReferenceTypeId = 0x08000000,
-    SuperTypeId = 0x10000000,
-    StatusCode = 0x20000000,
-  };
-
   NodeState LoadNode();
   NodeState LoadUnknownNode(unsigned& attribute_mask,
                             NodeClass node_class,
@@ -98,9 +104,12 @@ class NodeLoader : private NodeLoaderContext {
 
   static bool HasAttribute(unsigned& attribute_mask,
                            AttributesToSave attribute_id);
+
+  NodeIndex next_node_index_ = 0;
+  NodeIndex node_index_ = kInvalidNodeIndex;
 };
 
-void LoadStringTable(BinaryDecoder& decoder, StringTable& strings) {
+inline void LoadStringTable(BinaryReader& decoder, StringTable& strings) {
   auto count = decoder.Read<Int32>();
   for (Int32 i = 0; i < count; ++i)
     strings.Append(decoder.Read<String>());
@@ -140,6 +149,8 @@ inline bool NodeLoader::HasAttribute(unsigned& attribute_mask,
 }
 
 inline NodeState NodeLoader::LoadNode() {
+  node_index_ = next_node_index_++;
+
   auto attribute_mask = decoder_.Read<uint32_t>();
 
   if (!HasAttribute(attribute_mask, AttributesToSave::NodeClass))
@@ -198,17 +209,17 @@ inline NodeState NodeLoader::LoadUnknownChild(unsigned& attribute_mask,
 
   if (HasAttribute(attribute_mask, AttributesToSave::DisplayName))
     node.display_name = decoder_.Read<LocalizedText>();
-  else if (!node.browse_name.empty())
-    node.display_name = node.browse_name.name();
+  else if (!node.browse_name->empty())
+    node.display_name = LocalizedText{node.browse_name->name()};
 
   if (HasAttribute(attribute_mask, AttributesToSave::Description))
-    decoder_.Read<LocalizedText>();
+    attributes_.description.Set(node_index_, decoder_.Read<LocalizedText>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::WriteMask))
-    decoder_.Read<UInt32>();
+    attributes_.write_mask.Set(node_index_, decoder_.Read<UInt32>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::UserWriteMask))
-    decoder_.Read<UInt32>();
+    attributes_.user_write_mask.Set(node_index_, decoder_.Read<UInt32>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::ReferenceTypeId))
     node.reference_type_id = decoder_.Read<NodeId>();
@@ -259,7 +270,7 @@ inline void NodeLoader::LoadBaseAttributes(unsigned& attribute_mask,
     node.node_class = decoder_.ReadEnum<NodeClass>();
 
   if (HasAttribute(attribute_mask, AttributesToSave::SymbolicName))
-    decoder_.Read<String>();
+    decoder_.ReadStringView();
 
   if (HasAttribute(attribute_mask, AttributesToSave::BrowseName))
     node.browse_name = decoder_.Read<QualifiedName>();
@@ -267,19 +278,20 @@ inline void NodeLoader::LoadBaseAttributes(unsigned& attribute_mask,
   if (HasAttribute(attribute_mask, AttributesToSave::NodeId))
     node.node_id = decoder_.Read<NodeId>();
 
+  // Instances have read their DisplayName already.
   if (HasAttribute(attribute_mask, AttributesToSave::DisplayName))
     node.display_name = decoder_.Read<LocalizedText>();
-  else if (!node.browse_name.empty())
-    node.display_name = node.browse_name.name();
+  else if (node.display_name->empty() && !node.browse_name->empty())
+    node.display_name = LocalizedText{node.browse_name->name()};
 
   if (HasAttribute(attribute_mask, AttributesToSave::Description))
-    decoder_.Read<LocalizedText>();
+    attributes_.description.Set(node_index_, decoder_.Read<LocalizedText>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::WriteMask))
-    decoder_.Read<UInt32>();
+    attributes_.write_mask.Set(node_index_, decoder_.Read<UInt32>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::UserWriteMask))
-    decoder_.Read<UInt32>();
+    attributes_.user_write_mask.Set(node_index_, decoder_.Read<UInt32>());
 }
 
 inline void NodeLoader::LoadTypeAttributes(unsigned& attribute_mask,
@@ -290,7 +302,7 @@ inline void NodeLoader::LoadTypeAttributes(unsigned& attribute_mask,
     node.super_type_id = decoder_.Read<NodeId>();
 
   if (HasAttribute(attribute_mask, AttributesToSave::IsAbstract))
-    decoder_.Read<Boolean>();
+    attributes_.is_abstract.Set(node_index_, decoder_.Read<Boolean>());
 }
 
 inline void NodeLoader::LoadReferenceTypeAttributes(unsigned& attribute_mask,
@@ -298,10 +310,10 @@ inline void NodeLoader::LoadReferenceTypeAttributes(unsigned& attribute_mask,
   LoadTypeAttributes(attribute_mask, node);
 
   if (HasAttribute(attribute_mask, AttributesToSave::InverseName))
-    decoder_.Read<LocalizedText>();
+    attributes_.inverse_name.Set(node_index_, decoder_.Read<LocalizedText>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::Symmetric))
-    decoder_.Read<Boolean>();
+    attributes_.symmetric.Set(node_index_, decoder_.Read<Boolean>());
 }
 
 inline void NodeLoader::LoadVariableTypeAttributes(unsigned& attribute_mask,
@@ -310,17 +322,17 @@ inline void NodeLoader::LoadVariableTypeAttributes(unsigned& attribute_mask,
 
   if (HasAttribute(attribute_mask, AttributesToSave::Value)) {
     node.value = decoder_.Read<Variant>();
-    assert(!node.value.is_null());
+    assert(!node.value->is_null());
   }
 
   if (HasAttribute(attribute_mask, AttributesToSave::DataType))
     node.data_type_id = decoder_.Read<NodeId>();
 
   if (HasAttribute(attribute_mask, AttributesToSave::ValueRank))
-    decoder_.Read<Int32>();
+    attributes_.value_rank.Set(node_index_, decoder_.Read<Int32>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::ArrayDimensions))
-    decoder_.ReadArray<UInt32>();
+    attributes_.array_dimensions.Set(node_index_, decoder_.ReadArray<UInt32>());
 }
 
 inline void NodeLoader::LoadVariableAttributes(unsigned& attribute_mask,
@@ -329,7 +341,7 @@ inline void NodeLoader::LoadVariableAttributes(unsigned& attribute_mask,
 
   if (HasAttribute(attribute_mask, AttributesToSave::Value)) {
     node.value = decoder_.Read<Variant>();
-    assert(!node.value.is_null());
+    assert(!node.value->is_null());
   }
 
   if (HasAttribute(attribute_mask, AttributesToSave::StatusCode))
@@ -339,22 +351,28 @@ inline void NodeLoader::LoadVariableAttributes(unsigned& attribute_mask,
     node.data_type_id = decoder_.Read<NodeId>();
 
   if (HasAttribute(attribute_mask, AttributesToSave::ValueRank))
-    decoder_.Read<Int32>();
+    attributes_.value_rank.Set(node_index_, decoder_.Read<Int32>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::ArrayDimensions))
-    decoder_.ReadArray<UInt32>();
+    attributes_.array_dimensions.Set(node_index_, decoder_.ReadArray<UInt32>());
 
-  if (HasAttribute(attribute_mask, AttributesToSave::AccessLevel))
-    decoder_.Read<SByte>();
+  if (HasAttribute(attribute_mask, AttributesToSave::AccessLevel)) {
+    attributes_.access_level.Set(node_index_,
+                                 static_cast<Byte>(decoder_.Read<SByte>()));
+  }
 
-  if (HasAttribute(attribute_mask, AttributesToSave::UserAccessLevel))
-    decoder_.Read<SByte>();
+  if (HasAttribute(attribute_mask, AttributesToSave::UserAccessLevel)) {
+    attributes_.user_access_level.Set(
+        node_index_, static_cast<Byte>(decoder_.Read<SByte>()));
+  }
 
-  if (HasAttribute(attribute_mask, AttributesToSave::MinimumSamplingInterval))
-    decoder_.Read<Double>();
+  if (HasAttribute(attribute_mask, AttributesToSave::MinimumSamplingInterval)) {
+    attributes_.minimum_sampling_interval.Set(node_index_,
+                                              decoder_.Read<Double>());
+  }
 
   if (HasAttribute(attribute_mask, AttributesToSave::Historizing))
-    decoder_.Read<Boolean>();
+    attributes_.historizing.Set(node_index_, decoder_.Read<Boolean>());
 }
 
 inline void NodeLoader::LoadMethodAttributes(unsigned& attribute_mask,
@@ -362,10 +380,10 @@ inline void NodeLoader::LoadMethodAttributes(unsigned& attribute_mask,
   LoadInstanceAttributes(attribute_mask, node);
 
   if (HasAttribute(attribute_mask, AttributesToSave::Executable))
-    decoder_.Read<Boolean>();
+    attributes_.executable.Set(node_index_, decoder_.Read<Boolean>());
 
   if (HasAttribute(attribute_mask, AttributesToSave::UserExecutable))
-    decoder_.Read<Boolean>();
+    attributes_.user_executable.Set(node_index_, decoder_.Read<Boolean>());
 }
 
 inline void NodeLoader::LoadInstanceAttributes(unsigned& attribute_mask,
@@ -389,8 +407,10 @@ inline void NodeLoader::LoadObjectAttributes(unsigned& attribute_mask,
                                              NodeState& node) {
   LoadInstanceAttributes(attribute_mask, node);
 
-  if (HasAttribute(attribute_mask, AttributesToSave::EventNotifier))
-    decoder_.Read<SByte>();
+  if (HasAttribute(attribute_mask, AttributesToSave::EventNotifier)) {
+    attributes_.event_notifier.Set(node_index_,
+                                   static_cast<Byte>(decoder_.Read<SByte>()));
+  }
 }
 
 inline void NodeLoader::LoadNodeReferences(NodeState& node) {
@@ -419,6 +439,8 @@ inline void NodeLoader::LoadNodeChildren(NodeState& parent) {
 }
 
 inline NodeState NodeLoader::LoadChild() {
+  node_index_ = next_node_index_++;
+
   auto attribute_mask = decoder_.Read<uint32_t>();
 
   if (!HasAttribute(attribute_mask, AttributesToSave::NodeClass))
@@ -442,16 +464,15 @@ inline NodeState NodeLoader::LoadChild() {
 
 inline std::vector<NodeState> LoadPredefinedNodes(
     const StringTable& namespace_uris,
-    std::istream& stream) {
+    Span<const char> data,
+    NodeAttributes& attributes) {
   EncodableTypeTable types;
   types.AddKnownTypes();
 
   MessageContext context;
   context.KnownTypes = &types.get();
 
-  BinaryDecoder decoder;
-  StdInputStream input{stream};
-  decoder.Open(input.get(), context);
+  BinaryReader decoder{data, context};
 
   std::vector<NodeState> nodes;
 
@@ -459,11 +480,38 @@ inline std::vector<NodeState> LoadPredefinedNodes(
       decoder,
       nodes,
       namespace_uris,
+      attributes,
   }};
   loader.LoadNodes();
 
   return nodes;
 }
 
+inline std::vector<NodeState> LoadPredefinedNodes(
+    const StringTable& namespace_uris,
+    std::istream& stream,
+    NodeAttributes& attributes) {
+  const std::vector<char> data{std::istreambuf_iterator<char>{stream},
+                               std::istreambuf_iterator<char>{}};
+  return LoadPredefinedNodes(namespace_uris, {data.data(), data.size()},
+                             attributes);
+}
+
+// Decodes the file in place from a read-only mapping.
+inline std::vector<NodeState> LoadPredefinedNodes(
+    const StringTable& namespace_uris,
+    const std::string& path,
+    NodeAttributes& attributes) {
+  const MappedFile file{path};
+  return LoadPredefinedNodes(namespace_uris, file.data(), attributes);
+}
+
+inline std::vector<NodeState> LoadPredefinedNodes(
+    const StringTable& namespace_uris,
+    std::istream& stream) {
+  NodeAttributes attributes;
+  return LoadPredefinedNodes(namespace_uris, stream, attributes);
+}
+
 }  // namespace server
 }  // namespace opcua
@@ -0,0 +1,1045 @@
+#pragma once
+
+#include <opcuapp/server/node_loader.h>
+#include <opcuapp/xml_reader.h>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace opcua {
+namespace server {
+
+namespace detail {
+
+inline bool StartsWith(const std::string& str, const char* prefix) {
+  return str.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+inline Boolean ParseBoolean(const std::string& text) {
+  return text == "true" || text == "1";
+}
+
+// ISO 8601 to ticks (100 ns) since 1601-01-01. Times without an offset are
+// UTC.
+inline OpcUa_DateTime ParseDateTime(const std::string& text) {
+  int year = 0, month = 1, day = 1, hour = 0, minute = 0;
+  double second = 0;
+  int end = 0;
+  std::sscanf(text.c_str(), "%d-%d-%dT%d:%d:%lf%n", &year, &month, &day,
+              &hour, &minute, &second, &end);
+
+  // +hh:mm or -hh:mm, which is subtracted to get UTC.
+  int offset_minutes = 0;
+  if (end != 0 && (text[end] == '+' || text[end] == '-')) {
+    int offset_hour = 0, offset_minute = 0;
+    std::sscanf(text.c_str() + end + 1, "%d:%d", &offset_hour,
+                &offset_minute);
+    offset_minutes = (text[end] == '-' ? -1 : 1) *
+                     (offset_hour * 60 + offset_minute);
+  }
+
+  // Days from civil.
+  year -= month <= 2;
+  const long long era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(year - era * 400);
+  const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  const long long days = era * 146097 + static_cast<long long>(doe) - 719468;
+
+  const long long seconds = days * 86400 + hour * 3600 +
+                            (minute - offset_minutes) * 60LL +
+                            static_cast<long long>(second) + 11644473600LL;
+  auto ticks = static_cast<unsigned long long>(
+      seconds * 10000000LL +
+      static_cast<long long>((second - static_cast<long long>(second)) * 1e7));
+
+  OpcUa_DateTime result;
+  result.dwLowDateTime = static_cast<UInt32>(ticks & 0xFFFFFFFF);
+  result.dwHighDateTime = static_cast<UInt32>(ticks >> 32);
+  return result;
+}
+
+inline void ParseGuid(const std::string& text, OpcUa_Guid& guid) {
+  unsigned data1 = 0, data2 = 0, data3 = 0, data4[8] = {};
+  if (std::sscanf(text.c_str(), "%8x-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x", &data1,
+                  &data2, &data3, &data4[0], &data4[1], &data4[2], &data4[3],
+                  &data4[4], &data4[5], &data4[6], &data4[7]) != 11)
+    throw std::runtime_error("Invalid Guid");
+  guid.Data1 = data1;
+  guid.Data2 = static_cast<UInt16>(data2);
+  guid.Data3 = static_cast<UInt16>(data3);
+  for (int i = 0; i < 8; ++i)
+    guid.Data4[i] = static_cast<Byte>(data4[i]);
+}
+
+inline void DecodeBase64(const std::string& text, OpcUa_ByteString& result) {
+  std::vector<Byte> bytes;
+  bytes.reserve(text.size() * 3 / 4);
+  unsigned buffer = 0;
+  int bits = 0;
+  for (char c : text) {
+    int value;
+    if (c >= 'A' && c <= 'Z')
+      value = c - 'A';
+    else if (c >= 'a' && c <= 'z')
+      value = c - 'a' + 26;
+    else if (c >= '0' && c <= '9')
+      value = c - '0' + 52;
+    else if (c == '+')
+      value = 62;
+    else if (c == '/')
+      value = 63;
+    else
+      continue;
+    buffer = (buffer << 6) | value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      bytes.push_back(static_cast<Byte>(buffer >> bits));
+    }
+  }
+
+  ::OpcUa_ByteString_Initialize(&result);
+  if (bytes.empty())
+    return;
+  result.Data = static_cast<OpcUa_Byte*>(::OpcUa_Alloc(bytes.size()));
+  if (!result.Data)
+    Check(OpcUa_BadOutOfMemory);
+  std::memcpy(result.Data, bytes.data(), bytes.size());
+  result.Length = static_cast<Int32>(bytes.size());
+}
+
+template <class T>
+inline T* AllocateValue() {
+  auto* value = static_cast<T*>(::OpcUa_Alloc(sizeof(T)));
+  if (!value)
+    Check(OpcUa_BadOutOfMemory);
+  std::memset(value, 0, sizeof(T));
+  return value;
+}
+
+inline NodeId ParseNodeId(const std::string& text,
+                          const BinaryDecoder::NamespaceMapping& mapping) {
+  OpcUa_NodeId node_id;
+  Initialize(node_id);
+  if (text.empty())
+    return node_id;
+
+  const char* p = text.c_str();
+  if (std::strncmp(p, "ns=", 3) == 0) {
+    char* end = nullptr;
+    auto namespace_index =
+        static_cast<NamespaceIndex>(std::strtoul(p + 3, &end, 10));
+    if (*end != ';')
+      throw std::runtime_error("Invalid NodeId");
+    auto i = mapping.find(namespace_index);
+    node_id.NamespaceIndex = i == mapping.end() ? namespace_index : i->second;
+    p = end + 1;
+  }
+
+  if (p[0] == '\0' || p[1] != '=')
+    throw std::runtime_error("Invalid NodeId");
+
+  switch (p[0]) {
+    case 'i':
+      node_id.IdentifierType = OpcUa_IdentifierType_Numeric;
+      node_id.Identifier.Numeric = std::strtoul(p + 2, nullptr, 10);
+      break;
+    case 's':
+      node_id.IdentifierType = OpcUa_IdentifierType_String;
+      String{p + 2}.release(node_id.Identifier.String);
+      break;
+    case 'g':
+      node_id.IdentifierType = OpcUa_IdentifierType_Guid;
+      node_id.Identifier.Guid = AllocateValue<OpcUa_Guid>();
+      ParseGuid(p + 2, *node_id.Identifier.Guid);
+      break;
+    case 'b':
+      node_id.IdentifierType = OpcUa_IdentifierType_Opaque;
+      DecodeBase64(p + 2, node_id.Identifier.ByteString);
+      break;
+    default:
+      throw std::runtime_error("Invalid NodeId");
+  }
+
+  return node_id;
+}
+
+inline ExpandedNodeId ParseExpandedNodeId(
+    const std::string& text,
+    const BinaryDecoder::NamespaceMapping& mapping) {
+  OpcUa_ExpandedNodeId expanded_node_id;
+  Initialize(expanded_node_id);
+
+  size_t pos = 0;
+  if (StartsWith(text, "svr=")) {
+    pos = text.find(';');
+    expanded_node_id.ServerIndex = std::strtoul(text.c_str() + 4, nullptr, 10);
+    pos = pos == std::string::npos ? text.size() : pos + 1;
+  }
+
+  if (text.compare(pos, 4, "nsu=") == 0) {
+    auto end = text.find(';', pos);
+    if (end == std::string::npos)
+      throw std::runtime_error("Invalid ExpandedNodeId");
+    String{text.substr(pos + 4, end - pos - 4).c_str()}.release(
+        expanded_node_id.NamespaceUri);
+    pos = end + 1;
+  }
+
+  ParseNodeId(text.substr(pos), mapping).release(expanded_node_id.NodeId);
+  return expanded_node_id;
+}
+
+inline OpcUa_BuiltInType GetBuiltInType(const char* name) {
+  static const std::pair<const char*, OpcUa_BuiltInType> kTypes[] = {
+      {"Boolean", OpcUaType_Boolean},
+      {"SByte", OpcUaType_SByte},
+      {"Byte", OpcUaType_Byte},
+      {"Int16", OpcUaType_Int16},
+      {"UInt16", OpcUaType_UInt16},
+      {"Int32", OpcUaType_Int32},
+      {"UInt32", OpcUaType_UInt32},
+      {"Int64", OpcUaType_Int64},
+      {"UInt64", OpcUaType_UInt64},
+      {"Float", OpcUaType_Float},
+      {"Double", OpcUaType_Double},
+      {"String", OpcUaType_String},
+      {"DateTime", OpcUaType_DateTime},
+      {"Guid", OpcUaType_Guid},
+      {"ByteString", OpcUaType_ByteString},
+      {"NodeId", OpcUaType_NodeId},
+      {"ExpandedNodeId", OpcUaType_ExpandedNodeId},
+      {"StatusCode", OpcUaType_StatusCode},
+      {"QualifiedName", OpcUaType_QualifiedName},
+      {"LocalizedText", OpcUaType_LocalizedText},
+      {"ExtensionObject", OpcUaType_ExtensionObject},
+  };
+  for (auto& type : kTypes) {
+    if (std::strcmp(type.first, name) == 0)
+      return type.second;
+  }
+  return OpcUaType_Null;
+}
+
+inline size_t GetBuiltInTypeSize(OpcUa_BuiltInType type) {
+  switch (type) {
+    case OpcUaType_Boolean:
+      return sizeof(OpcUa_Boolean);
+    case OpcUaType_SByte:
+      return sizeof(OpcUa_SByte);
+    case OpcUaType_Byte:
+      return sizeof(OpcUa_Byte);
+    case OpcUaType_Int16:
+      return sizeof(OpcUa_Int16);
+    case OpcUaType_UInt16:
+      return sizeof(OpcUa_UInt16);
+    case OpcUaType_Int32:
+      return sizeof(OpcUa_Int32);
+    case OpcUaType_UInt32:
+      return sizeof(OpcUa_UInt32);
+    case OpcUaType_Int64:
+      return sizeof(OpcUa_Int64);
+    case OpcUaType_UInt64:
+      return sizeof(OpcUa_UInt64);
+    case OpcUaType_Float:
+      return sizeof(OpcUa_Float);
+    case OpcUaType_Double:
+      return sizeof(OpcUa_Double);
+    case OpcUaType_String:
+      return sizeof(OpcUa_String);
+    case OpcUaType_DateTime:
+      return sizeof(OpcUa_DateTime);
+    case OpcUaType_Guid:
+      return sizeof(OpcUa_Guid);
+    case OpcUaType_ByteString:
+      return sizeof(OpcUa_ByteString);
+    case OpcUaType_NodeId:
+      return sizeof(OpcUa_NodeId);
+    case OpcUaType_ExpandedNodeId:
+      return sizeof(OpcUa_ExpandedNodeId);
+    case OpcUaType_StatusCode:
+      return sizeof(OpcUa_StatusCode);
+    case OpcUaType_QualifiedName:
+      return sizeof(OpcUa_QualifiedName);
+    case OpcUaType_LocalizedText:
+      return sizeof(OpcUa_LocalizedText);
+    case OpcUaType_ExtensionObject:
+      return sizeof(OpcUa_ExtensionObject);
+    default:
+      assert(false);
+      return 0;
+  }
+}
+
+// Scalars of these types are stored in OpcUa_Variant by pointer.
+inline bool IsPointerScalar(OpcUa_BuiltInType type) {
+  switch (type) {
+    case OpcUaType_Guid:
+    case OpcUaType_NodeId:
+    case OpcUaType_ExpandedNodeId:
+    case OpcUaType_QualifiedName:
+    case OpcUaType_LocalizedText:
+    case OpcUaType_ExtensionObject:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Moves scalars of the same type into one array allocation.
+inline Variant MakeArray(OpcUa_BuiltInType type,
+                         std::deque<Variant>& elements) {
+  OpcUa_Variant result;
+  Initialize(result);
+  result.Datatype = static_cast<Byte>(type);
+  result.ArrayType = OpcUa_VariantArrayType_Array;
+  if (elements.empty())
+    return result;
+
+  const auto size = GetBuiltInTypeSize(type);
+  auto* data = static_cast<Byte*>(::OpcUa_Alloc(size * elements.size()));
+  if (!data)
+    Check(OpcUa_BadOutOfMemory);
+
+  const bool pointer_scalar = IsPointerScalar(type);
+  for (size_t i = 0; i < elements.size(); ++i) {
+    auto& element = elements[i].get();
+    assert(element.Datatype == type);
+    void* value = &element.Value;
+    if (pointer_scalar)
+      value = *static_cast<void**>(value);
+    std::memcpy(data + i * size, value, size);
+    if (pointer_scalar)
+      ::OpcUa_Free(value);
+    Initialize(element);
+  }
+
+  result.Value.Array.Length = static_cast<Int32>(elements.size());
+  result.Value.Array.Value.Array = data;
+  return result;
+}
+
+}  // namespace detail
+
+using NodeStateHandler = std::function<void(NodeState&& node)>;
+
+struct NodeSetLoaderContext {
+  XmlReader& reader_;
+  const StringTable& namespace_uris_;
+  const NodeStateHandler& handler_;
+  // Keyed by pre-order index of the loaded nodes.
+  NodeAttributes& attributes_;
+};
+
+// Loads nodes from an XML node set, passing each top-level node to the handler
+// as soon as it is read. Supports the UANodeSet (NodeSet2) schema and the
+// ListOfNodeState format the predefined nodes are distributed in.
+class NodeSetLoader : private NodeSetLoaderContext {
+ public:
+  explicit NodeSetLoader(NodeSetLoaderContext&& context);
+
+  void LoadNodes();
+
+ private:
+  void LoadUANodeSet();
+  void LoadNamespaceUris();
+  void LoadAliases();
+  NodeState LoadUANode(NodeClass node_class);
+  void LoadUAReferences(NodeState& node);
+
+  void LoadNodeStateList();
+  NodeState LoadNodeState();
+  void LoadNodeStateReferences(NodeState& node);
+
+  bool IsField() const;
+  NodeId ReadNodeIdField();
+  ExpandedNodeId ReadExpandedNodeIdField();
+  QualifiedName ReadQualifiedName();
+  LocalizedText ReadLocalizedText();
+  Variant ReadValueField();
+  Variant ReadVariant();
+  Variant ReadScalar(OpcUa_BuiltInType type);
+
+  bool SetAttribute(NodeIndex node_index,
+                    const char* name,
+                    const std::string& text);
+
+  NodeId ParseNodeId(const std::string& text) const;
+  QualifiedName ParseQualifiedName(const std::string& text) const;
+
+  static NodeClass GetUANodeClass(const char* name);
+  static LocalizedText MakeLocalizedText(const std::string& locale,
+                                         const std::string& text);
+
+  BinaryDecoder::NamespaceMapping namespace_mapping_;
+  std::unordered_map<std::string, NodeId> aliases_;
+  std::string fields_prefix_;
+  NodeIndex next_node_index_ = 0;
+};
+
+inline NodeSetLoader::NodeSetLoader(NodeSetLoaderContext&& context)
+    : NodeSetLoaderContext{std::move(context)} {}
+
+inline void NodeSetLoader::LoadNodes() {
+  while (reader_.Read() != XmlReader::NodeType::StartElement) {
+    if (reader_.node_type() == XmlReader::NodeType::EndOfStream)
+      return;
+  }
+
+  if (std::strcmp(reader_.local_name(), "UANodeSet") == 0)
+    LoadUANodeSet();
+  else if (std::strcmp(reader_.local_name(), "ListOfNodeState") == 0)
+    LoadNodeStateList();
+  else
+    throw std::runtime_error("Unknown node set format");
+}
+
+inline void NodeSetLoader::LoadUANodeSet() {
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    const char* name = reader_.local_name();
+    if (std::strcmp(name, "NamespaceUris") == 0) {
+      LoadNamespaceUris();
+    } else if (std::strcmp(name, "Aliases") == 0) {
+      LoadAliases();
+    } else {
+      auto node_class = GetUANodeClass(name);
+      if (node_class == OpcUa_NodeClass_Unspecified)
+        reader_.Skip();
+      else
+        handler_(LoadUANode(node_class));
+    }
+  }
+}
+
+inline void NodeSetLoader::LoadNamespaceUris() {
+  StringTable namespace_uris;
+  namespace_uris.Append("http://opcfoundation.org/UA/");
+
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    if (std::strcmp(reader_.local_name(), "Uri") == 0)
+      namespace_uris.Append(reader_.ReadElementText().c_str());
+    else
+      reader_.Skip();
+  }
+
+  namespace_mapping_ = MakeNamespaceMapping(namespace_uris, namespace_uris_);
+}
+
+inline void NodeSetLoader::LoadAliases() {
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    const char* alias = reader_.GetAttribute("Alias");
+    if (std::strcmp(reader_.local_name(), "Alias") != 0 || !alias) {
+      reader_.Skip();
+      continue;
+    }
+    std::string name = alias;
+    aliases_[std::move(name)] = ParseNodeId(reader_.ReadElementText());
+  }
+}
+
+inline NodeState NodeSetLoader::LoadUANode(NodeClass node_class) {
+  const auto node_index = next_node_index_++;
+
+  NodeState node;
+  node.node_class = node_class;
+
+  // Attribute values are invalidated by the next read.
+  for (auto& attribute : reader_.attributes()) {
+    if (attribute.first == "NodeId")
+      node.node_id = ParseNodeId(attribute.second);
+    else if (attribute.first == "BrowseName")
+      node.browse_name = ParseQualifiedName(attribute.second);
+    else if (attribute.first == "ParentNodeId")
+      node.parent_id = ParseNodeId(attribute.second);
+    else if (attribute.first == "DataType")
+      node.data_type_id = ParseNodeId(attribute.second);
+    else
+      SetAttribute(node_index, attribute.first.c_str(), attribute.second);
+  }
+
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    const char* name = reader_.local_name();
+    if (std::strcmp(name, "DisplayName") == 0) {
+      const char* locale = reader_.GetAttribute("Locale");
+      std::string locale_string = locale ? locale : "";
+      node.display_name =
+          MakeLocalizedText(locale_string, reader_.ReadElementText());
+    } else if (std::strcmp(name, "Description") == 0 ||
+               std::strcmp(name, "InverseName") == 0) {
+      auto& column = name[0] == 'D' ? attributes_.description
+                                    : attributes_.inverse_name;
+      const char* locale = reader_.GetAttribute("Locale");
+      std::string locale_string = locale ? locale : "";
+      column.Set(node_index,
+                 MakeLocalizedText(locale_string, reader_.ReadElementText()));
+    } else if (std::strcmp(name, "References") == 0) {
+      LoadUAReferences(node);
+    } else if (std::strcmp(name, "Value") == 0) {
+      const auto value_depth = reader_.depth();
+      if (reader_.ReadChildElement(value_depth)) {
+        node.value = ReadVariant();
+        while (reader_.ReadChildElement(value_depth))
+          reader_.Skip();
+      }
+    } else {
+      reader_.Skip();
+    }
+  }
+
+  if (node.display_name->empty() && !node.browse_name->empty())
+    node.display_name = LocalizedText{node.browse_name->name()};
+
+  return node;
+}
+
+inline void NodeSetLoader::LoadUAReferences(NodeState& node) {
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    if (std::strcmp(reader_.local_name(), "Reference") != 0) {
+      reader_.Skip();
+      continue;
+    }
+
+    const char* reference_type = reader_.GetAttribute("ReferenceType");
+    const char* is_forward = reader_.GetAttribute("IsForward");
+    auto reference_type_id =
+        ParseNodeId(reference_type ? reference_type : std::string{});
+    bool inverse = is_forward && !detail::ParseBoolean(is_forward);
+    auto target_id = ParseNodeId(reader_.ReadElementText());
+
+    if (!inverse && reference_type_id == OpcUaId_HasTypeDefinition) {
+      node.type_definition_id = std::move(target_id);
+    } else if (inverse && reference_type_id == OpcUaId_HasSubtype) {
+      node.super_type_id = std::move(target_id);
+    } else if (inverse && !node.parent_id.IsNull() &&
+               target_id == node.parent_id &&
+               node.reference_type_id.IsNull()) {
+      node.reference_type_id = std::move(reference_type_id);
+    } else {
+      node.references.push_back(
+          {std::move(reference_type_id), inverse, std::move(target_id)});
+    }
+  }
+}
+
+inline void NodeSetLoader::LoadNodeStateList() {
+  fields_prefix_ = "uax:";
+  for (auto& attribute : reader_.attributes()) {
+    if (detail::StartsWith(attribute.first, "xmlns:") &&
+        attribute.second == "http://opcfoundation.org/UA/2008/02/Types.xsd")
+      fields_prefix_ = attribute.first.substr(6) + ':';
+  }
+
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth))
+    handler_(LoadNodeState());
+}
+
+inline NodeState NodeSetLoader::LoadNodeState() {
+  const auto node_index = next_node_index_++;
+
+  NodeState node;
+  node.node_class = OpcUa_NodeClass_Unspecified;
+
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    if (!IsField()) {
+      node.children.emplace_back(LoadNodeState());
+      continue;
+    }
+
+    const char* name = reader_.local_name();
+    if (std::strcmp(name, "NodeClass") == 0) {
+      auto text = reader_.ReadElementText();
+      auto p = text.rfind('_');
+      if (p == std::string::npos)
+        throw std::runtime_error("Invalid node class");
+      node.node_class = static_cast<NodeClass>(std::atoi(text.c_str() + p + 1));
+    } else if (std::strcmp(name, "NodeId") == 0) {
+      node.node_id = ReadNodeIdField();
+    } else if (std::strcmp(name, "BrowseName") == 0) {
+      node.browse_name = ReadQualifiedName();
+    } else if (std::strcmp(name, "DisplayName") == 0) {
+      node.display_name = ReadLocalizedText();
+    } else if (std::strcmp(name, "Description") == 0) {
+      attributes_.description.Set(node_index, ReadLocalizedText());
+    } else if (std::strcmp(name, "InverseName") == 0) {
+      attributes_.inverse_name.Set(node_index, ReadLocalizedText());
+    } else if (std::strcmp(name, "ReferenceTypeId") == 0) {
+      node.reference_type_id = ReadNodeIdField();
+    } else if (std::strcmp(name, "TypeDefinitionId") == 0) {
+      node.type_definition_id = ReadNodeIdField();
+    } else if (std::strcmp(name, "SuperTypeId") == 0) {
+      node.super_type_id = ReadNodeIdField();
+    } else if (std::strcmp(name, "DataType") == 0) {
+      node.data_type_id = ReadNodeIdField();
+    } else if (std::strcmp(name, "Value") == 0) {
+      node.value = ReadValueField();
+    } else if (std::strcmp(name, "References") == 0) {
+      LoadNodeStateReferences(node);
+    } else {
+      const std::string field_name = name;
+      SetAttribute(node_index, field_name.c_str(), reader_.ReadElementText());
+    }
+  }
+
+  if (node.node_class == OpcUa_NodeClass_Unspecified)
+    throw std::runtime_error("No node class attribute");
+
+  if (node.display_name->empty() && !node.browse_name->empty())
+    node.display_name = LocalizedText{node.browse_name->name()};
+
+  return node;
+}
+
+inline void NodeSetLoader::LoadNodeStateReferences(NodeState& node) {
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    NodeId reference_type_id;
+    Boolean inverse = false;
+    ExpandedNodeId target_id;
+
+    const auto reference_depth = reader_.depth();
+    while (reader_.ReadChildElement(reference_depth)) {
+      const char* name = reader_.local_name();
+      if (std::strcmp(name, "ReferenceTypeId") == 0)
+        reference_type_id = ReadNodeIdField();
+      else if (std::strcmp(name, "IsInverse") == 0)
+        inverse = detail::ParseBoolean(reader_.ReadElementText());
+      else if (std::strcmp(name, "TargetId") == 0)
+        target_id = ReadExpandedNodeIdField();
+      else
+        reader_.Skip();
+    }
+
+    node.references.push_back(
+        {std::move(reference_type_id), inverse, std::move(target_id)});
+  }
+}
+
+inline bool NodeSetLoader::IsField() const {
+  return reader_.name().compare(0, fields_prefix_.size(), fields_prefix_) == 0;
+}
+
+inline NodeId NodeSetLoader::ReadNodeIdField() {
+  NodeId result;
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    if (std::strcmp(reader_.local_name(), "Identifier") == 0)
+      result = ParseNodeId(reader_.ReadElementText());
+    else
+      reader_.Skip();
+  }
+  return result;
+}
+
+inline ExpandedNodeId NodeSetLoader::ReadExpandedNodeIdField() {
+  ExpandedNodeId result;
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    if (std::strcmp(reader_.local_name(), "Identifier") == 0)
+      result = detail::ParseExpandedNodeId(reader_.ReadElementText(),
+                                           namespace_mapping_);
+    else
+      reader_.Skip();
+  }
+  return result;
+}
+
+inline QualifiedName NodeSetLoader::ReadQualifiedName() {
+  OpcUa_QualifiedName result;
+  Initialize(result);
+  QualifiedName qualified_name{std::move(result)};
+
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    const char* name = reader_.local_name();
+    if (std::strcmp(name, "NamespaceIndex") == 0) {
+      auto namespace_index = static_cast<NamespaceIndex>(
+          std::strtoul(reader_.ReadElementText().c_str(), nullptr, 10));
+      auto i = namespace_mapping_.find(namespace_index);
+      qualified_name.get().NamespaceIndex =
+          i == namespace_mapping_.end() ? namespace_index : i->second;
+    } else if (std::strcmp(name, "Name") == 0) {
+      Clear(qualified_name.get().Name);
+      String{reader_.ReadElementText().c_str()}.release(
+          qualified_name.get().Name);
+    } else {
+      reader_.Skip();
+    }
+  }
+  return qualified_name;
+}
+
+inline LocalizedText NodeSetLoader::ReadLocalizedText() {
+  std::string locale;
+  std::string text;
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    const char* name = reader_.local_name();
+    if (std::strcmp(name, "Locale") == 0)
+      locale = reader_.ReadElementText();
+    else if (std::strcmp(name, "Text") == 0)
+      text = reader_.ReadElementText();
+    else
+      reader_.Skip();
+  }
+  return MakeLocalizedText(locale, text);
+}
+
+inline Variant NodeSetLoader::ReadValueField() {
+  // <Value><Value><ListOfString>...</ListOfString></Value></Value>
+  Variant result;
+  const auto depth = reader_.depth();
+  while (reader_.ReadChildElement(depth)) {
+    if (std::strcmp(reader_.local_name(), "Value") != 0 ||
+        !result.is_null()) {
+      reader_.Skip();
+      continue;
+    }
+    const auto variant_depth = reader_.depth();
+    while (reader_.ReadChildElement(variant_depth)) {
+      if (result.is_null())
+        result = ReadVariant();
+      else
+        reader_.Skip();
+    }
+  }
+  return result;
+}
+
+inline Variant NodeSetLoader::ReadVariant() {
+  const std::string type_name = reader_.local_name();
+
+  if (detail::StartsWith(type_name, "ListOf")) {
+    auto type = detail::GetBuiltInType(type_name.c_str() + 6);
+    if (type == OpcUaType_Null) {
+      reader_.Skip();
+      return {};
+    }
+
+    std::deque<Variant> elements;
+    const auto depth = reader_.depth();
+    while (reader_.ReadChildElement(depth))
+      elements.emplace_back(ReadScalar(type));
+    return detail::MakeArray(type, elements);
+  }
+
+  auto type = detail::GetBuiltInType(type_name.c_str());
+  if (type == OpcUaType_Null) {
+    reader_.Skip();
+    return {};
+  }
+  return ReadScalar(type);
+}
+
+inline Variant NodeSetLoader::ReadScalar(OpcUa_BuiltInType type) {
+  OpcUa_Variant result;
+  Initialize(result);
+
+  switch (type) {
+    case OpcUaType_NodeId:
+      result.Value.NodeId = detail::AllocateValue<OpcUa_NodeId>();
+      result.Datatype = static_cast<Byte>(type);
+      ReadNodeIdField().release(*result.Value.NodeId);
+      return result;
+
+    case OpcUaType_ExpandedNodeId: {
+      result.Value.ExpandedNodeId =
+          detail::AllocateValue<OpcUa_ExpandedNodeId>();
+      result.Datatype = static_cast<Byte>(type);
+      auto value = ReadExpandedNodeIdField();
+      std::swap(*result.Value.ExpandedNodeId, value.get());
+      return result;
+    }
+
+    case OpcUaType_QualifiedName: {
+      result.Value.QualifiedName = detail::AllocateValue<OpcUa_QualifiedName>();
+      result.Datatype = static_cast<Byte>(type);
+      auto value = ReadQualifiedName();
+      std::swap(*result.Value.QualifiedName, value.get());
+      return result;
+    }
+
+    case OpcUaType_LocalizedText: {
+      result.Value.LocalizedText = detail::AllocateValue<OpcUa_LocalizedText>();
+      result.Datatype = static_cast<Byte>(type);
+      auto value = ReadLocalizedText();
+      std::swap(*result.Value.LocalizedText, value.get());
+      return result;
+    }
+
+    case OpcUaType_Guid: {
+      result.Value.Guid = detail::AllocateValue<OpcUa_Guid>();
+      result.Datatype = static_cast<Byte>(type);
+      std::string text;
+      const auto depth = reader_.depth();
+      while (reader_.ReadChildElement(depth))
+        text = reader_.ReadElementText();
+      detail::ParseGuid(text, *result.Value.Guid);
+      return result;
+    }
+
+    // <StatusCode><Code>0x80340000</Code></StatusCode>
+    case OpcUaType_StatusCode: {
+      std::string text;
+      const auto depth = reader_.depth();
+      while (reader_.ReadChildElement(depth)) {
+        if (std::strcmp(reader_.local_name(), "Code") == 0)
+          text = reader_.ReadElementText();
+        else
+          reader_.Skip();
+      }
+      result.Value.StatusCode = static_cast<OpcUa_StatusCode>(
+          std::strtoul(text.c_str(), nullptr, 0));
+      result.Datatype = static_cast<Byte>(type);
+      return result;
+    }
+
+    case OpcUaType_ExtensionObject: {
+      auto* extension_object = detail::AllocateValue<OpcUa_ExtensionObject>();
+      result.Value.ExtensionObject = extension_object;
+      result.Datatype = static_cast<Byte>(type);
+      // The body is kept XML-encoded instead of being decoded into a structure.
+      const auto depth = reader_.depth();
+      while (reader_.ReadChildElement(depth)) {
+        const char* name = reader_.local_name();
+        if (std::strcmp(name, "TypeId") == 0) {
+          ReadNodeIdField().release(extension_object->TypeId.NodeId);
+        } else if (std::strcmp(name, "Body") == 0) {
+          const auto body_depth = reader_.depth();
+          while (reader_.ReadChildElement(body_depth)) {
+            if (extension_object->Encoding !=
+                OpcUa_ExtensionObjectEncoding_None) {
+              reader_.Skip();
+              continue;
+            }
+            auto xml = reader_.ReadOuterXml();
+            auto& body = extension_object->Body.Xml;
+            body.Data = static_cast<OpcUa_Byte*>(::OpcUa_Alloc(xml.size()));
+            if (!body.Data)
+              Check(OpcUa_BadOutOfMemory);
+            std::memcpy(body.Data, xml.data(), xml.size());
+            body.Length = static_cast<Int32>(xml.size());
+            extension_object->Encoding = OpcUa_ExtensionObjectEncoding_Xml;
+            extension_object->BodySize = body.Length;
+          }
+        } else {
+          reader_.Skip();
+        }
+      }
+      return result;
+    }
+
+    default:
+      break;
+  }
+
+  const auto text = reader_.ReadElementText();
+  const char* str = text.c_str();
+  switch (type) {
+    case OpcUaType_Boolean:
+      result.Value.Boolean = detail::ParseBoolean(text);
+      break;
+    case OpcUaType_SByte:
+      result.Value.SByte = static_cast<SByte>(std::strtol(str, nullptr, 10));
+      break;
+    case OpcUaType_Byte:
+      result.Value.Byte = static_cast<Byte>(std::strtoul(str, nullptr, 10));
+      break;
+    case OpcUaType_Int16:
+      result.Value.Int16 = static_cast<Int16>(std::strtol(str, nullptr, 10));
+      break;
+    case OpcUaType_UInt16:
+      result.Value.UInt16 = static_cast<UInt16>(std::strtoul(str, nullptr, 10));
+      break;
+    case OpcUaType_Int32:
+      result.Value.Int32 = static_cast<Int32>(std::strtol(str, nullptr, 10));
+      break;
+    case OpcUaType_UInt32:
+      result.Value.UInt32 = static_cast<UInt32>(std::strtoul(str, nullptr, 10));
+      break;
+    case OpcUaType_Int64:
+      result.Value.Int64 = std::strtoll(str, nullptr, 10);
+      break;
+    case OpcUaType_UInt64:
+      result.Value.UInt64 = std::strtoull(str, nullptr, 10);
+      break;
+    case OpcUaType_Float:
+      result.Value.Float = std::strtof(str, nullptr);
+      break;
+    case OpcUaType_Double:
+      result.Value.Double = std::strtod(str, nullptr);
+      break;
+    case OpcUaType_String:
+      String{str}.release(result.Value.String);
+      break;
+    case OpcUaType_DateTime:
+      result.Value.DateTime = detail::ParseDateTime(text);
+      break;
+    case OpcUaType_ByteString:
+      detail::DecodeBase64(text, result.Value.ByteString);
+      break;
+    default:
+      assert(false);
+      return {};
+  }
+
+  result.Datatype = static_cast<Byte>(type);
+  return result;
+}
+
+inline bool NodeSetLoader::SetAttribute(NodeIndex node_index,
+                                        const char* name,
+                                        const std::string& text) {
+  const char* str = text.c_str();
+  if (std::strcmp(name, "WriteMask") == 0) {
+    attributes_.write_mask.Set(node_index, std::strtoul(str, nullptr, 10));
+  } else if (std::strcmp(name, "UserWriteMask") == 0) {
+    attributes_.user_write_mask.Set(node_index,
+                                    std::strtoul(str, nullptr, 10));
+  } else if (std::strcmp(name, "IsAbstract") == 0) {
+    attributes_.is_abstract.Set(node_index, detail::ParseBoolean(text));
+  } else if (std::strcmp(name, "Symmetric") == 0) {
+    attributes_.symmetric.Set(node_index, detail::ParseBoolean(text));
+  } else if (std::strcmp(name, "ContainsNoLoops") == 0) {
+    attributes_.contains_no_loops.Set(node_index, detail::ParseBoolean(text));
+  } else if (std::strcmp(name, "EventNotifier") == 0) {
+    attributes_.event_notifier.Set(
+        node_index, static_cast<Byte>(std::strtoul(str, nullptr, 10)));
+  } else if (std::strcmp(name, "ValueRank") == 0) {
+    attributes_.value_rank.Set(
+        node_index, static_cast<Int32>(std::strtol(str, nullptr, 10)));
+  } else if (std::strcmp(name, "ArrayDimensions") == 0) {
+    std::vector<UInt32> dimensions;
+    for (char* p = const_cast<char*>(str); *p;) {
+      dimensions.push_back(std::strtoul(p, &p, 10));
+      while (*p == ',' || *p == ' ')
+        ++p;
+    }
+    attributes_.array_dimensions.Set(node_index, std::move(dimensions));
+  } else if (std::strcmp(name, "AccessLevel") == 0) {
+    attributes_.access_level.Set(
+        node_index, static_cast<Byte>(std::strtoul(str, nullptr, 10)));
+  } else if (std::strcmp(name, "UserAccessLevel") == 0) {
+    attributes_.user_access_level.Set(
+        node_index, static_cast<Byte>(std::strtoul(str, nullptr, 10)));
+  } else if (std::strcmp(name, "MinimumSamplingInterval") == 0) {
+    attributes_.minimum_sampling_interval.Set(node_index,
+                                              std::strtod(str, nullptr));
+  } else if (std::strcmp(name, "Historizing") == 0) {
+    attributes_.historizing.Set(node_index, detail::ParseBoolean(text));
+  } else if (std::strcmp(name, "Executable") == 0) {
+    attributes_.executable.Set(node_index, detail::ParseBoolean(text));
+  } else if (std::strcmp(name, "UserExecutable") == 0) {
+    attributes_.user_executable.Set(node_index, detail::ParseBoolean(text));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline NodeId NodeSetLoader::ParseNodeId(const std::string& text) const {
+  auto i = aliases_.find(text);
+  if (i != aliases_.end())
+    return i->second;
+  return detail::ParseNodeId(text, namespace_mapping_);
+}
+
+inline QualifiedName NodeSetLoader::ParseQualifiedName(
+    const std::string& text) const {
+  OpcUa_QualifiedName result;
+  Initialize(result);
+
+  size_t name_pos = 0;
+  auto p = text.find(':');
+  if (p != std::string::npos && p != 0 &&
+      text.find_first_not_of("0123456789") == p) {
+    auto namespace_index =
+        static_cast<NamespaceIndex>(std::strtoul(text.c_str(), nullptr, 10));
+    auto i = namespace_mapping_.find(namespace_index);
+    result.NamespaceIndex =
+        i == namespace_mapping_.end() ? namespace_index : i->second;
+    name_pos = p + 1;
+  }
+
+  String{text.c_str() + name_pos}.release(result.Name);
+  return result;
+}
+
+inline NodeClass NodeSetLoader::GetUANodeClass(const char* name) {
+  static const std::pair<const char*, NodeClass> kNodeClasses[] = {
+      {"UAObject", OpcUa_NodeClass_Object},
+      {"UAVariable", OpcUa_NodeClass_Variable},
+      {"UAMethod", OpcUa_NodeClass_Method},
+      {"UAView", OpcUa_NodeClass_View},
+      {"UAObjectType", OpcUa_NodeClass_ObjectType},
+      {"UAVariableType", OpcUa_NodeClass_VariableType},
+      {"UAReferenceType", OpcUa_NodeClass_ReferenceType},
+      {"UADataType", OpcUa_NodeClass_DataType},
+  };
+  for (auto& node_class : kNodeClasses) {
+    if (std::strcmp(node_class.first, name) == 0)
+      return node_class.second;
+  }
+  return OpcUa_NodeClass_Unspecified;
+}
+
+inline LocalizedText NodeSetLoader::MakeLocalizedText(
+    const std::string& locale,
+    const std::string& text) {
+  OpcUa_LocalizedText result;
+  Initialize(result);
+  if (!locale.empty())
+    String{locale.c_str()}.release(result.Locale);
+  String{text.c_str()}.release(result.Text);
+  return result;
+}
+
+inline void LoadNodeSet(const StringTable& namespace_uris,
+                        std::istream& stream,
+                        NodeAttributes& attributes,
+                        const NodeStateHandler& handler) {
+  XmlReader reader{stream};
+  NodeSetLoader loader{NodeSetLoaderContext{
+      reader,
+      namespace_uris,
+      handler,
+      attributes,
+  }};
+  loader.LoadNodes();
+}
+
+inline void LoadNodeSet(const StringTable& namespace_uris,
+                        std::istream& stream,
+                        const NodeStateHandler& handler) {
+  NodeAttributes attributes;
+  LoadNodeSet(namespace_uris, stream, attributes, handler);
+}
+
+inline std::vector<NodeState> LoadNodeSet(const StringTable& namespace_uris,
+                                          std::istream& stream,
+                                          NodeAttributes& attributes) {
+  std::vector<NodeState> nodes;
+  LoadNodeSet(namespace_uris, stream, attributes, [&nodes](NodeState&& node) {
+    nodes.emplace_back(std::move(node));
+  });
+  return nodes;
+}
+
+inline std::vector<NodeState> LoadNodeSet(const StringTable& namespace_uris,
+                                          std::istream& stream) {
+  NodeAttributes attributes;
+  return LoadNodeSet(namespace_uris, stream, attributes);
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -2,7 +2,9 @@
 
 #include <opcuapp/basic_types.h>
 #include <opcuapp/expanded_node_id.h>
+#include <opcuapp/interned.h>
 #include <opcuapp/node_id.h>
+#include <opcuapp/shared_variant.h>
 #include <opcuapp/structs.h>
 #include <opcuapp/variant.h>
 #include <vector>
@@ -17,6 +19,14 @@ struct ReferenceState {
 };
 
 struct NodeState {
+  NodeState() = default;
+  NodeState(NodeState&&) = default;
+  NodeState& operator=(NodeState&&) = default;
+
+  // Copying would duplicate whole subtrees of children.
+  NodeState(const NodeState&) = delete;
+  NodeState& operator=(const NodeState&) = delete;
+
   NodeId node_id;
   NodeClass node_class;
   NodeId type_definition_id;
@@ -25,9 +35,11 @@ struct NodeState {
   NodeId super_type_id;
   std::vector<ReferenceState> references;
   std::vector<NodeState> children;
-  QualifiedName browse_name;
-  LocalizedText display_name;
-  Variant value;
+  // Interned, as the same names repeat across instances of a type.
+  Interned<QualifiedName> browse_name;
+  Interned<LocalizedText> display_name;
+  // Pooled, as static values such as EnumStrings repeat across instances.
+  SharedVariant value;
   NodeId data_type_id;
 };
 
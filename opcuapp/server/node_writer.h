@@ -0,0 +1,355 @@
+#pragma once
+
+#include <opcuapp/binary_encoder.h>
+#include <opcuapp/encodable_type_table.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/node_attributes.h>
+#include <opcuapp/server/node_loader.h>
+#include <opcuapp/server/node_state.h>
+#include <opcuapp/span.h>
+#include <opcuapp/stream.h>
+#include <opcuapp/string_table.h>
+#include <ostream>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+struct NodeWriterContext {
+  BinaryEncoder& encoder_;
+  // Written as the namespace table of the file, so NodeIds are saved as
+  // they are.
+  const StringTable& namespace_uris_;
+  // Keyed by pre-order index of the written nodes.
+  const NodeAttributes& attributes_;
+};
+
+// Writes nodes in the format read by NodeLoader. Attributes are written in
+// the order the loader consumes them.
+class NodeWriter : private NodeWriterContext {
+ public:
+  explicit NodeWriter(NodeWriterContext&& context);
+
+  void WriteNodes(Span<const NodeState* const> nodes);
+
+ private:
+  void WriteNode(const NodeState& node, bool child);
+  unsigned GetAttributeMask(const NodeState& node, bool child) const;
+  void WriteTypeAttributes(unsigned attribute_mask, const NodeState& node);
+  void WriteVariableAttributes(unsigned attribute_mask, const NodeState& node);
+  void WriteNodeReferences(const NodeState& node, bool child);
+
+  static bool HasAttribute(unsigned attribute_mask,
+                           AttributesToSave attribute_id) {
+    return (attribute_mask & static_cast<unsigned>(attribute_id)) != 0;
+  }
+
+  static bool IsInstance(NodeClass node_class) {
+    return node_class == OpcUa_NodeClass_Variable ||
+           node_class == OpcUa_NodeClass_Object ||
+           node_class == OpcUa_NodeClass_Method;
+  }
+
+  NodeIndex next_node_index_ = 0;
+  NodeIndex node_index_ = kInvalidNodeIndex;
+};
+
+inline NodeWriter::NodeWriter(NodeWriterContext&& context)
+    : NodeWriterContext{std::move(context)} {}
+
+inline void NodeWriter::WriteNodes(Span<const NodeState* const> nodes) {
+  // The loader prepends the standard namespace.
+  const auto namespace_count = namespace_uris_.GetCount();
+  encoder_.Write<Int32>(
+      namespace_count > 1 ? static_cast<Int32>(namespace_count - 1) : 0);
+  for (UInt32 i = 1; i < namespace_count; ++i)
+    encoder_.Write(namespace_uris_[i]);
+
+  // Server URIs.
+  encoder_.Write<Int32>(0);
+
+  encoder_.Write<Int32>(static_cast<Int32>(nodes.size()));
+  for (size_t i = 0; i < nodes.size(); ++i)
+    WriteNode(*nodes[i], false);
+}
+
+inline unsigned NodeWriter::GetAttributeMask(const NodeState& node,
+                                             bool child) const {
+  auto mask = static_cast<unsigned>(AttributesToSave::NodeClass);
+  auto set = [&mask](AttributesToSave attribute_id, bool present) {
+    if (present)
+      mask |= static_cast<unsigned>(attribute_id);
+  };
+
+  set(AttributesToSave::BrowseName, !node.browse_name->empty());
+  set(AttributesToSave::NodeId, !node.node_id.IsNull());
+  // The loader defaults the DisplayName to the name of the BrowseName.
+  set(AttributesToSave::DisplayName,
+      !OpcUa_String_IsEmpty(&node.display_name->locale()) ||
+          !opcua::detail::IsSameString(node.display_name->text(),
+                                       node.browse_name->name()));
+  set(AttributesToSave::Description,
+      attributes_.description.Has(node_index_));
+  set(AttributesToSave::WriteMask, attributes_.write_mask.Has(node_index_));
+  set(AttributesToSave::UserWriteMask,
+      attributes_.user_write_mask.Has(node_index_));
+
+  // Read only for instances and children.
+  if (child || IsInstance(node.node_class)) {
+    set(AttributesToSave::ReferenceTypeId, !node.reference_type_id.IsNull());
+    set(AttributesToSave::TypeDefinitionId,
+        !node.type_definition_id.IsNull());
+  }
+
+  switch (node.node_class) {
+    case OpcUa_NodeClass_ReferenceType:
+      set(AttributesToSave::InverseName,
+          attributes_.inverse_name.Has(node_index_));
+      set(AttributesToSave::Symmetric, attributes_.symmetric.Has(node_index_));
+      // Fall through.
+    case OpcUa_NodeClass_DataType:
+    case OpcUa_NodeClass_ObjectType:
+    case OpcUa_NodeClass_VariableType:
+      set(AttributesToSave::SuperTypeId, !node.super_type_id.IsNull());
+      set(AttributesToSave::IsAbstract,
+          attributes_.is_abstract.Has(node_index_));
+      break;
+    case OpcUa_NodeClass_Object:
+      set(AttributesToSave::EventNotifier,
+          attributes_.event_notifier.Has(node_index_));
+      break;
+    case OpcUa_NodeClass_Method:
+      set(AttributesToSave::Executable,
+          attributes_.executable.Has(node_index_));
+      set(AttributesToSave::UserExecutable,
+          attributes_.user_executable.Has(node_index_));
+      break;
+    default:
+      break;
+  }
+
+  if (node.node_class == OpcUa_NodeClass_Variable ||
+      node.node_class == OpcUa_NodeClass_VariableType) {
+    set(AttributesToSave::Value, !node.value->is_null());
+    set(AttributesToSave::DataType, !node.data_type_id.IsNull());
+    set(AttributesToSave::ValueRank, attributes_.value_rank.Has(node_index_));
+    set(AttributesToSave::ArrayDimensions,
+        attributes_.array_dimensions.Has(node_index_));
+  }
+
+  if (node.node_class == OpcUa_NodeClass_Variable) {
+    set(AttributesToSave::AccessLevel,
+        attributes_.access_level.Has(node_index_));
+    set(AttributesToSave::UserAccessLevel,
+        attributes_.user_access_level.Has(node_index_));
+    set(AttributesToSave::MinimumSamplingInterval,
+        attributes_.minimum_sampling_interval.Has(node_index_));
+    set(AttributesToSave::Historizing,
+        attributes_.historizing.Has(node_index_));
+  }
+
+  return mask;
+}
+
+inline void NodeWriter::WriteNode(const NodeState& node, bool child) {
+  node_index_ = next_node_index_++;
+
+  const auto attribute_mask = GetAttributeMask(node, child);
+  encoder_.Write<UInt32>(attribute_mask);
+  encoder_.Write<Int32>(node.node_class);
+
+  if (HasAttribute(attribute_mask, AttributesToSave::BrowseName))
+    encoder_.Write(node.browse_name->get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::NodeId))
+    encoder_.Write(node.node_id.get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::DisplayName))
+    encoder_.Write(node.display_name->get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::Description))
+    encoder_.Write(attributes_.description.Find(node_index_)->get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::WriteMask))
+    encoder_.Write(*attributes_.write_mask.Find(node_index_));
+
+  if (HasAttribute(attribute_mask, AttributesToSave::UserWriteMask))
+    encoder_.Write(*attributes_.user_write_mask.Find(node_index_));
+
+  if (HasAttribute(attribute_mask, AttributesToSave::ReferenceTypeId))
+    encoder_.Write(node.reference_type_id.get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::TypeDefinitionId))
+    encoder_.Write(node.type_definition_id.get());
+
+  switch (node.node_class) {
+    case OpcUa_NodeClass_ReferenceType:
+    case OpcUa_NodeClass_DataType:
+    case OpcUa_NodeClass_ObjectType:
+    case OpcUa_NodeClass_VariableType:
+      WriteTypeAttributes(attribute_mask, node);
+      break;
+    case OpcUa_NodeClass_Variable:
+      WriteVariableAttributes(attribute_mask, node);
+      break;
+    case OpcUa_NodeClass_Object:
+      if (HasAttribute(attribute_mask, AttributesToSave::EventNotifier)) {
+        encoder_.Write(
+            static_cast<SByte>(*attributes_.event_notifier.Find(node_index_)));
+      }
+      break;
+    case OpcUa_NodeClass_Method:
+      if (HasAttribute(attribute_mask, AttributesToSave::Executable))
+        encoder_.Write(*attributes_.executable.Find(node_index_));
+      if (HasAttribute(attribute_mask, AttributesToSave::UserExecutable))
+        encoder_.Write(*attributes_.user_executable.Find(node_index_));
+      break;
+    default:
+      assert(false);
+      break;
+  }
+
+  WriteNodeReferences(node, child);
+
+  encoder_.Write<Int32>(static_cast<Int32>(node.children.size()));
+  for (auto& node_child : node.children)
+    WriteNode(node_child, true);
+}
+
+inline void NodeWriter::WriteTypeAttributes(unsigned attribute_mask,
+                                            const NodeState& node) {
+  if (HasAttribute(attribute_mask, AttributesToSave::SuperTypeId))
+    encoder_.Write(node.super_type_id.get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::IsAbstract))
+    encoder_.Write(*attributes_.is_abstract.Find(node_index_));
+
+  if (HasAttribute(attribute_mask, AttributesToSave::InverseName))
+    encoder_.Write(attributes_.inverse_name.Find(node_index_)->get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::Symmetric))
+    encoder_.Write(*attributes_.symmetric.Find(node_index_));
+
+  if (node.node_class == OpcUa_NodeClass_VariableType)
+    WriteVariableAttributes(attribute_mask, node);
+}
+
+inline void NodeWriter::WriteVariableAttributes(unsigned attribute_mask,
+                                                const NodeState& node) {
+  if (HasAttribute(attribute_mask, AttributesToSave::Value))
+    encoder_.Write(node.value->get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::DataType))
+    encoder_.Write(node.data_type_id.get());
+
+  if (HasAttribute(attribute_mask, AttributesToSave::ValueRank))
+    encoder_.Write(*attributes_.value_rank.Find(node_index_));
+
+  if (HasAttribute(attribute_mask, AttributesToSave::ArrayDimensions))
+    encoder_.WriteArray(*attributes_.array_dimensions.Find(node_index_));
+
+  if (HasAttribute(attribute_mask, AttributesToSave::AccessLevel)) {
+    encoder_.Write(
+        static_cast<SByte>(*attributes_.access_level.Find(node_index_)));
+  }
+
+  if (HasAttribute(attribute_mask, AttributesToSave::UserAccessLevel)) {
+    encoder_.Write(
+        static_cast<SByte>(*attributes_.user_access_level.Find(node_index_)));
+  }
+
+  if (HasAttribute(attribute_mask, AttributesToSave::MinimumSamplingInterval))
+    encoder_.Write(*attributes_.minimum_sampling_interval.Find(node_index_));
+
+  if (HasAttribute(attribute_mask, AttributesToSave::Historizing))
+    encoder_.Write(*attributes_.historizing.Find(node_index_));
+}
+
+inline void NodeWriter::WriteNodeReferences(const NodeState& node,
+                                            bool child) {
+  // The format has no parent, so the parent of a top-level node is saved as
+  // an inverse reference.
+  const bool parent_reference = !child && !node.parent_id.IsNull() &&
+                                !node.reference_type_id.IsNull();
+
+  encoder_.Write<Int32>(
+      static_cast<Int32>(node.references.size() + (parent_reference ? 1 : 0)));
+
+  if (parent_reference) {
+    encoder_.Write(node.reference_type_id.get());
+    encoder_.Write<Boolean>(True);
+    encoder_.Write(ExpandedNodeId{node.parent_id}.get());
+  }
+
+  for (auto& reference : node.references) {
+    encoder_.Write(reference.reference_type_id.get());
+    encoder_.Write(reference.inverse);
+    encoder_.Write(reference.target_id.get());
+  }
+}
+
+// The top-level nodes of |address_space|, so that pre-order indexes of the
+// written nodes match the NodeIndex of the address space.
+inline std::vector<const NodeState*> GetTopLevelNodes(
+    const AddressSpace& address_space) {
+  std::vector<const NodeState*> nodes;
+  for (NodeIndex index = 0; index < address_space.node_count();) {
+    const auto& node = address_space.node(index);
+    nodes.emplace_back(&node);
+    index += detail::CountNodes(node);
+  }
+  return nodes;
+}
+
+inline void SavePredefinedNodes(const StringTable& namespace_uris,
+                                Span<const NodeState* const> nodes,
+                                const NodeAttributes& attributes,
+                                OpcUa_OutputStream& stream) {
+  EncodableTypeTable types;
+  types.AddKnownTypes();
+
+  MessageContext context;
+  context.KnownTypes = &types.get();
+
+  BinaryEncoder encoder;
+  encoder.Open(stream, context);
+
+  NodeWriter writer{NodeWriterContext{
+      encoder,
+      namespace_uris,
+      attributes,
+  }};
+  writer.WriteNodes(nodes);
+}
+
+inline void SavePredefinedNodes(const StringTable& namespace_uris,
+                                const std::vector<NodeState>& nodes,
+                                const NodeAttributes& attributes,
+                                OpcUa_OutputStream& stream) {
+  std::vector<const NodeState*> node_ptrs;
+  node_ptrs.reserve(nodes.size());
+  for (auto& node : nodes)
+    node_ptrs.emplace_back(&node);
+  SavePredefinedNodes(namespace_uris, {node_ptrs.data(), node_ptrs.size()},
+                      attributes, stream);
+}
+
+inline void SavePredefinedNodes(const StringTable& namespace_uris,
+                                const std::vector<NodeState>& nodes,
+                                const NodeAttributes& attributes,
+                                std::ostream& stream) {
+  StdOutputStream output{stream};
+  SavePredefinedNodes(namespace_uris, nodes, attributes, output.get());
+}
+
+inline void SavePredefinedNodes(const StringTable& namespace_uris,
+                                const AddressSpace& address_space,
+                                std::ostream& stream) {
+  const auto nodes = GetTopLevelNodes(address_space);
+  StdOutputStream output{stream};
+  SavePredefinedNodes(namespace_uris, {nodes.data(), nodes.size()},
+                      address_space.attributes(), output.get());
+}
+
+}  // namespace server
+}  // namespace opcua
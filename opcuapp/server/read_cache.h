@@ -0,0 +1,139 @@
+#pragma once
+
+#include <opcuapp/data_value.h>
+#include <opcuapp/server/node_attributes.h>
+#include <opcuapp/span.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+// Reads the current Values of |nodes| from a device or other slow source.
+using ValueBackend = std::function<void(Span<const NodeIndex> nodes,
+                                        Span<DataValue> results)>;
+
+// Values of one backend, reused while younger than the MaxAge of a Read.
+// All misses of a call go to the backend together. A node that is already
+// being fetched by another call is waited for instead of fetched again.
+class ReadCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit ReadCache(ValueBackend backend) : backend_{std::move(backend)} {}
+
+  // |max_age_ms| as in OpcUa_ReadRequest: 0 always goes to the backend.
+  void Read(Span<const NodeIndex> nodes,
+            Double max_age_ms,
+            Span<OpcUa_DataValue> results);
+
+  // Number of backend calls made.
+  size_t backend_calls() const;
+
+ private:
+  struct Entry {
+    std::shared_ptr<const DataValue> value;
+    Clock::time_point fetch_time;
+    // Incremented by every completed fetch.
+    UInt32 generation = 0;
+    bool pending = false;
+  };
+
+  const ValueBackend backend_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable fetched_;
+  std::unordered_map<NodeIndex, Entry> entries_;
+  size_t backend_calls_ = 0;
+};
+
+inline void ReadCache::Read(Span<const NodeIndex> nodes,
+                            Double max_age_ms,
+                            Span<OpcUa_DataValue> results) {
+  assert(nodes.size() == results.size());
+
+  const auto now = Clock::now();
+  const auto max_age = std::chrono::duration<Double, std::milli>{max_age_ms};
+
+  std::vector<std::shared_ptr<const DataValue>> values(nodes.size());
+  std::vector<NodeIndex> misses;
+  std::vector<size_t> miss_positions;
+  // Positions fetched by other calls, with the generation to wait past.
+  std::vector<std::pair<size_t, UInt32>> waits;
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      auto& entry = entries_[nodes[i]];
+      if (entry.pending) {
+        waits.emplace_back(i, entry.generation);
+      } else if (entry.value && max_age_ms > 0 &&
+                 now - entry.fetch_time <= max_age) {
+        values[i] = entry.value;
+      } else {
+        entry.pending = true;
+        misses.push_back(nodes[i]);
+        miss_positions.push_back(i);
+      }
+    }
+    if (!misses.empty())
+      ++backend_calls_;
+  }
+
+  if (!misses.empty()) {
+    std::vector<DataValue> fetched(misses.size());
+    try {
+      backend_({misses.data(), misses.size()},
+               {fetched.data(), fetched.size()});
+    } catch (...) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      for (auto node : misses)
+        entries_[node].pending = false;
+      fetched_.notify_all();
+      throw;
+    }
+
+    const auto fetch_time = Clock::now();
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (size_t i = 0; i < misses.size(); ++i) {
+      auto& entry = entries_[misses[i]];
+      entry.value = std::make_shared<const DataValue>(std::move(fetched[i]));
+      entry.fetch_time = fetch_time;
+      entry.pending = false;
+      ++entry.generation;
+      values[miss_positions[i]] = entry.value;
+    }
+    fetched_.notify_all();
+  }
+
+  if (!waits.empty()) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    for (auto& wait : waits) {
+      auto& entry = entries_[nodes[wait.first]];
+      fetched_.wait(lock, [&entry] { return !entry.pending; });
+      if (entry.generation != wait.second)
+        values[wait.first] = entry.value;
+    }
+  }
+
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    // Left empty only if the fetch waited for failed.
+    if (values[i])
+      Copy(values[i]->get(), results[i]);
+    else
+      results[i].StatusCode = OpcUa_BadCommunicationError;
+  }
+}
+
+inline size_t ReadCache::backend_calls() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return backend_calls_;
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <opcuapp/data_value.h>
+#include <opcuapp/date_time.h>
+#include <opcuapp/requests.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/read_cache.h>
+#include <opcuapp/server/registered_nodes.h>
+#include <opcuapp/server/value_store.h>
+#include <opcuapp/vector.h>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+// Provides the current Value of a dynamic node. The server timestamp is set
+// by the Reader.
+using ValueSource = std::function<DataValue()>;
+
+// Read over an AddressSpace. Items are served in NodeIndex order and written
+// straight into the preallocated result array. Value reads are served from
+// a ReadCache, the ValueStore, a ValueSource or the address space, in this
+// order. Each ReadCache is called once per request.
+//
+// Each call serves the version of the address space it is given. Sources
+// and caches are kept by NodeIndex, which later versions keep, so they are
+// set once for every version.
+class Reader {
+ public:
+  // Not thread-safe. Sources are expected to be registered before serving.
+  void SetValueSource(const AddressSpace& address_space,
+                      const NodeId& node_id,
+                      ValueSource source);
+
+  // |cache| must outlive the Reader.
+  void SetReadCache(const AddressSpace& address_space,
+                    const NodeId& node_id,
+                    ReadCache& cache);
+
+  // |value_store| must outlive the Reader.
+  void SetValueStore(const ValueStore& value_store) {
+    value_store_ = &value_store;
+  }
+
+  // |registered_nodes| resolves the aliases of the calling session.
+  ReadResponse Read(const AddressSpace& address_space,
+                    const OpcUa_ReadRequest& request,
+                    const RegisteredNodes* registered_nodes = nullptr) const;
+
+ private:
+  // Fills the results of all Value reads of cached nodes. |order| is
+  // sorted by NodeIndex.
+  void ReadCached(Span<const OpcUa_ReadValueId> read_value_ids,
+                  const std::vector<std::pair<NodeIndex, UInt32>>& order,
+                  Double max_age_ms,
+                  Span<OpcUa_DataValue> results,
+                  std::vector<bool>& cached) const;
+
+  void Read(const AddressSpace& address_space,
+            const OpcUa_ReadValueId& read_value_id,
+            NodeIndex index,
+            OpcUa_TimestampsToReturn timestamps_to_return,
+            const DateTime& now,
+            bool cached,
+            OpcUa_DataValue& result) const;
+
+  static bool IsPlainValueRead(const OpcUa_ReadValueId& read_value_id);
+
+  AttributeColumn<ValueSource> value_sources_;
+  AttributeColumn<ReadCache*> read_caches_;
+  const ValueStore* value_store_ = nullptr;
+};
+
+inline void Reader::SetValueSource(const AddressSpace& address_space,
+                                   const NodeId& node_id,
+                                   ValueSource source) {
+  const auto index = address_space.GetNodeIndex(node_id);
+  if (index == kInvalidNodeIndex)
+    Check(OpcUa_BadNodeIdUnknown);
+  value_sources_.Set(index, std::move(source));
+}
+
+inline void Reader::SetReadCache(const AddressSpace& address_space,
+                                 const NodeId& node_id,
+                                 ReadCache& cache) {
+  const auto index = address_space.GetNodeIndex(node_id);
+  if (index == kInvalidNodeIndex)
+    Check(OpcUa_BadNodeIdUnknown);
+  read_caches_.Set(index, &cache);
+}
+
+inline ReadResponse Reader::Read(
+    const AddressSpace& address_space,
+    const OpcUa_ReadRequest& request,
+    const RegisteredNodes* registered_nodes) const {
+  ReadResponse response;
+
+  Span<const OpcUa_ReadValueId> read_value_ids{
+      request.NodesToRead, static_cast<size_t>(request.NoOfNodesToRead)};
+  if (read_value_ids.empty()) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadNothingToDo;
+    return response;
+  }
+  if (request.MaxAge < 0) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadMaxAgeInvalid;
+    return response;
+  }
+  if (request.TimestampsToReturn < OpcUa_TimestampsToReturn_Source ||
+      request.TimestampsToReturn > OpcUa_TimestampsToReturn_Neither) {
+    response.ResponseHeader.ServiceResult =
+        OpcUa_BadTimestampsToReturnInvalid;
+    return response;
+  }
+
+  // Resolve once and visit nodes in storage order.
+  std::vector<std::pair<NodeIndex, UInt32>> order(read_value_ids.size());
+  for (size_t i = 0; i < read_value_ids.size(); ++i) {
+    order[i] = {ResolveNodeIndex(address_space, registered_nodes,
+                                 read_value_ids[i].NodeId),
+                static_cast<UInt32>(i)};
+  }
+  std::sort(order.begin(), order.end());
+
+  const auto now = DateTime::UtcNow();
+
+  Vector<OpcUa_DataValue> results(read_value_ids.size());
+  std::vector<bool> cached(read_value_ids.size(), false);
+  ReadCached(read_value_ids, order, request.MaxAge,
+             {results.data(), results.size()}, cached);
+  for (auto& p : order) {
+    Read(address_space, read_value_ids[p.second], p.first,
+         request.TimestampsToReturn, now, cached[p.second], results[p.second]);
+  }
+
+  response.ResponseHeader.ServiceResult = OpcUa_Good;
+  response.NoOfResults = results.size();
+  response.Results = results.release();
+  return response;
+}
+
+inline void Reader::ReadCached(
+    Span<const OpcUa_ReadValueId> read_value_ids,
+    const std::vector<std::pair<NodeIndex, UInt32>>& order,
+    Double max_age_ms,
+    Span<OpcUa_DataValue> results,
+    std::vector<bool>& cached) const {
+  struct Item {
+    ReadCache* cache;
+    NodeIndex node;
+    UInt32 position;
+  };
+
+  std::vector<Item> items;
+  for (auto& p : order) {
+    if (p.first == kInvalidNodeIndex ||
+        !IsPlainValueRead(read_value_ids[p.second])) {
+      continue;
+    }
+    if (auto* cache = read_caches_.Find(p.first))
+      items.push_back({*cache, p.first, p.second});
+  }
+  if (items.empty())
+    return;
+
+  // Group by cache, keeping the NodeIndex order within each group.
+  std::stable_sort(
+      items.begin(), items.end(),
+      [](const Item& a, const Item& b) { return a.cache < b.cache; });
+
+  std::vector<NodeIndex> nodes;
+  for (size_t begin = 0; begin < items.size();) {
+    auto* cache = items[begin].cache;
+    nodes.clear();
+    auto end = begin;
+    for (; end < items.size() && items[end].cache == cache; ++end)
+      nodes.push_back(items[end].node);
+
+    Vector<OpcUa_DataValue> values(nodes.size());
+    cache->Read({nodes.data(), nodes.size()}, max_age_ms,
+                {values.data(), values.size()});
+    for (auto i = begin; i < end; ++i) {
+      auto& value = values[i - begin];
+      results[items[i].position] = value;
+      Initialize(value);
+      cached[items[i].position] = true;
+    }
+
+    begin = end;
+  }
+}
+
+// static
+inline bool Reader::IsPlainValueRead(const OpcUa_ReadValueId& read_value_id) {
+  return read_value_id.AttributeId == OpcUa_Attributes_Value &&
+         OpcUa_String_IsEmpty(&read_value_id.IndexRange) != OpcUa_False &&
+         OpcUa_String_IsEmpty(&read_value_id.DataEncoding.Name) != OpcUa_False;
+}
+
+inline void Reader::Read(const AddressSpace& address_space,
+                         const OpcUa_ReadValueId& read_value_id,
+                         NodeIndex index,
+                         OpcUa_TimestampsToReturn timestamps_to_return,
+                         const DateTime& now,
+                         bool cached,
+                         OpcUa_DataValue& result) const {
+  if (index == kInvalidNodeIndex) {
+    result.StatusCode = OpcUa_BadNodeIdUnknown;
+    return;
+  }
+
+  const bool is_value = read_value_id.AttributeId == OpcUa_Attributes_Value;
+
+  if (!is_value &&
+      OpcUa_String_IsEmpty(&read_value_id.IndexRange) == OpcUa_False) {
+    result.StatusCode = OpcUa_BadIndexRangeInvalid;
+    return;
+  }
+  // Neither index ranges nor alternative data encodings are supported yet.
+  if (OpcUa_String_IsEmpty(&read_value_id.IndexRange) == OpcUa_False) {
+    result.StatusCode = OpcUa_BadNotSupported;
+    return;
+  }
+  if (OpcUa_String_IsEmpty(&read_value_id.DataEncoding.Name) == OpcUa_False) {
+    result.StatusCode = is_value ? OpcUa_BadDataEncodingUnsupported
+                                 : OpcUa_BadDataEncodingInvalid;
+    return;
+  }
+
+  const auto* source = is_value ? value_sources_.Find(index) : nullptr;
+  if (cached) {
+    // Filled by ReadCached().
+  } else if (is_value && value_store_ && value_store_->Read(index, result)) {
+    // Served from the store.
+  } else if (source) {
+    (*source)().release(result);
+  } else {
+    Variant value;
+    result.StatusCode =
+        address_space.Read(index, read_value_id.AttributeId, value).code();
+    if (OpcUa_IsBad(result.StatusCode))
+      return;
+    value.release(result.Value);
+    if (is_value)
+      result.SourceTimestamp = now.get();
+  }
+
+  // Only the Value attribute carries a source timestamp.
+  if (!is_value || timestamps_to_return == OpcUa_TimestampsToReturn_Server ||
+      timestamps_to_return == OpcUa_TimestampsToReturn_Neither) {
+    ::OpcUa_DateTime_Initialize(&result.SourceTimestamp);
+    result.SourcePicoseconds = 0;
+  }
+
+  if (timestamps_to_return == OpcUa_TimestampsToReturn_Server ||
+      timestamps_to_return == OpcUa_TimestampsToReturn_Both) {
+    result.ServerTimestamp = now.get();
+    result.ServerPicoseconds = now.picoseconds();
+  } else {
+    ::OpcUa_DateTime_Initialize(&result.ServerTimestamp);
+    result.ServerPicoseconds = 0;
+  }
+}
+
+}  // namespace server
+}  // namespace opcua
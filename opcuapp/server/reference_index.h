@@ -0,0 +1,493 @@
+#pragma once
+
+#include <opcuapp/interned.h>
+#include <opcuapp/server/chunked_vector.h>
+#include <opcuapp/server/node_attributes.h>
+#include <opcuapp/server/node_state.h>
+#include <opcuapp/span.h>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+namespace detail {
+
+inline size_t HashNodeId(const OpcUa_NodeId& node_id) {
+  auto hash = opcua::detail::HashBytes(
+      reinterpret_cast<const char*>(&node_id.NamespaceIndex),
+      sizeof(node_id.NamespaceIndex));
+  switch (node_id.IdentifierType) {
+    case OpcUa_IdentifierType_Numeric:
+      return opcua::detail::HashBytes(
+          reinterpret_cast<const char*>(&node_id.Identifier.Numeric),
+          sizeof(node_id.Identifier.Numeric), hash);
+    case OpcUa_IdentifierType_String:
+      return opcua::detail::CombineHash(
+          hash, opcua::detail::HashString(node_id.Identifier.String));
+    case OpcUa_IdentifierType_Opaque: {
+      const auto& bytes = node_id.Identifier.ByteString;
+      return opcua::detail::HashBytes(
+          reinterpret_cast<const char*>(bytes.Data),
+          static_cast<size_t>(std::max(bytes.Length, 0)), hash);
+    }
+    case OpcUa_IdentifierType_Guid:
+      return opcua::detail::HashBytes(
+          reinterpret_cast<const char*>(node_id.Identifier.Guid),
+          sizeof(OpcUa_Guid), hash);
+    default:
+      return hash;
+  }
+}
+
+inline size_t HashBrowseName(const OpcUa_QualifiedName& name) {
+  return opcua::detail::CombineHash(name.NamespaceIndex,
+                                    opcua::detail::HashString(name.Name));
+}
+
+}  // namespace detail
+
+// Dense number of a reference type within ReferenceIndex.
+using ReferenceTypeIndex = UInt32;
+
+const ReferenceTypeIndex kInvalidReferenceTypeIndex =
+    static_cast<ReferenceTypeIndex>(-1);
+
+struct NodeReference {
+  ReferenceTypeIndex reference_type;
+  Boolean inverse;
+  // kInvalidNodeIndex if the target is not in the address space.
+  NodeIndex target;
+  // Set only for targets outside of the address space.
+  const ExpandedNodeId* target_id;
+};
+
+// References of every node in both directions, including the ones implied by
+// NodeState fields, and the subtype closure of every reference type as a
+// bitset, so a Browse filter costs one bit test per reference.
+//
+// References are also indexed by source and target BrowseName, so a path
+// step doesn't scan all references of its node.
+//
+// Nodes are indexed batch by batch. Copies share the reference lists of
+// unchanged nodes, so a copy that indexes another batch only clones the
+// lists that gained references.
+class ReferenceIndex {
+ public:
+  // Indexes the nodes from |first| to |node_count|, which must be the nodes
+  // added since the previous call. |get_node| maps NodeIndex to NodeState,
+  // and |find_node| maps an OpcUa_NodeId to NodeIndex, including the new
+  // nodes. Earlier references to the new nodes are resolved.
+  template <class GetNode, class FindNode>
+  void AddNodes(NodeIndex first,
+                NodeIndex node_count,
+                const GetNode& get_node,
+                const FindNode& find_node);
+
+  // Drops all references from and to |nodes|, which must be sorted. Returns
+  // the other nodes that lost references, sorted.
+  template <class GetNode>
+  std::vector<NodeIndex> DeleteNodes(Span<const NodeIndex> nodes,
+                                     const GetNode& get_node);
+
+  Span<const NodeReference> GetReferences(NodeIndex node) const {
+    if (node >= references_.size())
+      return {};
+    auto& references = references_[node];
+    return {references.data(), references.size()};
+  }
+
+  // Visits the references of |source| to nodes whose BrowseName hashes to
+  // |name_hash|, as computed by detail::HashBrowseName. The caller compares
+  // the names.
+  template <class Visit>
+  void ForEachChild(NodeIndex source,
+                    size_t name_hash,
+                    const Visit& visit) const {
+    children_.ForEach(GetChildHash(source, name_hash), [&](const Child& child) {
+      if (child.source == source && child.reference.target != kInvalidNodeIndex)
+        visit(child.reference);
+    });
+  }
+
+  // Visits the references of |source| to targets outside of the address
+  // space.
+  template <class Visit>
+  void ForEachExternal(NodeIndex source, const Visit& visit) const {
+    children_.ForEach(GetChildHash(source, kExternalNameHash),
+                      [&](const Child& child) {
+                        if (child.source == source &&
+                            child.reference.target == kInvalidNodeIndex)
+                          visit(child.reference);
+                      });
+  }
+
+  ReferenceTypeIndex FindReferenceType(const NodeId& reference_type_id) const {
+    if (!types_)
+      return kInvalidReferenceTypeIndex;
+    auto i = types_->indexes.find(reference_type_id);
+    return i != types_->indexes.end() ? i->second
+                                      : kInvalidReferenceTypeIndex;
+  }
+
+  const NodeId& reference_type_id(ReferenceTypeIndex reference_type) const {
+    return types_->ids[reference_type];
+  }
+
+  // Whether |reference_type| is |base_type| or one of its subtypes.
+  bool IsSubtype(ReferenceTypeIndex reference_type,
+                 ReferenceTypeIndex base_type) const {
+    assert(reference_type < types_->ids.size());
+    assert(base_type < types_->ids.size());
+    const auto& bits = types_->subtypes[base_type];
+    return (bits[reference_type / 64] >> (reference_type % 64)) & 1;
+  }
+
+ private:
+  struct ReferenceTypes {
+    std::map<NodeId, ReferenceTypeIndex> indexes;
+    std::vector<NodeId> ids;
+    // Per reference type, the bitset of its subtypes including itself.
+    std::vector<std::vector<std::uint64_t>> subtypes;
+  };
+
+  // Append-only, so |target_id| pointers stay valid in every copy.
+  struct ExternalTargets {
+    std::mutex mutex;
+    std::deque<ExpandedNodeId> ids;
+  };
+
+  // Reference to a local node that is not in the address space yet.
+  struct PendingTarget {
+    NodeIndex source;
+    const ExpandedNodeId* target_id;
+  };
+
+  struct Child {
+    NodeIndex source;
+    NodeReference reference;
+  };
+
+  // Name hash of the references to targets outside of the address space.
+  static const size_t kExternalNameHash = 0;
+
+  static size_t GetChildHash(NodeIndex source, size_t name_hash) {
+    return opcua::detail::CombineHash(name_hash, source);
+  }
+
+  template <class GetNode>
+  size_t GetChildHash(NodeIndex source,
+                      const NodeReference& reference,
+                      const GetNode& get_node) const;
+
+  template <class GetNode>
+  void AddChild(NodeIndex source,
+                const NodeReference& reference,
+                const GetNode& get_node);
+
+  ReferenceTypeIndex AddReferenceType(const NodeId& reference_type_id);
+  const ExpandedNodeId& AddExternalTarget(const ExpandedNodeId& target_id);
+
+  template <class GetNode, class FindNode>
+  void UpdateSubtypes(const GetNode& get_node, const FindNode& find_node);
+
+  static void SortReferences(std::vector<NodeReference>& references);
+
+  ChunkedVector<std::vector<NodeReference>, 64> references_;
+  // Changed only when a batch adds reference types.
+  std::shared_ptr<ReferenceTypes> types_;
+  std::shared_ptr<ExternalTargets> external_targets_;
+  // Keyed by the hash of the target NodeId.
+  ChunkedHashIndex<PendingTarget> pending_targets_;
+  // Keyed by the source and the BrowseName hash of the target.
+  ChunkedHashIndex<Child> children_;
+};
+
+template <class GetNode>
+inline size_t ReferenceIndex::GetChildHash(NodeIndex source,
+                                           const NodeReference& reference,
+                                           const GetNode& get_node) const {
+  if (reference.target == kInvalidNodeIndex)
+    return GetChildHash(source, kExternalNameHash);
+  return GetChildHash(
+      source,
+      detail::HashBrowseName(get_node(reference.target).browse_name->get()));
+}
+
+template <class GetNode>
+inline void ReferenceIndex::AddChild(NodeIndex source,
+                                     const NodeReference& reference,
+                                     const GetNode& get_node) {
+  const auto hash = GetChildHash(source, reference, get_node);
+  if (reference.target == kInvalidNodeIndex) {
+    children_.Insert(hash, {source, reference});
+    return;
+  }
+
+  // The same reference is often recorded by both of its nodes.
+  const auto* existing = children_.Find(hash, [&](const Child& child) {
+    return child.source == source &&
+           child.reference.reference_type == reference.reference_type &&
+           child.reference.inverse == reference.inverse &&
+           child.reference.target == reference.target;
+  });
+  if (!existing)
+    children_.Insert(hash, {source, reference});
+}
+
+inline ReferenceTypeIndex ReferenceIndex::AddReferenceType(
+    const NodeId& reference_type_id) {
+  const auto index = FindReferenceType(reference_type_id);
+  if (index != kInvalidReferenceTypeIndex)
+    return index;
+
+  if (!types_)
+    types_ = std::make_shared<ReferenceTypes>();
+  else if (types_.use_count() != 1)
+    types_ = std::make_shared<ReferenceTypes>(*types_);
+  const auto type = static_cast<ReferenceTypeIndex>(types_->ids.size());
+  types_->indexes.emplace(reference_type_id, type);
+  types_->ids.emplace_back(reference_type_id);
+  return type;
+}
+
+inline const ExpandedNodeId& ReferenceIndex::AddExternalTarget(
+    const ExpandedNodeId& target_id) {
+  if (!external_targets_)
+    external_targets_ = std::make_shared<ExternalTargets>();
+  std::lock_guard<std::mutex> lock{external_targets_->mutex};
+  external_targets_->ids.emplace_back(target_id);
+  return external_targets_->ids.back();
+}
+
+// static
+inline void ReferenceIndex::SortReferences(
+    std::vector<NodeReference>& references) {
+  // The same reference is often recorded by both of its nodes.
+  const auto key = [](const NodeReference& r) {
+    return std::make_tuple(r.reference_type, r.inverse, r.target);
+  };
+  std::stable_sort(references.begin(), references.end(),
+                   [&](const NodeReference& a, const NodeReference& b) {
+                     return key(a) < key(b);
+                   });
+  references.erase(
+      std::unique(references.begin(), references.end(),
+                  [&](const NodeReference& a, const NodeReference& b) {
+                    return a.target != kInvalidNodeIndex && key(a) == key(b);
+                  }),
+      references.end());
+  references.shrink_to_fit();
+}
+
+template <class GetNode, class FindNode>
+inline void ReferenceIndex::AddNodes(NodeIndex first,
+                                     NodeIndex node_count,
+                                     const GetNode& get_node,
+                                     const FindNode& find_node) {
+  assert(first == references_.size());
+  references_.resize(node_count);
+  const auto type_count =
+      types_ ? types_->ids.size() : static_cast<size_t>(0);
+  bool has_reference_types = false;
+  // Earlier nodes that gained references.
+  std::vector<NodeIndex> changed;
+
+  // Reference type nodes come first so that their indexes are dense.
+  for (auto index = first; index < node_count; ++index) {
+    const auto& node = get_node(index);
+    if (node.node_class == OpcUa_NodeClass_ReferenceType) {
+      AddReferenceType(node.node_id);
+      has_reference_types = true;
+    }
+  }
+
+  // Earlier references to the new nodes.
+  for (auto index = first; index < node_count; ++index) {
+    const auto& node_id = get_node(index).node_id.get();
+    pending_targets_.Erase(
+        detail::HashNodeId(node_id), [&](const PendingTarget& pending) {
+          if (pending.target_id->get().NodeId != node_id)
+            return false;
+          for (auto& reference : references_.Mutable(pending.source)) {
+            if (reference.target_id != pending.target_id)
+              continue;
+            reference.target = index;
+            reference.target_id = nullptr;
+            const NodeReference inverse{reference.reference_type,
+                                        !reference.inverse, pending.source,
+                                        nullptr};
+            references_.Mutable(index).push_back(inverse);
+            AddChild(pending.source, reference, get_node);
+            AddChild(index, inverse, get_node);
+          }
+          children_.Erase(GetChildHash(pending.source, kExternalNameHash),
+                          [&](const Child& child) {
+                            return child.source == pending.source &&
+                                   child.reference.target_id ==
+                                       pending.target_id;
+                          });
+          changed.push_back(pending.source);
+          return true;
+        });
+  }
+
+  const auto add_reference = [&](NodeIndex source,
+                                 const NodeId& type_id,
+                                 bool inverse,
+                                 const ExpandedNodeId& target_id) {
+    const auto type = AddReferenceType(type_id);
+    const auto& id = target_id.get();
+    const bool local = id.ServerIndex == 0 &&
+                       OpcUa_String_IsEmpty(&id.NamespaceUri) != OpcUa_False;
+    const auto target = local ? find_node(id.NodeId) : kInvalidNodeIndex;
+    if (target == kInvalidNodeIndex) {
+      const auto& external = AddExternalTarget(target_id);
+      const NodeReference reference{type, inverse, kInvalidNodeIndex,
+                                    &external};
+      references_.Mutable(source).push_back(reference);
+      AddChild(source, reference, get_node);
+      if (local) {
+        pending_targets_.Insert(detail::HashNodeId(id.NodeId),
+                                {source, &external});
+      }
+      return;
+    }
+    const NodeReference reference{type, inverse, target, nullptr};
+    const NodeReference inverse_reference{type, !inverse, source, nullptr};
+    references_.Mutable(source).push_back(reference);
+    references_.Mutable(target).push_back(inverse_reference);
+    AddChild(source, reference, get_node);
+    AddChild(target, inverse_reference, get_node);
+    if (target < first)
+      changed.push_back(target);
+  };
+
+  for (auto index = first; index < node_count; ++index) {
+    const auto& node = get_node(index);
+
+    for (auto& reference : node.references) {
+      add_reference(index, reference.reference_type_id, reference.inverse != 0,
+                    reference.target_id);
+    }
+
+    for (auto& child : node.children) {
+      if (!child.reference_type_id.IsNull())
+        add_reference(index, child.reference_type_id, false, child.node_id);
+    }
+
+    if (!node.parent_id.IsNull() && !node.reference_type_id.IsNull())
+      add_reference(index, node.reference_type_id, true, node.parent_id);
+
+    if (!node.type_definition_id.IsNull())
+      add_reference(index, OpcUaId_HasTypeDefinition, false,
+                    node.type_definition_id);
+
+    if (!node.super_type_id.IsNull())
+      add_reference(index, OpcUaId_HasSubtype, true, node.super_type_id);
+  }
+
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  for (auto index : changed)
+    SortReferences(references_.Mutable(index));
+  for (auto index = first; index < node_count; ++index)
+    SortReferences(references_.Mutable(index));
+
+  // A new reference type, or a new supertype of a known one, can change the
+  // closure of any type.
+  if (types_ && (has_reference_types || types_->ids.size() != type_count))
+    UpdateSubtypes(get_node, find_node);
+}
+
+template <class GetNode>
+inline std::vector<NodeIndex> ReferenceIndex::DeleteNodes(
+    Span<const NodeIndex> nodes,
+    const GetNode& get_node) {
+  const auto deleted = [nodes](NodeIndex node) {
+    return std::binary_search(nodes.begin(), nodes.end(), node);
+  };
+
+  std::vector<NodeIndex> changed;
+  for (auto node : nodes) {
+    if (node >= references_.size())
+      continue;
+    const auto name_hash =
+        detail::HashBrowseName(get_node(node).browse_name->get());
+    std::vector<NodeReference> references;
+    references.swap(references_.Mutable(node));
+    for (auto& reference : references) {
+      children_.Erase(GetChildHash(node, reference, get_node),
+                      [&](const Child& child) { return child.source == node; });
+
+      if (reference.target == kInvalidNodeIndex) {
+        // A reference still waiting for its target.
+        pending_targets_.Erase(
+            detail::HashNodeId(reference.target_id->get().NodeId),
+            [&](const PendingTarget& pending) {
+              return pending.source == node &&
+                     pending.target_id == reference.target_id;
+            });
+        continue;
+      }
+
+      // Every reference is recorded by both of its nodes, so the others are
+      // found through the references of the deleted ones.
+      const auto target = reference.target;
+      if (deleted(target))
+        continue;
+      auto& target_references = references_.Mutable(target);
+      const auto end = std::remove_if(
+          target_references.begin(), target_references.end(),
+          [node](const NodeReference& r) { return r.target == node; });
+      if (end == target_references.end())
+        continue;
+      target_references.erase(end, target_references.end());
+      children_.Erase(GetChildHash(target, name_hash),
+                      [&](const Child& child) {
+                        return child.source == target &&
+                               child.reference.target == node;
+                      });
+      changed.push_back(target);
+    }
+  }
+
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  return changed;
+}
+
+template <class GetNode, class FindNode>
+inline void ReferenceIndex::UpdateSubtypes(const GetNode& get_node,
+                                           const FindNode& find_node) {
+  if (types_.use_count() != 1)
+    types_ = std::make_shared<ReferenceTypes>(*types_);
+
+  auto& subtypes = types_->subtypes;
+  const auto type_count = types_->ids.size();
+  const auto word_count = (type_count + 63) / 64;
+  subtypes.assign(type_count, std::vector<std::uint64_t>(word_count, 0));
+  for (ReferenceTypeIndex type = 0; type < type_count; ++type) {
+    // Mark |type| in the closure of itself and every supertype. The depth
+    // bound protects against cycles in malformed models.
+    auto ancestor = type;
+    for (size_t depth = 0; depth <= type_count; ++depth) {
+      subtypes[ancestor][type / 64] |= std::uint64_t{1} << (type % 64);
+      const auto node = find_node(types_->ids[ancestor].get());
+      if (node == kInvalidNodeIndex || get_node(node).super_type_id.IsNull())
+        break;
+      ancestor = FindReferenceType(get_node(node).super_type_id);
+      if (ancestor == kInvalidReferenceTypeIndex)
+        break;
+    }
+  }
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <opcuapp/node_id.h>
+#include <opcuapp/requests.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/vector.h>
+#include <shared_mutex>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+// Per-session aliases of registered nodes. An alias is a numeric NodeId in
+// kNamespaceIndex whose identifier is the slot of the resolved node, so
+// services map it back with an array lookup instead of a NodeId search.
+class RegisteredNodes {
+ public:
+  // Not a namespace of the server; used only for aliases.
+  static const NamespaceIndex kNamespaceIndex = 0xFFFF;
+  static const size_t kDefaultMaxCount = 10000;
+
+  explicit RegisteredNodes(size_t max_count = kDefaultMaxCount)
+      : max_count_{max_count} {}
+
+  // Returns the alias, or |node_id| itself if no alias is left.
+  NodeId Register(const OpcUa_NodeId& node_id, NodeIndex index);
+
+  bool Unregister(const OpcUa_NodeId& alias);
+
+  static bool IsAlias(const OpcUa_NodeId& node_id) {
+    return node_id.NamespaceIndex == kNamespaceIndex &&
+           node_id.IdentifierType == OpcUa_IdentifierType_Numeric;
+  }
+
+  // kInvalidNodeIndex if |alias| is not registered.
+  NodeIndex Find(const OpcUa_NodeId& alias) const;
+
+  // The registered NodeId of |alias|, or a null NodeId.
+  NodeId FindNodeId(const OpcUa_NodeId& alias) const;
+
+  // Replaces |node_id| with the NodeId it is an alias of. Other NodeIds and
+  // unknown aliases are kept.
+  void ReplaceAlias(OpcUa_NodeId& node_id) const;
+
+  void Clear();
+
+  size_t size() const;
+
+ private:
+  struct Entry {
+    NodeIndex index = kInvalidNodeIndex;
+    NodeId node_id;
+  };
+
+  const Entry* FindEntry(const OpcUa_NodeId& alias) const;
+
+  const size_t max_count_;
+
+  mutable std::shared_timed_mutex mutex_;
+  // Alias identifier N is entries_[N - 1].
+  std::vector<Entry> entries_;
+  std::vector<UInt32> free_slots_;
+};
+
+inline NodeId RegisteredNodes::Register(const OpcUa_NodeId& node_id,
+                                        NodeIndex index) {
+  std::lock_guard<std::shared_timed_mutex> lock{mutex_};
+
+  UInt32 slot = 0;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  } else if (entries_.size() < max_count_) {
+    slot = static_cast<UInt32>(entries_.size());
+    entries_.emplace_back();
+  } else {
+    return node_id;
+  }
+
+  auto& entry = entries_[slot];
+  entry.index = index;
+  entry.node_id = node_id;
+  return NodeId{slot + 1, kNamespaceIndex};
+}
+
+inline bool RegisteredNodes::Unregister(const OpcUa_NodeId& alias) {
+  std::lock_guard<std::shared_timed_mutex> lock{mutex_};
+
+  auto* entry = const_cast<Entry*>(FindEntry(alias));
+  if (!entry)
+    return false;
+
+  entry->index = kInvalidNodeIndex;
+  entry->node_id = NodeId{};
+  free_slots_.push_back(alias.Identifier.Numeric - 1);
+  return true;
+}
+
+inline NodeIndex RegisteredNodes::Find(const OpcUa_NodeId& alias) const {
+  std::shared_lock<std::shared_timed_mutex> lock{mutex_};
+  auto* entry = FindEntry(alias);
+  return entry ? entry->index : kInvalidNodeIndex;
+}
+
+inline NodeId RegisteredNodes::FindNodeId(const OpcUa_NodeId& alias) const {
+  std::shared_lock<std::shared_timed_mutex> lock{mutex_};
+  auto* entry = FindEntry(alias);
+  return entry ? entry->node_id : NodeId{};
+}
+
+inline void RegisteredNodes::ReplaceAlias(OpcUa_NodeId& node_id) const {
+  if (!IsAlias(node_id))
+    return;
+  auto registered_node_id = FindNodeId(node_id);
+  if (!registered_node_id.IsNull())
+    registered_node_id.CopyTo(node_id);
+}
+
+inline void RegisteredNodes::Clear() {
+  std::lock_guard<std::shared_timed_mutex> lock{mutex_};
+  entries_.clear();
+  entries_.shrink_to_fit();
+  free_slots_.clear();
+  free_slots_.shrink_to_fit();
+}
+
+inline size_t RegisteredNodes::size() const {
+  std::shared_lock<std::shared_timed_mutex> lock{mutex_};
+  return entries_.size() - free_slots_.size();
+}
+
+inline const RegisteredNodes::Entry* RegisteredNodes::FindEntry(
+    const OpcUa_NodeId& alias) const {
+  if (!IsAlias(alias))
+    return nullptr;
+  const auto slot = alias.Identifier.Numeric - 1;
+  if (slot >= entries_.size() || entries_[slot].index == kInvalidNodeIndex)
+    return nullptr;
+  return &entries_[slot];
+}
+
+// Resolves aliases of |registered_nodes| and NodeIds of |address_space|.
+// Aliases of nodes added after |address_space|, or deleted in it, don't
+// resolve in it.
+inline NodeIndex ResolveNodeIndex(const AddressSpace& address_space,
+                                  const RegisteredNodes* registered_nodes,
+                                  const OpcUa_NodeId& node_id) {
+  if (registered_nodes && RegisteredNodes::IsAlias(node_id)) {
+    const auto index = registered_nodes->Find(node_id);
+    return index < address_space.node_count() &&
+                   !address_space.is_deleted(index)
+               ? index
+               : kInvalidNodeIndex;
+  }
+  return address_space.GetNodeIndex(node_id);
+}
+
+// Replace the aliases of a request for services that don't resolve them.
+inline void ReplaceAliases(const RegisteredNodes& registered_nodes,
+                           OpcUa_ReadRequest& request) {
+  for (Int32 i = 0; i < request.NoOfNodesToRead; ++i)
+    registered_nodes.ReplaceAlias(request.NodesToRead[i].NodeId);
+}
+
+inline void ReplaceAliases(const RegisteredNodes& registered_nodes,
+                           OpcUa_WriteRequest& request) {
+  for (Int32 i = 0; i < request.NoOfNodesToWrite; ++i)
+    registered_nodes.ReplaceAlias(request.NodesToWrite[i].NodeId);
+}
+
+// Continuation points keep the resolved node, so BrowseNext needs no
+// replacement.
+inline void ReplaceAliases(const RegisteredNodes& registered_nodes,
+                           OpcUa_BrowseRequest& request) {
+  for (Int32 i = 0; i < request.NoOfNodesToBrowse; ++i)
+    registered_nodes.ReplaceAlias(request.NodesToBrowse[i].NodeId);
+}
+
+inline void ReplaceAliases(
+    const RegisteredNodes& registered_nodes,
+    OpcUa_TranslateBrowsePathsToNodeIdsRequest& request) {
+  for (Int32 i = 0; i < request.NoOfBrowsePaths; ++i)
+    registered_nodes.ReplaceAlias(request.BrowsePaths[i].StartingNode);
+}
+
+// Registers every known node of |request|. Unknown nodes are returned as
+// they are.
+inline RegisterNodesResponse RegisterNodes(
+    const AddressSpace& address_space,
+    const OpcUa_RegisterNodesRequest& request,
+    RegisteredNodes& registered_nodes) {
+  RegisterNodesResponse response;
+
+  Span<const OpcUa_NodeId> node_ids{
+      request.NodesToRegister,
+      static_cast<size_t>(request.NoOfNodesToRegister)};
+  if (node_ids.empty()) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadNothingToDo;
+    return response;
+  }
+
+  Vector<OpcUa_NodeId> results(node_ids.size());
+  for (size_t i = 0; i < node_ids.size(); ++i) {
+    const auto index = address_space.GetNodeIndex(node_ids[i]);
+    if (index != kInvalidNodeIndex)
+      registered_nodes.Register(node_ids[i], index).CopyTo(results[i]);
+    else
+      NodeId{node_ids[i]}.CopyTo(results[i]);
+  }
+
+  response.ResponseHeader.ServiceResult = OpcUa_Good;
+  response.NoOfRegisteredNodeIds = results.size();
+  response.RegisteredNodeIds = results.release();
+  return response;
+}
+
+inline UnregisterNodesResponse UnregisterNodes(
+    const OpcUa_UnregisterNodesRequest& request,
+    RegisteredNodes& registered_nodes) {
+  UnregisterNodesResponse response;
+
+  if (request.NoOfNodesToUnregister <= 0) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadNothingToDo;
+    return response;
+  }
+
+  // Unknown aliases are ignored, as there is no per-node result.
+  for (Int32 i = 0; i < request.NoOfNodesToUnregister; ++i)
+    registered_nodes.Unregister(request.NodesToUnregister[i]);
+
+  response.ResponseHeader.ServiceResult = OpcUa_Good;
+  return response;
+}
+
+}  // namespace server
+}  // namespace opcua
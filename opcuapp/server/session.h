@@ -21,6 +21,8 @@ struct SessionContext {
   const NodeId id_;
   const String name_;
   const NodeId authentication_token_;
+  // Zero for no limit.
+  const UInt32 max_response_message_size_;
   const SessionHandlers handlers_;
 };
 
@@ -52,10 +54,26 @@ class Session : public std::enable_shared_from_this<Session>,
   void BeginInvoke(OpcUa_ReadRequest& request,
                    ReadResponseHandler&& response_handler);
 
+  template <class WriteResponseHandler>
+  void BeginInvoke(OpcUa_WriteRequest& request,
+                   WriteResponseHandler&& response_handler);
+
+  template <class RegisterNodesResponseHandler>
+  void BeginInvoke(OpcUa_RegisterNodesRequest& request,
+                   RegisterNodesResponseHandler&& response_handler);
+
+  template <class UnregisterNodesResponseHandler>
+  void BeginInvoke(OpcUa_UnregisterNodesRequest& request,
+                   UnregisterNodesResponseHandler&& response_handler);
+
   template <class BrowseResponseHandler>
   void BeginInvoke(OpcUa_BrowseRequest& request,
                    BrowseResponseHandler&& response_handler);
 
+  template <class BrowseNextResponseHandler>
+  void BeginInvoke(OpcUa_BrowseNextRequest& request,
+                   BrowseNextResponseHandler&& response_handler);
+
   template <class TranslateBrowsePathsToNodeIdsResponseHandler>
   void BeginInvoke(
       OpcUa_TranslateBrowsePathsToNodeIdsRequest& request,
@@ -103,6 +121,10 @@ class Session : public std::enable_shared_from_this<Session>,
 
   std::list<PendingPublishRequest> pending_publish_requests_;
 
+  BrowseContinuationPoints browse_continuation_points_;
+
+  RegisteredNodes registered_nodes_;
+
   Timer pending_publish_requests_timer_;
 
   bool closed_ = false;
@@ -132,25 +154,103 @@ inline void Session::BeginInvoke(OpcUa_ReadRequest& request,
                                  ReadResponseHandler&& response_handler) {
   // TODO: |closed_|
 
+  if (handlers_.registered_read_handler_) {
+    handlers_.registered_read_handler_(
+        request, registered_nodes_,
+        std::forward<ReadResponseHandler>(response_handler));
+    return;
+  }
+
+  ReplaceAliases(registered_nodes_, request);
   handlers_.read_handler_(request,
                           std::forward<ReadResponseHandler>(response_handler));
 }
 
+template <class WriteResponseHandler>
+inline void Session::BeginInvoke(OpcUa_WriteRequest& request,
+                                 WriteResponseHandler&& response_handler) {
+  if (handlers_.registered_write_handler_) {
+    handlers_.registered_write_handler_(
+        request, registered_nodes_,
+        std::forward<WriteResponseHandler>(response_handler));
+    return;
+  }
+
+  if (!handlers_.write_handler_) {
+    WriteResponse response;
+    response.ResponseHeader.ServiceResult = OpcUa_BadServiceUnsupported;
+    response_handler(std::move(response));
+    return;
+  }
+
+  ReplaceAliases(registered_nodes_, request);
+  handlers_.write_handler_(
+      request, std::forward<WriteResponseHandler>(response_handler));
+}
+
+template <class RegisterNodesResponseHandler>
+inline void Session::BeginInvoke(
+    OpcUa_RegisterNodesRequest& request,
+    RegisterNodesResponseHandler&& response_handler) {
+  if (!handlers_.register_nodes_handler_) {
+    RegisterNodesResponse response;
+    response.ResponseHeader.ServiceResult = OpcUa_BadServiceUnsupported;
+    response_handler(std::move(response));
+    return;
+  }
+
+  handlers_.register_nodes_handler_(
+      request, registered_nodes_,
+      std::forward<RegisterNodesResponseHandler>(response_handler));
+}
+
+template <class UnregisterNodesResponseHandler>
+inline void Session::BeginInvoke(
+    OpcUa_UnregisterNodesRequest& request,
+    UnregisterNodesResponseHandler&& response_handler) {
+  response_handler(UnregisterNodes(request, registered_nodes_));
+}
+
 template <class BrowseResponseHandler>
 inline void Session::BeginInvoke(OpcUa_BrowseRequest& request,
                                  BrowseResponseHandler&& response_handler) {
   // TODO: |closed_|
 
+  ReplaceAliases(registered_nodes_, request);
+  if (handlers_.continuation_browse_handler_) {
+    handlers_.continuation_browse_handler_(
+        request, browse_continuation_points_,
+        std::forward<BrowseResponseHandler>(response_handler));
+    return;
+  }
+
   handlers_.browse_handler_(
       request, std::forward<BrowseResponseHandler>(response_handler));
 }
 
+template <class BrowseNextResponseHandler>
+inline void Session::BeginInvoke(
+    OpcUa_BrowseNextRequest& request,
+    BrowseNextResponseHandler&& response_handler) {
+  if (!handlers_.browse_next_handler_) {
+    BrowseNextResponse response;
+    response.ResponseHeader.ServiceResult = OpcUa_BadServiceUnsupported;
+    response_handler(std::move(response));
+    return;
+  }
+
+  handlers_.browse_next_handler_(
+      request, browse_continuation_points_,
+      std::forward<BrowseNextResponseHandler>(response_handler));
+}
+
 template <class TranslateBrowsePathsToNodeIdsResponseHandler>
 inline void Session::BeginInvoke(
     OpcUa_TranslateBrowsePathsToNodeIdsRequest& request,
     TranslateBrowsePathsToNodeIdsResponseHandler&& response_handler) {
   // TODO: |closed_|
 
+  ReplaceAliases(registered_nodes_, request);
   handlers_.translate_browse_paths_to_node_ids_handler_(
       request, std::forward<TranslateBrowsePathsToNodeIdsResponseHandler>(
                    response_handler));
@@ -316,9 +416,17 @@ inline std::shared_ptr<Session::Subscription> Session::CreateSubscription(
       request.MaxNotificationsPerPublish != 0
           ? static_cast<size_t>(request.MaxNotificationsPerPublish)
           : std::numeric_limits<size_t>::max(),
+      max_response_message_size_ != 0
+          ? static_cast<size_t>(max_response_message_size_)
+          : std::numeric_limits<size_t>::max(),
       request.PublishingEnabled != OpcUa_False,
       request.Priority,
-      handlers_.create_monitored_item_handler_,
+      [ref](ReadValueId&& read_value_id, MonitoringParameters&& params) {
+        // Handlers see the registered NodeId instead of the alias.
+        ref->registered_nodes_.ReplaceAlias(read_value_id.NodeId);
+        return ref->handlers_.create_monitored_item_handler_(
+            std::move(read_value_id), std::move(params));
+      },
       [ref] { ref->Publish(); },
       [ref, subscription_id] { ref->DeleteSubscription(subscription_id); },
   });
@@ -368,6 +476,9 @@ inline void Session::Close() {
     subscriptions = std::move(subscriptions_);
   }
 
+  browse_continuation_points_.Clear();
+  registered_nodes_.Clear();
+
   for (auto& p : subscriptions)
     p.second->Close();
 }
@@ -4,6 +4,7 @@
 #include <opcuapp/extension_object.h>
 #include <opcuapp/requests.h>
 #include <opcuapp/server/handlers.h>
+#include <opcuapp/shared_extension_object.h>
 #include <opcuapp/vector.h>
 #include <map>
 #include <memory>
@@ -43,6 +44,9 @@ struct SubscriptionContext {
   const UInt32 max_lifetime_count_;
   const UInt32 max_keep_alive_count_;
   const size_t max_notifications_per_publish_;
+  // Encoded size of a PublishResponse, within the session's
+  // MaxResponseMessageSize.
+  const size_t max_message_size_;
   const bool publishing_enabled_;
   const Byte priority_;
   const CreateMonitoredItemHandler create_monitored_item_handler_;
@@ -109,7 +113,7 @@ class BasicSubscription
 
   std::mutex mutex_;
 
-  std::queue<ExtensionObject> notifications_;
+  std::queue<SharedExtensionObject> notifications_;
 
   UInt32 keep_alive_count_ = 0;
   UInt32 lifetime_count_ = 0;
@@ -125,6 +129,10 @@ class BasicSubscription
   bool closed_ = false;
 
   const Double kMinPublishingIntervalResolutionMs = 10;
+
+  // Response and message headers, sequence numbers and security overhead
+  // around the notifications.
+  const size_t kPublishResponseOverhead = 1024;
 };
 
 // static
@@ -259,16 +267,29 @@ template <class Timer>
 inline bool BasicSubscription<Timer>::PublishMessage(
     NotificationMessage& message) {
   if (!notifications_.empty()) {
-    // Notification messages response.
-    Vector<OpcUa_ExtensionObject> notifications(
-        std::min(max_notifications_per_publish_, notifications_.size()));
-    for (size_t i = 0; i < notifications.size(); ++i) {
-      assert(IsValid(notifications_.front().get()));
-      auto notification = std::move(notifications_.front());
+    // Notification messages response. The rest is left for the next one,
+    // but a message always takes at least one notification.
+    const auto overhead = kPublishResponseOverhead +
+                          sizeof(UInt32) * (published_messages_.size() + 1);
+    const auto budget =
+        max_message_size_ > overhead ? max_message_size_ - overhead : 0;
+
+    Vector<OpcUa_ExtensionObject> notifications;
+    notifications.reserve(
+        std::min(notifications_.size(), max_notifications_per_publish_));
+    size_t notifications_size = 0;
+    while (!notifications_.empty() &&
+           notifications.size() < max_notifications_per_publish_) {
+      // Encoded once; the message and its retransmission copies take the
+      // encoded body.
+      const auto size = notifications_.front().encoded().size();
+      if (!notifications.empty() && notifications_size + size > budget)
+        break;
+      notifications_size += size;
+      auto& notification = notifications.emplace_back();
+      notifications_.front().CopyTo(notification);
+      assert(IsValid(notification));
       notifications_.pop();
-      assert(IsValid(notification.get()));
-      notification.release(notifications[i]);
-      assert(IsValid(notifications[i]));
     }
 
     message.NoOfNotificationData =
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <opcuapp/data_value.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/handlers.h>
+#include <opcuapp/signal.h>
+#include <opcuapp/variant.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace opcua {
+namespace server {
+
+// Current Values of dynamic variables, one slot per variable. Producers
+// update a slot under its seqlock; readers copy it without locking and retry
+// if a write overlapped. Scalars of fixed size are stored in the slot
+// itself. Other values are kept in an immutable heap copy tagged with the
+// sequence number that published it. Slots are kept by NodeIndex, so they
+// serve every version of the address space.
+class ValueStore {
+ public:
+  // Not thread-safe. Variables are expected to be added before serving.
+  void AddVariable(const AddressSpace& address_space, const NodeId& node_id);
+
+  bool Has(NodeIndex index) const { return slots_.Has(index); }
+
+  // Replaces the Value and notifies subscribers. The server timestamp is not
+  // stored.
+  StatusCode Write(NodeIndex index, const OpcUa_DataValue& data_value);
+  StatusCode Write(const AddressSpace& address_space,
+                   const NodeId& node_id,
+                   const OpcUa_DataValue& data_value) {
+    return Write(address_space.GetNodeIndex(node_id), data_value);
+  }
+
+  // Returns false if the node has no slot.
+  bool Read(NodeIndex index, OpcUa_DataValue& data_value) const;
+
+  // Reports the current Value on subscription and every later write.
+  std::shared_ptr<MonitoredItem> CreateMonitoredItem(NodeIndex index);
+
+ private:
+  // The part of a DataValue that is copied under the seqlock.
+  struct Header {
+    OpcUa_StatusCode status_code;
+    UInt16 source_picoseconds;
+    Byte datatype;
+    // The value is in Slot::heap_value instead of |scalar|.
+    Byte on_heap;
+    OpcUa_DateTime source_timestamp;
+    std::uint64_t scalar;
+  };
+
+  static const size_t kHeaderWords =
+      (sizeof(Header) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  struct HeapValue {
+    std::uint32_t sequence;
+    Variant value;
+  };
+
+  struct Slot {
+    std::atomic<std::uint32_t> sequence{0};
+    std::atomic<std::uint64_t> words[kHeaderWords] = {};
+    std::shared_ptr<const HeapValue> heap_value;
+    // Serializes producers of the slot.
+    std::mutex write_mutex;
+    Signal<void(const DataValue& data_value)> changed;
+  };
+
+  class Item;
+
+  static bool IsInline(const OpcUa_Variant& value);
+
+  AttributeColumn<std::unique_ptr<Slot>> slots_;
+};
+
+class ValueStore::Item : public MonitoredItem {
+ public:
+  Item(const ValueStore& store, NodeIndex index, Slot& slot)
+      : store_{store}, index_{index}, slot_{slot} {}
+
+  virtual void SubscribeDataChange(
+      const DataChangeHandler& data_change_handler) override {
+    connection_ = slot_.changed.Connect(
+        [data_change_handler](const DataValue& data_value) {
+          data_change_handler(DataValue{data_value});
+        });
+
+    DataValue data_value;
+    store_.Read(index_, data_value.get());
+    data_change_handler(std::move(data_value));
+  }
+
+  // Variables don't notify events.
+  virtual void SubscribeEvents(const EventHandler& /*event_handler*/) override {
+  }
+
+ private:
+  const ValueStore& store_;
+  const NodeIndex index_;
+  Slot& slot_;
+  ScopedSignalConnection connection_;
+};
+
+inline void ValueStore::AddVariable(const AddressSpace& address_space,
+                                    const NodeId& node_id) {
+  const auto index = address_space.GetNodeIndex(node_id);
+  if (index == kInvalidNodeIndex)
+    Check(OpcUa_BadNodeIdUnknown);
+  if (!slots_.Has(index))
+    slots_.Set(index, std::make_unique<Slot>());
+}
+
+// static
+inline bool ValueStore::IsInline(const OpcUa_Variant& value) {
+  if (value.ArrayType != OpcUa_VariantArrayType_Scalar)
+    return false;
+
+  switch (value.Datatype) {
+    case OpcUaType_Null:
+    case OpcUaType_Boolean:
+    case OpcUaType_SByte:
+    case OpcUaType_Byte:
+    case OpcUaType_Int16:
+    case OpcUaType_UInt16:
+    case OpcUaType_Int32:
+    case OpcUaType_UInt32:
+    case OpcUaType_Int64:
+    case OpcUaType_UInt64:
+    case OpcUaType_Float:
+    case OpcUaType_Double:
+    case OpcUaType_DateTime:
+    case OpcUaType_StatusCode:
+      return true;
+    default:
+      return false;
+  }
+}
+
+inline StatusCode ValueStore::Write(NodeIndex index,
+                                    const OpcUa_DataValue& data_value) {
+  auto* slot_ptr = slots_.Find(index);
+  if (!slot_ptr)
+    return OpcUa_BadNodeIdUnknown;
+  auto& slot = **slot_ptr;
+
+  Header header = {};
+  header.status_code = data_value.StatusCode;
+  header.source_picoseconds = data_value.SourcePicoseconds;
+  header.datatype = data_value.Value.Datatype;
+  header.source_timestamp = data_value.SourceTimestamp;
+
+  const bool on_heap = !IsInline(data_value.Value);
+  header.on_heap = on_heap;
+  if (!on_heap) {
+    static_assert(sizeof(data_value.Value.Value) >= sizeof(header.scalar),
+                  "Variant value is smaller than a word");
+    std::memcpy(&header.scalar, &data_value.Value.Value,
+                sizeof(header.scalar));
+  }
+
+  std::uint64_t words[kHeaderWords] = {};
+  std::memcpy(words, &header, sizeof(header));
+
+  {
+    std::lock_guard<std::mutex> lock{slot.write_mutex};
+
+    const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    if (on_heap) {
+      // Published before the header, so readers that see the new sequence
+      // find the matching value.
+      std::atomic_store(&slot.heap_value,
+                        std::shared_ptr<const HeapValue>{
+                            new HeapValue{sequence + 2, data_value.Value}});
+    }
+
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kHeaderWords; ++i)
+      slot.words[i].store(words[i], std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  // Skips the copy for slots that were never subscribed.
+  if (slot.changed.begin() != slot.changed.end()) {
+    DataValue notification;
+    Read(index, notification.get());
+    slot.changed(notification);
+  }
+
+  return OpcUa_Good;
+}
+
+inline bool ValueStore::Read(NodeIndex index,
+                             OpcUa_DataValue& data_value) const {
+  auto* slot_ptr = slots_.Find(index);
+  if (!slot_ptr)
+    return false;
+  const auto& slot = **slot_ptr;
+
+  Header header;
+  std::shared_ptr<const HeapValue> heap_value;
+  for (;;) {
+    const auto sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::uint64_t words[kHeaderWords];
+    for (size_t i = 0; i < kHeaderWords; ++i)
+      words[i] = slot.words[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+      continue;
+
+    std::memcpy(&header, words, sizeof(header));
+    if (!header.on_heap)
+      break;
+
+    // A newer write may have replaced the heap value meanwhile.
+    heap_value = std::atomic_load(&slot.heap_value);
+    if (heap_value && heap_value->sequence == sequence)
+      break;
+  }
+
+  Clear(data_value);
+  data_value.StatusCode = header.status_code;
+  data_value.SourceTimestamp = header.source_timestamp;
+  data_value.SourcePicoseconds = header.source_picoseconds;
+  if (header.on_heap) {
+    Copy(heap_value->value.get(), data_value.Value);
+  } else {
+    data_value.Value.Datatype = header.datatype;
+    std::memcpy(&data_value.Value.Value, &header.scalar,
+                sizeof(header.scalar));
+  }
+  return true;
+}
+
+inline std::shared_ptr<MonitoredItem> ValueStore::CreateMonitoredItem(
+    NodeIndex index) {
+  auto* slot = slots_.Find(index);
+  if (!slot)
+    return nullptr;
+  return std::make_shared<Item>(*this, index, **slot);
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <opcuapp/requests.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/registered_nodes.h>
+#include <opcuapp/server/value_store.h>
+#include <opcuapp/vector.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace opcua {
+namespace server {
+
+struct WriteItem {
+  NodeIndex node;
+  const OpcUa_WriteValue* write_value;
+};
+
+// Writes a batch of Values to a device or other data source. |results| are
+// set to OpcUa_Good before the call.
+using WriteBackend = std::function<void(Span<const WriteItem> items,
+                                        Span<OpcUa_StatusCode> results)>;
+
+// Write over an AddressSpace. The Values of a request are grouped by
+// backend, so each backend is called once per request, and the results are
+// written into the preallocated status array. Nodes without a backend are
+// written to the ValueStore.
+//
+// Each call serves the version of the address space it is given. Backends
+// are kept by NodeIndex, which later versions keep.
+class Writer {
+ public:
+  // Not thread-safe. Nodes sharing a |backend| object are written together,
+  // so share one pointer between the nodes of a device.
+  void SetWriteBackend(const AddressSpace& address_space,
+                       const NodeId& node_id,
+                       std::shared_ptr<const WriteBackend> backend);
+
+  // |value_store| must outlive the Writer.
+  void SetValueStore(ValueStore& value_store) { value_store_ = &value_store; }
+
+  // |registered_nodes| resolves the aliases of the calling session.
+  WriteResponse Write(const AddressSpace& address_space,
+                      const OpcUa_WriteRequest& request,
+                      const RegisteredNodes* registered_nodes = nullptr) const;
+
+ private:
+  StatusCode Validate(const AddressSpace& address_space,
+                      const OpcUa_WriteValue& write_value,
+                      NodeIndex index) const;
+
+  // Whether a value of built-in type |datatype| may be written to a node of
+  // |node_data_type_id|. Data types missing from the address space can't be
+  // checked and are accepted.
+  bool IsOfDataType(const AddressSpace& address_space,
+                    Byte datatype,
+                    const NodeId& node_data_type_id) const;
+
+  static bool IsOfValueRank(Byte array_type, Int32 value_rank);
+
+  AttributeColumn<std::shared_ptr<const WriteBackend>> backends_;
+  ValueStore* value_store_ = nullptr;
+};
+
+inline void Writer::SetWriteBackend(
+    const AddressSpace& address_space,
+    const NodeId& node_id,
+    std::shared_ptr<const WriteBackend> backend) {
+  const auto index = address_space.GetNodeIndex(node_id);
+  if (index == kInvalidNodeIndex)
+    Check(OpcUa_BadNodeIdUnknown);
+  backends_.Set(index, std::move(backend));
+}
+
+inline WriteResponse Writer::Write(
+    const AddressSpace& address_space,
+    const OpcUa_WriteRequest& request,
+    const RegisteredNodes* registered_nodes) const {
+  WriteResponse response;
+
+  Span<const OpcUa_WriteValue> write_values{
+      request.NodesToWrite, static_cast<size_t>(request.NoOfNodesToWrite)};
+  if (write_values.empty()) {
+    response.ResponseHeader.ServiceResult = OpcUa_BadNothingToDo;
+    return response;
+  }
+
+  struct Item {
+    const WriteBackend* backend;
+    NodeIndex node;
+    UInt32 position;
+  };
+
+  Vector<OpcUa_StatusCode> results(write_values.size());
+  std::vector<Item> items;
+  items.reserve(write_values.size());
+
+  for (size_t i = 0; i < write_values.size(); ++i) {
+    const auto& write_value = write_values[i];
+    const auto index = ResolveNodeIndex(address_space, registered_nodes,
+                                        write_value.NodeId);
+    const auto status_code = Validate(address_space, write_value, index);
+    if (!status_code) {
+      results[i] = status_code.code();
+      continue;
+    }
+
+    if (auto* backend = backends_.Find(index)) {
+      items.push_back({backend->get(), index, static_cast<UInt32>(i)});
+    } else if (value_store_ && value_store_->Has(index)) {
+      results[i] = value_store_->Write(index, write_value.Value).code();
+    } else {
+      results[i] = OpcUa_BadNotWritable;
+    }
+  }
+
+  // Group by backend, keeping the request order within each group.
+  std::stable_sort(
+      items.begin(), items.end(),
+      [](const Item& a, const Item& b) { return a.backend < b.backend; });
+
+  std::vector<WriteItem> batch;
+  std::vector<OpcUa_StatusCode> batch_results;
+  for (size_t begin = 0; begin < items.size();) {
+    auto* backend = items[begin].backend;
+    batch.clear();
+    auto end = begin;
+    for (; end < items.size() && items[end].backend == backend; ++end)
+      batch.push_back({items[end].node, &write_values[items[end].position]});
+
+    batch_results.assign(batch.size(), OpcUa_Good);
+    (*backend)({batch.data(), batch.size()},
+               {batch_results.data(), batch_results.size()});
+    for (auto i = begin; i < end; ++i)
+      results[items[i].position] = batch_results[i - begin];
+
+    begin = end;
+  }
+
+  response.ResponseHeader.ServiceResult = OpcUa_Good;
+  response.NoOfResults = results.size();
+  response.Results = results.release();
+  return response;
+}
+
+inline StatusCode Writer::Validate(const AddressSpace& address_space,
+                                   const OpcUa_WriteValue& write_value,
+                                   NodeIndex index) const {
+  if (index == kInvalidNodeIndex)
+    return OpcUa_BadNodeIdUnknown;
+
+  // Only Values are writable.
+  if (write_value.AttributeId != OpcUa_Attributes_Value)
+    return OpcUa_BadNotWritable;
+
+  if (OpcUa_String_IsEmpty(&write_value.IndexRange) == OpcUa_False)
+    return OpcUa_BadIndexRangeInvalid;
+
+  const auto& attributes = address_space.attributes();
+  const auto* access_level = attributes.access_level.Find(index);
+  if (!access_level || (*access_level & OpcUa_AccessLevels_CurrentWrite) == 0)
+    return OpcUa_BadNotWritable;
+  // Nodes without a UserAccessLevel don't restrict users further.
+  const auto* user_access_level = attributes.user_access_level.Find(index);
+  if (user_access_level &&
+      (*user_access_level & OpcUa_AccessLevels_CurrentWrite) == 0) {
+    return OpcUa_BadUserAccessDenied;
+  }
+
+  // Null values are accepted for any node.
+  const auto& value = write_value.Value.Value;
+  if (value.Datatype == OpcUaType_Null)
+    return OpcUa_Good;
+  const auto& node = address_space.node(index);
+  const auto* value_rank = attributes.value_rank.Find(index);
+  if (!IsOfDataType(address_space, value.Datatype, node.data_type_id) ||
+      !IsOfValueRank(value.ArrayType, value_rank ? *value_rank : -1)) {
+    return OpcUa_BadTypeMismatch;
+  }
+
+  return OpcUa_Good;
+}
+
+inline bool Writer::IsOfDataType(const AddressSpace& address_space,
+                                 Byte datatype,
+                                 const NodeId& node_data_type_id) const {
+  const auto is_signed = [datatype] {
+    return datatype == OpcUaType_SByte || datatype == OpcUaType_Int16 ||
+           datatype == OpcUaType_Int32 || datatype == OpcUaType_Int64;
+  };
+  const auto is_unsigned = [datatype] {
+    return datatype == OpcUaType_Byte || datatype == OpcUaType_UInt16 ||
+           datatype == OpcUaType_UInt32 || datatype == OpcUaType_UInt64;
+  };
+
+  // Walks up the supertypes to the first standard data type. The depth
+  // bound guards against supertype cycles in loaded models.
+  const auto* id = &node_data_type_id.get();
+  for (int depth = 0; depth < 64; ++depth) {
+    if (id->NamespaceIndex == 0 &&
+        id->IdentifierType == OpcUa_IdentifierType_Numeric) {
+      switch (id->Identifier.Numeric) {
+        case OpcUaId_BaseDataType:
+          return true;
+        case OpcUaId_Number:
+          return is_signed() || is_unsigned() || datatype == OpcUaType_Float ||
+                 datatype == OpcUaType_Double;
+        case OpcUaId_Integer:
+          return is_signed();
+        case OpcUaId_UInteger:
+          return is_unsigned();
+        case OpcUaId_Enumeration:
+          return datatype == OpcUaType_Int32;
+      }
+      // Built-in types and Structure share their identifiers with the
+      // Variant type tags.
+      if (id->Identifier.Numeric <= OpcUaType_DiagnosticInfo)
+        return id->Identifier.Numeric == datatype;
+    }
+
+    const auto index = address_space.GetNodeIndex(*id);
+    if (index == kInvalidNodeIndex)
+      return true;
+    id = &address_space.node(index).super_type_id.get();
+    if (::OpcUa_NodeId_IsNull(const_cast<OpcUa_NodeId*>(id)))
+      return true;
+  }
+  return true;
+}
+
+// static
+inline bool Writer::IsOfValueRank(Byte array_type, Int32 value_rank) {
+  switch (value_rank) {
+    case -3:  // ScalarOrOneDimension
+      return array_type != OpcUa_VariantArrayType_Matrix;
+    case -2:  // Any
+      return true;
+    case -1:  // Scalar
+      return array_type == OpcUa_VariantArrayType_Scalar;
+    case 0:  // OneOrMoreDimensions
+      return array_type != OpcUa_VariantArrayType_Scalar;
+    case 1:
+      return array_type == OpcUa_VariantArrayType_Array;
+    default:
+      return array_type == OpcUa_VariantArrayType_Matrix;
+  }
+}
+
+}  // namespace server
+}  // namespace opcua
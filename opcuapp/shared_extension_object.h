@@ -0,0 +1,124 @@
+#pragma once
+
+// Before binary_decoder.h, which can't be included first.
+#include <opcuapp/binary_reader.h>
+
+#include <opcuapp/binary_writer.h>
+#include <opcuapp/byte_string.h>
+#include <opcuapp/encodable_object.h>
+#include <opcuapp/extension_object.h>
+#include <opcuapp/span.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace opcua {
+
+// Immutable ExtensionObject shared by reference. Copies share one body,
+// and its binary encoding is made once, on first use. Null objects have no
+// body.
+class SharedExtensionObject {
+ public:
+  SharedExtensionObject() = default;
+  SharedExtensionObject(ExtensionObject&& value) { *this = std::move(value); }
+
+  SharedExtensionObject& operator=(ExtensionObject&& value) {
+    if (value.encoding() == OpcUa_ExtensionObjectEncoding_None) {
+      body_.reset();
+    } else {
+      body_ = std::make_shared<Body>();
+      body_->value = std::move(value);
+    }
+    return *this;
+  }
+
+  explicit operator bool() const { return !!body_; }
+
+  const ExtensionObject& operator*() const {
+    return body_ ? body_->value : Null();
+  }
+  const ExtensionObject* operator->() const { return &**this; }
+
+  // Binary encoding of the whole object; empty for null.
+  Span<const char> encoded() const {
+    if (!body_)
+      return {nullptr, 0};
+    const auto& encoded = Encode();
+    return {encoded.data(), encoded.size()};
+  }
+
+  // Fills |target| with the encoded body, which the stack writes as is.
+  // Bodies not encoded as binary, such as XML, are deep copied instead.
+  void CopyTo(OpcUa_ExtensionObject& target) const;
+
+  // Deep copy that doesn't share memory with the body.
+  ExtensionObject Copy() const { return body_ ? body_->value : Null(); }
+
+  friend bool operator==(const SharedExtensionObject& a,
+                         const SharedExtensionObject& b) {
+    return a.body_ == b.body_;
+  }
+  friend bool operator!=(const SharedExtensionObject& a,
+                         const SharedExtensionObject& b) {
+    return a.body_ != b.body_;
+  }
+
+ private:
+  struct Body {
+    ExtensionObject value;
+    std::once_flag encode_once;
+    std::vector<char> encoded;
+    // Set only if the body is encoded as binary.
+    bool binary = false;
+    Span<const char> binary_body{nullptr, 0};
+  };
+
+  static const ExtensionObject& Null() {
+    static const ExtensionObject value;
+    return value;
+  }
+
+  const std::vector<char>& Encode() const;
+
+  std::shared_ptr<Body> body_;
+};
+
+inline const std::vector<char>& SharedExtensionObject::Encode() const {
+  auto& body = *body_;
+  std::call_once(body.encode_once, [&body] {
+    auto context = detail::MakeMessageContext();
+    BinaryWriter{body.encoded, context}.Write(body.value.get());
+
+    // Type id, encoding byte, then the body as a ByteString.
+    BinaryReader reader{{body.encoded.data(), body.encoded.size()}, context};
+    reader.Read<NodeId>();
+    if (reader.Read<Byte>() == 0x01) {
+      body.binary = true;
+      body.binary_body = reader.ReadByteStringView();
+    }
+  });
+  return body.encoded;
+}
+
+inline void SharedExtensionObject::CopyTo(
+    OpcUa_ExtensionObject& target) const {
+  if (!body_) {
+    Initialize(target);
+    return;
+  }
+
+  Encode();
+  if (!body_->binary) {
+    opcua::Copy(body_->value.get(), target);
+    return;
+  }
+
+  const auto& binary_body = body_->binary_body;
+  opcua::Copy(body_->value.type_id(), target.TypeId);
+  target.Encoding = OpcUa_ExtensionObjectEncoding_Binary;
+  target.Body.Binary =
+      ByteString{binary_body.data(), binary_body.size()}.release();
+  target.BodySize = static_cast<Int32>(binary_body.size());
+}
+
+}  // namespace opcua
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <opcuapp/basic_structs.h>
+#include <opcuapp/encodable_object.h>
+#include <opcuapp/interned.h>
+#include <opcuapp/span.h>
+#include <opcuapp/variant.h>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace opcua {
+
+// Process-wide set of immutable Variants keyed by their binary encoding.
+// Entries are reference-counted by SharedVariant handles and removed with
+// the last one.
+class SharedVariantPool {
+ public:
+  struct Entry {
+    Variant value;
+    std::vector<char> encoded;
+    size_t hash;
+    std::weak_ptr<const Entry> self;
+  };
+
+  static SharedVariantPool& Get() {
+    // Leaked: the deleter of each entry removes it from the pool, and
+    // handles owned by other statics are released during static
+    // destruction, in no fixed order.
+    static auto& pool = *new SharedVariantPool;
+    return pool;
+  }
+
+  std::shared_ptr<const Entry> Share(Variant&& value);
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return index_.size();
+  }
+
+ private:
+  struct Hash {
+    size_t operator()(const Entry* entry) const { return entry->hash; }
+  };
+
+  struct Equal {
+    bool operator()(const Entry* a, const Entry* b) const {
+      return a->encoded == b->encoded;
+    }
+  };
+
+  SharedVariantPool() = default;
+
+  void Remove(const Entry* entry);
+
+  mutable std::mutex mutex_;
+  std::unordered_set<const Entry*, Hash, Equal> index_;
+};
+
+inline std::shared_ptr<const SharedVariantPool::Entry>
+SharedVariantPool::Share(Variant&& value) {
+  std::unique_ptr<Entry> candidate{new Entry};
+  candidate->encoded = detail::EncodeVariant(value.get());
+  candidate->hash = detail::HashBytes(candidate->encoded.data(),
+                                      candidate->encoded.size());
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto i = index_.find(candidate.get());
+  if (i != index_.end()) {
+    if (auto shared = (*i)->self.lock())
+      return shared;
+    // The last handle is being released. Its Remove finds the new entry and
+    // leaves it.
+    index_.erase(i);
+  }
+
+  candidate->value = std::move(value);
+  std::shared_ptr<Entry> shared{candidate.release(), [](Entry* entry) {
+                                  Get().Remove(entry);
+                                  delete entry;
+                                }};
+  shared->self = shared;
+  index_.insert(shared.get());
+  return shared;
+}
+
+inline void SharedVariantPool::Remove(const Entry* entry) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto i = index_.find(entry);
+  if (i != index_.end() && *i == entry)
+    index_.erase(i);
+}
+
+// Handle of a pooled Variant. Equal values share one immutable copy and its
+// encoding, so handles are compared by pointer. Null values are not pooled.
+class SharedVariant {
+ public:
+  SharedVariant() = default;
+  SharedVariant(Variant&& value) { *this = std::move(value); }
+
+  SharedVariant& operator=(Variant&& value) {
+    if (value.is_null())
+      entry_.reset();
+    else
+      entry_ = SharedVariantPool::Get().Share(std::move(value));
+    return *this;
+  }
+
+  const Variant& operator*() const { return entry_ ? entry_->value : Null(); }
+  const Variant* operator->() const { return &**this; }
+
+  // Binary encoding of the value; empty for null.
+  Span<const char> encoded() const {
+    if (!entry_)
+      return {};
+    return {entry_->encoded.data(), entry_->encoded.size()};
+  }
+
+  // Deep copy that doesn't share memory with the pooled value.
+  Variant Copy() const { return entry_ ? entry_->value : Variant{}; }
+
+  friend bool operator==(const SharedVariant& a, const SharedVariant& b) {
+    return a.entry_ == b.entry_;
+  }
+  friend bool operator!=(const SharedVariant& a, const SharedVariant& b) {
+    return a.entry_ != b.entry_;
+  }
+
+ private:
+  static const Variant& Null() {
+    static const Variant value;
+    return value;
+  }
+
+  std::shared_ptr<const SharedVariantPool::Entry> entry_;
+};
+
+}  // namespace opcua
@@ -98,7 +98,7 @@ class Signal : public BasicSignal {
 
   template <typename... Args>
   void operator()(Args... args) const {
-    for (auto& sink : *this) {
+    for (const auto& sink : *this) {
       if (sink)
         sink(args...);
     }
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <opcua_memorystream.h>
+#include <opcuapp/buffer_pool.h>
 #include <opcuapp/span.h>
+#include <algorithm>
+#include <cstring>
 #include <istream>
+#include <ostream>
 #include <vector>
 
 namespace opcua {
@@ -47,6 +51,46 @@ class StdInputStream {
   OpcUa_InputStream ua_stream_ = {};
 };
 
+class StdOutputStream {
+ public:
+  explicit StdOutputStream(std::ostream& stream) {
+    ua_stream_.Type = OpcUa_StreamType_Output;
+    ua_stream_.Handle = &stream;
+    ua_stream_.GetPosition = &StdOutputStream::GetPosition;
+    ua_stream_.SetPosition = &StdOutputStream::SetPosition;
+    ua_stream_.Write = &StdOutputStream::Write;
+  }
+
+  OpcUa_OutputStream& get() { return ua_stream_; }
+  const OpcUa_OutputStream& get() const { return ua_stream_; }
+
+ private:
+  static OpcUa_StatusCode GetPosition(OpcUa_Stream* strm,
+                                      OpcUa_UInt32* position) {
+    auto& stream = *reinterpret_cast<std::ostream*>(strm->Handle);
+    *position = static_cast<OpcUa_UInt32>(stream.tellp());
+    return OpcUa_Good;
+  }
+
+  static OpcUa_StatusCode SetPosition(OpcUa_Stream* strm,
+                                      OpcUa_UInt32 position) {
+    auto& stream = *reinterpret_cast<std::ostream*>(strm->Handle);
+    stream.seekp(position);
+    return OpcUa_Good;
+  }
+
+  static OpcUa_StatusCode Write(OpcUa_OutputStream* ostrm,
+                                OpcUa_Byte* buffer,
+                                OpcUa_UInt32 count) {
+    auto& stream = *reinterpret_cast<std::ostream*>(ostrm->Handle);
+    return stream.write(reinterpret_cast<const char*>(buffer), count)
+               ? OpcUa_Good
+               : OpcUa_Bad;
+  }
+
+  OpcUa_OutputStream ua_stream_ = {};
+};
+
 class MemoryInputStream {
  public:
   MemoryInputStream(const void* data, size_t size)
@@ -139,6 +183,108 @@ class VectorOutputStream {
   size_t pos_ = 0;
 };
 
+// Output stream writing into a chain of buffers from |pool| instead of one
+// growing vector, so large encodings are never reallocated or copied. The
+// data is read back as a list of spans, one per buffer. Buffers return to
+// the pool with the stream.
+class ChunkedOutputStream {
+ public:
+  explicit ChunkedOutputStream(BufferPool& pool = BufferPool::Get())
+      : pool_{pool} {
+    ua_stream_.Type = OpcUa_StreamType_Output;
+    ua_stream_.Handle = this;
+    ua_stream_.GetPosition = &ChunkedOutputStream::GetPosition;
+    ua_stream_.SetPosition = &ChunkedOutputStream::SetPosition;
+    ua_stream_.Write = &ChunkedOutputStream::Write;
+  }
+
+  ChunkedOutputStream(const ChunkedOutputStream&) = delete;
+  ChunkedOutputStream& operator=(const ChunkedOutputStream&) = delete;
+
+  OpcUa_OutputStream& get() { return ua_stream_; }
+  const OpcUa_OutputStream& get() const { return ua_stream_; }
+
+  size_t size() const { return size_; }
+
+  // Valid until the stream is cleared or destroyed.
+  std::vector<Span<const char>> spans() const;
+
+  void Write(const void* data, size_t size);
+  void WriteTo(std::ostream& stream) const;
+
+  void Clear() {
+    buffers_.clear();
+    size_ = 0;
+    pos_ = 0;
+  }
+
+ private:
+  static OpcUa_StatusCode GetPosition(OpcUa_Stream* strm,
+                                      OpcUa_UInt32* position) {
+    auto& stream = *reinterpret_cast<ChunkedOutputStream*>(strm->Handle);
+    *position = static_cast<OpcUa_UInt32>(stream.pos_);
+    return OpcUa_Good;
+  }
+
+  static OpcUa_StatusCode SetPosition(OpcUa_Stream* strm,
+                                      OpcUa_UInt32 position) {
+    auto& stream = *reinterpret_cast<ChunkedOutputStream*>(strm->Handle);
+    if (position > stream.size_)
+      return OpcUa_Bad;
+    stream.pos_ = position;
+    return OpcUa_Good;
+  }
+
+  static OpcUa_StatusCode Write(OpcUa_OutputStream* ostrm,
+                                OpcUa_Byte* buffer,
+                                OpcUa_UInt32 count) {
+    auto& stream = *reinterpret_cast<ChunkedOutputStream*>(ostrm->Handle);
+    stream.Write(buffer, count);
+    return OpcUa_Good;
+  }
+
+  BufferPool& pool_;
+  OpcUa_OutputStream ua_stream_ = {};
+  std::vector<BufferPool::Buffer> buffers_;
+  size_t size_ = 0;
+  size_t pos_ = 0;
+};
+
+inline std::vector<Span<const char>> ChunkedOutputStream::spans() const {
+  const auto buffer_size = pool_.buffer_size();
+  std::vector<Span<const char>> result;
+  result.reserve(buffers_.size());
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    const auto offset = i * buffer_size;
+    result.emplace_back(buffers_[i].get(),
+                        std::min(buffer_size, size_ - offset));
+  }
+  return result;
+}
+
+inline void ChunkedOutputStream::Write(const void* data, size_t size) {
+  // Writes after SetPosition overwrite the data.
+  const auto buffer_size = pool_.buffer_size();
+  auto* source = static_cast<const char*>(data);
+  while (size != 0) {
+    const auto index = pos_ / buffer_size;
+    const auto offset = pos_ % buffer_size;
+    if (index == buffers_.size())
+      buffers_.emplace_back(pool_.Acquire());
+    const auto count = std::min(size, buffer_size - offset);
+    std::memcpy(buffers_[index].get() + offset, source, count);
+    source += count;
+    size -= count;
+    pos_ += count;
+  }
+  size_ = std::max(size_, pos_);
+}
+
+inline void ChunkedOutputStream::WriteTo(std::ostream& stream) const {
+  for (auto& span : spans())
+    stream.write(span.data(), span.size());
+}
+
 class NullOutputStream {
  public:
   NullOutputStream() {
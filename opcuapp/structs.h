@@ -30,12 +30,15 @@ OPCUA_DEFINE_ENCODEABLE(ReferenceDescription);
 OPCUA_DEFINE_ENCODEABLE(RequestHeader);
 OPCUA_DEFINE_ENCODEABLE(ResponseHeader);
 OPCUA_DEFINE_ENCODEABLE(UserTokenPolicy);
+OPCUA_DEFINE_ENCODEABLE(WriteValue);
 OPCUA_DEFINE_ENCODEABLE(DataChangeFilter);
 OPCUA_DEFINE_ENCODEABLE(DataChangeNotification);
 OPCUA_DEFINE_ENCODEABLE(EventFieldList);
 OPCUA_DEFINE_ENCODEABLE(EventNotificationList);
 OPCUA_DEFINE_ENCODEABLE(EventFilter);
 OPCUA_DEFINE_ENCODEABLE(ServerStatusDataType);
+OPCUA_DEFINE_ENCODEABLE(ModelChangeStructureDataType);
+OPCUA_DEFINE_ENCODEABLE(SimpleAttributeOperand);
 
 }  // namespace opcua
 
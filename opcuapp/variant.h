@@ -1,9 +1,15 @@
 #pragma once
 
 #include <opcuapp/basic_types.h>
+#include <opcuapp/byte_string.h>
 #include <opcuapp/date_time.h>
+#include <opcuapp/expanded_node_id.h>
 #include <opcuapp/helpers.h>
+#include <opcuapp/localized_text.h>
+#include <opcuapp/qualified_name.h>
 #include <opcuapp/span.h>
+#include <opcuapp/variant_matrix.h>
+#include <cstring>
 
 template <class T>
 inline bool operator==(T&& a, const OpcUa_Variant& b) {
@@ -22,6 +28,8 @@ class ExtensionObject;
 OPCUA_DEFINE_METHODS(Variant);
 
 void Copy(const OpcUa_Variant& source, OpcUa_Variant& target);
+void Copy(const OpcUa_DataValue& source, OpcUa_DataValue& target);
+void Copy(const OpcUa_ExtensionObject& source, OpcUa_ExtensionObject& target);
 
 class Variant {
  public:
@@ -146,36 +154,6 @@ inline Span<const OpcUa_LocalizedText> Variant::get() const {
   return {array.Value.LocalizedTextArray, static_cast<size_t>(array.Length)};
 }
 
-inline void Copy(const OpcUa_Variant& source, OpcUa_Variant& target) {
-  // Copy primitive types.
-  if (source.ArrayType == OpcUa_VariantArrayType_Scalar) {
-    target.ArrayType = OpcUa_VariantArrayType_Scalar;
-    target.Datatype = source.Datatype;
-    switch (source.Datatype) {
-      case OpcUaType_Null:
-        return;
-      case OpcUaType_Boolean:
-        target.Value.Boolean = source.Value.Boolean;
-        return;
-      case OpcUaType_SByte:
-        target.Value.SByte = source.Value.SByte;
-        return;
-      case OpcUaType_Byte:
-        target.Value.Byte = source.Value.Byte;
-        return;
-      case OpcUaType_Double:
-        target.Value.Double = source.Value.Double;
-        return;
-      case OpcUaType_DateTime:
-        target.Value.DateTime = source.Value.DateTime;
-        return;
-      default:
-        assert(false);
-        return;
-    }
-  }
-}
-
 }  // namespace opcua
 
 #include <opcuapp/extension_object.h>
@@ -190,3 +168,207 @@ inline Variant::Variant(ExtensionObject&& extension_object) {
 }
 
 }  // namespace opcua
+
+namespace opcua {
+
+namespace detail {
+
+// Zero-initialized, as by Initialize().
+template <class T>
+inline T* AllocateValues(Int32 count) {
+  const auto size = sizeof(T) * static_cast<size_t>(count);
+  auto* values = static_cast<T*>(::OpcUa_Alloc(static_cast<UInt32>(size)));
+  if (!values)
+    Check(OpcUa_BadOutOfMemory);
+  std::memset(values, 0, size);
+  return values;
+}
+
+template <class T>
+inline void CopyPointee(const T* source, T*& target) {
+  if (!source)
+    return;
+  target = AllocateValues<T>(1);
+  Copy(*source, *target);
+}
+
+// Plain data is copied with a single memcpy.
+template <class T>
+inline void CopyPlainArray(const T* source, Int32 length, T*& target) {
+  if (!source || length <= 0)
+    return;
+  const auto size = sizeof(T) * static_cast<size_t>(length);
+  target = static_cast<T*>(::OpcUa_Alloc(static_cast<UInt32>(size)));
+  if (!target)
+    Check(OpcUa_BadOutOfMemory);
+  std::memcpy(target, source, size);
+}
+
+// |target| holds initialized elements before they are copied, so it can be
+// cleared if a copy throws.
+template <class T>
+inline void CopyArray(const T* source, Int32 length, T*& target) {
+  if (!source || length <= 0)
+    return;
+  target = AllocateValues<T>(length);
+  for (Int32 i = 0; i < length; ++i)
+    Copy(source[i], target[i]);
+}
+
+inline void CopyArray(Byte datatype,
+                      const OpcUa_VariantArrayUnion& source,
+                      Int32 length,
+                      OpcUa_VariantArrayUnion& target) {
+  switch (datatype) {
+    case OpcUaType_Null:
+      return;
+    case OpcUaType_Boolean:
+      return CopyPlainArray(source.BooleanArray, length, target.BooleanArray);
+    case OpcUaType_SByte:
+      return CopyPlainArray(source.SByteArray, length, target.SByteArray);
+    case OpcUaType_Byte:
+      return CopyPlainArray(source.ByteArray, length, target.ByteArray);
+    case OpcUaType_Int16:
+      return CopyPlainArray(source.Int16Array, length, target.Int16Array);
+    case OpcUaType_UInt16:
+      return CopyPlainArray(source.UInt16Array, length, target.UInt16Array);
+    case OpcUaType_Int32:
+      return CopyPlainArray(source.Int32Array, length, target.Int32Array);
+    case OpcUaType_UInt32:
+      return CopyPlainArray(source.UInt32Array, length, target.UInt32Array);
+    case OpcUaType_Int64:
+      return CopyPlainArray(source.Int64Array, length, target.Int64Array);
+    case OpcUaType_UInt64:
+      return CopyPlainArray(source.UInt64Array, length, target.UInt64Array);
+    case OpcUaType_Float:
+      return CopyPlainArray(source.FloatArray, length, target.FloatArray);
+    case OpcUaType_Double:
+      return CopyPlainArray(source.DoubleArray, length, target.DoubleArray);
+    case OpcUaType_DateTime:
+      return CopyPlainArray(source.DateTimeArray, length,
+                            target.DateTimeArray);
+    case OpcUaType_Guid:
+      return CopyPlainArray(source.GuidArray, length, target.GuidArray);
+    case OpcUaType_StatusCode:
+      return CopyPlainArray(source.StatusCodeArray, length,
+                            target.StatusCodeArray);
+    case OpcUaType_String:
+      return CopyArray(source.StringArray, length, target.StringArray);
+    case OpcUaType_ByteString:
+      return CopyArray(source.ByteStringArray, length, target.ByteStringArray);
+    case OpcUaType_XmlElement:
+      return CopyArray(source.XmlElementArray, length, target.XmlElementArray);
+    case OpcUaType_NodeId:
+      return CopyArray(source.NodeIdArray, length, target.NodeIdArray);
+    case OpcUaType_ExpandedNodeId:
+      return CopyArray(source.ExpandedNodeIdArray, length,
+                       target.ExpandedNodeIdArray);
+    case OpcUaType_QualifiedName:
+      return CopyArray(source.QualifiedNameArray, length,
+                       target.QualifiedNameArray);
+    case OpcUaType_LocalizedText:
+      return CopyArray(source.LocalizedTextArray, length,
+                       target.LocalizedTextArray);
+    case OpcUaType_ExtensionObject:
+      return CopyArray(source.ExtensionObjectArray, length,
+                       target.ExtensionObjectArray);
+    case OpcUaType_DataValue:
+      return CopyArray(source.DataValueArray, length, target.DataValueArray);
+    case OpcUaType_Variant:
+      return CopyArray(source.VariantArray, length, target.VariantArray);
+    default:
+      Check(OpcUa_BadDataTypeIdUnknown);
+  }
+}
+
+inline void CopyScalar(Byte datatype,
+                       const OpcUa_VariantUnion& source,
+                       OpcUa_VariantUnion& target) {
+  switch (datatype) {
+    case OpcUaType_Null:
+      return;
+    case OpcUaType_Boolean:
+    case OpcUaType_SByte:
+    case OpcUaType_Byte:
+    case OpcUaType_Int16:
+    case OpcUaType_UInt16:
+    case OpcUaType_Int32:
+    case OpcUaType_UInt32:
+    case OpcUaType_Int64:
+    case OpcUaType_UInt64:
+    case OpcUaType_Float:
+    case OpcUaType_Double:
+    case OpcUaType_DateTime:
+    case OpcUaType_StatusCode:
+      target = source;
+      return;
+    case OpcUaType_Guid:
+      if (source.Guid) {
+        target.Guid = AllocateValues<OpcUa_Guid>(1);
+        *target.Guid = *source.Guid;
+      }
+      return;
+    case OpcUaType_String:
+      return Copy(source.String, target.String);
+    case OpcUaType_ByteString:
+      return Copy(source.ByteString, target.ByteString);
+    case OpcUaType_XmlElement:
+      return Copy(source.XmlElement, target.XmlElement);
+    case OpcUaType_NodeId:
+      return CopyPointee(source.NodeId, target.NodeId);
+    case OpcUaType_ExpandedNodeId:
+      return CopyPointee(source.ExpandedNodeId, target.ExpandedNodeId);
+    case OpcUaType_QualifiedName:
+      return CopyPointee(source.QualifiedName, target.QualifiedName);
+    case OpcUaType_LocalizedText:
+      return CopyPointee(source.LocalizedText, target.LocalizedText);
+    case OpcUaType_ExtensionObject:
+      return CopyPointee(source.ExtensionObject, target.ExtensionObject);
+    case OpcUaType_DataValue:
+      return CopyPointee(source.DataValue, target.DataValue);
+    default:
+      Check(OpcUa_BadDataTypeIdUnknown);
+  }
+}
+
+}  // namespace detail
+
+// |target| is initialized. If a copy throws, |target| holds what was copied
+// so far and must be cleared.
+inline void Copy(const OpcUa_Variant& source, OpcUa_Variant& target) {
+  target.Datatype = source.Datatype;
+  target.ArrayType = source.ArrayType;
+
+  switch (source.ArrayType) {
+    case OpcUa_VariantArrayType_Scalar:
+      detail::CopyScalar(source.Datatype, source.Value, target.Value);
+      return;
+
+    case OpcUa_VariantArrayType_Array: {
+      auto& array = source.Value.Array;
+      target.Value.Array.Length = array.Length;
+      detail::CopyArray(source.Datatype, array.Value, array.Length,
+                        target.Value.Array.Value);
+      return;
+    }
+
+    case OpcUa_VariantArrayType_Matrix: {
+      auto& matrix = source.Value.Matrix;
+      auto& target_matrix = target.Value.Matrix;
+      if (!matrix.Dimensions || matrix.NoOfDimensions <= 0)
+        return;
+      const auto length = detail::GetMatrixLength(matrix);
+      detail::CopyPlainArray(matrix.Dimensions, matrix.NoOfDimensions,
+                             target_matrix.Dimensions);
+      target_matrix.NoOfDimensions = matrix.NoOfDimensions;
+      detail::CopyArray(source.Datatype, matrix.Value, length,
+                        target_matrix.Value);
+      return;
+    }
+
+    default:
+      Check(OpcUa_BadInvalidArgument);
+  }
+}
+
+}  // namespace opcua
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <opcua.h>
+#include <opcua_builtintypes.h>
+#include <opcuapp/basic_types.h>
+#include <opcuapp/status_code.h>
+#include <cstdint>
+#include <limits>
+
+namespace opcua {
+namespace detail {
+
+// Element count of |matrix|, or 0 without dimensions. Throws for negative
+// dimensions or a count that doesn't fit an Int32.
+inline Int32 GetMatrixLength(const OpcUa_VariantMatrixValue& matrix) {
+  if (matrix.NoOfDimensions <= 0)
+    return 0;
+  if (!matrix.Dimensions)
+    Check(OpcUa_BadInvalidArgument);
+  // Checked at each step, so the product can't overflow.
+  std::int64_t length = 1;
+  for (Int32 i = 0; i < matrix.NoOfDimensions; ++i) {
+    if (matrix.Dimensions[i] < 0)
+      Check(OpcUa_BadInvalidArgument);
+    length *= matrix.Dimensions[i];
+    if (length > std::numeric_limits<Int32>::max())
+      Check(OpcUa_BadInvalidArgument);
+  }
+  return static_cast<Int32>(length);
+}
+
+}  // namespace detail
+}  // namespace opcua
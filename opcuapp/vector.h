@@ -1,6 +1,10 @@
 #pragma once
 
 #include <opcuapp/basic_types.h>
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <type_traits>
 
 namespace opcua {
 
@@ -18,21 +22,26 @@ class Vector {
     std::for_each(data, data + size, [](auto& v) { Initialize(v); });
     data_ = data;
     size_ = size;
+    capacity_ = size;
   }
 
   Vector(Attach, T*& data, Int32& size)
-      : data_{data}, size_{static_cast<size_t>(size)} {
+      : data_{data},
+        size_{static_cast<size_t>(size)},
+        capacity_{static_cast<size_t>(size)} {
     data = OpcUa_Null;
     size = 0;
   }
 
-  Vector(Vector&& source) : data_{source.data_}, size_{source.size_} {
+  Vector(Vector&& source)
+      : data_{source.data_}, size_{source.size_}, capacity_{source.capacity_} {
     source.data_ = OpcUa_Null;
     source.size_ = 0;
+    source.capacity_ = 0;
   }
 
   ~Vector() {
-    std::for_each(data_, data_ + size_, [](auto& v) { Clear(v); });
+    clear();
     ::OpcUa_Memory_Free(data_);
   }
 
@@ -40,17 +49,65 @@ class Vector {
   Vector& operator=(const Vector&) = delete;
 
   Vector& operator=(Vector&& source) {
-    if (this != &source) {
-      data_ = source.data_;
-      size_ = source.size_;
-      source.data_ = OpcUa_Null;
-      source.size_ = 0;
-    }
+    if (this != &source)
+      Vector{std::move(source)}.swap(*this);
     return *this;
   }
 
+  void swap(Vector& other) {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+  }
+
   bool empty() const { return size_ == 0; }
   size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+
+  void reserve(size_t capacity) {
+    if (capacity > capacity_)
+      Reallocate(capacity);
+  }
+
+  void shrink_to_fit() {
+    if (capacity_ > size_)
+      Reallocate(size_);
+  }
+
+  void resize(size_t size) {
+    if (size < size_) {
+      std::for_each(data_ + size, data_ + size_, [](auto& v) { Clear(v); });
+    } else {
+      reserve(size);
+      std::for_each(data_ + size_, data_ + size,
+                    [](auto& v) { Initialize(v); });
+    }
+    size_ = size;
+  }
+
+  // Keeps the capacity.
+  void clear() { resize(0); }
+
+  // Appends an initialized element to be filled in place.
+  T& emplace_back() {
+    if (size_ == capacity_)
+      Reallocate(std::max<size_t>(4, capacity_ * 2));
+    auto& value = data_[size_++];
+    Initialize(value);
+    return value;
+  }
+
+  // Takes over the contents of |value| and leaves it initialized.
+  void push_back(T&& value) {
+    emplace_back() = value;
+    Initialize(value);
+  }
+
+  template <class U = T>
+  std::enable_if_t<std::is_arithmetic<U>::value || std::is_enum<U>::value>
+  push_back(const T& value) {
+    emplace_back() = value;
+  }
 
   T* data() { return data_; }
   const T* data() const { return data_; }
@@ -67,10 +124,12 @@ class Vector {
   T& operator[](size_t index) { return at(index); }
   const T& operator[](size_t index) const { return at(index); }
 
+  // The block may be larger than the elements; the stack frees it whole.
   T* release() {
     auto* data = data_;
     data_ = nullptr;
     size_ = 0;
+    capacity_ = 0;
     return data;
   }
 
@@ -80,8 +139,28 @@ class Vector {
   const T* end() const { return data_ + size_; }
 
  private:
+  // Elements are plain stack structs, so they are relocated bitwise.
+  void Reallocate(size_t capacity) {
+    assert(capacity >= size_);
+    if (capacity == 0) {
+      ::OpcUa_Memory_Free(data_);
+      data_ = OpcUa_Null;
+      capacity_ = 0;
+      return;
+    }
+    if (capacity > std::numeric_limits<OpcUa_UInt32>::max() / sizeof(T))
+      throw OpcUa_BadOutOfMemory;
+    auto* data = reinterpret_cast<T*>(::OpcUa_Memory_ReAlloc(
+        data_, static_cast<OpcUa_UInt32>(sizeof(T) * capacity)));
+    if (!data)
+      throw OpcUa_BadOutOfMemory;
+    data_ = data;
+    capacity_ = capacity;
+  }
+
   T* data_ = OpcUa_Null;
   size_t size_ = 0;
+  size_t capacity_ = 0;
 };
 
 }  // namespace opcua
@@ -0,0 +1,501 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace opcua {
+
+// Forward-only XML pull reader. Reads the stream through a fixed-size buffer
+// and keeps only the current node, so memory doesn't depend on document size.
+// Supports the subset used by OPC UA schema files: elements, attributes,
+// character data, CDATA and predefined/numeric entities. Comments, processing
+// instructions and DOCTYPE declarations are skipped.
+class XmlReader {
+ public:
+  enum class NodeType { None, StartElement, EndElement, Text, EndOfStream };
+
+  explicit XmlReader(std::istream& stream, size_t buffer_size = 64 * 1024);
+
+  XmlReader(const XmlReader&) = delete;
+  XmlReader& operator=(const XmlReader&) = delete;
+
+  NodeType Read();
+
+  // Moves to the next start element or end of its parent. Returns false on end
+  // of parent element.
+  bool ReadChildElement(size_t parent_depth);
+
+  // Must be called on a start element. Returns concatenated text content and
+  // leaves the reader on the matching end element.
+  std::string ReadElementText();
+
+  // Must be called on a start element. Leaves the reader on the matching end
+  // element.
+  void Skip();
+
+  // Must be called on a start element. Returns the element and its content as
+  // XML text and leaves the reader on the matching end element.
+  std::string ReadOuterXml();
+
+  NodeType node_type() const { return node_type_; }
+  size_t depth() const { return depth_; }
+  bool is_empty_element() const { return empty_element_; }
+
+  const std::string& name() const { return name_; }
+  const char* local_name() const;
+  const std::string& text() const { return text_; }
+
+  const char* GetAttribute(const char* name) const;
+
+  using Attributes = std::vector<std::pair<std::string, std::string>>;
+  const Attributes& attributes() const { return attributes_; }
+
+ private:
+  int Peek() {
+    if (pos_ == end_ && !Fill())
+      return -1;
+    return static_cast<unsigned char>(buffer_[pos_]);
+  }
+
+  int Get() {
+    int c = Peek();
+    if (c != -1)
+      ++pos_;
+    return c;
+  }
+
+  int Expect() {
+    int c = Get();
+    if (c == -1)
+      throw std::runtime_error("Unexpected end of XML stream");
+    return c;
+  }
+
+  bool Fill();
+
+  void ReadMarkup();
+  void ReadStartElement(int first_char);
+  void ReadEndElement();
+  void ReadName(std::string& name, int first_char);
+  void ReadAttributeValue(std::string& value);
+  void ReadEntity(std::string& target);
+  void ReadCData();
+  void SkipUntil(const char* terminator);
+  void SkipWhitespace();
+
+  static bool IsWhitespace(int c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  static bool IsNameChar(int c) {
+    return c != -1 && !IsWhitespace(c) && c != '/' && c != '>' && c != '=' &&
+           c != '<';
+  }
+
+  static void AppendUtf8(std::string& target, unsigned long code_point);
+  static void AppendEscaped(std::string& target, const std::string& text);
+
+  std::istream& stream_;
+  std::vector<char> buffer_;
+  size_t pos_ = 0;
+  size_t end_ = 0;
+
+  NodeType node_type_ = NodeType::None;
+  size_t depth_ = 0;
+  bool empty_element_ = false;
+  bool pending_end_element_ = false;
+
+  std::string name_;
+  std::string text_;
+  Attributes attributes_;
+  size_t attribute_count_ = 0;
+};
+
+inline XmlReader::XmlReader(std::istream& stream, size_t buffer_size)
+    : stream_{stream}, buffer_(buffer_size) {
+  assert(buffer_size != 0);
+  // Skip UTF-8 BOM.
+  if (Peek() == 0xEF) {
+    Get();
+    if (Get() != 0xBB || Get() != 0xBF)
+      throw std::runtime_error("Invalid XML byte order mark");
+  }
+}
+
+inline bool XmlReader::Fill() {
+  if (!stream_)
+    return false;
+  stream_.read(buffer_.data(), buffer_.size());
+  pos_ = 0;
+  end_ = static_cast<size_t>(stream_.gcount());
+  return end_ != 0;
+}
+
+inline const char* XmlReader::local_name() const {
+  auto p = name_.find(':');
+  return name_.c_str() + (p == std::string::npos ? 0 : p + 1);
+}
+
+inline const char* XmlReader::GetAttribute(const char* name) const {
+  for (size_t i = 0; i < attribute_count_; ++i) {
+    if (attributes_[i].first == name)
+      return attributes_[i].second.c_str();
+  }
+  return nullptr;
+}
+
+inline XmlReader::NodeType XmlReader::Read() {
+  if (node_type_ == NodeType::StartElement && !pending_end_element_)
+    ++depth_;
+
+  if (pending_end_element_) {
+    pending_end_element_ = false;
+    empty_element_ = false;
+    attribute_count_ = 0;
+    return node_type_ = NodeType::EndElement;
+  }
+
+  empty_element_ = false;
+  attribute_count_ = 0;
+
+  for (;;) {
+    int c = Peek();
+    if (c == -1) {
+      if (depth_ != 0)
+        throw std::runtime_error("Unexpected end of XML stream");
+      return node_type_ = NodeType::EndOfStream;
+    }
+
+    if (c == '<') {
+      Get();
+      c = Peek();
+      if (c == '/') {
+        Get();
+        ReadEndElement();
+        return node_type_ = NodeType::EndElement;
+      }
+      if (c == '!' || c == '?') {
+        ReadMarkup();
+        if (!text_.empty())
+          return node_type_ = NodeType::Text;
+        continue;
+      }
+      ReadStartElement(Expect());
+      return node_type_ = NodeType::StartElement;
+    }
+
+    // Character data.
+    text_.clear();
+    bool whitespace_only = true;
+    while ((c = Peek()) != -1 && c != '<') {
+      Get();
+      if (c == '&') {
+        ReadEntity(text_);
+        whitespace_only = false;
+      } else {
+        text_.push_back(static_cast<char>(c));
+        whitespace_only = whitespace_only && IsWhitespace(c);
+      }
+    }
+    if (!whitespace_only)
+      return node_type_ = NodeType::Text;
+  }
+}
+
+inline bool XmlReader::ReadChildElement(size_t parent_depth) {
+  for (;;) {
+    switch (Read()) {
+      case NodeType::StartElement:
+        if (depth_ == parent_depth + 1)
+          return true;
+        Skip();
+        break;
+      case NodeType::EndElement:
+        if (depth_ <= parent_depth)
+          return false;
+        break;
+      case NodeType::EndOfStream:
+        return false;
+      default:
+        break;
+    }
+  }
+}
+
+inline std::string XmlReader::ReadElementText() {
+  assert(node_type_ == NodeType::StartElement);
+  const auto element_depth = depth_;
+  std::string result;
+  for (;;) {
+    switch (Read()) {
+      case NodeType::Text:
+        result += text_;
+        break;
+      case NodeType::StartElement:
+        Skip();
+        break;
+      case NodeType::EndElement:
+        if (depth_ == element_depth)
+          return result;
+        break;
+      case NodeType::EndOfStream:
+        throw std::runtime_error("Unexpected end of XML stream");
+      default:
+        break;
+    }
+  }
+}
+
+inline void XmlReader::Skip() {
+  assert(node_type_ == NodeType::StartElement);
+  const auto element_depth = depth_;
+  for (;;) {
+    switch (Read()) {
+      case NodeType::EndElement:
+        if (depth_ == element_depth)
+          return;
+        break;
+      case NodeType::EndOfStream:
+        throw std::runtime_error("Unexpected end of XML stream");
+      default:
+        break;
+    }
+  }
+}
+
+inline std::string XmlReader::ReadOuterXml() {
+  assert(node_type_ == NodeType::StartElement);
+  const auto element_depth = depth_;
+  std::string result;
+  for (;;) {
+    switch (node_type_) {
+      case NodeType::StartElement:
+        result += '<';
+        result += name_;
+        for (size_t i = 0; i < attribute_count_; ++i) {
+          result += ' ';
+          result += attributes_[i].first;
+          result += "=\"";
+          AppendEscaped(result, attributes_[i].second);
+          result += '"';
+        }
+        result += '>';
+        break;
+      case NodeType::EndElement:
+        result += "</";
+        result += name_;
+        result += '>';
+        if (depth_ == element_depth)
+          return result;
+        break;
+      case NodeType::Text:
+        AppendEscaped(result, text_);
+        break;
+      case NodeType::EndOfStream:
+        throw std::runtime_error("Unexpected end of XML stream");
+      default:
+        break;
+    }
+    Read();
+  }
+}
+
+inline void XmlReader::ReadMarkup() {
+  text_.clear();
+  if (Get() == '?') {
+    SkipUntil("?>");
+    return;
+  }
+  // '!' was consumed.
+  if (Peek() == '-') {
+    Get();
+    if (Expect() != '-')
+      throw std::runtime_error("Invalid XML comment");
+    SkipUntil("-->");
+  } else if (Peek() == '[') {
+    ReadCData();
+  } else {
+    // DOCTYPE and other declarations. Internal subsets aren't supported.
+    SkipUntil(">");
+  }
+}
+
+inline void XmlReader::ReadCData() {
+  static const char kPrefix[] = "[CDATA[";
+  for (const char* p = kPrefix; *p; ++p) {
+    if (Expect() != *p)
+      throw std::runtime_error("Invalid XML CDATA section");
+  }
+  for (;;) {
+    int c = Expect();
+    text_.push_back(static_cast<char>(c));
+    auto size = text_.size();
+    if (size >= 3 && text_.compare(size - 3, 3, "]]>") == 0) {
+      text_.resize(size - 3);
+      return;
+    }
+  }
+}
+
+inline void XmlReader::SkipUntil(const char* terminator) {
+  const size_t length = std::strlen(terminator);
+  size_t matched = 0;
+  while (matched < length) {
+    int c = Expect();
+    if (c == terminator[matched])
+      ++matched;
+    else
+      matched = c == terminator[0] ? 1 : 0;
+  }
+}
+
+inline void XmlReader::SkipWhitespace() {
+  while (IsWhitespace(Peek()))
+    Get();
+}
+
+inline void XmlReader::ReadName(std::string& name, int first_char) {
+  name.clear();
+  name.push_back(static_cast<char>(first_char));
+  while (IsNameChar(Peek()))
+    name.push_back(static_cast<char>(Get()));
+}
+
+inline void XmlReader::ReadStartElement(int first_char) {
+  ReadName(name_, first_char);
+
+  for (;;) {
+    SkipWhitespace();
+    int c = Expect();
+    if (c == '>')
+      return;
+    if (c == '/') {
+      if (Expect() != '>')
+        throw std::runtime_error("Invalid XML empty element");
+      empty_element_ = true;
+      pending_end_element_ = true;
+      return;
+    }
+
+    // Reuse attribute strings to avoid allocations on every element.
+    if (attribute_count_ == attributes_.size())
+      attributes_.emplace_back();
+    auto& attribute = attributes_[attribute_count_++];
+    ReadName(attribute.first, c);
+    SkipWhitespace();
+    if (Expect() != '=')
+      throw std::runtime_error("Invalid XML attribute");
+    SkipWhitespace();
+    ReadAttributeValue(attribute.second);
+  }
+}
+
+inline void XmlReader::ReadEndElement() {
+  int c = Expect();
+  ReadName(name_, c);
+  SkipWhitespace();
+  if (Expect() != '>' || depth_ == 0)
+    throw std::runtime_error("Invalid XML end element");
+  --depth_;
+}
+
+inline void XmlReader::ReadAttributeValue(std::string& value) {
+  value.clear();
+  int quote = Expect();
+  if (quote != '"' && quote != '\'')
+    throw std::runtime_error("Invalid XML attribute value");
+  for (;;) {
+    int c = Expect();
+    if (c == quote)
+      return;
+    if (c == '&')
+      ReadEntity(value);
+    else
+      value.push_back(static_cast<char>(c));
+  }
+}
+
+inline void XmlReader::ReadEntity(std::string& target) {
+  // '&' was consumed.
+  char entity[16];
+  size_t length = 0;
+  for (;;) {
+    int c = Expect();
+    if (c == ';')
+      break;
+    if (length == sizeof(entity) - 1)
+      throw std::runtime_error("Invalid XML entity");
+    entity[length++] = static_cast<char>(c);
+  }
+  entity[length] = '\0';
+
+  if (entity[0] == '#') {
+    unsigned long code_point = entity[1] == 'x'
+                                   ? std::strtoul(entity + 2, nullptr, 16)
+                                   : std::strtoul(entity + 1, nullptr, 10);
+    AppendUtf8(target, code_point);
+  } else if (std::strcmp(entity, "lt") == 0) {
+    target.push_back('<');
+  } else if (std::strcmp(entity, "gt") == 0) {
+    target.push_back('>');
+  } else if (std::strcmp(entity, "amp") == 0) {
+    target.push_back('&');
+  } else if (std::strcmp(entity, "quot") == 0) {
+    target.push_back('"');
+  } else if (std::strcmp(entity, "apos") == 0) {
+    target.push_back('\'');
+  } else {
+    throw std::runtime_error("Unknown XML entity");
+  }
+}
+
+// static
+inline void XmlReader::AppendUtf8(std::string& target,
+                                  unsigned long code_point) {
+  if (code_point < 0x80) {
+    target.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    target.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    target.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    target.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    target.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    target.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    target.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    target.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    target.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    target.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+// static
+inline void XmlReader::AppendEscaped(std::string& target,
+                                     const std::string& text) {
+  for (char c : text) {
+    switch (c) {
+      case '<':
+        target += "&lt;";
+        break;
+      case '>':
+        target += "&gt;";
+        break;
+      case '&':
+        target += "&amp;";
+        break;
+      case '"':
+        target += "&quot;";
+        break;
+      default:
+        target.push_back(c);
+        break;
+    }
+  }
+}
+
+}  // namespace opcua
@@ -2,11 +2,15 @@
 #include <opcuapp/platform.h>
 #include <opcuapp/proxy_stub.h>
 #include <opcuapp/requests.h>
+#include <opcuapp/server/address_space_versions.h>
+#include <opcuapp/server/browse_path_translator.h>
+#include <opcuapp/server/browser.h>
 #include <opcuapp/server/endpoint.h>
 #include <opcuapp/server/node_loader.h>
+#include <opcuapp/server/reader.h>
+#include <opcuapp/server/writer.h>
 #include <opcuapp/timer.h>
 #include <opcuapp/vector.h>
-#include <fstream>
 #include <iostream>
 #include <thread>
 
@@ -70,12 +74,8 @@ class Server {
 
  private:
   std::shared_ptr<Variable> GetVariable(const OpcUa_NodeId& node_id) const;
-  const opcua::server::NodeState* GetStaticNode(
-      const OpcUa_NodeId& node_id) const;
 
-  opcua::DataValue Read(const OpcUa_ReadValueId& read_value_id) const;
-
-  opcua::Platform platform_;
+  opcua::Platform platform_{opcua::MemoryAllocator::Pool};
   opcua::ProxyStub proxy_stub_{platform_, opcua::ProxyStubConfiguration{}};
 
   opcua::StringTable namespace_uris_;
@@ -86,25 +86,25 @@ class Server {
                                      {0, (OpcUa_Byte*)""}};
   const OpcUa_P_OpenSSL_CertificateStore_Config pki_config_{
       OpcUa_NO_PKI, OpcUa_Null, OpcUa_Null, OpcUa_Null, 0, OpcUa_Null};
+  // Each service call serves the version pinned at its start. Outlives the
+  // sessions of |endpoint_|, whose continuation points hold versions.
+  opcua::server::AddressSpaceVersions address_space_;
   opcua::server::Endpoint endpoint_{OpcUa_Endpoint_SerializerType_Binary};
 
   const opcua::DateTime start_time_ = opcua::DateTime::UtcNow();
 
-  std::map<opcua::NodeId, opcua::server::NodeState> static_nodes_;
+  opcua::server::Browser browser_;
+  opcua::server::BrowsePathTranslator browse_path_translator_;
+  opcua::server::Reader reader_;
+  opcua::server::Writer writer_;
   std::map<opcua::NodeId, std::shared_ptr<Variable>> variables_;
 };
 
 Server::Server() {
-  std::ifstream stream{kPredefinedNodesPath, std::ios::in | std::ios::binary};
-  if (!stream)
-    throw std::runtime_error{std::string{"Can't open file "} +
-                             kPredefinedNodesPath};
-
-  for (auto& static_node :
-       opcua::server::LoadPredefinedNodes(namespace_uris_, stream)) {
-    opcua::NodeId node_id = static_node.node_id;
-    static_nodes_.emplace(std::move(node_id), std::move(static_node));
-  }
+  opcua::server::NodeAttributes attributes;
+  auto nodes = opcua::server::LoadPredefinedNodes(
+      namespace_uris_, kPredefinedNodesPath, attributes);
+  address_space_.AddNodes(std::move(nodes), std::move(attributes));
 
   variables_.emplace(
       OpcUaId_Server_ServerStatus,
@@ -134,6 +134,13 @@ Server::Server() {
             return {OpcUa_Good, time, time, time};
           }));
 
+  for (auto& p : variables_) {
+    reader_.SetValueSource(*address_space_.Pin(), p.first,
+                           [variable = p.second] {
+                             return variable->Read(OpcUa_Attributes_Value);
+                           });
+  }
+
   endpoint_.set_status_handler([](opcua::server::Endpoint::Event event) {
     switch (event) {
       case eOpcUa_Endpoint_Event_SecureChannelOpened:
@@ -157,42 +164,76 @@ Server::Server() {
     }
   });
 
-  endpoint_.set_read_handler(
+  opcua::server::SessionHandlers handlers;
+
+  handlers.registered_read_handler_ =
       [this](OpcUa_ReadRequest& request,
+             const opcua::server::RegisteredNodes& registered_nodes,
              const opcua::server::ReadCallback& callback) {
-        opcua::Span<OpcUa_ReadValueId> read_value_ids{
-            request.NodesToRead, static_cast<size_t>(request.NoOfNodesToRead)};
-        std::cout << "Read " << read_value_ids.size() << " values" << std::endl;
-
-        opcua::Vector<OpcUa_DataValue> results(read_value_ids.size());
-        for (size_t i = 0; i < read_value_ids.size(); ++i)
-          Read(read_value_ids[i]).release(results[i]);
-
-        opcua::ReadResponse response;
-        response.ResponseHeader.ServiceResult = OpcUa_Good;
-        response.NoOfResults = results.size();
-        response.Results = results.release();
-        callback(response);
-      });
-
-  endpoint_.set_browse_handler(
-      [](OpcUa_BrowseRequest& request,
-         const opcua::server::BrowseCallback& callback) {
+        std::cout << "Read " << request.NoOfNodesToRead << " values"
+                  << std::endl;
+        callback(
+            reader_.Read(*address_space_.Pin(), request, &registered_nodes));
+      };
+
+  handlers.registered_write_handler_ =
+      [this](OpcUa_WriteRequest& request,
+             const opcua::server::RegisteredNodes& registered_nodes,
+             const opcua::server::WriteCallback& callback) {
+        std::cout << "Write " << request.NoOfNodesToWrite << " values"
+                  << std::endl;
+        callback(
+            writer_.Write(*address_space_.Pin(), request, &registered_nodes));
+      };
+
+  handlers.register_nodes_handler_ =
+      [this](OpcUa_RegisterNodesRequest& request,
+             opcua::server::RegisteredNodes& registered_nodes,
+             const opcua::server::RegisterNodesCallback& callback) {
+        std::cout << "RegisterNodes" << std::endl;
+        callback(opcua::server::RegisterNodes(*address_space_.Pin(), request,
+                                              registered_nodes));
+      };
+
+  handlers.continuation_browse_handler_ =
+      [this](OpcUa_BrowseRequest& request,
+             opcua::server::BrowseContinuationPoints& continuation_points,
+             const opcua::server::BrowseCallback& callback) {
         std::cout << "Browse" << std::endl;
-        opcua::BrowseResponse response;
-        response.ResponseHeader.ServiceResult = OpcUa_Bad;
-        callback(response);
-      });
-
-  endpoint_.set_create_monitored_item_handler(
-      [this](opcua::ReadValueId& read_value_id)
-          -> opcua::server::CreateMonitoredItemResult {
-        std::cout << "CreateMonitoredItem" << std::endl;
-        auto variable = GetVariable(read_value_id.NodeId);
-        if (!variable)
-          return {OpcUa_Bad};
-        return {OpcUa_Good, variable};
-      });
+        callback(browser_.Browse(address_space_.Pin(), request,
+                                 continuation_points));
+      };
+
+  handlers.browse_next_handler_ =
+      [this](OpcUa_BrowseNextRequest& request,
+             opcua::server::BrowseContinuationPoints& continuation_points,
+             const opcua::server::BrowseNextCallback& callback) {
+        std::cout << "BrowseNext" << std::endl;
+        callback(browser_.BrowseNext(*address_space_.Pin(), request,
+                                     continuation_points));
+      };
+
+  handlers.translate_browse_paths_to_node_ids_handler_ =
+      [this](OpcUa_TranslateBrowsePathsToNodeIdsRequest& request,
+             const opcua::server::TranslateBrowsePathsToNodeIdsCallback&
+                 callback) {
+        std::cout << "TranslateBrowsePathsToNodeIds" << std::endl;
+        callback(browse_path_translator_.Translate(*address_space_.Pin(),
+                                                  request));
+      };
+
+  handlers.create_monitored_item_handler_ =
+      [this](opcua::ReadValueId&& read_value_id,
+             opcua::MonitoringParameters&& params)
+      -> opcua::server::CreateMonitoredItemResult {
+    std::cout << "CreateMonitoredItem" << std::endl;
+    auto variable = GetVariable(read_value_id.NodeId);
+    if (!variable)
+      return {OpcUa_Bad};
+    return {OpcUa_Good, variable};
+  };
+
+  endpoint_.set_session_handlers(std::move(handlers));
 
   opcua::String url = "opc.tcp://localhost:4840";
   endpoint_.Open(std::move(url), true, server_certificate_.get(),
@@ -205,27 +246,6 @@ std::shared_ptr<Variable> Server::GetVariable(
   return i != variables_.end() ? i->second : nullptr;
 }
 
-const opcua::server::NodeState* Server::GetStaticNode(
-    const OpcUa_NodeId& node_id) const {
-  auto i = static_nodes_.find(node_id);
-  return i != static_nodes_.end() ? &i->second : nullptr;
-}
-
-opcua::DataValue Server::Read(const OpcUa_ReadValueId& read_value_id) const {
-  if (auto variable = GetVariable(read_value_id.NodeId)) {
-    return variable->Read(read_value_id.AttributeId);
-
-  } else if (auto* static_node = GetStaticNode(read_value_id.NodeId)) {
-    if (read_value_id.AttributeId != OpcUa_Attributes_Value)
-      return OpcUa_Bad;
-    auto timestamp = opcua::DateTime::UtcNow();
-    return {OpcUa_Good, static_node->value, timestamp, timestamp};
-
-  } else {
-    return OpcUa_Bad;
-  }
-}
-
 int main() {
   try {
     std::cout << "Starting..." << std::endl;
@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+#include <opcuapp/binary_reader.h>
+#include <opcuapp/data_value.h>
+#include <opcuapp/encodable_object.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+
+namespace opcua {
+
+namespace {
+
+template <class T>
+T* AllocateArray(size_t count) {
+  auto* values =
+      static_cast<T*>(::OpcUa_Alloc(static_cast<UInt32>(sizeof(T) * count)));
+  std::memset(values, 0, sizeof(T) * count);
+  return values;
+}
+
+const char* GetRawString(const OpcUa_String& string) {
+  return ::OpcUa_String_GetRawString(&string);
+}
+
+std::string ToString(Span<const char> view) {
+  return {view.data(), view.size()};
+}
+
+template <class T>
+void Append(std::vector<char>& data, T value) {
+  data.insert(data.end(), reinterpret_cast<const char*>(&value),
+              reinterpret_cast<const char*>(&value) + sizeof(value));
+}
+
+OpcUa_StatusCode GetReadError(Span<const char> data,
+                              OpcUa_MessageContext& context) {
+  BinaryReader reader{data, context};
+  try {
+    reader.Read<Variant>();
+  } catch (const StatusCodeException& e) {
+    return e.status_code().code();
+  }
+  return OpcUa_Good;
+}
+
+}  // namespace
+
+TEST(BinaryReader, ReadsWrittenValues) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  Variant matrix;
+  matrix.get().Datatype = OpcUaType_String;
+  matrix.get().ArrayType = OpcUa_VariantArrayType_Matrix;
+  matrix.get().Value.Matrix.NoOfDimensions = 2;
+  matrix.get().Value.Matrix.Dimensions = AllocateArray<Int32>(2);
+  matrix.get().Value.Matrix.Dimensions[0] = 1;
+  matrix.get().Value.Matrix.Dimensions[1] = 2;
+  auto* strings = AllocateArray<OpcUa_String>(2);
+  matrix.get().Value.Matrix.Value.StringArray = strings;
+  String{"cell"}.release(strings[1]);
+
+  QualifiedName browse_name;
+  browse_name.get().NamespaceIndex = 3;
+  String{"browse"}.release(browse_name.get().Name);
+
+  LocalizedText text;
+  String{"en"}.release(text.get().Locale);
+  String{"text"}.release(text.get().Text);
+
+  std::vector<char> data;
+  auto context = detail::MakeMessageContext();
+  {
+    BinaryWriter writer{data, context};
+    writer.Write(Int32{-7});
+    writer.Write(String{"name"}.get());
+    writer.Write(String{"view"}.get());
+    writer.Write(NodeId{85}.get());
+    writer.Write(NodeId{String{"node"}, 2}.get());
+    writer.Write(browse_name.get());
+    writer.Write(text.get());
+    writer.Write(DataValue{OpcUa_Good, 2.5, DateTime{}, DateTime{}}.get());
+    writer.Write(matrix.get());
+    const UInt32 array[] = {4, 5, 6};
+    writer.WriteArray(array, 3);
+    writer.WriteArray<UInt32>(nullptr, 0);
+  }
+
+  BinaryReader reader{{data.data(), data.size()}, context};
+  EXPECT_EQ(-7, reader.Read<Int32>());
+  EXPECT_STREQ("name", GetRawString(reader.Read<String>().get()));
+  EXPECT_EQ("view", ToString(reader.ReadStringView()));
+  EXPECT_EQ(NodeId{85}, reader.Read<NodeId>());
+  EXPECT_EQ((NodeId{String{"node"}, 2}), reader.Read<NodeId>());
+
+  const auto read_browse_name = reader.Read<QualifiedName>();
+  EXPECT_EQ(3, read_browse_name.namespace_index());
+  EXPECT_STREQ("browse", GetRawString(read_browse_name.name()));
+
+  const auto read_text = reader.Read<LocalizedText>();
+  EXPECT_STREQ("en", GetRawString(read_text.get().Locale));
+  EXPECT_STREQ("text", GetRawString(read_text.get().Text));
+
+  const auto value = reader.Read<DataValue>();
+  EXPECT_EQ(2.5, value.get().Value);
+
+  const auto matrix_copy = reader.Read<Variant>();
+  ASSERT_TRUE(matrix_copy.is_matrix());
+  const auto& copied_matrix = matrix_copy.get().Value.Matrix;
+  ASSERT_EQ(2, copied_matrix.NoOfDimensions);
+  EXPECT_EQ(2, copied_matrix.Dimensions[1]);
+  EXPECT_TRUE(::OpcUa_String_IsNull(&copied_matrix.Value.StringArray[0]));
+  EXPECT_STREQ("cell", GetRawString(copied_matrix.Value.StringArray[1]));
+
+  EXPECT_EQ((std::vector<UInt32>{4, 5, 6}), reader.ReadArray<UInt32>());
+  EXPECT_TRUE(reader.ReadArray<UInt32>().empty());
+  EXPECT_TRUE(reader.at_end());
+}
+
+TEST(BinaryReader, CopiesPlainArrays) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  Variant doubles;
+  doubles.get().Datatype = OpcUaType_Double;
+  doubles.get().ArrayType = OpcUa_VariantArrayType_Array;
+  doubles.get().Value.Array.Length = 3;
+  auto* values = AllocateArray<Double>(3);
+  doubles.get().Value.Array.Value.DoubleArray = values;
+  values[0] = 1.5;
+  values[2] = -2.5;
+
+  Variant guids;
+  guids.get().Datatype = OpcUaType_Guid;
+  guids.get().ArrayType = OpcUa_VariantArrayType_Array;
+  guids.get().Value.Array.Length = 2;
+  auto* guid_values = AllocateArray<OpcUa_Guid>(2);
+  guids.get().Value.Array.Value.GuidArray = guid_values;
+  guid_values[1].Data1 = 0x01020304;
+  guid_values[1].Data4[7] = 9;
+
+  std::vector<char> data;
+  auto context = detail::MakeMessageContext();
+  {
+    BinaryWriter writer{data, context};
+    writer.Write(doubles.get());
+    writer.Write(guids.get());
+  }
+
+  BinaryReader reader{{data.data(), data.size()}, context};
+  const auto read_doubles = reader.Read<Variant>();
+  ASSERT_EQ(3, read_doubles.get().Value.Array.Length);
+  EXPECT_EQ(1.5, read_doubles.get().Value.Array.Value.DoubleArray[0]);
+  EXPECT_EQ(-2.5, read_doubles.get().Value.Array.Value.DoubleArray[2]);
+  const auto read_guids = reader.Read<Variant>();
+  ASSERT_EQ(2, read_guids.get().Value.Array.Length);
+  const auto& guid = read_guids.get().Value.Array.Value.GuidArray[1];
+  EXPECT_EQ(0x01020304u, guid.Data1);
+  EXPECT_EQ(9, guid.Data4[7]);
+  EXPECT_TRUE(reader.at_end());
+}
+
+TEST(BinaryReader, LimitsNesting) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+  auto context = detail::MakeMessageContext();
+
+  // Variant arrays holding a single Variant each.
+  const auto make_nested = [](UInt32 depth) {
+    std::vector<char> data;
+    for (UInt32 i = 1; i < depth; ++i) {
+      data.push_back(static_cast<char>(0x80 | OpcUaType_Variant));
+      Append(data, Int32{1});
+    }
+    data.push_back(OpcUaType_Null);
+    return data;
+  };
+
+  const auto allowed = make_nested(BinaryReader::kMaxDepth);
+  EXPECT_EQ(OpcUa_Good,
+            GetReadError({allowed.data(), allowed.size()}, context));
+  const auto too_deep = make_nested(BinaryReader::kMaxDepth + 1);
+  EXPECT_EQ(OpcUa_BadEncodingLimitsExceeded,
+            GetReadError({too_deep.data(), too_deep.size()}, context));
+}
+
+TEST(BinaryReader, LimitsArrays) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+  auto context = detail::MakeMessageContext();
+
+  // An empty Int32 matrix with the given dimensions.
+  const auto make_matrix = [](std::initializer_list<Int32> dimensions) {
+    std::vector<char> data;
+    data.push_back(static_cast<char>(0xC0 | OpcUaType_Int32));
+    Append(data, Int32{0});
+    Append(data, static_cast<Int32>(dimensions.size()));
+    for (auto dimension : dimensions)
+      Append(data, dimension);
+    return data;
+  };
+
+  const auto negative = make_matrix({-1, 0});
+  EXPECT_EQ(OpcUa_BadDecodingError,
+            GetReadError({negative.data(), negative.size()}, context));
+  // The product doesn't fit in an Int32.
+  const auto huge = make_matrix({0x10000, 0x10000});
+  EXPECT_EQ(OpcUa_BadEncodingLimitsExceeded,
+            GetReadError({huge.data(), huge.size()}, context));
+
+  std::vector<char> array;
+  array.push_back(static_cast<char>(0x80 | OpcUaType_Int32));
+  Append(array, Int32{5});
+  for (Int32 i = 0; i < 5; ++i)
+    Append(array, i);
+  EXPECT_EQ(OpcUa_Good, GetReadError({array.data(), array.size()}, context));
+  context.MaxArrayLength = 4;
+  EXPECT_EQ(OpcUa_BadEncodingLimitsExceeded,
+            GetReadError({array.data(), array.size()}, context));
+}
+
+TEST(BinaryReader, MapsNamespaces) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  std::vector<char> data;
+  auto context = detail::MakeMessageContext();
+  BinaryWriter{data, context}.Write(NodeId{10, 1}.get());
+
+  BinaryReader reader{{data.data(), data.size()}, context};
+  reader.set_namespace_mapping({{1, 4}});
+  EXPECT_EQ((NodeId{10, 4}), reader.Read<NodeId>());
+}
+
+TEST(BinaryReader, RejectsTruncatedData) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  std::vector<char> data;
+  auto context = detail::MakeMessageContext();
+  BinaryWriter{data, context}.Write(String{"truncated"}.get());
+  data.pop_back();
+
+  BinaryReader reader{{data.data(), data.size()}, context};
+  EXPECT_THROW(reader.Read<String>(), std::exception);
+
+  // A Double array longer than the data.
+  const char huge_array[] = {'\x8B', 0, 0, 0, 0x10};
+  BinaryReader array_reader{{huge_array, sizeof(huge_array)}, context};
+  EXPECT_THROW(array_reader.Read<Variant>(), std::exception);
+}
+
+}  // namespace opcua
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <opcuapp/data_value.h>
+#include <opcuapp/encodable_object.h>
+#include <opcuapp/extension_object.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/structs.h>
+
+namespace opcua {
+
+namespace {
+
+std::vector<char> EncodeWithStack(const OpcUa_Variant& value) {
+  std::vector<char> data;
+  auto context = detail::MakeMessageContext();
+  BinaryEncoder encoder;
+  VectorOutputStream stream{data};
+  encoder.Open(stream.get(), context);
+  encoder.Write(value);
+  return data;
+}
+
+template <class T>
+std::vector<char> EncodeWithStack(const T& value) {
+  std::vector<char> data;
+  auto context = detail::MakeMessageContext();
+  BinaryEncoder encoder;
+  VectorOutputStream stream{data};
+  encoder.Open(stream.get(), context);
+  encoder.WriteEncodable(GetEncodableType<T>(), &value);
+  return data;
+}
+
+template <class T>
+std::vector<char> EncodeWithWriter(const T& value) {
+  std::vector<char> data;
+  auto context = detail::MakeMessageContext();
+  BinaryWriter{data, context}.Write(value);
+  return data;
+}
+
+template <class T>
+T* AllocateArray(size_t count) {
+  auto* values =
+      static_cast<T*>(::OpcUa_Alloc(static_cast<UInt32>(sizeof(T) * count)));
+  std::memset(values, 0, sizeof(T) * count);
+  return values;
+}
+
+Vector<OpcUa_Variant> MakeVariants() {
+  Vector<OpcUa_Variant> variants{5};
+  Variant{2.5}.release(variants[0]);
+
+  variants[1].Datatype = OpcUaType_String;
+  variants[1].ArrayType = OpcUa_VariantArrayType_Array;
+  variants[1].Value.Array.Length = 2;
+  Vector<OpcUa_String> strings{2};
+  String{"first"}.release(strings[0]);
+  variants[1].Value.Array.Value.StringArray = strings.release();
+
+  variants[2].Datatype = OpcUaType_NodeId;
+  variants[2].Value.NodeId = AllocateArray<OpcUa_NodeId>(1);
+  NodeId{String{"node"}, 3}.release(*variants[2].Value.NodeId);
+
+  variants[3].Datatype = OpcUaType_LocalizedText;
+  variants[3].Value.LocalizedText = AllocateArray<OpcUa_LocalizedText>(1);
+  String{"text"}.release(variants[3].Value.LocalizedText->Text);
+
+  auto& matrix = variants[4];
+  matrix.Datatype = OpcUaType_Int16;
+  matrix.ArrayType = OpcUa_VariantArrayType_Matrix;
+  matrix.Value.Matrix.NoOfDimensions = 2;
+  matrix.Value.Matrix.Dimensions = AllocateArray<Int32>(2);
+  matrix.Value.Matrix.Dimensions[0] = 1;
+  matrix.Value.Matrix.Dimensions[1] = 2;
+  matrix.Value.Matrix.Value.Int16Array = AllocateArray<Int16>(2);
+  matrix.Value.Matrix.Value.Int16Array[1] = -3;
+  return variants;
+}
+
+MonitoredItemNotification MakeMonitoredItem(UInt32 client_handle,
+                                            Double value) {
+  MonitoredItemNotification item;
+  item.ClientHandle = client_handle;
+  DataValue{OpcUa_Good, value, DateTime{}, DateTime{}}.release(item.Value);
+  return item;
+}
+
+}  // namespace
+
+TEST(BinaryWriter, Layout) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  const auto item = MakeMonitoredItem(7, 1.5);
+  const std::vector<char> expected = {
+      7, 0, 0, 0,  // ClientHandle
+      0x01,        // DataValue with a value only
+      11,          // Double
+      0, 0, 0, 0, 0, 0, '\xF8', '\x3F',
+  };
+  EXPECT_EQ(expected, EncodeWithWriter<OpcUa_MonitoredItemNotification>(item));
+
+  // Null arrays.
+  const DataChangeNotification notification;
+  const std::vector<char> null_arrays = {-1, -1, -1, -1, -1, -1, -1, -1};
+  EXPECT_EQ(null_arrays,
+            EncodeWithWriter<OpcUa_DataChangeNotification>(notification));
+
+  // Initialized DiagnosticInfos are written without the stack.
+  ResponseHeader header;
+  header.RequestHandle = 5;
+  const std::vector<char> response_header = {
+      0, 0, 0, 0, 0, 0, 0, 0,  // Timestamp
+      5, 0, 0, 0,              // RequestHandle
+      0, 0, 0, 0,              // ServiceResult
+      0x00,                    // Empty ServiceDiagnostics
+      -1, -1, -1, -1,          // Null StringTable
+      0x00, 0x00, 0x00,        // Null AdditionalHeader
+  };
+  EXPECT_EQ(response_header, EncodeWithWriter<OpcUa_ResponseHeader>(header));
+}
+
+TEST(BinaryWriter, EncodedSize) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  auto variants = MakeVariants();
+  for (size_t i = 0; i < variants.size(); ++i) {
+    EXPECT_EQ(EncodeWithWriter(variants[i]).size(), EncodedSize(variants[i]))
+        << "Variant " << i;
+  }
+
+  DataChangeNotification data_change;
+  Vector<OpcUa_MonitoredItemNotification> items{1};
+  MakeMonitoredItem(1, 1.5).release(items[0]);
+  data_change.NoOfMonitoredItems = items.size();
+  data_change.MonitoredItems = items.release();
+  auto notification = ExtensionObject::Encode(std::move(data_change));
+  EXPECT_EQ(EncodeWithWriter(notification.get()).size(),
+            EncodedSize(notification.get()));
+}
+
+TEST(BinaryWriter, RejectsInvalidMatrixDimensions) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  auto variants = MakeVariants();
+  auto& dimensions = variants[4].Value.Matrix.Dimensions;
+  dimensions[0] = 0x10000;
+  dimensions[1] = 0x10000;
+  EXPECT_THROW(EncodeWithWriter(variants[4]), StatusCodeException);
+  dimensions[0] = -1;
+  dimensions[1] = -2;
+  EXPECT_THROW(EncodeWithWriter(variants[4]), StatusCodeException);
+  // Restored, so the variant can be cleared.
+  dimensions[0] = 1;
+  dimensions[1] = 2;
+}
+
+// The writer must produce the same bytes as the stack encoder.
+TEST(BinaryWriter, MatchesStackEncoder) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  auto variants = MakeVariants();
+  for (size_t i = 0; i < variants.size(); ++i) {
+    EXPECT_EQ(EncodeWithStack(variants[i]), EncodeWithWriter(variants[i]))
+        << "Variant " << i;
+  }
+
+  DataChangeNotification data_change;
+  Vector<OpcUa_MonitoredItemNotification> items{2};
+  MakeMonitoredItem(1, 1.5).release(items[0]);
+  MakeMonitoredItem(2, -4).release(items[1]);
+  items[1].Value.StatusCode = OpcUa_Bad;
+  items[1].Value.SourceTimestamp = DateTime::UtcNow().get();
+  items[1].Value.ServerPicoseconds = 10;
+  data_change.NoOfMonitoredItems = items.size();
+  data_change.MonitoredItems = items.release();
+
+  EventNotificationList event_list;
+  Vector<OpcUa_EventFieldList> events{1};
+  events[0].ClientHandle = 3;
+  events[0].NoOfEventFields = variants.size();
+  events[0].EventFields = variants.release();
+  event_list.NoOfEvents = events.size();
+  event_list.Events = events.release();
+
+  PublishResponse response;
+  response.ResponseHeader.Timestamp = DateTime::UtcNow().get();
+  response.ResponseHeader.RequestHandle = 5;
+  response.SubscriptionId = 9;
+  response.MoreNotifications = OpcUa_True;
+  Vector<UInt32> sequence_numbers{2};
+  sequence_numbers[0] = 11;
+  sequence_numbers[1] = 12;
+  response.NoOfAvailableSequenceNumbers = sequence_numbers.size();
+  response.AvailableSequenceNumbers = sequence_numbers.release();
+
+  auto& message = response.NotificationMessage;
+  message.SequenceNumber = 12;
+  message.PublishTime = DateTime::UtcNow().get();
+  Vector<OpcUa_ExtensionObject> notification_data{2};
+  ExtensionObject::Encode(std::move(data_change))
+      .release(notification_data[0]);
+  ExtensionObject::Encode(std::move(event_list)).release(notification_data[1]);
+  message.NoOfNotificationData = notification_data.size();
+  message.NotificationData = notification_data.release();
+
+  EXPECT_EQ(EncodeWithStack<OpcUa_PublishResponse>(response),
+            EncodeWithWriter<OpcUa_PublishResponse>(response));
+}
+
+}  // namespace opcua
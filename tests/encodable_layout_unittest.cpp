@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <opcuapp/data_value.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/requests.h>
+
+namespace opcua {
+
+TEST(EncodableLayout, CopiesMembers) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  Vector<OpcUa_MonitoredItemNotification> monitored_items{2};
+  const auto timestamp = DateTime::UtcNow();
+  monitored_items[0].ClientHandle = 1;
+  DataValue{OpcUa_Good, 1.5, timestamp, timestamp}.release(
+      monitored_items[0].Value);
+  monitored_items[1].ClientHandle = 2;
+  auto& value = monitored_items[1].Value.Value;
+  value.Datatype = OpcUaType_String;
+  String{"text"}.release(value.Value.String);
+
+  auto* diagnostic_info = static_cast<OpcUa_DiagnosticInfo*>(
+      ::OpcUa_Alloc(sizeof(OpcUa_DiagnosticInfo)));
+  ::OpcUa_DiagnosticInfo_Initialize(diagnostic_info);
+  String{"info"}.release(diagnostic_info->AdditionalInfo);
+
+  DataChangeNotification notification;
+  notification.NoOfMonitoredItems = monitored_items.size();
+  notification.MonitoredItems = monitored_items.release();
+  notification.NoOfDiagnosticInfos = 1;
+  notification.DiagnosticInfos = diagnostic_info;
+
+  const DataChangeNotification copy = notification;
+  ASSERT_EQ(2, copy.NoOfMonitoredItems);
+  EXPECT_NE(notification.MonitoredItems, copy.MonitoredItems);
+  EXPECT_EQ(2, copy.MonitoredItems[1].ClientHandle);
+  EXPECT_EQ(1.5, copy.MonitoredItems[0].Value.Value);
+  EXPECT_EQ(OpcUa_Good, copy.MonitoredItems[0].Value.StatusCode);
+
+  const auto& copied_value = copy.MonitoredItems[1].Value.Value;
+  ASSERT_EQ(OpcUaType_String, copied_value.Datatype);
+  const auto* text = ::OpcUa_String_GetRawString(&copied_value.Value.String);
+  EXPECT_NE(::OpcUa_String_GetRawString(&value.Value.String), text);
+  EXPECT_STREQ("text", text);
+
+  ASSERT_EQ(1, copy.NoOfDiagnosticInfos);
+  EXPECT_STREQ("info", ::OpcUa_String_GetRawString(
+                           &copy.DiagnosticInfos[0].AdditionalInfo));
+
+  // Nested structures and null arrays.
+  ReadRequest request;
+  request.RequestHeader.RequestHandle = 7;
+  String{"audit"}.release(request.RequestHeader.AuditEntryId);
+  request.NoOfNodesToRead = -1;
+
+  const ReadRequest request_copy = request;
+  EXPECT_EQ(7, request_copy.RequestHeader.RequestHandle);
+  EXPECT_STREQ("audit", ::OpcUa_String_GetRawString(
+                            &request_copy.RequestHeader.AuditEntryId));
+  EXPECT_EQ(-1, request_copy.NoOfNodesToRead);
+  EXPECT_EQ(nullptr, request_copy.NodesToRead);
+}
+
+}  // namespace opcua
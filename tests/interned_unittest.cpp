@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <opcuapp/interned.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+
+namespace opcua {
+
+TEST(Interned, SharedValues) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  const Interned<LocalizedText> speed1{LocalizedText{"Speed"}};
+  const Interned<LocalizedText> speed2{LocalizedText{"Speed"}};
+  const Interned<LocalizedText> range{LocalizedText{"EURange"}};
+  EXPECT_EQ(speed1, speed2);
+  EXPECT_EQ(&*speed1, &*speed2);
+  EXPECT_NE(speed1, range);
+  EXPECT_STREQ("Speed", OpcUa_String_GetRawString(&speed2->text()));
+
+  // Names in different namespaces are different.
+  QualifiedName name1;
+  name1.get().NamespaceIndex = 1;
+  String{"Speed"}.release(name1.get().Name);
+  QualifiedName name2;
+  String{"Speed"}.release(name2.get().Name);
+  EXPECT_NE(Interned<QualifiedName>{std::move(name1)},
+            Interned<QualifiedName>{std::move(name2)});
+
+  // Default handles share the empty value.
+  EXPECT_EQ(Interned<String>{}, Interned<String>{String{""}});
+}
+
+TEST(Interned, OutlivesPlatform) {
+  const LocalizedText* interned = nullptr;
+  {
+    Platform platform{MemoryAllocator::Pool};
+    ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+    interned = &*Interned<LocalizedText>{LocalizedText{"PoolAllocated"}};
+  }
+
+  // The value stays valid and is never freed after the stack is gone.
+  EXPECT_STREQ("PoolAllocated", OpcUa_String_GetRawString(&interned->text()));
+}
+
+}  // namespace opcua
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <opcuapp/mapped_file.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace opcua {
+
+namespace {
+
+const char kPath[] = "mapped_file_unittest.bin";
+
+void WriteFile(const std::string& contents) {
+  std::ofstream stream{kPath,
+                       std::ios::out | std::ios::binary | std::ios::trunc};
+  stream.write(contents.data(), contents.size());
+}
+
+}  // namespace
+
+TEST(MappedFile, MapsFile) {
+  WriteFile("contents");
+  {
+    MappedFile file{kPath};
+    const auto data = file.data();
+    EXPECT_EQ("contents", std::string(data.data(), data.size()));
+  }
+
+  WriteFile("");
+  {
+    MappedFile file;
+    EXPECT_TRUE(file.Open(kPath));
+    EXPECT_TRUE(file.data().empty());
+  }
+
+  std::remove(kPath);
+  MappedFile file;
+  EXPECT_FALSE(file.Open(kPath));
+  EXPECT_THROW(MappedFile{kPath}, std::runtime_error);
+}
+
+TEST(MappedFile, InputStream) {
+  WriteFile("abcdef");
+  {
+    MappedFileInputStream stream{kPath};
+    auto& ua_stream = stream.get();
+
+    OpcUa_Byte buffer[4] = {};
+    OpcUa_UInt32 count = 4;
+    ASSERT_EQ(OpcUa_Good, ua_stream.Read(&ua_stream, buffer, &count));
+    EXPECT_EQ(0, std::memcmp(buffer, "abcd", 4));
+
+    OpcUa_UInt32 position = 0;
+    ASSERT_EQ(OpcUa_Good, ua_stream.GetPosition(&ua_stream, &position));
+    EXPECT_EQ(4u, position);
+
+    // Past the end.
+    count = 4;
+    EXPECT_EQ(OpcUa_Bad, ua_stream.Read(&ua_stream, buffer, &count));
+  }
+  std::remove(kPath);
+}
+
+}  // namespace opcua
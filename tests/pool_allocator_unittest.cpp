@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/pool_allocator.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace opcua {
+
+TEST(PoolAllocator, AllocatesBySizeClass) {
+  auto& allocator = PoolAllocator::Get();
+  const auto before = allocator.stats();
+  ASSERT_EQ(PoolAllocator::kClassCount + 1, before.size());
+  EXPECT_EQ(16u, before[0].size);
+  EXPECT_EQ(256u, before[PoolAllocator::kClassCount - 1].size);
+  EXPECT_EQ(0u, before.back().size);
+
+  auto* small = allocator.Allocate(10);
+  auto* medium = allocator.Allocate(40);
+  auto* large = allocator.Allocate(1000);
+  ASSERT_TRUE(small && medium && large);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(small) % alignof(std::max_align_t));
+  std::memset(small, 1, 10);
+  std::memset(medium, 2, 40);
+  std::memset(large, 3, 1000);
+
+  auto after = allocator.stats();
+  EXPECT_EQ(before[0].allocations + 1, after[0].allocations);
+  EXPECT_EQ(before[2].allocations + 1, after[2].allocations);
+  EXPECT_EQ(before.back().allocations + 1, after.back().allocations);
+  EXPECT_LE(1u, after[0].slabs);
+
+  allocator.Free(small);
+  allocator.Free(medium);
+  allocator.Free(large);
+  allocator.Free(nullptr);
+
+  after = allocator.stats();
+  EXPECT_EQ(before[0].frees + 1, after[0].frees);
+  EXPECT_EQ(before[2].frees + 1, after[2].frees);
+  EXPECT_EQ(before.back().frees + 1, after.back().frees);
+
+  // Freed blocks are reused by the same thread.
+  auto* reused = allocator.Allocate(12);
+  EXPECT_EQ(small, reused);
+  allocator.Free(reused);
+}
+
+TEST(PoolAllocator, Reallocates) {
+  auto& allocator = PoolAllocator::Get();
+
+  auto* data = static_cast<char*>(allocator.Reallocate(nullptr, 8));
+  std::memcpy(data, "abcdefgh", 8);
+  // Same size class.
+  EXPECT_EQ(data, allocator.Reallocate(data, 16));
+
+  data = static_cast<char*>(allocator.Reallocate(data, 100));
+  EXPECT_EQ(0, std::memcmp(data, "abcdefgh", 8));
+  data = static_cast<char*>(allocator.Reallocate(data, 5000));
+  EXPECT_EQ(0, std::memcmp(data, "abcdefgh", 8));
+  data = static_cast<char*>(allocator.Reallocate(data, 10000));
+  EXPECT_EQ(0, std::memcmp(data, "abcdefgh", 8));
+  data = static_cast<char*>(allocator.Reallocate(data, 8));
+  EXPECT_EQ(0, std::memcmp(data, "abcdefgh", 8));
+  allocator.Free(data);
+}
+
+TEST(PoolAllocator, SharesBlocksAcrossThreads) {
+  auto& allocator = PoolAllocator::Get();
+  const auto before = allocator.stats();
+
+  const size_t kCount = 1000;
+  std::vector<void*> blocks(kCount);
+  std::thread allocating{[&] {
+    for (auto& block : blocks)
+      block = allocator.Allocate(64);
+  }};
+  allocating.join();
+
+  std::thread freeing{[&] {
+    for (auto* block : blocks)
+      allocator.Free(block);
+  }};
+  freeing.join();
+
+  const auto after = allocator.stats();
+  EXPECT_EQ(before[3].allocations + kCount, after[3].allocations);
+  EXPECT_EQ(before[3].frees + kCount, after[3].frees);
+
+  // Blocks cached by the exited threads went back to the shared list.
+  const auto slabs = after[3].slabs;
+  for (auto& block : blocks)
+    block = allocator.Allocate(64);
+  for (auto* block : blocks)
+    allocator.Free(block);
+  EXPECT_EQ(slabs, allocator.stats()[3].slabs);
+}
+
+TEST(PoolAllocator, Uninstall) {
+  auto& allocator = PoolAllocator::Get();
+  const size_t kSmallClass = 1;
+
+  OpcUa_Port_CallTable* calls = nullptr;
+  void* small = nullptr;
+  void* large = nullptr;
+  {
+    Platform platform{MemoryAllocator::Pool};
+    calls = static_cast<OpcUa_Port_CallTable*>(platform.handle());
+    ASSERT_TRUE(calls);
+    small = calls->MemAlloc(32);
+    large = calls->MemAlloc(1000);
+    EXPECT_TRUE(allocator.Owns(small));
+    EXPECT_TRUE(allocator.Owns(large));
+    std::memset(large, 5, 1000);
+  }
+
+  // New blocks come from the system.
+  const auto before = allocator.stats();
+  auto* system_block = calls->MemAlloc(32);
+  EXPECT_FALSE(allocator.Owns(system_block));
+  system_block = calls->MemReAlloc(system_block, 64);
+  calls->MemFree(system_block);
+
+  // Blocks allocated before go back to the pool.
+  calls->MemFree(small);
+  large = calls->MemReAlloc(large, 2000);
+  EXPECT_FALSE(allocator.Owns(large));
+  EXPECT_EQ(5, static_cast<char*>(large)[999]);
+  calls->MemFree(large);
+
+  const auto after = allocator.stats();
+  EXPECT_EQ(before[kSmallClass].allocations, after[kSmallClass].allocations);
+  EXPECT_EQ(before[kSmallClass].frees + 1, after[kSmallClass].frees);
+  EXPECT_EQ(before.back().frees + 1, after.back().frees);
+
+  // Blocks allocated while uninstalled go back to the system, even after
+  // installing again.
+  auto* freed_system_block = calls->MemAlloc(32);
+  auto* grown_system_block = calls->MemAlloc(32);
+  std::memset(grown_system_block, 7, 32);
+
+  // Installs again over the uninstalled table.
+  {
+    Platform platform{MemoryAllocator::Pool};
+    auto* block = calls->MemAlloc(32);
+    EXPECT_TRUE(allocator.Owns(block));
+    calls->MemFree(block);
+
+    const auto before_reinstalled = allocator.stats();
+    calls->MemFree(freed_system_block);
+    grown_system_block = calls->MemReAlloc(grown_system_block, 2000);
+    EXPECT_FALSE(allocator.Owns(grown_system_block));
+    EXPECT_EQ(7, static_cast<char*>(grown_system_block)[31]);
+    calls->MemFree(grown_system_block);
+    const auto after_reinstalled = allocator.stats();
+    EXPECT_EQ(before_reinstalled[kSmallClass].frees,
+              after_reinstalled[kSmallClass].frees);
+    EXPECT_EQ(before_reinstalled.back().allocations,
+              after_reinstalled.back().allocations);
+  }
+}
+
+}  // namespace opcua
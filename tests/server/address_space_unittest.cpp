@@ -0,0 +1,339 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/node_set_loader.h>
+#include <opcuapp/string_table.h>
+#include <sstream>
+
+namespace opcua {
+namespace server {
+
+TEST(AttributeColumn, SparseValues) {
+  AttributeColumn<Int32> column;
+  column.Set(200, 2);
+  column.Set(3, 1);
+  column.Set(1000, 3);
+  column.Set(3, 4);
+
+  EXPECT_EQ(3, column.size());
+  EXPECT_FALSE(column.Has(0));
+  EXPECT_FALSE(column.Has(5000));
+  ASSERT_NE(nullptr, column.Find(3));
+  EXPECT_EQ(4, *column.Find(3));
+  EXPECT_EQ(2, *column.Find(200));
+  EXPECT_EQ(3, *column.Find(1000));
+
+  AttributeColumn<Int32> target;
+  target.Set(0, 5);
+  target.Append(std::move(column), 10);
+  EXPECT_EQ(4, target.size());
+  EXPECT_EQ(5, *target.Find(0));
+  EXPECT_EQ(4, *target.Find(13));
+  EXPECT_EQ(3, *target.Find(1010));
+  EXPECT_EQ(0, column.size());
+}
+
+TEST(AddressSpace, ReadAttributes) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream stream{R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAObject NodeId="i=1000" BrowseName="Tank" />
+  <UAVariable NodeId="i=1001" BrowseName="Level" ParentNodeId="i=1000"
+              DataType="i=11" ValueRank="1" ArrayDimensions="4"
+              AccessLevel="3">
+    <Description>Tank level</Description>
+  </UAVariable>
+</UANodeSet>)"};
+
+  NodeAttributes attributes;
+  auto nodes = LoadNodeSet(namespace_uris, stream, attributes);
+
+  AddressSpace address_space;
+  address_space.AddNodes({});
+  address_space.AddNodes(std::move(nodes), std::move(attributes));
+  ASSERT_EQ(2, address_space.node_count());
+
+  auto index = address_space.GetNodeIndex(1001);
+  ASSERT_EQ(1, index);
+
+  Variant value;
+  ASSERT_TRUE(address_space.Read(index, OpcUa_Attributes_ValueRank, value)
+                  .IsGood());
+  EXPECT_EQ(OpcUaType_Int32, value.data_type());
+  EXPECT_EQ(1, value.get().Value.Int32);
+
+  ASSERT_TRUE(
+      address_space.Read(index, OpcUa_Attributes_AccessLevel, value).IsGood());
+  EXPECT_EQ(3, value.get().Value.Byte);
+
+  ASSERT_TRUE(
+      address_space.Read(index, OpcUa_Attributes_ArrayDimensions, value)
+          .IsGood());
+  ASSERT_EQ(1, value.get().Value.Array.Length);
+  EXPECT_EQ(4, value.get().Value.Array.Value.UInt32Array[0]);
+
+  ASSERT_TRUE(
+      address_space.Read(index, OpcUa_Attributes_Description, value).IsGood());
+  EXPECT_STREQ("Tank level", OpcUa_String_GetRawString(
+                                 &value.get().Value.LocalizedText->Text));
+
+  ASSERT_TRUE(address_space
+                  .Read(index, OpcUa_Attributes_MinimumSamplingInterval, value)
+                  .IsGood());
+  EXPECT_EQ(-1, value.get().Value.Double);
+
+  auto object_index = address_space.GetNodeIndex(1000);
+  EXPECT_EQ(OpcUa_BadAttributeIdInvalid,
+            address_space.Read(object_index, OpcUa_Attributes_ValueRank, value)
+                .code());
+  ASSERT_TRUE(address_space
+                  .Read(object_index, OpcUa_Attributes_EventNotifier, value)
+                  .IsGood());
+  EXPECT_EQ(0, value.get().Value.Byte);
+}
+
+TEST(AddressSpace, ReferenceIndex) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream stream{R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAReferenceType NodeId="i=33" BrowseName="HierarchicalReferences" />
+  <UAReferenceType NodeId="i=34" BrowseName="HasChild">
+    <References>
+      <Reference ReferenceType="i=45" IsForward="false">i=33</Reference>
+    </References>
+  </UAReferenceType>
+  <UAReferenceType NodeId="i=47" BrowseName="HasComponent">
+    <References>
+      <Reference ReferenceType="i=45" IsForward="false">i=34</Reference>
+    </References>
+  </UAReferenceType>
+  <UAReferenceType NodeId="i=40" BrowseName="HasTypeDefinition" />
+  <UAObject NodeId="i=1000" BrowseName="Tank">
+    <References>
+      <Reference ReferenceType="i=47">i=1001</Reference>
+      <Reference ReferenceType="i=40">i=58</Reference>
+    </References>
+  </UAObject>
+  <UAVariable NodeId="i=1001" BrowseName="Level" ParentNodeId="i=1000">
+    <References>
+      <Reference ReferenceType="i=47" IsForward="false">i=1000</Reference>
+    </References>
+  </UAVariable>
+</UANodeSet>)"};
+
+  AddressSpace address_space;
+  address_space.AddNodes(LoadNodeSet(namespace_uris, stream));
+
+  auto& references = address_space.references();
+  auto has_component = references.FindReferenceType(OpcUaId_HasComponent);
+  auto has_child = references.FindReferenceType(OpcUaId_HasChild);
+  auto hierarchical =
+      references.FindReferenceType(OpcUaId_HierarchicalReferences);
+  auto has_type_definition =
+      references.FindReferenceType(OpcUaId_HasTypeDefinition);
+  ASSERT_NE(kInvalidReferenceTypeIndex, has_component);
+  EXPECT_TRUE(references.IsSubtype(has_component, has_component));
+  EXPECT_TRUE(references.IsSubtype(has_component, has_child));
+  EXPECT_TRUE(references.IsSubtype(has_component, hierarchical));
+  EXPECT_FALSE(references.IsSubtype(has_child, has_component));
+  EXPECT_FALSE(references.IsSubtype(has_type_definition, hierarchical));
+
+  auto tank = address_space.GetNodeIndex(1000);
+  auto level = address_space.GetNodeIndex(1001);
+
+  // Both directions of the HasComponent reference are recorded once.
+  auto tank_references = references.GetReferences(tank);
+  ASSERT_EQ(2, tank_references.size());
+  EXPECT_EQ(has_component, tank_references[0].reference_type);
+  EXPECT_FALSE(tank_references[0].inverse);
+  EXPECT_EQ(level, tank_references[0].target);
+  EXPECT_EQ(kInvalidNodeIndex, tank_references[1].target);
+  ASSERT_NE(nullptr, tank_references[1].target_id);
+
+  auto level_references = references.GetReferences(level);
+  ASSERT_EQ(1, level_references.size());
+  EXPECT_TRUE(level_references[0].inverse);
+  EXPECT_EQ(tank, level_references[0].target);
+
+  // Inverse HasSubtype is added to the supertype.
+  auto has_child_references =
+      references.GetReferences(address_space.GetNodeIndex(OpcUaId_HasChild));
+  ASSERT_EQ(2, has_child_references.size());
+}
+
+TEST(AddressSpace, CopiesKeepTheirVersion) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  const auto make_node = [](UInt32 id) {
+    NodeState node;
+    node.node_id = NodeId{id};
+    node.node_class = OpcUa_NodeClass_Object;
+    return node;
+  };
+
+  // The target of the reference is added by a later version.
+  std::vector<NodeState> nodes;
+  nodes.push_back(make_node(1000));
+  nodes[0].references.push_back(
+      {NodeId{OpcUaId_Organizes}, OpcUa_False, NodeId{1001}});
+  NodeAttributes attributes;
+  attributes.event_notifier.Set(0, 1);
+  AddressSpace first;
+  first.AddNodes(std::move(nodes), std::move(attributes));
+
+  AddressSpace second = first;
+  nodes.clear();
+  nodes.push_back(make_node(1001));
+  second.AddNodes(std::move(nodes));
+
+  EXPECT_EQ(1, first.node_count());
+  EXPECT_EQ(kInvalidNodeIndex, first.GetNodeIndex(1001));
+  auto first_references = first.references().GetReferences(0);
+  ASSERT_EQ(1, first_references.size());
+  EXPECT_EQ(kInvalidNodeIndex, first_references[0].target);
+  EXPECT_NE(nullptr, first_references[0].target_id);
+
+  EXPECT_EQ(2, second.node_count());
+  EXPECT_EQ(1, second.GetNodeIndex(1001));
+  auto second_references = second.references().GetReferences(0);
+  ASSERT_EQ(1, second_references.size());
+  EXPECT_EQ(1, second_references[0].target);
+  auto inverse_references = second.references().GetReferences(1);
+  ASSERT_EQ(1, inverse_references.size());
+  EXPECT_TRUE(inverse_references[0].inverse);
+  EXPECT_EQ(0, inverse_references[0].target);
+  EXPECT_EQ(second.model_version(), second.node_version(0));
+  EXPECT_EQ(1, *second.attributes().event_notifier.Find(0));
+
+  // Enough versions to span several chunks and rehashes of every index.
+  std::vector<AddressSpace> versions{second};
+  for (UInt32 i = 0; i < 600; ++i) {
+    auto next = versions.back();
+    nodes.clear();
+    nodes.push_back(make_node(2000 + i));
+    nodes[0].references.push_back(
+        {NodeId{OpcUaId_Organizes}, OpcUa_True, NodeId{1000}});
+    NodeAttributes next_attributes;
+    next_attributes.event_notifier.Set(0, static_cast<Byte>(i));
+    next.AddNodes(std::move(nodes), std::move(next_attributes));
+    versions.push_back(std::move(next));
+  }
+
+  for (UInt32 i = 0; i < versions.size(); ++i) {
+    const auto& version = versions[i];
+    ASSERT_EQ(2 + i, version.node_count());
+    EXPECT_EQ(1 + i, version.references().GetReferences(0).size());
+    EXPECT_EQ(1, version.GetNodeIndex(1001));
+    if (i != 0) {
+      const auto index = version.GetNodeIndex(2000 + i - 1);
+      ASSERT_EQ(1 + i, index);
+      EXPECT_EQ(static_cast<Byte>(i - 1),
+                *version.attributes().event_notifier.Find(index));
+    }
+    EXPECT_EQ(kInvalidNodeIndex, version.GetNodeIndex(2000 + i));
+  }
+}
+
+TEST(AddressSpace, RejectsExistingNodeIds) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  const auto make_nodes = [](std::vector<UInt32> ids) {
+    std::vector<NodeState> nodes(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+      nodes[i].node_id = NodeId{ids[i]};
+      nodes[i].node_class = OpcUa_NodeClass_Object;
+    }
+    return nodes;
+  };
+
+  AddressSpace address_space;
+  address_space.AddNodes(make_nodes({1000, 1001}));
+
+  EXPECT_EQ(OpcUa_Good,
+            address_space.CheckNewNodeIds(make_nodes({1002, 1003})).code());
+  EXPECT_EQ(OpcUa_BadNodeIdExists,
+            address_space.CheckNewNodeIds(make_nodes({1002, 1001})).code());
+  EXPECT_EQ(OpcUa_BadNodeIdExists,
+            address_space.CheckNewNodeIds(make_nodes({1002, 1002})).code());
+
+  // Children are checked too.
+  auto nodes = make_nodes({1002});
+  nodes[0].children = make_nodes({1000});
+  EXPECT_THROW(address_space.AddNodes(std::move(nodes)), std::exception);
+  EXPECT_EQ(2, address_space.node_count());
+  EXPECT_EQ(kInvalidNodeIndex, address_space.GetNodeIndex(1002));
+}
+
+TEST(AddressSpace, DeletesNodes) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  const auto make_node = [](UInt32 id) {
+    NodeState node;
+    node.node_id = NodeId{id};
+    node.node_class = OpcUa_NodeClass_Object;
+    return node;
+  };
+
+  // The child of 1000 organizes 1002, and 1004 organizes 1003, which is
+  // added later.
+  std::vector<NodeState> nodes;
+  nodes.push_back(make_node(1000));
+  nodes[0].children.push_back(make_node(1001));
+  nodes[0].children[0].references.push_back(
+      {NodeId{OpcUaId_Organizes}, OpcUa_False, NodeId{1002}});
+  nodes.push_back(make_node(1002));
+  nodes.push_back(make_node(1004));
+  nodes[2].references.push_back(
+      {NodeId{OpcUaId_Organizes}, OpcUa_False, NodeId{1003}});
+  AddressSpace address_space;
+  address_space.AddNodes(std::move(nodes));
+  const AddressSpace previous = address_space;
+
+  // The child is covered by its parent.
+  const auto changes =
+      address_space.DeleteNodes({NodeId{1001}, NodeId{1004}, NodeId{1000}});
+  ASSERT_EQ(3, changes.size());
+  EXPECT_EQ(NodeId{1000}, changes[0].affected);
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_NodeDeleted, changes[0].verb);
+  EXPECT_EQ(NodeId{1004}, changes[1].affected);
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_NodeDeleted, changes[1].verb);
+  EXPECT_EQ(NodeId{1002}, changes[2].affected);
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_ReferenceDeleted,
+            changes[2].verb);
+
+  EXPECT_EQ(4, address_space.node_count());
+  EXPECT_TRUE(address_space.is_deleted(1));
+  EXPECT_FALSE(address_space.is_deleted(2));
+  EXPECT_EQ(kInvalidNodeIndex, address_space.GetNodeIndex(1001));
+  EXPECT_EQ(nullptr, address_space.GetNode(NodeId{1004}));
+  EXPECT_TRUE(address_space.references().GetReferences(2).empty());
+  EXPECT_EQ(address_space.model_version(), address_space.node_version(2));
+  EXPECT_THROW(address_space.DeleteNodes({NodeId{1000}}), std::exception);
+
+  // Copies keep the deleted nodes.
+  EXPECT_EQ(1, previous.GetNodeIndex(1001));
+  EXPECT_FALSE(previous.is_deleted(1));
+  EXPECT_EQ(1, previous.references().GetReferences(2).size());
+
+  // NodeIds are free again, and references of deleted nodes stay deleted.
+  nodes.clear();
+  nodes.push_back(make_node(1000));
+  nodes.push_back(make_node(1003));
+  address_space.AddNodes(std::move(nodes));
+  EXPECT_EQ(4, address_space.GetNodeIndex(1000));
+  EXPECT_TRUE(address_space.references().GetReferences(5).empty());
+  EXPECT_TRUE(address_space.references().GetReferences(3).empty());
+}
+
+}  // namespace server
+}  // namespace opcua
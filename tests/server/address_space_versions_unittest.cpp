@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/address_space_versions.h>
+#include <atomic>
+#include <thread>
+
+namespace opcua {
+namespace server {
+
+namespace {
+
+std::vector<NodeState> MakeNodes(UInt32 first_id, size_t count) {
+  std::vector<NodeState> nodes(count);
+  for (size_t i = 0; i < count; ++i) {
+    nodes[i].node_id = NodeId{static_cast<UInt32>(first_id + i)};
+    nodes[i].node_class = OpcUa_NodeClass_Object;
+  }
+  return nodes;
+}
+
+}  // namespace
+
+TEST(AddressSpaceVersions, PinnedSnapshot) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  AddressSpaceVersions versions;
+  versions.AddNodes(MakeNodes(1000, 2), NodeAttributes{});
+
+  {
+    auto snapshot = versions.Pin();
+    EXPECT_EQ(2, snapshot->node_count());
+
+    versions.AddNodes(MakeNodes(2000, 3), NodeAttributes{});
+    EXPECT_EQ(2, snapshot->node_count());
+    EXPECT_EQ(kInvalidNodeIndex, snapshot->GetNodeIndex(2000));
+    EXPECT_EQ(5, versions.Pin()->node_count());
+
+    // The pinned version is still in use.
+    EXPECT_EQ(1, versions.retired_count());
+  }
+
+  versions.Reclaim();
+  EXPECT_EQ(0, versions.retired_count());
+}
+
+TEST(AddressSpaceVersions, ConcurrentReaders) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  AddressSpaceVersions versions;
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!done) {
+        auto snapshot = versions.Pin();
+        const auto count = snapshot->node_count();
+        if (count != 0)
+          EXPECT_EQ(1000u, snapshot->node(0).node_id.get().Identifier.Numeric);
+      }
+    });
+  }
+
+  for (UInt32 i = 0; i < 50; ++i)
+    versions.AddNodes(MakeNodes(1000 + i * 10, 10), NodeAttributes{});
+
+  done = true;
+  for (auto& reader : readers)
+    reader.join();
+
+  versions.Reclaim();
+  EXPECT_EQ(0, versions.retired_count());
+  EXPECT_EQ(500, versions.Pin()->node_count());
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/address_space_versions.h>
+#include <opcuapp/server/browse_path_translator.h>
+#include <opcuapp/server/node_set_loader.h>
+#include <opcuapp/string_table.h>
+#include <sstream>
+#include <thread>
+
+namespace opcua {
+namespace server {
+
+namespace {
+
+std::vector<NodeState> LoadNodes(const char* xml) {
+  StringTable namespace_uris;
+  std::istringstream stream{xml};
+  return LoadNodeSet(namespace_uris, stream);
+}
+
+StatusCode Translate(BrowsePathTranslator& translator,
+                     const AddressSpace& address_space,
+                     NumericNodeId starting_node,
+                     std::initializer_list<const char*> names,
+                     NodeId& target) {
+  Vector<OpcUa_RelativePathElement> elements(names.size());
+  size_t i = 0;
+  for (auto* name : names) {
+    NodeId{OpcUaId_HierarchicalReferences}.CopyTo(
+        elements[i].ReferenceTypeId);
+    elements[i].IncludeSubtypes = OpcUa_True;
+    Check(::OpcUa_String_AttachCopy(&elements[i].TargetName.Name,
+                                    const_cast<OpcUa_StringA>(name)));
+    ++i;
+  }
+
+  Vector<OpcUa_BrowsePath> paths(1);
+  NodeId{starting_node}.CopyTo(paths[0].StartingNode);
+  paths[0].RelativePath.NoOfElements = static_cast<Int32>(elements.size());
+  paths[0].RelativePath.Elements = elements.release();
+
+  TranslateBrowsePathsToNodeIdsRequest request;
+  request.NoOfBrowsePaths = static_cast<Int32>(paths.size());
+  request.BrowsePaths = paths.release();
+
+  auto response = translator.Translate(address_space, request);
+  EXPECT_EQ(1, response.NoOfResults);
+  auto& result = response.Results[0];
+  if (result.NoOfTargets == 1)
+    target = result.Targets[0].TargetId.NodeId;
+  return result.StatusCode;
+}
+
+}  // namespace
+
+TEST(BrowsePathTranslator, Translate) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  AddressSpace address_space;
+  address_space.AddNodes(LoadNodes(R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAReferenceType NodeId="i=33" BrowseName="HierarchicalReferences" />
+  <UAReferenceType NodeId="i=35" BrowseName="Organizes">
+    <References>
+      <Reference ReferenceType="i=45" IsForward="false">i=33</Reference>
+    </References>
+  </UAReferenceType>
+  <UAObject NodeId="i=85" BrowseName="Objects" />
+  <UAObject NodeId="i=1000" BrowseName="Plant">
+    <References>
+      <Reference ReferenceType="i=35" IsForward="false">i=85</Reference>
+    </References>
+  </UAObject>
+  <UAVariable NodeId="i=1001" BrowseName="Speed">
+    <References>
+      <Reference ReferenceType="i=35" IsForward="false">i=1000</Reference>
+    </References>
+  </UAVariable>
+</UANodeSet>)"));
+
+  BrowsePathTranslator translator{1};
+
+  NodeId target;
+  EXPECT_EQ(OpcUa_Good,
+            Translate(translator, address_space, OpcUaId_ObjectsFolder,
+                      {"Plant", "Speed"}, target)
+                .code());
+  EXPECT_EQ(NodeId{1001}, target);
+
+  // Served from the cache.
+  target = NodeId{};
+  EXPECT_EQ(OpcUa_Good,
+            Translate(translator, address_space, OpcUaId_ObjectsFolder,
+                      {"Plant", "Speed"}, target)
+                .code());
+  EXPECT_EQ(NodeId{1001}, target);
+
+  EXPECT_EQ(OpcUa_BadNoMatch,
+            Translate(translator, address_space, OpcUaId_ObjectsFolder,
+                      {"Plant", "Level"}, target)
+                .code());
+
+  // Adding nodes invalidates the cached miss.
+  address_space.AddNodes(LoadNodes(R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAVariable NodeId="i=1002" BrowseName="Level">
+    <References>
+      <Reference ReferenceType="i=35" IsForward="false">i=1000</Reference>
+    </References>
+  </UAVariable>
+</UANodeSet>)"));
+
+  EXPECT_EQ(OpcUa_Good,
+            Translate(translator, address_space, OpcUaId_ObjectsFolder,
+                      {"Plant", "Level"}, target)
+                .code());
+  EXPECT_EQ(NodeId{1002}, target);
+
+  // A reference to a node of a later batch is indexed once the node exists.
+  address_space.AddNodes(LoadNodes(R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAObject NodeId="i=1003" BrowseName="Motor">
+    <References>
+      <Reference ReferenceType="i=35" IsForward="false">i=1000</Reference>
+      <Reference ReferenceType="i=35">i=1004</Reference>
+    </References>
+  </UAObject>
+</UANodeSet>)"));
+  address_space.AddNodes(LoadNodes(R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAVariable NodeId="i=1004" BrowseName="Current" />
+</UANodeSet>)"));
+
+  EXPECT_EQ(OpcUa_Good,
+            Translate(translator, address_space, OpcUaId_ObjectsFolder,
+                      {"Plant", "Motor", "Current"}, target)
+                .code());
+  EXPECT_EQ(NodeId{1004}, target);
+
+  address_space.DeleteNodes({NodeId{1004}});
+  EXPECT_EQ(OpcUa_BadNoMatch,
+            Translate(translator, address_space, OpcUaId_ObjectsFolder,
+                      {"Plant", "Motor", "Current"}, target)
+                .code());
+}
+
+TEST(BrowsePathTranslator, ServesPinnedVersions) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  AddressSpaceVersions versions;
+  versions.AddNodes(LoadNodes(R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAReferenceType NodeId="i=33" BrowseName="HierarchicalReferences" />
+  <UAReferenceType NodeId="i=35" BrowseName="Organizes">
+    <References>
+      <Reference ReferenceType="i=45" IsForward="false">i=33</Reference>
+    </References>
+  </UAReferenceType>
+  <UAObject NodeId="i=85" BrowseName="Objects" />
+  <UAObject NodeId="i=1000" BrowseName="Plant">
+    <References>
+      <Reference ReferenceType="i=35" IsForward="false">i=85</Reference>
+    </References>
+  </UAObject>
+</UANodeSet>)"),
+                    NodeAttributes{});
+
+  BrowsePathTranslator translator;
+  auto pinned = versions.Pin();
+  NodeId target;
+  EXPECT_EQ(OpcUa_BadNoMatch,
+            Translate(translator, *pinned, OpcUaId_ObjectsFolder,
+                      {"Plant", "Level"}, target)
+                .code());
+
+  versions.AddNodes(LoadNodes(R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAVariable NodeId="i=1002" BrowseName="Level">
+    <References>
+      <Reference ReferenceType="i=35" IsForward="false">i=1000</Reference>
+    </References>
+  </UAVariable>
+</UANodeSet>)"),
+                    NodeAttributes{});
+
+  // Each version is served from its own index and cache, concurrently.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 100; ++j) {
+        NodeId current_target;
+        EXPECT_EQ(OpcUa_Good,
+                  Translate(translator, *versions.Pin(),
+                            OpcUaId_ObjectsFolder, {"Plant", "Level"},
+                            current_target)
+                      .code());
+        EXPECT_EQ(NodeId{1002}, current_target);
+        NodeId pinned_target;
+        EXPECT_EQ(OpcUa_BadNoMatch,
+                  Translate(translator, *pinned, OpcUaId_ObjectsFolder,
+                            {"Plant", "Level"}, pinned_target)
+                      .code());
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
+
+}  // namespace server
+}  // namespace opcua
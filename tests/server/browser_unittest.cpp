@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/address_space_versions.h>
+#include <opcuapp/server/browser.h>
+#include <opcuapp/server/node_set_loader.h>
+#include <opcuapp/string_table.h>
+#include <sstream>
+
+namespace opcua {
+namespace server {
+
+namespace {
+
+const char kNodeSet[] = R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAReferenceType NodeId="i=33" BrowseName="HierarchicalReferences" />
+  <UAReferenceType NodeId="i=47" BrowseName="HasComponent">
+    <References>
+      <Reference ReferenceType="i=45" IsForward="false">i=33</Reference>
+    </References>
+  </UAReferenceType>
+  <UAObject NodeId="i=1000" BrowseName="Tank" />
+  <UAVariable NodeId="i=1001" BrowseName="Level" ParentNodeId="i=1000">
+    <References>
+      <Reference ReferenceType="i=47" IsForward="false">i=1000</Reference>
+    </References>
+  </UAVariable>
+  <UAVariable NodeId="i=1002" BrowseName="Temperature" ParentNodeId="i=1000">
+    <References>
+      <Reference ReferenceType="i=47" IsForward="false">i=1000</Reference>
+    </References>
+  </UAVariable>
+  <UAObject NodeId="i=1003" BrowseName="Valve">
+    <References>
+      <Reference ReferenceType="i=47" IsForward="false">i=1000</Reference>
+    </References>
+  </UAObject>
+</UANodeSet>)";
+
+}  // namespace
+
+TEST(Browser, ContinuationPoints) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream stream{kNodeSet};
+
+  AddressSpace address_space;
+  address_space.AddNodes(LoadNodeSet(namespace_uris, stream));
+
+  const Browser browser;
+  BrowseContinuationPoints continuation_points;
+
+  BrowseDescription description;
+  NodeId{1000}.CopyTo(description.NodeId);
+  NodeId{OpcUaId_HierarchicalReferences}.CopyTo(description.ReferenceTypeId);
+  description.IncludeSubtypes = OpcUa_True;
+  description.BrowseDirection = OpcUa_BrowseDirection_Forward;
+  description.NodeClassMask = OpcUa_NodeClass_Variable;
+  description.ResultMask = OpcUa_BrowseResultMask_All;
+
+  BrowseRequest request;
+  request.RequestedMaxReferencesPerNode = 1;
+  request.NoOfNodesToBrowse = 1;
+  request.NodesToBrowse = &description;
+
+  auto response = browser.Browse(address_space, request, continuation_points);
+  request.NoOfNodesToBrowse = 0;
+  request.NodesToBrowse = OpcUa_Null;
+
+  ASSERT_EQ(OpcUa_Good, response.ResponseHeader.ServiceResult);
+  ASSERT_EQ(1, response.NoOfResults);
+  auto& result = response.Results[0];
+  EXPECT_EQ(OpcUa_Good, result.StatusCode);
+  ASSERT_EQ(1, result.NoOfReferences);
+  EXPECT_EQ(NodeId{1001}, NodeId{result.References[0].NodeId.NodeId});
+  EXPECT_EQ(NodeId{OpcUaId_HasComponent},
+            NodeId{result.References[0].ReferenceTypeId});
+  EXPECT_EQ(OpcUa_NodeClass_Variable, result.References[0].NodeClass);
+  ASSERT_GT(result.ContinuationPoint.Length, 0);
+  EXPECT_EQ(1, continuation_points.size());
+
+  BrowseNextRequest next_request;
+  next_request.NoOfContinuationPoints = 1;
+  next_request.ContinuationPoints = &result.ContinuationPoint;
+
+  auto next_response =
+      browser.BrowseNext(address_space, next_request, continuation_points);
+  next_request.NoOfContinuationPoints = 0;
+  next_request.ContinuationPoints = OpcUa_Null;
+
+  ASSERT_EQ(1, next_response.NoOfResults);
+  auto& next_result = next_response.Results[0];
+  EXPECT_EQ(OpcUa_Good, next_result.StatusCode);
+  ASSERT_EQ(1, next_result.NoOfReferences);
+  EXPECT_EQ(NodeId{1002}, NodeId{next_result.References[0].NodeId.NodeId});
+  // The object is filtered out by NodeClassMask, so nothing is left.
+  EXPECT_LE(next_result.ContinuationPoint.Length, 0);
+  EXPECT_EQ(0, continuation_points.size());
+
+  // A consumed continuation point can't be reused.
+  next_request.NoOfContinuationPoints = 1;
+  next_request.ContinuationPoints = &result.ContinuationPoint;
+  auto invalid_response =
+      browser.BrowseNext(address_space, next_request, continuation_points);
+  next_request.NoOfContinuationPoints = 0;
+  next_request.ContinuationPoints = OpcUa_Null;
+  ASSERT_EQ(1, invalid_response.NoOfResults);
+  EXPECT_EQ(OpcUa_BadContinuationPointInvalid,
+            invalid_response.Results[0].StatusCode);
+}
+
+TEST(Browser, ContinuesInHeldVersions) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream stream{kNodeSet};
+  AddressSpaceVersions versions;
+  versions.AddNodes(LoadNodeSet(namespace_uris, stream), NodeAttributes{});
+  AddressSpace address_space = *versions.Pin();
+
+  const Browser browser;
+  BrowseContinuationPoints continuation_points;
+
+  BrowseDescription description;
+  NodeId{1000}.CopyTo(description.NodeId);
+  description.BrowseDirection = OpcUa_BrowseDirection_Forward;
+  description.NodeClassMask = OpcUa_NodeClass_Variable;
+  description.ResultMask = OpcUa_BrowseResultMask_All;
+
+  BrowseRequest request;
+  request.RequestedMaxReferencesPerNode = 1;
+  request.NoOfNodesToBrowse = 1;
+  request.NodesToBrowse = &description;
+  auto held_response =
+      browser.Browse(versions.Pin(), request, continuation_points);
+  auto response = browser.Browse(address_space, request, continuation_points);
+  request.NoOfNodesToBrowse = 0;
+  request.NodesToBrowse = OpcUa_Null;
+  ASSERT_EQ(1, held_response.NoOfResults);
+  ASSERT_EQ(1, response.NoOfResults);
+  EXPECT_EQ(2, continuation_points.size());
+
+  // The continuation point keeps the version with the deleted node.
+  versions.DeleteNodes({NodeId{1002}});
+  address_space.DeleteNodes({NodeId{1002}});
+  EXPECT_EQ(1, versions.retired_count());
+
+  OpcUa_ByteString points[] = {held_response.Results[0].ContinuationPoint,
+                               response.Results[0].ContinuationPoint};
+  BrowseNextRequest next_request;
+  next_request.NoOfContinuationPoints = 2;
+  next_request.ContinuationPoints = points;
+  auto next_response =
+      browser.BrowseNext(*versions.Pin(), next_request, continuation_points);
+  next_request.NoOfContinuationPoints = 0;
+  next_request.ContinuationPoints = OpcUa_Null;
+
+  ASSERT_EQ(2, next_response.NoOfResults);
+  auto& next_result = next_response.Results[0];
+  EXPECT_EQ(OpcUa_Good, next_result.StatusCode);
+  ASSERT_EQ(1, next_result.NoOfReferences);
+  EXPECT_EQ(NodeId{1002}, NodeId{next_result.References[0].NodeId.NodeId});
+  // Positions of a continuation point that doesn't hold its version are
+  // invalid in other versions.
+  EXPECT_EQ(OpcUa_BadContinuationPointInvalid,
+            next_response.Results[1].StatusCode);
+
+  // Freed once the continuation point is consumed.
+  EXPECT_EQ(0, continuation_points.size());
+  versions.Reclaim();
+  EXPECT_EQ(0, versions.retired_count());
+}
+
+}  // namespace server
+}  // namespace opcua
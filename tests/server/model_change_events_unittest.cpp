@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/model_change_events.h>
+
+namespace opcua {
+namespace server {
+
+namespace {
+
+class TestTimer {
+ public:
+  void set_interval(UInt32 interval_ms) {}
+
+  template <class WaitHandler>
+  void Start(WaitHandler&& handler) {}
+
+  void Stop() {}
+};
+
+NodeState MakeNode(NumericNodeId id, NumericNodeId parent_id = 0) {
+  NodeState node;
+  node.node_id = id;
+  node.node_class = OpcUa_NodeClass_Object;
+  node.type_definition_id = OpcUaId_FolderType;
+  if (parent_id != 0) {
+    node.parent_id = parent_id;
+    node.reference_type_id = OpcUaId_Organizes;
+  }
+  return node;
+}
+
+OpcUa_SimpleAttributeOperand MakeOperand(const char* browse_name) {
+  OpcUa_SimpleAttributeOperand operand;
+  ::OpcUa_SimpleAttributeOperand_Initialize(&operand);
+  operand.AttributeId = OpcUa_Attributes_Value;
+  operand.NoOfBrowsePath = 1;
+  operand.BrowsePath = static_cast<OpcUa_QualifiedName*>(
+      ::OpcUa_Alloc(sizeof(OpcUa_QualifiedName)));
+  ::OpcUa_QualifiedName_Initialize(&operand.BrowsePath[0]);
+  String{browse_name}.release(operand.BrowsePath[0].Name);
+  return operand;
+}
+
+}  // namespace
+
+TEST(AddressSpace, NodeVersions) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  AddressSpace address_space;
+  {
+    std::vector<NodeState> nodes;
+    nodes.push_back(MakeNode(1000));
+    nodes.push_back(MakeNode(1001));
+    address_space.AddNodes(std::move(nodes));
+  }
+
+  std::vector<NodeState> nodes;
+  nodes.push_back(MakeNode(2000, 1000));
+  nodes.back().children.push_back(MakeNode(2001));
+  nodes.push_back(MakeNode(3000, 1000));
+  auto changes = address_space.AddNodes(std::move(nodes));
+
+  // Both new nodes, and their parent once.
+  ASSERT_EQ(3, changes.size());
+  EXPECT_EQ(NodeId{2000}, changes[0].affected);
+  EXPECT_EQ(NodeId{OpcUaId_FolderType}, changes[0].affected_type);
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_NodeAdded, changes[0].verb);
+  EXPECT_EQ(NodeId{3000}, changes[1].affected);
+  EXPECT_EQ(NodeId{1000}, changes[2].affected);
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_ReferenceAdded,
+            changes[2].verb);
+
+  EXPECT_EQ(2, address_space.model_version());
+  EXPECT_EQ(2, address_space.node_version(address_space.GetNodeIndex(1000)));
+  EXPECT_EQ(1, address_space.node_version(address_space.GetNodeIndex(1001)));
+  EXPECT_EQ(2, address_space.node_version(address_space.GetNodeIndex(2001)));
+}
+
+TEST(ModelChangeEvents, CoalescesChanges) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  BasicModelChangeEvents<TestTimer> events{1000};
+
+  EventFilter event_filter;
+  Vector<OpcUa_SimpleAttributeOperand> select_clauses{3};
+  select_clauses[0] = MakeOperand("EventType");
+  select_clauses[1] = MakeOperand("Changes");
+  select_clauses[2] = MakeOperand("Unknown");
+  event_filter.NoOfSelectClauses = select_clauses.size();
+  event_filter.SelectClauses = select_clauses.release();
+  auto filter = ExtensionObject::Encode(std::move(event_filter));
+
+  auto result = events.CreateMonitoredItem(filter.get());
+  ASSERT_TRUE(result.status_code.IsGood());
+  EXPECT_FALSE(events.CreateMonitoredItem(ExtensionObject{}.get())
+                   .status_code.IsGood());
+
+  std::vector<Vector<OpcUa_Variant>> notifications;
+  result.monitored_item->SubscribeEvents(
+      [&](Vector<OpcUa_Variant>&& event_fields) {
+        notifications.emplace_back(std::move(event_fields));
+      });
+
+  events.Flush();
+  EXPECT_TRUE(notifications.empty());
+
+  events.Report({{2000, NodeId{}, OpcUa_ModelChangeStructureVerbMask_NodeAdded},
+                 {1000, NodeId{},
+                  OpcUa_ModelChangeStructureVerbMask_ReferenceAdded}});
+  events.Report(
+      {{1000, NodeId{}, OpcUa_ModelChangeStructureVerbMask_NodeAdded}});
+  EXPECT_EQ(2, events.pending_count());
+
+  events.Flush();
+  EXPECT_EQ(0, events.pending_count());
+  ASSERT_EQ(1, notifications.size());
+
+  auto& event_fields = notifications[0];
+  ASSERT_EQ(3, event_fields.size());
+  ASSERT_EQ(OpcUaType_NodeId, event_fields[0].Datatype);
+  EXPECT_EQ(OpcUaId_GeneralModelChangeEventType,
+            event_fields[0].Value.NodeId->Identifier.Numeric);
+  EXPECT_EQ(OpcUaType_Null, event_fields[2].Datatype);
+
+  ASSERT_EQ(OpcUaType_ExtensionObject, event_fields[1].Datatype);
+  ASSERT_EQ(2, event_fields[1].Value.Array.Length);
+  auto* changes = event_fields[1].Value.Array.Value.ExtensionObjectArray;
+  auto& first = *static_cast<OpcUa_ModelChangeStructureDataType*>(
+      changes[0].Body.EncodeableObject.Object);
+  EXPECT_EQ(2000, first.Affected.Identifier.Numeric);
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_NodeAdded, first.Verb);
+  auto& second = *static_cast<OpcUa_ModelChangeStructureDataType*>(
+      changes[1].Body.EncodeableObject.Object);
+  EXPECT_EQ(1000, second.Affected.Identifier.Numeric);
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_NodeAdded |
+                OpcUa_ModelChangeStructureVerbMask_ReferenceAdded,
+            second.Verb);
+
+  // A node added and deleted within the interval is reported as deleted. A
+  // NodeId added again after its deletion keeps both verbs.
+  events.Report({{3000, NodeId{}, OpcUa_ModelChangeStructureVerbMask_NodeAdded},
+                 {1000, NodeId{},
+                  OpcUa_ModelChangeStructureVerbMask_ReferenceAdded}});
+  events.Report(
+      {{3000, NodeId{}, OpcUa_ModelChangeStructureVerbMask_NodeDeleted},
+       {1000, NodeId{}, OpcUa_ModelChangeStructureVerbMask_ReferenceDeleted},
+       {4000, NodeId{}, OpcUa_ModelChangeStructureVerbMask_NodeDeleted}});
+  events.Report(
+      {{4000, NodeId{}, OpcUa_ModelChangeStructureVerbMask_NodeAdded}});
+  EXPECT_EQ(3, events.pending_count());
+
+  events.Flush();
+  ASSERT_EQ(2, notifications.size());
+  ASSERT_EQ(3, notifications[1][1].Value.Array.Length);
+  auto* merged = notifications[1][1].Value.Array.Value.ExtensionObjectArray;
+  auto get_verb = [&](size_t i) {
+    return static_cast<OpcUa_ModelChangeStructureDataType*>(
+               merged[i].Body.EncodeableObject.Object)
+        ->Verb;
+  };
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_NodeDeleted, get_verb(0));
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_ReferenceAdded |
+                OpcUa_ModelChangeStructureVerbMask_ReferenceDeleted,
+            get_verb(1));
+  EXPECT_EQ(OpcUa_ModelChangeStructureVerbMask_NodeDeleted |
+                OpcUa_ModelChangeStructureVerbMask_NodeAdded,
+            get_verb(2));
+
+  // Deleted items are dropped.
+  result.monitored_item.reset();
+  events.Report(
+      {{2000, NodeId{}, OpcUa_ModelChangeStructureVerbMask_ReferenceAdded}});
+  events.Flush();
+  EXPECT_EQ(2, notifications.size());
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/node_journal.h>
+#include <opcuapp/server/node_set_loader.h>
+#include <opcuapp/string_table.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace opcua {
+namespace server {
+
+namespace {
+
+const char kPath[] = "node_journal_unittest.uanodes";
+
+void RemoveFiles() {
+  for (auto* suffix : {"", ".journal", ".journal.old", ".tmp"})
+    std::remove((std::string{kPath} + suffix).c_str());
+}
+
+void AddVariables(NodeJournal& journal,
+                  AddressSpaceVersions& versions,
+                  const StringTable& namespace_uris,
+                  std::initializer_list<UInt32> ids) {
+  std::string xml =
+      "<UANodeSet "
+      "xmlns=\"http://opcfoundation.org/UA/2011/03/UANodeSet.xsd\">";
+  for (auto id : ids) {
+    xml += "<UAVariable NodeId=\"i=" + std::to_string(id) +
+           "\" BrowseName=\"Level\" AccessLevel=\"3\" />";
+  }
+  xml += "</UANodeSet>";
+  std::istringstream stream{xml};
+  NodeAttributes attributes;
+  auto nodes = LoadNodeSet(namespace_uris, stream, attributes);
+  journal.AddNodes(versions, std::move(nodes), std::move(attributes));
+}
+
+void AddVariable(NodeJournal& journal,
+                 AddressSpaceVersions& versions,
+                 const StringTable& namespace_uris,
+                 UInt32 id) {
+  AddVariables(journal, versions, namespace_uris, {id});
+}
+
+size_t GetFileSize(const std::string& path) {
+  std::ifstream stream{path, std::ios::in | std::ios::binary | std::ios::ate};
+  return stream ? static_cast<size_t>(stream.tellg()) : 0;
+}
+
+bool HasNode(const AddressSpaceVersions& versions, UInt32 id) {
+  return versions.Pin()->GetNodeIndex(id) != kInvalidNodeIndex;
+}
+
+}  // namespace
+
+TEST(NodeJournal, RestoresBatches) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+  StringTable namespace_uris;
+  RemoveFiles();
+
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, kPath};
+    journal.Load(versions);
+    AddVariable(journal, versions, namespace_uris, 1000);
+    AddVariable(journal, versions, namespace_uris, 1001);
+    EXPECT_EQ(2, journal.batch_count());
+  }
+
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, kPath};
+    journal.Load(versions);
+    EXPECT_EQ(2, versions.Pin()->node_count());
+    EXPECT_TRUE(HasNode(versions, 1001));
+
+    ASSERT_TRUE(journal.Compact(versions));
+    AddVariable(journal, versions, namespace_uris, 1002);
+    journal.WaitForCompaction();
+    EXPECT_EQ(1, journal.batch_count());
+  }
+
+  // A batch torn by a crash.
+  {
+    std::ofstream stream{std::string{kPath} + ".journal",
+                         std::ios::out | std::ios::binary | std::ios::app};
+    stream.write("\x40\x00\x00\x00\x01\x02", 6);
+  }
+
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, kPath};
+    journal.Load(versions);
+    EXPECT_EQ(3, versions.Pin()->node_count());
+    EXPECT_TRUE(HasNode(versions, 1000));
+    EXPECT_TRUE(HasNode(versions, 1002));
+    EXPECT_EQ(1, journal.batch_count());
+
+    auto index = versions.Pin()->GetNodeIndex(1001);
+    Variant value;
+    ASSERT_TRUE(
+        versions.Pin()->Read(index, OpcUa_Attributes_AccessLevel, value));
+    EXPECT_EQ(3, value.get().Value.Byte);
+
+    AddVariable(journal, versions, namespace_uris, 1003);
+  }
+
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, kPath};
+    journal.Load(versions);
+    EXPECT_EQ(4, versions.Pin()->node_count());
+    EXPECT_TRUE(HasNode(versions, 1003));
+  }
+
+  RemoveFiles();
+}
+
+TEST(NodeJournal, RejectsExistingNodeIds) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+  StringTable namespace_uris;
+  RemoveFiles();
+
+  const auto journal_path = std::string{kPath} + ".journal";
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, kPath};
+    journal.Load(versions);
+    AddVariable(journal, versions, namespace_uris, 1000);
+    const auto journal_size = GetFileSize(journal_path);
+
+    // Neither journaled nor added.
+    EXPECT_THROW(AddVariables(journal, versions, namespace_uris, {1001, 1000}),
+                 StatusCodeException);
+    EXPECT_THROW(AddVariables(journal, versions, namespace_uris, {1001, 1001}),
+                 StatusCodeException);
+    EXPECT_EQ(journal_size, GetFileSize(journal_path));
+    EXPECT_EQ(1, journal.batch_count());
+    EXPECT_EQ(1, versions.Pin()->node_count());
+  }
+
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, kPath};
+    journal.Load(versions);
+    EXPECT_EQ(1, versions.Pin()->node_count());
+  }
+
+  RemoveFiles();
+}
+
+TEST(NodeJournal, ChecksEveryNodeOfReplayedBatches) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+  StringTable namespace_uris;
+  RemoveFiles();
+
+  const auto journal_path = std::string{kPath} + ".journal";
+  const std::string other_path = "node_journal_unittest_other.uanodes";
+
+  // A batch of an existing and a new node, as no crash can leave it.
+  std::vector<char> batch;
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, other_path};
+    journal.Load(versions);
+    AddVariables(journal, versions, namespace_uris, {1000, 1001});
+  }
+  ASSERT_TRUE(GetFileSize(other_path + ".journal") != 0);
+  {
+    std::ifstream stream{other_path + ".journal",
+                         std::ios::in | std::ios::binary};
+    batch.assign(std::istreambuf_iterator<char>{stream},
+                 std::istreambuf_iterator<char>{});
+  }
+  std::remove((other_path + ".journal").c_str());
+
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, kPath};
+    journal.Load(versions);
+    AddVariable(journal, versions, namespace_uris, 1000);
+    ASSERT_TRUE(journal.Compact(versions));
+    journal.WaitForCompaction();
+  }
+
+  {
+    std::ofstream stream{journal_path,
+                         std::ios::out | std::ios::binary | std::ios::app};
+    stream.write(batch.data(), batch.size());
+  }
+
+  {
+    AddressSpaceVersions versions;
+    NodeJournal journal{namespace_uris, kPath};
+    EXPECT_THROW(journal.Load(versions), std::runtime_error);
+  }
+
+  RemoveFiles();
+}
+
+}  // namespace server
+}  // namespace opcua
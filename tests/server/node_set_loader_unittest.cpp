@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/node_set_loader.h>
+#include <opcuapp/string_table.h>
+#include <fstream>
+#include <sstream>
+
+#ifndef OPCUAPP_SCHEMA_DIR
+#define OPCUAPP_SCHEMA_DIR "opcuapp/schema"
+#endif
+
+namespace opcua {
+namespace server {
+
+TEST(NodeSetLoader, UANodeSet) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  namespace_uris.Append("http://opcfoundation.org/UA/");
+  namespace_uris.Append("urn:test");
+
+  std::istringstream stream{R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd"
+           xmlns:uax="http://opcfoundation.org/UA/2008/02/Types.xsd">
+  <NamespaceUris>
+    <Uri>urn:other</Uri>
+    <Uri>urn:test</Uri>
+  </NamespaceUris>
+  <Aliases>
+    <Alias Alias="HasComponent">i=47</Alias>
+    <Alias Alias="HasTypeDefinition">i=40</Alias>
+  </Aliases>
+  <UAVariable NodeId="ns=2;i=1" BrowseName="2:Level" ParentNodeId="i=85" DataType="i=11">
+    <DisplayName>Tank Level</DisplayName>
+    <References>
+      <Reference ReferenceType="HasTypeDefinition">i=63</Reference>
+      <Reference ReferenceType="HasComponent" IsForward="false">i=85</Reference>
+      <Reference ReferenceType="i=37">i=78</Reference>
+    </References>
+    <Value>
+      <uax:ListOfDouble>
+        <uax:Double>1.5</uax:Double>
+        <uax:Double>2.5</uax:Double>
+      </uax:ListOfDouble>
+    </Value>
+  </UAVariable>
+  <UAVariable NodeId="ns=2;i=2" BrowseName="2:Status" DataType="i=19">
+    <Value>
+      <uax:StatusCode>
+        <uax:Code>0x80340000</uax:Code>
+      </uax:StatusCode>
+    </Value>
+  </UAVariable>
+  <UAObject NodeId="ns=2;s=Tank" BrowseName="2:Tank" />
+</UANodeSet>)"};
+
+  auto nodes = LoadNodeSet(namespace_uris, stream);
+  ASSERT_EQ(3, nodes.size());
+
+  auto& variable = nodes[0];
+  EXPECT_EQ(OpcUa_NodeClass_Variable, variable.node_class);
+  EXPECT_EQ(NodeId(1, 1), variable.node_id);
+  EXPECT_EQ(1, variable.browse_name->namespace_index());
+  EXPECT_STREQ("Tank Level",
+               OpcUa_String_GetRawString(&variable.display_name->text()));
+  EXPECT_EQ(NodeId(OpcUaId_ObjectsFolder), variable.parent_id);
+  EXPECT_EQ(NodeId(OpcUaId_HasComponent), variable.reference_type_id);
+  EXPECT_EQ(NodeId(OpcUaId_BaseDataVariableType),
+            variable.type_definition_id);
+  EXPECT_EQ(NodeId(OpcUaId_Double), variable.data_type_id);
+  ASSERT_EQ(1, variable.references.size());
+  EXPECT_EQ(NodeId(OpcUaId_HasModellingRule),
+            variable.references[0].reference_type_id);
+
+  auto& value = variable.value->get();
+  EXPECT_EQ(OpcUaType_Double, value.Datatype);
+  EXPECT_EQ(OpcUa_VariantArrayType_Array, value.ArrayType);
+  ASSERT_EQ(2, value.Value.Array.Length);
+  EXPECT_EQ(2.5, value.Value.Array.Value.DoubleArray[1]);
+
+  auto& status = nodes[1].value->get();
+  EXPECT_EQ(OpcUaType_StatusCode, status.Datatype);
+  EXPECT_EQ(OpcUa_BadNodeIdUnknown, status.Value.StatusCode);
+
+  auto& object = nodes[2];
+  EXPECT_EQ(OpcUa_NodeClass_Object, object.node_class);
+  EXPECT_EQ(NodeId(String{"Tank"}, 1), object.node_id);
+  EXPECT_STREQ("Tank", OpcUa_String_GetRawString(&object.display_name->text()));
+}
+
+TEST(NodeSetLoader, ListOfNodeState) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream stream{R"(<?xml version="1.0" encoding="utf-8"?>
+<uax:ListOfNodeState xmlns:uax="http://opcfoundation.org/UA/2008/02/Types.xsd">
+  <ServerStatus xmlns="http://opcfoundation.org/UA/">
+    <uax:NodeClass>Object_1</uax:NodeClass>
+    <uax:NodeId><uax:Identifier>i=2256</uax:Identifier></uax:NodeId>
+    <uax:BrowseName>
+      <uax:NamespaceIndex>0</uax:NamespaceIndex>
+      <uax:Name>ServerStatus</uax:Name>
+    </uax:BrowseName>
+    <uax:References>
+      <uax:Reference>
+        <uax:ReferenceTypeId><uax:Identifier>i=35</uax:Identifier></uax:ReferenceTypeId>
+        <uax:IsInverse>true</uax:IsInverse>
+        <uax:TargetId><uax:Identifier>i=2253</uax:Identifier></uax:TargetId>
+      </uax:Reference>
+    </uax:References>
+    <State>
+      <uax:NodeClass>Variable_2</uax:NodeClass>
+      <uax:NodeId><uax:Identifier>i=2259</uax:Identifier></uax:NodeId>
+      <uax:Value>
+        <uax:Value>
+          <uax:String>Running</uax:String>
+        </uax:Value>
+      </uax:Value>
+    </State>
+  </ServerStatus>
+</uax:ListOfNodeState>)"};
+
+  auto nodes = LoadNodeSet(namespace_uris, stream);
+  ASSERT_EQ(1, nodes.size());
+
+  auto& node = nodes[0];
+  EXPECT_EQ(OpcUa_NodeClass_Object, node.node_class);
+  EXPECT_EQ(NodeId(OpcUaId_Server_ServerStatus), node.node_id);
+  ASSERT_EQ(1, node.references.size());
+  EXPECT_TRUE(node.references[0].inverse);
+
+  ASSERT_EQ(1, node.children.size());
+  auto& child = node.children[0];
+  EXPECT_EQ(OpcUa_NodeClass_Variable, child.node_class);
+  EXPECT_EQ(OpcUaType_String, child.value->get().Datatype);
+  EXPECT_STREQ("Running",
+               OpcUa_String_GetRawString(&child.value->get().Value.String));
+}
+
+TEST(NodeSetLoader, PredefinedNodes) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  namespace_uris.Append("http://opcfoundation.org/UA/");
+  std::ifstream stream{OPCUAPP_SCHEMA_DIR "/Opc.Ua.PredefinedNodes.xml"};
+  ASSERT_TRUE(stream.is_open());
+
+  NodeAttributes attributes;
+  auto nodes = LoadNodeSet(namespace_uris, stream, attributes);
+  AddressSpace address_space;
+  address_space.AddNodes(std::move(nodes), std::move(attributes));
+
+  const auto expect_node = [&](UInt32 id, NodeClass node_class,
+                               const char* browse_name) {
+    SCOPED_TRACE(id);
+    const auto index = address_space.GetNodeIndex(id);
+    ASSERT_NE(kInvalidNodeIndex, index);
+    Variant value;
+    ASSERT_TRUE(address_space.Read(index, OpcUa_Attributes_NodeClass, value)
+                    .IsGood());
+    EXPECT_EQ(node_class, value.get().Value.Int32);
+    ASSERT_TRUE(address_space.Read(index, OpcUa_Attributes_BrowseName, value)
+                    .IsGood());
+    ASSERT_EQ(OpcUaType_QualifiedName, value.data_type());
+    const auto& name = *value.get().Value.QualifiedName;
+    EXPECT_EQ(0, name.NamespaceIndex);
+    EXPECT_STREQ(browse_name, OpcUa_String_GetRawString(&name.Name));
+  };
+
+  expect_node(OpcUaId_ObjectsFolder, OpcUa_NodeClass_Object, "Objects");
+  expect_node(OpcUaId_Server, OpcUa_NodeClass_Object, "Server");
+  expect_node(OpcUaId_Server_ServerStatus, OpcUa_NodeClass_Variable,
+              "ServerStatus");
+  expect_node(OpcUaId_Server_ServerStatus_State, OpcUa_NodeClass_Variable,
+              "State");
+}
+
+TEST(NodeSetLoader, ParseDateTime) {
+  const auto ticks = [](const char* text) {
+    const auto date_time = detail::ParseDateTime(text);
+    return (static_cast<uint64_t>(date_time.dwHighDateTime) << 32) |
+           date_time.dwLowDateTime;
+  };
+
+  const auto utc = ticks("2020-01-01T00:00:00Z");
+  EXPECT_EQ(132223104000000000ULL, utc);
+  EXPECT_EQ(utc, ticks("2020-01-01T00:00:00"));
+  EXPECT_EQ(utc, ticks("2020-01-01T05:30:00+05:30"));
+  EXPECT_EQ(utc, ticks("2019-12-31T22:00:00-02:00"));
+  EXPECT_EQ(utc + 5000000, ticks("2020-01-01T01:00:00.5+01:00"));
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/address_space.h>
+#include <opcuapp/server/node_loader.h>
+#include <opcuapp/server/node_set_loader.h>
+#include <opcuapp/server/node_writer.h>
+#include <opcuapp/string_table.h>
+#include <algorithm>
+#include <sstream>
+
+namespace opcua {
+namespace server {
+
+TEST(NodeWriter, LoadsWrittenNodes) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream xml{R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd"
+           xmlns:uax="http://opcfoundation.org/UA/2008/02/Types.xsd">
+  <UAReferenceType NodeId="i=47" BrowseName="HasComponent" IsAbstract="true">
+    <InverseName>ComponentOf</InverseName>
+  </UAReferenceType>
+  <UAObject NodeId="i=1000" BrowseName="Tank" EventNotifier="1" />
+  <UAVariable NodeId="i=1001" BrowseName="Level" ParentNodeId="i=1000"
+              DataType="i=11" ValueRank="1" ArrayDimensions="2"
+              AccessLevel="3">
+    <DisplayName>Tank Level</DisplayName>
+    <Description>Tank level</Description>
+    <References>
+      <Reference ReferenceType="i=47" IsForward="false">i=1000</Reference>
+    </References>
+    <Value>
+      <uax:ListOfDouble>
+        <uax:Double>1.5</uax:Double>
+        <uax:Double>2.5</uax:Double>
+      </uax:ListOfDouble>
+    </Value>
+  </UAVariable>
+</UANodeSet>)"};
+
+  NodeAttributes source_attributes;
+  AddressSpace source;
+  source.AddNodes(LoadNodeSet(namespace_uris, xml, source_attributes),
+                  std::move(source_attributes));
+
+  std::stringstream stream;
+  SavePredefinedNodes(namespace_uris, source, stream);
+
+  NodeAttributes attributes;
+  AddressSpace address_space;
+  address_space.AddNodes(
+      LoadPredefinedNodes(namespace_uris, stream, attributes),
+      std::move(attributes));
+  ASSERT_EQ(source.node_count(), address_space.node_count());
+
+  const auto index = address_space.GetNodeIndex(1001);
+  ASSERT_EQ(source.GetNodeIndex(1001), index);
+
+  auto& variable = address_space.node(index);
+  EXPECT_STREQ("Level",
+               OpcUa_String_GetRawString(&variable.browse_name->name()));
+  EXPECT_STREQ("Tank Level",
+               OpcUa_String_GetRawString(&variable.display_name->text()));
+  EXPECT_EQ(NodeId(OpcUaId_Double), variable.data_type_id);
+
+  // The parent is kept as an inverse reference.
+  EXPECT_TRUE(std::any_of(
+      variable.references.begin(), variable.references.end(),
+      [](const ReferenceState& reference) {
+        return reference.inverse &&
+               reference.reference_type_id == NodeId(OpcUaId_HasComponent) &&
+               NodeId{reference.target_id.get().NodeId} == NodeId(1000);
+      }));
+
+  Variant value;
+  ASSERT_TRUE(address_space.Read(index, OpcUa_Attributes_Value, value));
+  ASSERT_TRUE(value.is_array());
+  ASSERT_EQ(2, value.get().Value.Array.Length);
+  EXPECT_EQ(2.5, value.get().Value.Array.Value.DoubleArray[1]);
+
+  ASSERT_TRUE(address_space.Read(index, OpcUa_Attributes_ValueRank, value));
+  EXPECT_EQ(1, value.get().Value.Int32);
+
+  ASSERT_TRUE(address_space.Read(index, OpcUa_Attributes_AccessLevel, value));
+  EXPECT_EQ(3, value.get().Value.Byte);
+
+  ASSERT_TRUE(
+      address_space.Read(index, OpcUa_Attributes_ArrayDimensions, value));
+  ASSERT_EQ(1, value.get().Value.Array.Length);
+  EXPECT_EQ(2, value.get().Value.Array.Value.UInt32Array[0]);
+
+  ASSERT_TRUE(address_space.Read(index, OpcUa_Attributes_Description, value));
+  EXPECT_STREQ("Tank level", OpcUa_String_GetRawString(
+                                 &value.get().Value.LocalizedText->Text));
+
+  const auto object_index = address_space.GetNodeIndex(1000);
+  ASSERT_TRUE(address_space.Read(object_index, OpcUa_Attributes_EventNotifier,
+                                 value));
+  EXPECT_EQ(1, value.get().Value.Byte);
+
+  const auto type_index = address_space.GetNodeIndex(OpcUaId_HasComponent);
+  ASSERT_TRUE(
+      address_space.Read(type_index, OpcUa_Attributes_IsAbstract, value));
+  EXPECT_EQ(True, value.get().Value.Boolean);
+  ASSERT_TRUE(
+      address_space.Read(type_index, OpcUa_Attributes_InverseName, value));
+  EXPECT_STREQ("ComponentOf", OpcUa_String_GetRawString(
+                                  &value.get().Value.LocalizedText->Text));
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/read_cache.h>
+#include <opcuapp/vector.h>
+#include <future>
+#include <thread>
+
+namespace opcua {
+namespace server {
+
+TEST(ReadCache, MaxAge) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  std::vector<size_t> batch_sizes;
+  ReadCache cache{[&batch_sizes](Span<const NodeIndex> nodes,
+                                 Span<DataValue> results) {
+    batch_sizes.push_back(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      results[i] = DataValue{OpcUa_Good, static_cast<Double>(nodes[i]),
+                             DateTime{}, DateTime{}};
+    }
+  }};
+
+  const NodeIndex nodes[] = {3, 5, 7};
+  Vector<OpcUa_DataValue> results(std::size(nodes));
+
+  cache.Read({nodes, 3}, 1000, {results.data(), results.size()});
+  ASSERT_EQ(std::vector<size_t>{3}, batch_sizes);
+  EXPECT_EQ(7.0, results[2].Value.Value.Double);
+
+  // Served from the cache.
+  cache.Read({nodes, 2}, 1000, {results.data(), 2});
+  EXPECT_EQ(1, cache.backend_calls());
+  EXPECT_EQ(5.0, results[1].Value.Value.Double);
+
+  // MaxAge 0 always reads the backend.
+  cache.Read({nodes, 1}, 0, {results.data(), 1});
+  EXPECT_EQ(2, cache.backend_calls());
+  EXPECT_EQ(1, batch_sizes.back());
+}
+
+TEST(ReadCache, SingleFlight) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  std::promise<void> entered;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  ReadCache cache{[&](Span<const NodeIndex> nodes, Span<DataValue> results) {
+    entered.set_value();
+    released.wait();
+    results[0] = DataValue{OpcUa_Good, 1.5, DateTime{}, DateTime{}};
+  }};
+
+  const NodeIndex node = 1;
+  std::thread first{[&] {
+    Vector<OpcUa_DataValue> results(1);
+    cache.Read({&node, 1}, 0, {results.data(), 1});
+    EXPECT_EQ(1.5, results[0].Value.Value.Double);
+  }};
+  entered.get_future().wait();
+
+  std::thread second{[&] {
+    Vector<OpcUa_DataValue> results(1);
+    cache.Read({&node, 1}, 0, {results.data(), 1});
+    EXPECT_EQ(1.5, results[0].Value.Value.Double);
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  release.set_value();
+
+  first.join();
+  second.join();
+  EXPECT_EQ(1, cache.backend_calls());
+}
+
+}  // namespace server
+}  // namespace opcua
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/address_space_versions.h>
+#include <opcuapp/server/node_set_loader.h>
+#include <opcuapp/server/reader.h>
+#include <opcuapp/string_table.h>
+#include <sstream>
+
+namespace opcua {
+namespace server {
+
+TEST(Reader, Read) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream stream{R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd"
+           xmlns:uax="http://opcfoundation.org/UA/2008/02/Types.xsd">
+  <UAObject NodeId="i=1000" BrowseName="Tank" />
+  <UAVariable NodeId="i=1001" BrowseName="Level" DataType="i=11">
+    <Value><uax:Double>1.5</uax:Double></Value>
+  </UAVariable>
+  <UAVariable NodeId="i=1002" BrowseName="Temperature" DataType="i=11" />
+</UANodeSet>)"};
+
+  NodeAttributes attributes;
+  AddressSpace address_space;
+  address_space.AddNodes(LoadNodeSet(namespace_uris, stream, attributes),
+                         std::move(attributes));
+
+  Reader reader;
+  std::vector<NodeIndex> backend_nodes;
+  ReadCache cache{[&backend_nodes](Span<const NodeIndex> nodes,
+                                   Span<DataValue> results) {
+    backend_nodes.assign(nodes.begin(), nodes.end());
+    for (auto& result : results)
+      result = DataValue{OpcUa_Good, 7.5, DateTime{}, DateTime{}};
+  }};
+  reader.SetReadCache(address_space, NodeId{1000}, cache);
+  reader.SetReadCache(address_space, NodeId{1001}, cache);
+  int source_reads = 0;
+  reader.SetValueSource(address_space, NodeId{1002}, [&source_reads] {
+    ++source_reads;
+    return DataValue{OpcUa_Good, 20.5, DateTime{}, DateTime{}};
+  });
+
+  const struct {
+    UInt32 node;
+    AttributeId attribute_id;
+  } items[] = {
+      {1002, OpcUa_Attributes_Value},
+      {1000, OpcUa_Attributes_Value},
+      {1001, OpcUa_Attributes_Value},
+      {2000, OpcUa_Attributes_Value},
+      {1001, OpcUa_Attributes_DataType},
+  };
+
+  ReadRequest request;
+  request.TimestampsToReturn = OpcUa_TimestampsToReturn_Both;
+  {
+    Vector<OpcUa_ReadValueId> nodes_to_read(std::size(items));
+    for (size_t i = 0; i < nodes_to_read.size(); ++i) {
+      NodeId{items[i].node}.CopyTo(nodes_to_read[i].NodeId);
+      nodes_to_read[i].AttributeId = items[i].attribute_id;
+    }
+    request.NoOfNodesToRead = static_cast<Int32>(nodes_to_read.size());
+    request.NodesToRead = nodes_to_read.release();
+  }
+
+  auto response = reader.Read(address_space, request);
+  ASSERT_EQ(OpcUa_Good, response.ResponseHeader.ServiceResult);
+  ASSERT_EQ(5, response.NoOfResults);
+  const auto* results = response.Results;
+
+  EXPECT_EQ(1, source_reads);
+  EXPECT_EQ(OpcUa_Good, results[0].StatusCode);
+  EXPECT_EQ(20.5, results[0].Value.Value.Double);
+
+  // Both cached nodes are fetched in one backend call.
+  EXPECT_EQ(1, cache.backend_calls());
+  EXPECT_EQ(2, backend_nodes.size());
+  EXPECT_EQ(OpcUa_Good, results[1].StatusCode);
+  EXPECT_EQ(7.5, results[1].Value.Value.Double);
+
+  EXPECT_EQ(OpcUa_Good, results[2].StatusCode);
+  EXPECT_EQ(7.5, results[2].Value.Value.Double);
+
+  EXPECT_EQ(OpcUa_BadNodeIdUnknown, results[3].StatusCode);
+
+  EXPECT_EQ(OpcUa_Good, results[4].StatusCode);
+  EXPECT_EQ(OpcUaType_NodeId, results[4].Value.Datatype);
+
+  // The server timestamp is taken once per request.
+  EXPECT_EQ(results[0].ServerTimestamp.dwLowDateTime,
+            results[4].ServerTimestamp.dwLowDateTime);
+}
+
+TEST(Reader, ServesPinnedVersions) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  const auto make_nodes = [](UInt32 id) {
+    std::vector<NodeState> nodes(1);
+    nodes[0].node_id = NodeId{id};
+    nodes[0].node_class = OpcUa_NodeClass_Variable;
+    return nodes;
+  };
+
+  AddressSpaceVersions versions;
+  versions.AddNodes(make_nodes(1000), NodeAttributes{});
+
+  // Set once for every later version.
+  Reader reader;
+  reader.SetValueSource(*versions.Pin(), NodeId{1000}, [] {
+    return DataValue{OpcUa_Good, 20.5, DateTime{}, DateTime{}};
+  });
+
+  ReadRequest request;
+  request.TimestampsToReturn = OpcUa_TimestampsToReturn_Neither;
+  {
+    Vector<OpcUa_ReadValueId> nodes_to_read(2);
+    NodeId{1000}.CopyTo(nodes_to_read[0].NodeId);
+    NodeId{1001}.CopyTo(nodes_to_read[1].NodeId);
+    for (auto& node_to_read : nodes_to_read)
+      node_to_read.AttributeId = OpcUa_Attributes_Value;
+    request.NoOfNodesToRead = static_cast<Int32>(nodes_to_read.size());
+    request.NodesToRead = nodes_to_read.release();
+  }
+
+  auto pinned = versions.Pin();
+  versions.AddNodes(make_nodes(1001), NodeAttributes{});
+
+  auto pinned_response = reader.Read(*pinned, request);
+  ASSERT_EQ(2, pinned_response.NoOfResults);
+  EXPECT_EQ(20.5, pinned_response.Results[0].Value.Value.Double);
+  EXPECT_EQ(OpcUa_BadNodeIdUnknown, pinned_response.Results[1].StatusCode);
+
+  auto response = reader.Read(*versions.Pin(), request);
+  ASSERT_EQ(2, response.NoOfResults);
+  EXPECT_EQ(20.5, response.Results[0].Value.Value.Double);
+  EXPECT_EQ(OpcUa_Good, response.Results[1].StatusCode);
+}
+
+}  // namespace server
+}  // namespace opcua
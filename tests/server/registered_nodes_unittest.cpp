@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/browser.h>
+#include <opcuapp/server/handlers.h>
+#include <opcuapp/server/reader.h>
+#include <opcuapp/server/registered_nodes.h>
+
+namespace opcua {
+namespace server {
+
+TEST(RegisteredNodes, RegisterNodes) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  std::vector<NodeState> nodes(1);
+  nodes[0].node_id = NodeId{1000};
+  nodes[0].node_class = OpcUa_NodeClass_Variable;
+  AddressSpace address_space;
+  address_space.AddNodes(std::move(nodes), NodeAttributes{});
+
+  RegisteredNodes registered_nodes{1};
+
+  RegisterNodesRequest request;
+  {
+    Vector<OpcUa_NodeId> node_ids(3);
+    NodeId{1000}.CopyTo(node_ids[0]);
+    NodeId{2000}.CopyTo(node_ids[1]);
+    // No alias is left for the second registration.
+    NodeId{1000}.CopyTo(node_ids[2]);
+    request.NoOfNodesToRegister = static_cast<Int32>(node_ids.size());
+    request.NodesToRegister = node_ids.release();
+  }
+
+  auto response = RegisterNodes(address_space, request, registered_nodes);
+  ASSERT_EQ(OpcUa_Good, response.ResponseHeader.ServiceResult);
+  ASSERT_EQ(3, response.NoOfRegisteredNodeIds);
+  const auto& alias = response.RegisteredNodeIds[0];
+  EXPECT_TRUE(RegisteredNodes::IsAlias(alias));
+  EXPECT_EQ(NodeId{2000}, NodeId{response.RegisteredNodeIds[1]});
+  EXPECT_EQ(NodeId{1000}, NodeId{response.RegisteredNodeIds[2]});
+
+  EXPECT_EQ(address_space.GetNodeIndex(NodeId{1000}),
+            ResolveNodeIndex(address_space, &registered_nodes, alias));
+  EXPECT_EQ(NodeId{1000}, registered_nodes.FindNodeId(alias));
+
+  // Aliases are resolved by the services.
+  Reader reader;
+  ReadRequest read_request;
+  {
+    Vector<OpcUa_ReadValueId> nodes_to_read(1);
+    NodeId{alias}.CopyTo(nodes_to_read[0].NodeId);
+    nodes_to_read[0].AttributeId = OpcUa_Attributes_NodeClass;
+    read_request.NoOfNodesToRead = 1;
+    read_request.NodesToRead = nodes_to_read.release();
+  }
+  auto read_response =
+      reader.Read(address_space, read_request, &registered_nodes);
+  ASSERT_EQ(1, read_response.NoOfResults);
+  EXPECT_EQ(OpcUa_Good, read_response.Results[0].StatusCode);
+  auto unresolved_response = reader.Read(address_space, read_request);
+  EXPECT_EQ(OpcUa_BadNodeIdUnknown, unresolved_response.Results[0].StatusCode);
+
+  UnregisterNodesRequest unregister_request;
+  {
+    Vector<OpcUa_NodeId> node_ids(1);
+    NodeId{alias}.CopyTo(node_ids[0]);
+    unregister_request.NoOfNodesToUnregister = 1;
+    unregister_request.NodesToUnregister = node_ids.release();
+  }
+  UnregisterNodes(unregister_request, registered_nodes);
+  EXPECT_EQ(0, registered_nodes.size());
+  EXPECT_EQ(kInvalidNodeIndex, registered_nodes.Find(alias));
+}
+
+TEST(RegisteredNodes, ReplaceAliases) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  std::vector<NodeState> nodes(3);
+  nodes[0].node_id = NodeId{1000};
+  nodes[0].node_class = OpcUa_NodeClass_Object;
+  for (UInt32 i = 1; i < 3; ++i) {
+    nodes[i].node_id = NodeId{1000 + i};
+    nodes[i].node_class = OpcUa_NodeClass_Variable;
+    nodes[i].parent_id = NodeId{1000};
+    nodes[i].reference_type_id = NodeId{OpcUaId_HasComponent};
+  }
+  AddressSpace address_space;
+  address_space.AddNodes(std::move(nodes), NodeAttributes{});
+
+  RegisteredNodes registered_nodes;
+  const auto alias = registered_nodes.Register(
+      NodeId{1000}.get(), address_space.GetNodeIndex(NodeId{1000}));
+  ASSERT_TRUE(RegisteredNodes::IsAlias(alias.get()));
+
+  TranslateBrowsePathsToNodeIdsRequest translate_request;
+  {
+    Vector<OpcUa_BrowsePath> paths(2);
+    alias.CopyTo(paths[0].StartingNode);
+    // Unknown aliases are kept and fail in the service.
+    NodeId{999, RegisteredNodes::kNamespaceIndex}.CopyTo(
+        paths[1].StartingNode);
+    translate_request.NoOfBrowsePaths = static_cast<Int32>(paths.size());
+    translate_request.BrowsePaths = paths.release();
+  }
+  ReplaceAliases(registered_nodes, translate_request);
+  EXPECT_EQ(NodeId{1000},
+            NodeId{translate_request.BrowsePaths[0].StartingNode});
+  EXPECT_EQ((NodeId{999, RegisteredNodes::kNamespaceIndex}),
+            NodeId{translate_request.BrowsePaths[1].StartingNode});
+
+  // BrowseNext continues from the node the alias was replaced with.
+  BrowseRequest request;
+  {
+    Vector<OpcUa_BrowseDescription> descriptions(1);
+    alias.CopyTo(descriptions[0].NodeId);
+    descriptions[0].BrowseDirection = OpcUa_BrowseDirection_Forward;
+    descriptions[0].ResultMask = OpcUa_BrowseResultMask_All;
+    request.RequestedMaxReferencesPerNode = 1;
+    request.NoOfNodesToBrowse = 1;
+    request.NodesToBrowse = descriptions.release();
+  }
+  ReplaceAliases(registered_nodes, request);
+
+  const Browser browser;
+  BrowseContinuationPoints continuation_points;
+  auto response = browser.Browse(address_space, request, continuation_points);
+  ASSERT_EQ(1, response.NoOfResults);
+  auto& result = response.Results[0];
+  ASSERT_EQ(OpcUa_Good, result.StatusCode);
+  ASSERT_EQ(1, result.NoOfReferences);
+  EXPECT_EQ(NodeId{1001}, NodeId{result.References[0].NodeId.NodeId});
+
+  BrowseNextRequest next_request;
+  next_request.NoOfContinuationPoints = 1;
+  next_request.ContinuationPoints = &result.ContinuationPoint;
+  auto next_response =
+      browser.BrowseNext(address_space, next_request, continuation_points);
+  next_request.NoOfContinuationPoints = 0;
+  next_request.ContinuationPoints = OpcUa_Null;
+  ASSERT_EQ(1, next_response.NoOfResults);
+  auto& next_result = next_response.Results[0];
+  ASSERT_EQ(OpcUa_Good, next_result.StatusCode);
+  ASSERT_EQ(1, next_result.NoOfReferences);
+  EXPECT_EQ(NodeId{1002}, NodeId{next_result.References[0].NodeId.NodeId});
+}
+
+TEST(RegisteredNodes, Handlers) {
+  // Handlers without the table keep working, and get the NodeIds.
+  SessionHandlers handlers;
+  handlers.read_handler_ = [](OpcUa_ReadRequest& /*request*/,
+                              const ReadCallback& callback) {
+    callback(ReadResponse{});
+  };
+  handlers.write_handler_ = [](OpcUa_WriteRequest& /*request*/,
+                               const WriteCallback& callback) {
+    callback(WriteResponse{});
+  };
+  handlers.registered_read_handler_ =
+      [](OpcUa_ReadRequest& /*request*/,
+         const RegisteredNodes& /*registered_nodes*/,
+         const ReadCallback& callback) { callback(ReadResponse{}); };
+  EXPECT_TRUE(handlers.read_handler_);
+  EXPECT_TRUE(handlers.write_handler_);
+  EXPECT_TRUE(handlers.registered_read_handler_);
+  EXPECT_FALSE(handlers.registered_write_handler_);
+
+  // Browse handlers without continuation points keep their signature too.
+  handlers.browse_handler_ = [](OpcUa_BrowseRequest& /*request*/,
+                                const BrowseCallback& callback) {
+    callback(BrowseResponse{});
+  };
+  handlers.continuation_browse_handler_ =
+      [](OpcUa_BrowseRequest& /*request*/,
+         BrowseContinuationPoints& /*continuation_points*/,
+         const BrowseCallback& callback) { callback(BrowseResponse{}); };
+  EXPECT_TRUE(handlers.browse_handler_);
+  EXPECT_TRUE(handlers.continuation_browse_handler_);
+}
+}  // namespace server
+}  // namespace opcua
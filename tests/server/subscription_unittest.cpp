@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <opcuapp/encodable_object.h>
 #include <opcuapp/platform.h>
 #include <opcuapp/proxy_stub.h>
 #include <opcuapp/server/subscription.h>
@@ -17,6 +18,18 @@ class TestTimer {
   void Stop() {}
 };
 
+class TestMonitoredItem : public MonitoredItem {
+ public:
+  virtual void SubscribeDataChange(
+      const DataChangeHandler& data_change_handler) override {
+    data_change_handler_ = data_change_handler;
+  }
+
+  virtual void SubscribeEvents(const EventHandler& event_handler) override {}
+
+  DataChangeHandler data_change_handler_;
+};
+
 TEST(Subcription, Test) {
   Platform platform;
   ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
@@ -27,6 +40,7 @@ TEST(Subcription, Test) {
       0,
       0,
       0,
+      0,
       false,
       0,
       nullptr,
@@ -35,5 +49,62 @@ TEST(Subcription, Test) {
   });
 }
 
+TEST(Subcription, SplitsMessagesBySize) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  DataChangeNotification notification;
+  Vector<OpcUa_MonitoredItemNotification> items{1};
+  items[0].ClientHandle = 5;
+  DataValue{OpcUa_Good, 1.5, DateTime{}, DateTime{}}.release(items[0].Value);
+  notification.NoOfMonitoredItems = items.size();
+  notification.MonitoredItems = items.release();
+  const auto notification_size =
+      EncodedSize(ExtensionObject::Encode(std::move(notification)).get());
+
+  // Room for two and a half notifications.
+  auto monitored_item = std::make_shared<TestMonitoredItem>();
+  auto subscription = BasicSubscription<TestTimer>::Create(SubscriptionContext{
+      123,
+      0,
+      100,
+      100,
+      100,
+      1024 + 4 + notification_size * 5 / 2,
+      false,
+      0,
+      [monitored_item](ReadValueId&& read_value_id,
+                       MonitoringParameters&& params) {
+        return CreateMonitoredItemResult{OpcUa_Good, monitored_item};
+      },
+      nullptr,
+      nullptr,
+  });
+
+  CreateMonitoredItemsRequest request;
+  Vector<OpcUa_MonitoredItemCreateRequest> items_to_create{1};
+  items_to_create[0].ItemToMonitor.AttributeId = OpcUa_Attributes_Value;
+  items_to_create[0].RequestedParameters.ClientHandle = 5;
+  request.NoOfItemsToCreate = items_to_create.size();
+  request.ItemsToCreate = items_to_create.release();
+  subscription->BeginInvoke(request, [](CreateMonitoredItemsResponse&&) {});
+  ASSERT_TRUE(monitored_item->data_change_handler_);
+
+  for (int i = 0; i < 3; ++i) {
+    monitored_item->data_change_handler_(
+        DataValue{OpcUa_Good, 1.5, DateTime{}, DateTime{}});
+  }
+
+  PublishResponse response;
+  ASSERT_TRUE(subscription->Publish(response));
+  EXPECT_EQ(2, response.NotificationMessage.NoOfNotificationData);
+  EXPECT_EQ(OpcUa_True, response.MoreNotifications);
+
+  PublishResponse next_response;
+  ASSERT_TRUE(subscription->Publish(next_response));
+  EXPECT_EQ(1, next_response.NotificationMessage.NoOfNotificationData);
+  EXPECT_EQ(OpcUa_False, next_response.MoreNotifications);
+}
+
 } // namespace server
-} // namespace opcua
\ No newline at end of file
+} // namespace opcua
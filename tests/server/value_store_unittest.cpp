@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/value_store.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace opcua {
+namespace server {
+
+namespace {
+
+AddressSpace MakeAddressSpace() {
+  std::vector<NodeState> nodes(2);
+  nodes[0].node_id = NodeId{1000};
+  nodes[0].node_class = OpcUa_NodeClass_Variable;
+  nodes[1].node_id = NodeId{1001};
+  nodes[1].node_class = OpcUa_NodeClass_Variable;
+
+  AddressSpace address_space;
+  address_space.AddNodes(std::move(nodes), NodeAttributes{});
+  return address_space;
+}
+
+DataValue MakeStringValue(UInt32 i) {
+  DataValue data_value;
+  data_value.get().Value.Datatype = OpcUaType_String;
+  String{("value " + std::to_string(i)).c_str()}.release(
+      data_value.get().Value.Value.String);
+  data_value.get().SourceTimestamp.dwLowDateTime = i;
+  return data_value;
+}
+
+// |i| repeated |i % 4 + 1| times.
+DataValue MakeArrayValue(UInt32 i) {
+  const auto length = static_cast<Int32>(i % 4 + 1);
+  auto* values = static_cast<UInt32*>(
+      ::OpcUa_Alloc(static_cast<UInt32>(sizeof(UInt32) * length)));
+  std::fill(values, values + length, i);
+
+  DataValue data_value;
+  auto& value = data_value.get().Value;
+  value.Datatype = OpcUaType_UInt32;
+  value.ArrayType = OpcUa_VariantArrayType_Array;
+  value.Value.Array.Length = length;
+  value.Value.Array.Value.UInt32Array = values;
+  data_value.get().SourceTimestamp.dwLowDateTime = i;
+  return data_value;
+}
+
+}  // namespace
+
+TEST(ValueStore, WriteRead) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  const auto address_space = MakeAddressSpace();
+  ValueStore store;
+  store.AddVariable(address_space, NodeId{1000});
+
+  const auto index = address_space.GetNodeIndex(NodeId{1000});
+  DataValue data_value;
+  EXPECT_FALSE(store.Read(address_space.GetNodeIndex(NodeId{1001}),
+                          data_value.get()));
+  EXPECT_EQ(OpcUa_BadNodeIdUnknown,
+            store.Write(address_space, NodeId{1001}, data_value.get()).code());
+
+  std::vector<Double> changes;
+  auto item = store.CreateMonitoredItem(index);
+  ASSERT_TRUE(item);
+  item->SubscribeDataChange([&changes](DataValue&& data_value) {
+    changes.push_back(data_value.get().Value.Value.Double);
+  });
+
+  const DataValue level{OpcUa_Good, 2.5, DateTime{}, DateTime{}};
+  ASSERT_TRUE(store.Write(index, level.get()));
+  ASSERT_TRUE(store.Read(index, data_value.get()));
+  EXPECT_EQ(OpcUa_Good, data_value.get().StatusCode);
+  EXPECT_EQ(OpcUaType_Double, data_value.get().Value.Datatype);
+  EXPECT_EQ(2.5, data_value.get().Value.Value.Double);
+
+  // The initial value is reported on subscription.
+  ASSERT_EQ(2, changes.size());
+  EXPECT_EQ(2.5, changes[1]);
+
+  item.reset();
+  ASSERT_TRUE(store.Write(index, level.get()));
+  EXPECT_EQ(2, changes.size());
+}
+
+TEST(ValueStore, ConcurrentWriters) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  const auto address_space = MakeAddressSpace();
+  ValueStore store;
+  store.AddVariable(address_space, NodeId{1000});
+  const auto index = address_space.GetNodeIndex(NodeId{1000});
+
+  std::atomic<bool> done{false};
+  std::thread writer{[&] {
+    for (UInt32 i = 0; i < 10000; ++i) {
+      DataValue data_value{OpcUa_Good, i, DateTime{}, DateTime{}};
+      data_value.get().SourceTimestamp.dwLowDateTime = i;
+      store.Write(index, data_value.get());
+    }
+    done = true;
+  }};
+
+  while (!done) {
+    DataValue data_value;
+    ASSERT_TRUE(store.Read(index, data_value.get()));
+    // The value and the source timestamp always come from the same write.
+    const auto& value = data_value.get();
+    if (value.Value.Datatype != OpcUaType_Null) {
+      EXPECT_EQ(OpcUaType_UInt32, value.Value.Datatype);
+      EXPECT_EQ(value.Value.Value.UInt32, value.SourceTimestamp.dwLowDateTime);
+    }
+  }
+  writer.join();
+}
+
+TEST(ValueStore, HeapValues) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  const auto address_space = MakeAddressSpace();
+  ValueStore store;
+  store.AddVariable(address_space, NodeId{1000});
+  const auto index = address_space.GetNodeIndex(NodeId{1000});
+
+  DataValue data_value;
+  data_value.get().Value.Datatype = OpcUaType_String;
+  String{"running"}.release(data_value.get().Value.Value.String);
+  ASSERT_TRUE(store.Write(index, data_value.get()));
+
+  // Each read gets its own copy of the stored value.
+  DataValue read1;
+  DataValue read2;
+  ASSERT_TRUE(store.Read(index, read1.get()));
+  ASSERT_TRUE(store.Read(index, read2.get()));
+  const auto& string1 = read1.get().Value.Value.String;
+  const auto& string2 = read2.get().Value.Value.String;
+  ASSERT_EQ(OpcUaType_String, read1.get().Value.Datatype);
+  EXPECT_STREQ("running", ::OpcUa_String_GetRawString(&string1));
+  EXPECT_NE(::OpcUa_String_GetRawString(&string1),
+            ::OpcUa_String_GetRawString(&string2));
+
+  ASSERT_TRUE(store.Write(index, MakeArrayValue(6).get()));
+  DataValue array;
+  ASSERT_TRUE(store.Read(index, array.get()));
+  const auto& value = array.get().Value;
+  EXPECT_EQ(OpcUaType_UInt32, value.Datatype);
+  ASSERT_EQ(OpcUa_VariantArrayType_Array, value.ArrayType);
+  ASSERT_EQ(3, value.Value.Array.Length);
+  EXPECT_EQ(6u, value.Value.Array.Value.UInt32Array[0]);
+  EXPECT_EQ(6u, value.Value.Array.Value.UInt32Array[2]);
+  EXPECT_EQ(6u, array.get().SourceTimestamp.dwLowDateTime);
+
+  // Back to an inline value.
+  const DataValue level{OpcUa_Good, 2.5, DateTime{}, DateTime{}};
+  ASSERT_TRUE(store.Write(index, level.get()));
+  DataValue scalar;
+  ASSERT_TRUE(store.Read(index, scalar.get()));
+  EXPECT_EQ(OpcUaType_Double, scalar.get().Value.Datatype);
+  EXPECT_EQ(2.5, scalar.get().Value.Value.Double);
+}
+
+TEST(ValueStore, ConcurrentHeapWriters) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  const auto address_space = MakeAddressSpace();
+  ValueStore store;
+  store.AddVariable(address_space, NodeId{1000});
+  const auto index = address_space.GetNodeIndex(NodeId{1000});
+
+  // Strings and arrays alternate between two writers.
+  std::atomic<int> running{2};
+  const auto write = [&](bool strings) {
+    for (UInt32 i = 0; i < 5000; ++i) {
+      const auto data_value = strings ? MakeStringValue(i) : MakeArrayValue(i);
+      store.Write(index, data_value.get());
+    }
+    --running;
+  };
+  std::thread string_writer{write, true};
+  std::thread array_writer{write, false};
+
+  while (running != 0) {
+    DataValue data_value;
+    ASSERT_TRUE(store.Read(index, data_value.get()));
+    // The value and the source timestamp always come from the same write.
+    const auto& value = data_value.get().Value;
+    const auto i = data_value.get().SourceTimestamp.dwLowDateTime;
+    if (value.Datatype == OpcUaType_String) {
+      EXPECT_EQ("value " + std::to_string(i),
+                ::OpcUa_String_GetRawString(&value.Value.String));
+    } else if (value.Datatype == OpcUaType_UInt32) {
+      ASSERT_EQ(OpcUa_VariantArrayType_Array, value.ArrayType);
+      ASSERT_EQ(static_cast<Int32>(i % 4 + 1), value.Value.Array.Length);
+      for (Int32 j = 0; j < value.Value.Array.Length; ++j)
+        EXPECT_EQ(i, value.Value.Array.Value.UInt32Array[j]);
+    } else {
+      EXPECT_EQ(OpcUaType_Null, value.Datatype);
+    }
+  }
+  string_writer.join();
+  array_writer.join();
+}
+
+}  // namespace server
+}  // namespace opcua
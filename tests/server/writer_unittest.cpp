@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/server/node_set_loader.h>
+#include <opcuapp/server/writer.h>
+#include <opcuapp/string_table.h>
+#include <sstream>
+
+namespace opcua {
+namespace server {
+
+TEST(Writer, Write) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream stream{R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UAVariable NodeId="i=1000" BrowseName="SetPoint1" DataType="i=11" AccessLevel="3" />
+  <UAVariable NodeId="i=1001" BrowseName="SetPoint2" DataType="i=11" AccessLevel="3" />
+  <UAVariable NodeId="i=1002" BrowseName="Level" DataType="i=11" AccessLevel="1" />
+  <UAVariable NodeId="i=1003" BrowseName="Mode" DataType="i=11" AccessLevel="3" />
+  <UAVariable NodeId="i=1004" BrowseName="Speed" DataType="i=11" AccessLevel="3" />
+</UANodeSet>)"};
+
+  NodeAttributes attributes;
+  AddressSpace address_space;
+  address_space.AddNodes(LoadNodeSet(namespace_uris, stream, attributes),
+                         std::move(attributes));
+
+  std::vector<size_t> batch_sizes;
+  const auto plc = std::make_shared<const WriteBackend>(
+      [&batch_sizes](Span<const WriteItem> items,
+                     Span<OpcUa_StatusCode> results) {
+        batch_sizes.push_back(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+          if (items[i].write_value->Value.Value.Value.Double < 0)
+            results[i] = OpcUa_BadOutOfRange;
+        }
+      });
+
+  ValueStore value_store;
+  value_store.AddVariable(address_space, NodeId{1004});
+
+  Writer writer;
+  writer.SetWriteBackend(address_space, NodeId{1000}, plc);
+  writer.SetWriteBackend(address_space, NodeId{1001}, plc);
+  writer.SetValueStore(value_store);
+
+  const struct {
+    UInt32 node;
+    Double value;
+  } items[] = {
+      {1000, 1.0}, {1002, 2.0}, {1001, -1.0}, {1003, 3.0},
+      {1004, 4.0}, {2000, 5.0},
+  };
+
+  WriteRequest request;
+  {
+    Vector<OpcUa_WriteValue> nodes_to_write(std::size(items));
+    for (size_t i = 0; i < nodes_to_write.size(); ++i) {
+      NodeId{items[i].node}.CopyTo(nodes_to_write[i].NodeId);
+      nodes_to_write[i].AttributeId = OpcUa_Attributes_Value;
+      DataValue{OpcUa_Good, items[i].value, DateTime{}, DateTime{}}.release(
+          nodes_to_write[i].Value);
+    }
+    request.NoOfNodesToWrite = static_cast<Int32>(nodes_to_write.size());
+    request.NodesToWrite = nodes_to_write.release();
+  }
+
+  auto response = writer.Write(address_space, request);
+  ASSERT_EQ(OpcUa_Good, response.ResponseHeader.ServiceResult);
+  ASSERT_EQ(6, response.NoOfResults);
+  const auto* results = response.Results;
+
+  // Both PLC values are written in one call.
+  EXPECT_EQ(std::vector<size_t>{2}, batch_sizes);
+  EXPECT_EQ(OpcUa_Good, results[0]);
+  EXPECT_EQ(OpcUa_BadNotWritable, results[1]);
+  EXPECT_EQ(OpcUa_BadOutOfRange, results[2]);
+  EXPECT_EQ(OpcUa_BadNotWritable, results[3]);
+  EXPECT_EQ(OpcUa_Good, results[4]);
+  EXPECT_EQ(OpcUa_BadNodeIdUnknown, results[5]);
+
+  DataValue speed;
+  ASSERT_TRUE(value_store.Read(address_space.GetNodeIndex(NodeId{1004}),
+                               speed.get()));
+  EXPECT_EQ(4.0, speed.get().Value.Value.Double);
+}
+
+TEST(Writer, Validate) {
+  const Platform platform;
+  const ProxyStub proxy_stub_{platform, ProxyStubConfiguration{}};
+
+  StringTable namespace_uris;
+  std::istringstream stream{R"(<?xml version="1.0" encoding="utf-8"?>
+<UANodeSet xmlns="http://opcfoundation.org/UA/2011/03/UANodeSet.xsd">
+  <UADataType NodeId="i=5000" BrowseName="Mode">
+    <References>
+      <Reference ReferenceType="i=45" IsForward="false">i=6</Reference>
+    </References>
+  </UADataType>
+  <UAVariable NodeId="i=1000" BrowseName="Double" DataType="i=11" AccessLevel="3" />
+  <UAVariable NodeId="i=1001" BrowseName="Number" DataType="i=26" AccessLevel="3" />
+  <UAVariable NodeId="i=1002" BrowseName="Mode" DataType="i=5000" AccessLevel="3" />
+  <UAVariable NodeId="i=1003" BrowseName="Array" DataType="i=11" ValueRank="1" AccessLevel="3" />
+  <UAVariable NodeId="i=1004" BrowseName="Locked" DataType="i=11" AccessLevel="3" UserAccessLevel="1" />
+</UANodeSet>)"};
+
+  NodeAttributes attributes;
+  AddressSpace address_space;
+  address_space.AddNodes(LoadNodeSet(namespace_uris, stream, attributes),
+                         std::move(attributes));
+
+  // The Writer keeps the backend alive.
+  Writer writer;
+  const auto backend = std::make_shared<const WriteBackend>(
+      [](Span<const WriteItem> items, Span<OpcUa_StatusCode> results) {});
+  for (UInt32 node = 1000; node <= 1004; ++node)
+    writer.SetWriteBackend(address_space, NodeId{node}, backend);
+
+  const auto write = [&writer, &address_space](UInt32 node, Variant value) {
+    WriteRequest request;
+    Vector<OpcUa_WriteValue> nodes_to_write(1);
+    NodeId{node}.CopyTo(nodes_to_write[0].NodeId);
+    nodes_to_write[0].AttributeId = OpcUa_Attributes_Value;
+    value.release(nodes_to_write[0].Value.Value);
+    request.NoOfNodesToWrite = 1;
+    request.NodesToWrite = nodes_to_write.release();
+    auto response = writer.Write(address_space, request);
+    EXPECT_EQ(1, response.NoOfResults);
+    return response.Results[0];
+  };
+
+  EXPECT_EQ(OpcUa_Good, write(1000, Variant{1.0}));
+  EXPECT_EQ(OpcUa_BadTypeMismatch, write(1000, Variant{Int32{1}}));
+  EXPECT_EQ(OpcUa_Good, write(1000, Variant{}));
+
+  EXPECT_EQ(OpcUa_Good, write(1001, Variant{UInt32{1}}));
+  EXPECT_EQ(OpcUa_BadTypeMismatch, write(1001, Variant{DateTime{}}));
+
+  // Subtypes of Int32 take Int32 values.
+  EXPECT_EQ(OpcUa_Good, write(1002, Variant{Int32{1}}));
+  EXPECT_EQ(OpcUa_BadTypeMismatch, write(1002, Variant{1.0}));
+
+  EXPECT_EQ(OpcUa_BadTypeMismatch, write(1003, Variant{1.0}));
+
+  EXPECT_EQ(OpcUa_BadUserAccessDenied, write(1004, Variant{1.0}));
+}
+
+}  // namespace server
+}  // namespace opcua
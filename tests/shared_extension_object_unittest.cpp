@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/shared_extension_object.h>
+#include <cstring>
+
+namespace opcua {
+
+namespace {
+
+ExtensionObject MakeNotification(UInt32 client_handle) {
+  DataChangeNotification notification;
+  Vector<OpcUa_MonitoredItemNotification> items{1};
+  items[0].ClientHandle = client_handle;
+  items[0].Value.Value.Datatype = OpcUaType_Double;
+  items[0].Value.Value.Value.Double = 1.5;
+  notification.NoOfMonitoredItems = static_cast<Int32>(items.size());
+  notification.MonitoredItems = items.release();
+  return ExtensionObject::Encode(std::move(notification));
+}
+
+}  // namespace
+
+TEST(SharedExtensionObject, SharesBody) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  const SharedExtensionObject shared{MakeNotification(7)};
+  ASSERT_TRUE(shared);
+
+  // Copies share the body and its encoding.
+  const auto copy = shared;
+  EXPECT_EQ(shared, copy);
+  EXPECT_EQ(&*shared, &*copy);
+  EXPECT_NE(shared, SharedExtensionObject{MakeNotification(7)});
+
+  auto* notification = shared->get_if<OpcUa_DataChangeNotification>();
+  ASSERT_TRUE(notification);
+  EXPECT_EQ(7u, notification->MonitoredItems[0].ClientHandle);
+
+  const auto encoded = shared.encoded();
+  EXPECT_FALSE(encoded.empty());
+  EXPECT_EQ(encoded.data(), copy.encoded().data());
+
+  // Deep copies don't share memory with the body.
+  auto deep_copy = shared.Copy();
+  auto* copied = deep_copy.get_if<OpcUa_DataChangeNotification>();
+  ASSERT_TRUE(copied);
+  EXPECT_NE(notification, copied);
+  EXPECT_EQ(7u, copied->MonitoredItems[0].ClientHandle);
+}
+
+TEST(SharedExtensionObject, CopiesEncodedBody) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  auto notification = MakeNotification(3);
+  const auto expected = EncodedSize(notification.get());
+  const SharedExtensionObject shared{std::move(notification)};
+  EXPECT_EQ(expected, shared.encoded().size());
+
+  ExtensionObject target;
+  shared.CopyTo(target.get());
+  EXPECT_EQ(OpcUa_ExtensionObjectEncoding_Binary, target.encoding());
+  EXPECT_EQ(static_cast<UInt32>(
+                OpcUaId_DataChangeNotification_Encoding_DefaultBinary),
+            target.type_id().NodeId.Identifier.Numeric);
+  EXPECT_TRUE(IsValid(target.get()));
+
+  // The encoding of the copy is the same.
+  EXPECT_EQ(expected, EncodedSize(target.get()));
+  const auto encoded = shared.encoded();
+  std::vector<char> copy_encoded;
+  auto context = detail::MakeMessageContext();
+  BinaryWriter{copy_encoded, context}.Write(target.get());
+  EXPECT_EQ(std::vector<char>(encoded.begin(), encoded.end()), copy_encoded);
+}
+
+TEST(SharedExtensionObject, CopiesXmlBody) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  const char xml[] = "<Value>1</Value>";
+  OpcUa_ExtensionObject value;
+  Initialize(value);
+  ExpandedNodeId{UInt32{5000}}.release(value.TypeId);
+  value.Encoding = OpcUa_ExtensionObjectEncoding_Xml;
+  value.Body.Xml = ByteString{xml, sizeof(xml) - 1}.release();
+  value.BodySize = sizeof(xml) - 1;
+  const SharedExtensionObject shared{ExtensionObject{std::move(value)}};
+
+  // Only binary bodies are copied from the encoding.
+  ExtensionObject target;
+  shared.CopyTo(target.get());
+  EXPECT_EQ(OpcUa_ExtensionObjectEncoding_Xml, target.encoding());
+  EXPECT_EQ(5000u, target.type_id().NodeId.Identifier.Numeric);
+  const auto& body = target.get().Body.Xml;
+  ASSERT_EQ(static_cast<Int32>(sizeof(xml) - 1), body.Length);
+  EXPECT_EQ(0, std::memcmp(xml, body.Data, body.Length));
+
+  EXPECT_EQ(EncodedSize(target.get()), shared.encoded().size());
+}
+
+TEST(SharedExtensionObject, Null) {
+  const SharedExtensionObject null_object{ExtensionObject{}};
+  EXPECT_FALSE(null_object);
+  EXPECT_EQ(OpcUa_ExtensionObjectEncoding_None, null_object->encoding());
+  EXPECT_TRUE(null_object.encoded().empty());
+  EXPECT_EQ(SharedExtensionObject{}, null_object);
+}
+
+}  // namespace opcua
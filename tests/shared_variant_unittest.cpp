@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+#include <opcuapp/shared_variant.h>
+
+namespace opcua {
+
+namespace {
+
+Variant MakeDoubleArray(std::initializer_list<Double> values) {
+  Variant result;
+  auto& variant = result.get();
+  variant.Datatype = OpcUaType_Double;
+  variant.ArrayType = OpcUa_VariantArrayType_Array;
+  auto* data = static_cast<Double*>(
+      ::OpcUa_Alloc(static_cast<UInt32>(sizeof(Double) * values.size())));
+  std::copy(values.begin(), values.end(), data);
+  variant.Value.Array.Value.DoubleArray = data;
+  variant.Value.Array.Length = static_cast<Int32>(values.size());
+  return result;
+}
+
+}  // namespace
+
+TEST(SharedVariant, SharedValues) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  auto& pool = SharedVariantPool::Get();
+  const auto pool_size = pool.size();
+
+  {
+    const SharedVariant range1{MakeDoubleArray({0, 100})};
+    const SharedVariant range2{MakeDoubleArray({0, 100})};
+    const SharedVariant other{MakeDoubleArray({0, 50})};
+    EXPECT_EQ(range1, range2);
+    EXPECT_EQ(&*range1, &*range2);
+    EXPECT_NE(range1, other);
+    EXPECT_EQ(pool_size + 2, pool.size());
+    EXPECT_FALSE(range1.encoded().empty());
+
+    // Copies are deep and don't touch the shared value.
+    auto copy = range2.Copy();
+    ASSERT_TRUE(copy.is_array());
+    ASSERT_EQ(2, copy.get().Value.Array.Length);
+    EXPECT_EQ(100, copy.get().Value.Array.Value.DoubleArray[1]);
+    EXPECT_NE(copy.get().Value.Array.Value.DoubleArray,
+              range1->get().Value.Array.Value.DoubleArray);
+  }
+
+  // Released with the last handle.
+  EXPECT_EQ(pool_size, pool.size());
+
+  // Null values are not pooled.
+  const SharedVariant null_value{Variant{}};
+  EXPECT_TRUE(null_value->is_null());
+  EXPECT_TRUE(null_value.encoded().empty());
+  EXPECT_EQ(pool_size, pool.size());
+}
+
+}  // namespace opcua
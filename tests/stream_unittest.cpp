@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <opcuapp/stream.h>
+#include <sstream>
+
+namespace opcua {
+
+TEST(ChunkedOutputStream, WritesAcrossBuffers) {
+  BufferPool pool{4};
+
+  std::string expected;
+  {
+    ChunkedOutputStream stream{pool};
+    for (char c = 'a'; c <= 'j'; ++c) {
+      stream.Write(&c, 1);
+      expected += c;
+    }
+    // A write spanning several buffers.
+    stream.Write("0123456789", 10);
+    expected += "0123456789";
+
+    const auto spans = stream.spans();
+    ASSERT_EQ(5u, spans.size());
+    EXPECT_EQ(4u, spans.front().size());
+    EXPECT_EQ(4u, spans.back().size());
+    EXPECT_EQ(expected.size(), stream.size());
+
+    std::ostringstream output;
+    stream.WriteTo(output);
+    EXPECT_EQ(expected, output.str());
+  }
+
+  // Buffers are returned and reused.
+  EXPECT_EQ(5u, pool.free_count());
+  {
+    ChunkedOutputStream stream{pool};
+    stream.Write("xyz", 3);
+    EXPECT_EQ(4u, pool.free_count());
+  }
+  EXPECT_EQ(5u, pool.free_count());
+}
+
+TEST(ChunkedOutputStream, OverwritesAtPosition) {
+  BufferPool pool{4};
+  ChunkedOutputStream stream{pool};
+  stream.Write("abcdefgh", 8);
+
+  auto& ua_stream = stream.get();
+  ASSERT_EQ(OpcUa_Good, ua_stream.SetPosition(&ua_stream, 3));
+  OpcUa_Byte patch[] = {'X', 'Y'};
+  ASSERT_EQ(OpcUa_Good, ua_stream.Write(&ua_stream, patch, 2));
+  EXPECT_EQ(OpcUa_Bad, ua_stream.SetPosition(&ua_stream, 9));
+
+  std::ostringstream output;
+  stream.WriteTo(output);
+  EXPECT_EQ("abcXYfgh", output.str());
+}
+
+}  // namespace opcua
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <opcuapp/data_value.h>
+#include <opcuapp/platform.h>
+#include <opcuapp/proxy_stub.h>
+
+namespace opcua {
+
+namespace {
+
+template <class T>
+T* AllocateArray(size_t count) {
+  auto* values =
+      static_cast<T*>(::OpcUa_Alloc(static_cast<UInt32>(sizeof(T) * count)));
+  std::memset(values, 0, sizeof(T) * count);
+  return values;
+}
+
+const char* GetRawString(const OpcUa_String& string) {
+  return ::OpcUa_String_GetRawString(&string);
+}
+
+}  // namespace
+
+TEST(Variant, CopiesScalars) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  const Variant int_value{Int32{-5}};
+  const Variant int_copy = int_value;
+  EXPECT_EQ(OpcUaType_Int32, int_copy.data_type());
+  EXPECT_EQ(-5, int_copy.get().Value.Int32);
+
+  Variant string_value;
+  string_value.get().Datatype = OpcUaType_String;
+  String{"text"}.release(string_value.get().Value.String);
+  const Variant string_copy = string_value;
+  EXPECT_STREQ("text", GetRawString(string_copy.get().Value.String));
+  EXPECT_NE(GetRawString(string_value.get().Value.String),
+            GetRawString(string_copy.get().Value.String));
+
+  Variant node_id_value;
+  node_id_value.get().Datatype = OpcUaType_NodeId;
+  node_id_value.get().Value.NodeId = AllocateArray<OpcUa_NodeId>(1);
+  NodeId{String{"node"}, 2}.release(*node_id_value.get().Value.NodeId);
+  const Variant node_id_copy = node_id_value;
+  ASSERT_NE(node_id_value.get().Value.NodeId, node_id_copy.get().Value.NodeId);
+  EXPECT_EQ(*node_id_value.get().Value.NodeId,
+            *node_id_copy.get().Value.NodeId);
+
+  Variant text_value;
+  text_value.get().Datatype = OpcUaType_LocalizedText;
+  text_value.get().Value.LocalizedText = AllocateArray<OpcUa_LocalizedText>(1);
+  String{"label"}.release(text_value.get().Value.LocalizedText->Text);
+  const Variant text_copy = text_value;
+  EXPECT_STREQ("label",
+               GetRawString(text_copy.get().Value.LocalizedText->Text));
+}
+
+TEST(Variant, CopiesArrays) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  Variant strings;
+  strings.get().Datatype = OpcUaType_String;
+  strings.get().ArrayType = OpcUa_VariantArrayType_Array;
+  strings.get().Value.Array.Length = 3;
+  auto* string_array = AllocateArray<OpcUa_String>(3);
+  strings.get().Value.Array.Value.StringArray = string_array;
+  String{"a"}.release(string_array[0]);
+  String{"b"}.release(string_array[2]);
+
+  const Variant strings_copy = strings;
+  ASSERT_TRUE(strings_copy.is_array());
+  ASSERT_EQ(3, strings_copy.get().Value.Array.Length);
+  auto* copied_strings = strings_copy.get().Value.Array.Value.StringArray;
+  EXPECT_NE(string_array, copied_strings);
+  EXPECT_STREQ("a", GetRawString(copied_strings[0]));
+  EXPECT_TRUE(::OpcUa_String_IsNull(&copied_strings[1]));
+  EXPECT_STREQ("b", GetRawString(copied_strings[2]));
+
+  // Variants nested in an array.
+  Variant variants;
+  variants.get().Datatype = OpcUaType_Variant;
+  variants.get().ArrayType = OpcUa_VariantArrayType_Array;
+  variants.get().Value.Array.Length = 2;
+  auto* variant_array = AllocateArray<OpcUa_Variant>(2);
+  variants.get().Value.Array.Value.VariantArray = variant_array;
+  Variant{1.5}.release(variant_array[0]);
+  strings.release(variant_array[1]);
+
+  const Variant variants_copy = variants;
+  auto* copied_variants = variants_copy.get().Value.Array.Value.VariantArray;
+  EXPECT_EQ(1.5, copied_variants[0]);
+  ASSERT_EQ(3, copied_variants[1].Value.Array.Length);
+  EXPECT_STREQ(
+      "b", GetRawString(copied_variants[1].Value.Array.Value.StringArray[2]));
+
+  // Null arrays stay null.
+  Variant null_array;
+  null_array.get().Datatype = OpcUaType_Double;
+  null_array.get().ArrayType = OpcUa_VariantArrayType_Array;
+  null_array.get().Value.Array.Length = -1;
+  const Variant null_array_copy = null_array;
+  EXPECT_EQ(-1, null_array_copy.get().Value.Array.Length);
+  EXPECT_EQ(nullptr, null_array_copy.get().Value.Array.Value.DoubleArray);
+}
+
+TEST(Variant, CopiesMatrices) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  Variant matrix;
+  auto& value = matrix.get();
+  value.Datatype = OpcUaType_Int32;
+  value.ArrayType = OpcUa_VariantArrayType_Matrix;
+  value.Value.Matrix.NoOfDimensions = 2;
+  value.Value.Matrix.Dimensions = AllocateArray<Int32>(2);
+  value.Value.Matrix.Dimensions[0] = 2;
+  value.Value.Matrix.Dimensions[1] = 3;
+  value.Value.Matrix.Value.Int32Array = AllocateArray<Int32>(6);
+  for (Int32 i = 0; i < 6; ++i)
+    value.Value.Matrix.Value.Int32Array[i] = i * 10;
+
+  const Variant copy = matrix;
+  ASSERT_TRUE(copy.is_matrix());
+  auto& copied_matrix = copy.get().Value.Matrix;
+  ASSERT_EQ(2, copied_matrix.NoOfDimensions);
+  EXPECT_NE(value.Value.Matrix.Dimensions, copied_matrix.Dimensions);
+  EXPECT_EQ(3, copied_matrix.Dimensions[1]);
+  EXPECT_NE(value.Value.Matrix.Value.Int32Array,
+            copied_matrix.Value.Int32Array);
+  EXPECT_EQ(50, copied_matrix.Value.Int32Array[5]);
+}
+
+TEST(Variant, RejectsInvalidMatrixDimensions) {
+  Platform platform;
+  ProxyStub proxy_stub{platform, ProxyStubConfiguration{}};
+
+  Variant matrix;
+  auto& value = matrix.get();
+  value.Datatype = OpcUaType_Byte;
+  value.ArrayType = OpcUa_VariantArrayType_Matrix;
+  value.Value.Matrix.NoOfDimensions = 2;
+  value.Value.Matrix.Dimensions = AllocateArray<Int32>(2);
+  value.Value.Matrix.Value.ByteArray = AllocateArray<Byte>(1);
+
+  // The product of the dimensions doesn't fit an Int32.
+  value.Value.Matrix.Dimensions[0] = 0x10000;
+  value.Value.Matrix.Dimensions[1] = 0x10000;
+  EXPECT_THROW(Variant{matrix}, StatusCodeException);
+
+  value.Value.Matrix.Dimensions[0] = -1;
+  value.Value.Matrix.Dimensions[1] = -1;
+  EXPECT_THROW(Variant{matrix}, StatusCodeException);
+
+  value.Value.Matrix.Dimensions[0] = 1;
+  value.Value.Matrix.Dimensions[1] = 1;
+  const Variant copy = matrix;
+  EXPECT_EQ(1, copy.get().Value.Matrix.Dimensions[0]);
+}
+
+}  // namespace opcua
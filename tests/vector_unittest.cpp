@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <opcuapp/string.h>
+#include <opcuapp/vector.h>
+
+namespace opcua {
+
+TEST(Vector, Grows) {
+  Vector<OpcUa_UInt32> vector;
+  EXPECT_EQ(0u, vector.capacity());
+
+  for (OpcUa_UInt32 i = 0; i < 10; ++i)
+    vector.push_back(i);
+  ASSERT_EQ(10u, vector.size());
+  EXPECT_LE(10u, vector.capacity());
+  for (OpcUa_UInt32 i = 0; i < 10; ++i)
+    EXPECT_EQ(i, vector[i]);
+
+  vector.shrink_to_fit();
+  EXPECT_EQ(10u, vector.capacity());
+
+  vector.resize(3);
+  EXPECT_EQ(3u, vector.size());
+  EXPECT_EQ(2u, vector.at(2));
+  vector.resize(5);
+  EXPECT_EQ(0u, vector.at(4));
+
+  vector.clear();
+  EXPECT_TRUE(vector.empty());
+  EXPECT_EQ(10u, vector.capacity());
+  vector.shrink_to_fit();
+  EXPECT_EQ(0u, vector.capacity());
+  EXPECT_EQ(nullptr, vector.data());
+}
+
+TEST(Vector, TakesOverElements) {
+  Vector<OpcUa_String> vector;
+  vector.reserve(2);
+  EXPECT_EQ(2u, vector.capacity());
+
+  String{"first"}.release(vector.emplace_back());
+
+  OpcUa_String second;
+  String{"second"}.release(second);
+  vector.push_back(std::move(second));
+  EXPECT_TRUE(::OpcUa_String_IsNull(&second));
+
+  // Growing relocates the elements.
+  String{"third"}.release(vector.emplace_back());
+  ASSERT_EQ(3u, vector.size());
+  EXPECT_STREQ("first", ::OpcUa_String_GetRawString(&vector[0]));
+  EXPECT_STREQ("third", ::OpcUa_String_GetRawString(&vector[2]));
+
+  // The released block is owned by the caller, as with stack arrays.
+  Int32 count = static_cast<Int32>(vector.size());
+  auto* data = vector.release();
+  EXPECT_EQ(0u, vector.capacity());
+  Vector<OpcUa_String> attached{Attach{}, data, count};
+  EXPECT_EQ(3u, attached.size());
+  EXPECT_STREQ("second", ::OpcUa_String_GetRawString(&attached[1]));
+
+  Vector<OpcUa_String> moved;
+  moved = std::move(attached);
+  EXPECT_EQ(3u, moved.size());
+  EXPECT_TRUE(attached.empty());
+}
+
+}  // namespace opcua